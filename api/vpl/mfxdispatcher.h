@@ -10,6 +10,9 @@
 #include "mfxdefs.h"
 #include "mfxcommon.h"
 #include "mfxsession.h"
+#ifdef ONEVPL_EXPERIMENTAL
+#include "mfxstructures.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -147,6 +150,141 @@ mfxStatus MFX_CDECL MFXCreateSession(mfxLoader loader, mfxU32 i, mfxSession* ses
 */
 mfxStatus MFX_CDECL MFXDispReleaseImplDescription(mfxLoader loader, mfxHDL hdl);
 
+#ifdef ONEVPL_EXPERIMENTAL
+
+/*! The mfxSessionPoolComponent enumerator specifies the component kept initialized in a pooled session. */
+typedef enum {
+    MFX_SESSION_POOL_DECODE = 0, /*!< Decoder initialized with MFXVideoDECODE_Init. */
+    MFX_SESSION_POOL_ENCODE = 1, /*!< Encoder initialized with MFXVideoENCODE_Init. */
+    MFX_SESSION_POOL_VPP    = 2, /*!< VPP initialized with MFXVideoVPP_Init. */
+} mfxSessionPoolComponent;
+
+MFX_PACK_BEGIN_USUAL_STRUCT()
+/*! Specifies the policy of the loader session pool. */
+typedef struct {
+    mfxU32 MaxIdleSessions; /*!< Maximum number of idle sessions kept by the loader. The least recently returned session
+                                 is closed when the pool is full. 0 (default) disables pooling. */
+    mfxU32 IdleTimeout;     /*!< Time in milliseconds after which an idle session is closed. 0 means no timeout. */
+    mfxU32 reserved[6];     /*!< Reserved for future use. */
+} mfxSessionPoolParam;
+MFX_PACK_END()
+
+MFX_PACK_BEGIN_STRUCT_W_L_TYPE()
+/*! Returns statistics of the loader session pool. */
+typedef struct {
+    mfxU64 NumHits;         /*!< Number of checkouts which reused an idle session. */
+    mfxU64 NumMisses;       /*!< Number of checkouts which created a new session. */
+    mfxU64 NumEvictions;    /*!< Number of idle sessions closed because of timeout, pool size or failed reset. */
+    mfxU32 NumIdleSessions; /*!< Number of sessions currently held by the pool. */
+    mfxU32 reserved[5];     /*!< Reserved for future use. */
+} mfxSessionPoolStat;
+MFX_PACK_END()
+
+/*!
+   @brief
+      Sets the session pool policy of the loader. Idle sessions which do not fit the new policy are closed.
+
+   @param[in] loader Loader handle.
+   @param[in] par    Pool policy.
+
+   @return
+      MFX_ERR_NONE        The function completed successfully. \n
+      MFX_ERR_NULL_PTR    If loader or par is NULL.
+
+   @since This function is available since API version 2.6.
+*/
+mfxStatus MFX_CDECL MFXSetSessionPoolParam(mfxLoader loader, const mfxSessionPoolParam *par);
+
+/*!
+   @brief
+      Gets a session with implementation i and the component comp ready to process a stream with parameters par.
+      If the pool holds an idle session which was returned with the same implementation, component and parameters,
+      the component is reset with par and the session is reused. Otherwise a new session is created with
+      MFXCreateSession and the application initializes the component as usual.
+
+   @param[in]  loader Loader handle.
+   @param[in]  i      Index of the implementation, as in MFXCreateSession.
+   @param[in]  comp   Component of the session.
+   @param[in]  par    Stream parameters.
+   @param[out] session Pointer to the session handle.
+   @param[out] reused  Set to 1 if the session was taken from the pool and the component is initialized, 0 otherwise.
+
+   @return
+      MFX_ERR_NONE        The function completed successfully. \n
+      MFX_ERR_NULL_PTR    If loader, par, session or reused is NULL. \n
+      MFX_ERR_NOT_FOUND   Provided index is out of possible range.
+
+   @since This function is available since API version 2.6.
+*/
+mfxStatus MFX_CDECL MFXCheckoutSession(mfxLoader loader,
+                                       mfxU32 i,
+                                       mfxSessionPoolComponent comp,
+                                       mfxVideoParam *par,
+                                       mfxSession *session,
+                                       mfxU16 *reused);
+
+/*!
+   @brief
+      Returns a session to the loader pool instead of closing it. The component comp must stay initialized with par,
+      other components must be closed. The application must not use the session after the call. If pooling is
+      disabled the session is closed with MFXClose.
+
+   @param[in] loader  Loader handle.
+   @param[in] i       Index of the implementation the session was created with.
+   @param[in] comp    Initialized component of the session.
+   @param[in] par     Parameters the component was initialized with.
+   @param[in] session Session handle.
+
+   @return
+      MFX_ERR_NONE        The function completed successfully. \n
+      MFX_ERR_NULL_PTR    If loader, par or session is NULL.
+
+   @since This function is available since API version 2.6.
+*/
+mfxStatus MFX_CDECL MFXReturnSession(mfxLoader loader,
+                                     mfxU32 i,
+                                     mfxSessionPoolComponent comp,
+                                     const mfxVideoParam *par,
+                                     mfxSession session);
+
+/*!
+   @brief
+      Returns statistics of the loader session pool.
+
+   @param[in]  loader Loader handle.
+   @param[out] stat   Pool statistics.
+
+   @return
+      MFX_ERR_NONE        The function completed successfully. \n
+      MFX_ERR_NULL_PTR    If loader or stat is NULL.
+
+   @since This function is available since API version 2.6.
+*/
+mfxStatus MFX_CDECL MFXGetSessionPoolStat(mfxLoader loader, mfxSessionPoolStat *stat);
+
+/*!
+   @brief
+      Writes descriptions of all valid implementations of the loader to a binary caps snapshot file.
+      A loader created while the ONEVPL_CAPS_SNAPSHOT environment variable points to the file serves
+      MFXEnumImplementations and config filters from the snapshot, and a runtime library is loaded only by
+      MFXCreateSession. The snapshot is ignored if it was written by a dispatcher with a different format or
+      if any runtime library was changed since, in which case the loader falls back to the regular search.
+
+   @param[in] loader Loader handle.
+   @param[in] path   Null-terminated path of the snapshot file.
+
+   @return
+      MFX_ERR_NONE        The function completed successfully. \n
+      MFX_ERR_NULL_PTR    If loader or path is NULL. \n
+      MFX_ERR_NOT_FOUND   No implementations found or the file cannot be created. \n
+      MFX_ERR_UNSUPPORTED Descriptions are not available (low latency mode).
+
+   @since This function is available since API version 2.6.
+*/
+mfxStatus MFX_CDECL MFXSaveCapsSnapshot(mfxLoader loader, const mfxChar *path);
+
+#endif
+
 /* Helper macro definitions to add config filter properties. */
 
 /*! Adds single property of mfxU32 type.
@@ -92,6 +92,12 @@ public:
     virtual ~extension_buffer() {}
 
 public:
+    /// @brief Underlying C structure type.
+    typedef T raw_type;
+
+    /// @brief ID of the extension buffer in a form of FourCC code known at compile time.
+    static constexpr uint32_t buffer_ID = ID;
+
     /// @brief Returns ID of the extension buffer in a form of FourCC code.
     /// @return Buffer ID
     uint32_t get_ID() const {
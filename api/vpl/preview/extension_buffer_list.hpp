@@ -6,8 +6,11 @@
 
 #pragma once
 
+#include <array>
 #include <exception>
 #include <map>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "vpl/preview/extension_buffer.hpp"
@@ -300,6 +303,11 @@ class decoder_process_list : public buffer_list {
                                                      std::false_type>::type {};
 
 public:
+    /// @brief Verifies that all types are pointers to the buffers allowed in this list.
+    /// @tparam OptsT Pointers to the extension buffer classes.
+    template <typename... OptsT>
+    using accepts = AllBuffers<OptsT...>;
+
     decoder_process_list() {
         ctor_helper();
     }
@@ -692,6 +700,11 @@ class encoder_process_list : public buffer_list {
                                std::false_type>::type {};
 
 public:
+    /// @brief Verifies that all types are pointers to the buffers allowed in this list.
+    /// @tparam OptsT Pointers to the extension buffer classes.
+    template <typename... OptsT>
+    using accepts = AllBuffers<OptsT...>;
+
     encoder_process_list() {
         ctor_helper();
     }
@@ -942,6 +955,11 @@ class vpp_process_list : public buffer_list {
                                std::false_type>::type {};
 
 public:
+    /// @brief Verifies that all types are pointers to the buffers allowed in this list.
+    /// @tparam OptsT Pointers to the extension buffer classes.
+    template <typename... OptsT>
+    using accepts = AllBuffers<OptsT...>;
+
     vpp_process_list() {
         ctor_helper();
     }
@@ -993,5 +1011,156 @@ protected:
         ctor_helper(Opts...);
     }
 };
+
+/// @brief Fixed-capacity list of extension buffers for the per-frame calls.
+/// Set of buffer types is fixed at compile time, so array of raw pointers is built once at construction
+/// and stays at the same address until the list is destroyed. Passing the list to every
+/// DecodeFrameAsync/EncodeFrameAsync call costs no allocations or map lookups, unlike @p buffer_list.
+/// Buffers are owned by the application and must outlive the list.
+/// @tparam ListT Regular list class which defines allowed buffers, e.g. encoder_process_list.
+/// @tparam BuffersT Extension buffer classes, each buffer ID may appear once.
+template <typename ListT, typename... BuffersT>
+class fixed_buffer_list {
+    static_assert(ListT::template accepts<BuffersT*...>::value,
+                  "Extension buffer isn't allowed in this list");
+
+    template <uint32_t ID>
+    static constexpr std::size_t count_ID() {
+        return ((BuffersT::buffer_ID == ID ? 1 : 0) + ... + 0);
+    }
+
+    static constexpr bool unique_IDs() {
+        return ((count_ID<BuffersT::buffer_ID>() == 1) && ... && true);
+    }
+
+    static_assert(unique_IDs(), "Extension buffer with the same ID is in the list twice");
+
+    // index of the buffer with given ID in the BuffersT pack
+    template <uint32_t ID>
+    static constexpr std::size_t index_of() {
+        constexpr uint32_t ids[] = { BuffersT::buffer_ID..., 0 };
+        std::size_t i            = 0;
+        while (i < sizeof...(BuffersT) && ids[i] != ID)
+            i++;
+        return i;
+    }
+
+public:
+    /// @brief Maximal number of buffers in the list
+    static constexpr std::size_t capacity = sizeof...(BuffersT);
+
+    /// @brief Constructs list. Null pointers are allowed and skipped.
+    /// @param[in] buffers Pointers to the extension buffers.
+    explicit fixed_buffer_list(BuffersT*... buffers) : buffers_(buffers...), raw_(), size_(0) {
+        build_raw();
+    }
+
+    /// @brief Returns number of non-null buffers in the list.
+    /// @return Number of buffers.
+    std::size_t get_size() const {
+        std::size_t n = 0;
+        std::apply(
+            [&n](auto*... b) {
+                n = ((b ? 1 : 0) + ... + 0);
+            },
+            buffers_);
+        return n;
+    }
+
+    /// @brief verifies that list contains given buffer
+    /// @tparam ID extension buffer ID in the form of FourCC code.
+    /// @return true if buffer is in the list and isn't null.
+    template <uint32_t ID>
+    bool has_buffer() const {
+        if constexpr (index_of<ID>() < capacity)
+            return nullptr != std::get<index_of<ID>()>(buffers_);
+        else
+            return false;
+    }
+
+    /// @brief returns extension buffer of given type and ID.
+    /// @tparam T C structure of the extension buffer.
+    /// @tparam ID extension buffer ID in the form of FourCC code.
+    /// @return pointer to the extension buffer or nullptr if that buffer isn't in the list
+    template <typename T, uint32_t ID>
+    T* get_buffer() {
+        if constexpr (index_of<ID>() < capacity) {
+            auto buff = std::get<index_of<ID>()>(buffers_);
+            return buff ? reinterpret_cast<T*>(buff->get_base_ptr()) : nullptr;
+        }
+        else {
+            return nullptr;
+        }
+    }
+
+    /// @brief returns extension buffer object of given class.
+    /// @tparam BufferT extension buffer class.
+    /// @return pointer to the extension buffer object, may be null.
+    template <typename BufferT>
+    BufferT* get() {
+        return std::get<BufferT*>(buffers_);
+    }
+
+    /// @brief replaces extension buffer object of given class. Raw pointers array is updated in place.
+    /// @tparam BufferT extension buffer class.
+    /// @param[in] buffer pointer to the extension buffer, may be null.
+    template <typename BufferT>
+    void set(BufferT* buffer) {
+        std::get<BufferT*>(buffers_) = buffer;
+        build_raw();
+    }
+
+    /// @brief returns pair of array of pointers to the extension buffer and number of buffers.
+    /// Array is owned by the list and isn't reallocated between the calls.
+    /// @return pair of array of pointers to the extension buffer and number of buffers
+    std::pair<mfxExtBuffer**, std::size_t> get_raw_ext_buffers() {
+        return std::pair<mfxExtBuffer**, std::size_t>(size_ ? raw_.data() : nullptr, size_);
+    }
+
+protected:
+    /// @brief Fills array of raw pointers, buffers from ignore list aren't attached.
+    void build_raw() {
+        size_ = 0;
+        std::apply(
+            [this](auto*... b) {
+                (add_raw(b), ...);
+            },
+            buffers_);
+    }
+
+    /// @brief Appends single buffer to the array of raw pointers.
+    /// @param[in] b pointer to the extension buffer
+    template <typename BufferT>
+    void add_raw(BufferT* b) {
+        if (!b)
+            return;
+        for (auto id : ignore_ID_list) {
+            if (BufferT::buffer_ID == id)
+                return;
+        }
+        raw_[size_++] = b->get_base_ptr();
+    }
+
+    /// Pointers to the extension buffers
+    std::tuple<BuffersT*...> buffers_;
+    /// Array of raw pointers to attach to the C structures
+    std::array<mfxExtBuffer*, capacity + 1> raw_;
+    /// Number of valid entries in @p raw_
+    std::size_t size_;
+};
+
+/// @brief Verifies that @p T is a list of extension buffers of @p ListT kind: either @p ListT itself
+/// or fixed_buffer_list based on it.
+/// @tparam ListT Regular list class.
+/// @tparam T Type to check.
+template <typename ListT, typename T>
+struct is_buffer_list_of : std::is_same<ListT, T> {};
+
+/// @brief Specialization for fixed capacity lists.
+/// @tparam ListT Regular list class.
+/// @tparam BuffersT Extension buffer classes.
+template <typename ListT, typename... BuffersT>
+struct is_buffer_list_of<ListT, fixed_buffer_list<ListT, BuffersT...>> : std::true_type {};
+
 } // namespace vpl
 } // namespace oneapi
@@ -11,6 +11,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "vpl/preview/bitstream.hpp"
 #include "vpl/preview/defs.hpp"
@@ -189,8 +190,166 @@ protected:
     }
 };
 
-using future_surface_t   = future<std::shared_ptr<frame_surface>>;
-using future_bitstream_t = future<std::shared_ptr<bitstream_as_dst>>;
+/// @brief This class represents a batch of future data containers produced by a single batched processing call.
+/// Only successfully scheduled outputs are placed into the batch, so it may hold fewer items than the number of
+/// submitted inputs while the component buffers data. Whole batch is synchronized with a single wait call, every
+/// item is synchronized once.
+/// @tparam data frame_surface class or bitstream_as_dst class
+template <typename data,
+          typename = typename std::enable_if<
+              std::is_base_of<std::shared_ptr<frame_surface>, data>::value ||
+              std::is_base_of<std::shared_ptr<bitstream_as_dst>, data>::value>::type>
+class future_batch {
+public:
+    /// @brief Default ctor
+    future_batch() : items_(), synced_(), fatal_happened_(false) {}
+
+    /// @brief Adds scheduled data object to the end of the batch.
+    /// @param[in] future_data Data object to take care about.
+    void push(data future_data) {
+        items_.push_back(future_data);
+        synced_.push_back(false);
+    }
+
+    /// @brief Returns number of data objects in the batch.
+    /// @return Number of data objects.
+    size_t size() const {
+        return items_.size();
+    }
+
+    /// @brief Checks if the batch has no data objects.
+    /// @return true if batch is empty.
+    bool empty() const {
+        return items_.empty();
+    }
+
+    /// @brief Indefinitely waits for completion of all operations in the batch.
+    /// Last item is waited first: once it is ready, remaining items of in-order processing are ready too
+    /// and their synchronization doesn't block.
+    void wait() {
+        if (!have_to_wait())
+            return;
+        if (!items_.empty())
+            wait_item(items_.size() - 1);
+        for (size_t i = 0; i < items_.size(); i++) {
+            wait_item(i);
+        }
+    }
+
+    /// @brief Provides syncronized data. Waits indefinitely for the synchronization of whole batch.
+    /// @return Synchronized data in the submission order.
+    std::vector<data> &get() {
+        wait();
+        return items_;
+    }
+
+    /// @brief Waits for completion of all operations in the batch. Blocks until specified timeout_duration has
+    /// elapsed for the whole batch or all results become available, whichever comes first.
+    /// @param timeout_duration Maximum duration to block for.
+    /// @return Wait status of the first item which is not ready or ready status.
+    template <class Rep, class Period>
+    async_op_status wait_for(const std::chrono::duration<Rep, Period> &timeout_duration) {
+        if (!have_to_wait())
+            return async_op_status::cancelled;
+
+        auto deadline = std::chrono::steady_clock::now() + timeout_duration;
+        auto wait_one = [&](size_t idx) {
+            if (synced_[idx] || !items_[idx])
+                return async_op_status::ready;
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            if (left.count() < 0)
+                left = std::chrono::milliseconds(0);
+            async_op_status s = items_[idx]->wait_for(left);
+            if (async_op_status::ready == s)
+                synced_[idx] = true;
+            return s;
+        };
+
+        if (!items_.empty()) {
+            if (async_op_status s = wait_one(items_.size() - 1); s != async_op_status::ready)
+                return s;
+        }
+        for (size_t i = 0; i < items_.size(); i++) {
+            if (async_op_status s = wait_one(i); s != async_op_status::ready)
+                return s;
+        }
+        return async_op_status::ready;
+    }
+
+    /// @brief Waits for the oldest data object which is not synchronized yet. Used by the producer to free
+    /// processing resources when the device is busy.
+    /// @return false if there is no pending data object in the batch.
+    bool wait_first_pending() {
+        for (size_t i = 0; i < items_.size(); i++) {
+            if (!synced_[i]) {
+                wait_item(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief add batch operation scheduling status into the history of the batch.
+    /// @param[in] op Operation's status
+    void add_operation(operation_status op) {
+        history_.push_back(op);
+        fatal_happened_ = op.fatal_;
+    }
+
+    /// @brief retrieve last operation scheduling status
+    /// @return operation scheduling status
+    status get_last_schedule_status() {
+        return history_.back().schedule_status_;
+    }
+
+    /// @brief Check if fatal error happened.
+    /// @return true if fatal error happened.
+    bool had_fatal() {
+        return fatal_happened_;
+    }
+
+    /// @brief Propagate processing history from previous future object in the pipeline.
+    /// @param old Reference to the previouse future object in the pipeline
+    /// @tparam T Type of the data container
+    template <typename T>
+    void propagate_history(const future<T> &old) {
+        std::for_each(old.history_.rbegin(), old.history_.rend(), [&](operation_status s) {
+            history_.push_front(s);
+        });
+    }
+
+    /// Processing history
+    std::deque<operation_status> history_;
+
+protected:
+    /// @brief Checks if we need to wait for the data. Items of the batch are scheduled successfully even if
+    /// the batch reached end of stream, so only fatal error cancels the wait.
+    /// @return true if wait operation is required.
+    bool have_to_wait() const {
+        return !fatal_happened_;
+    }
+
+    /// @brief Synchronizes single data object if it is not synchronized yet.
+    /// @param[in] idx Index of the data object.
+    void wait_item(size_t idx) {
+        if (!synced_[idx] && items_[idx]) {
+            items_[idx]->wait();
+            synced_[idx] = true;
+        }
+    }
+
+    /// Data containers in the submission order
+    std::vector<data> items_;
+    /// Synchronization flags of the data containers
+    std::vector<bool> synced_;
+    /// Global fatal flag.
+    bool fatal_happened_;
+};
+
+using future_surface_t         = future<std::shared_ptr<frame_surface>>;
+using future_bitstream_t       = future<std::shared_ptr<bitstream_as_dst>>;
+using future_bitstream_batch_t = future_batch<std::shared_ptr<bitstream_as_dst>>;
 
 } // namespace vpl
 } // namespace oneapi
@@ -10,6 +10,7 @@
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <vector>
 
 #include "vpl/preview/defs.hpp"
 #include "vpl/preview/exception.hpp"
@@ -359,10 +360,13 @@ public:
 
     /// @brief Decodes frame
     /// @param[out] out_surface Future object with decoded data.
-    /// @param[in] list List of extension buffers to attach to bitstream.
+    /// @param[in] list List of extension buffers to attach to bitstream. decoder_process_list or
+    /// fixed_buffer_list based on it, the latter attaches buffers without allocations.
     /// @return Ok or warning
-    status decode_frame(std::shared_ptr<frame_surface> out_surface,
-                        decoder_process_list list = {}) {
+    template <typename ListT = decoder_process_list,
+              typename      = std::enable_if_t<
+                  is_buffer_list_of<decoder_process_list, std::decay_t<ListT>>::value>>
+    status decode_frame(std::shared_ptr<frame_surface> out_surface, ListT &&list = {}) {
         mfxSyncPoint syncp;
         mfxFrameSurface1 *surf = NULL;
 
@@ -423,8 +427,10 @@ public:
     /// @brief Decodes frame
     /// @param[in] list List of extension buffers to attach to bitstream
     /// @return Future object with decoded data
-    std::shared_ptr<future<std::shared_ptr<frame_surface>>> process(
-        decoder_process_list list = {}) {
+    template <typename ListT = decoder_process_list,
+              typename      = std::enable_if_t<
+                  is_buffer_list_of<decoder_process_list, std::decay_t<ListT>>::value>>
+    std::shared_ptr<future<std::shared_ptr<frame_surface>>> process(ListT &&list = {}) {
         std::shared_ptr<frame_surface> surface = std::make_shared<frame_surface>();
         std::shared_ptr<future_surface_t> f;
 
@@ -486,7 +492,9 @@ public:
     /// @param[in] sel Implementation selector
     explicit encode_session(const implemetation_selector &sel)
             : session(sel, detail::CAPI<>::Encoder),
-              rdr_(nullptr) {
+              rdr_(nullptr),
+              ctrl_(),
+              last_sp_(nullptr) {
         component_ = component::encoder;
     }
 
@@ -495,7 +503,9 @@ public:
     /// @param[in] rdr Pointer to the raw frame reader
     encode_session(const implemetation_selector &sel, frame_source_reader *rdr)
             : session(sel, detail::CAPI<>::Encoder),
-              rdr_(rdr) {
+              rdr_(rdr),
+              ctrl_(),
+              last_sp_(nullptr) {
         component_ = component::encoder;
     }
 
@@ -533,38 +543,19 @@ public:
     /// @param[out] bs Future object with bitstream portion.
     /// @param[in] list List of extension buffers to use
     /// @return Ok or warning
+    template <typename ListT = encoder_process_list,
+              typename      = std::enable_if_t<
+                  is_buffer_list_of<encoder_process_list, std::decay_t<ListT>>::value>>
     status encode_frame(std::shared_ptr<frame_surface> in_surface,
                         std::shared_ptr<bitstream_as_dst> bs,
-                        encoder_process_list list = {}) {
+                        ListT &&list = {}) {
         mfxSyncPoint sp;
         mfxFrameSurface1 *surf = in_surface.get() ? in_surface.get()->get_raw_ptr() : nullptr;
-        std::shared_ptr<mfxEncodeCtrl> ctrl = nullptr;
-        bool alocated_ctrl                  = false;
+        mfxEncodeCtrl *ctrl    = make_encode_ctrl(list);
 
         if (nullptr == surf) {
             state_ = state::Draining;
         }
-        if(list.get_size() && list.has_buffer<0>()) {
-            ctrl.reset(list.get_buffer<mfxEncodeCtrl, 0>(), [](mfxEncodeCtrl *p) { p = nullptr; });
-            std::cout << "enc ctrl from the list" << std::endl;
-        } else {
-            ctrl = std::make_shared<mfxEncodeCtrl>();
-            *ctrl = {0};
-            alocated_ctrl = true;
-        }
-        
-        // Asumption: Encoder will copy-in all extension buffers.
-        if (auto [buffers, size] = list.get_raw_ext_buffers(); size) {
-            ctrl->ExtParam = buffers;
-            ctrl->NumExtParam = (mfxU16)size;
-        } else {
-            if (alocated_ctrl) {
-                ctrl.reset();
-            } else {
-                ctrl->ExtParam = 0;
-                ctrl->NumExtParam = 0;
-            }
-        }
         detail::c_api_invoker e({ [](mfxStatus s) {
                                     switch (s) {
                                         case MFX_ERR_MORE_DATA:
@@ -580,11 +571,13 @@ public:
                                 } },
                                 MFXVideoENCODE_EncodeFrameAsync,
                                 session_,
-                                ctrl.get(),
+                                ctrl,
                                 surf,
                                 (*bs.get())(),
                                 &sp);
         bs->associate_context({ session_, sp });
+        if (e.sts_ >= MFX_ERR_NONE && e.sts_ != MFX_WRN_DEVICE_BUSY && sp)
+            last_sp_ = sp;
 
         if (e.sts_ == MFX_ERR_MORE_DATA && state_ == state::Draining) {
             state_ = state::Done;
@@ -598,7 +591,10 @@ public:
     /// @param[out] bs Future object with bitstream portion.
     /// @param[in] list List of extension buffers to use
     /// @return Ok or warning
-    status encode_frame(std::shared_ptr<bitstream_as_dst> bs, encoder_process_list list = {}) {
+    template <typename ListT = encoder_process_list,
+              typename      = std::enable_if_t<
+                  is_buffer_list_of<encoder_process_list, std::decay_t<ListT>>::value>>
+    status encode_frame(std::shared_ptr<bitstream_as_dst> bs, ListT &&list = {}) {
         status sts;
         if (!rdr_)
             throw base_exception("NULL reader ptr", MFX_ERR_NULL_PTR);
@@ -641,8 +637,11 @@ public:
     /// @param[in] in_future Future object with the surface from the previous operation.
     /// @param[in] list List of extension buffers to use
     /// @return Future object with the bitstream.
+    template <typename ListT = encoder_process_list,
+              typename      = std::enable_if_t<
+                  is_buffer_list_of<encoder_process_list, std::decay_t<ListT>>::value>>
     std::shared_ptr<future_bitstream_t> process(std::shared_ptr<future_surface_t> in_future,
-                                                encoder_process_list list = {}) {
+                                                ListT &&list = {}) {
         std::shared_ptr<bitstream_as_dst> bits;
         std::shared_ptr<future_bitstream_t> f_out = std::make_shared<future_bitstream_t>(nullptr);
         operation_status op(component_, this);
@@ -683,6 +682,86 @@ public:
         return f_out;
     }
 
+    /// @brief Encodes batch of frames. All frames are submitted with a single encode control built from the list
+    /// and bitstream buffers sized once per batch. Returned batch holds bitstreams only for the frames which
+    /// produced output, so it may be shorter than the input while the encoder buffers frames.
+    /// Null surface in the input drains the encoder, batch is finished with end of stream status then.
+    /// @param[in] surfaces Surfaces to encode in display order.
+    /// @param[in] list List of extension buffers to use for every frame of the batch.
+    /// @return Future object with the batch of bitstreams.
+    template <typename ListT = encoder_process_list,
+              typename      = std::enable_if_t<
+                  is_buffer_list_of<encoder_process_list, std::decay_t<ListT>>::value>>
+    std::shared_ptr<future_bitstream_batch_t> process(
+        const std::vector<std::shared_ptr<frame_surface>> &surfaces,
+        ListT &&list = {}) {
+        std::shared_ptr<future_bitstream_batch_t> f_out =
+            std::make_shared<future_bitstream_batch_t>();
+        operation_status op(component_, this);
+
+        if (state_ == state::Done) {
+            op.schedule_status_ = status::EndOfStreamReached;
+        }
+        else {
+            try {
+                op.schedule_status_ = encode_batch(surfaces, list, *f_out);
+            }
+            catch (base_exception &e) {
+                op.schedule_status_ = mfxstatus_to_onevplstatus(e.get_status());
+                op.fatal_           = true;
+            }
+        }
+
+        f_out->add_operation(op);
+        return f_out;
+    }
+
+    /// @brief Encodes batch of frames delivered by the previous operations in the pipeline. Input futures are
+    /// consumed in order until the first one with fatal status; inputs which didn't deliver data are skipped.
+    /// @param[in] in_futures Future objects with the surfaces from the previous operations.
+    /// @param[in] list List of extension buffers to use for every frame of the batch.
+    /// @return Future object with the batch of bitstreams.
+    template <typename ListT = encoder_process_list,
+              typename      = std::enable_if_t<
+                  is_buffer_list_of<encoder_process_list, std::decay_t<ListT>>::value>>
+    std::shared_ptr<future_bitstream_batch_t> process(
+        const std::vector<std::shared_ptr<future_surface_t>> &in_futures,
+        ListT &&list = {}) {
+        std::vector<std::shared_ptr<frame_surface>> surfaces;
+        std::shared_ptr<future_surface_t> last_future = nullptr;
+        operation_status op(component_, this);
+
+        surfaces.reserve(in_futures.size());
+        for (auto &in_future : in_futures) {
+            std::shared_ptr<frame_surface> in_surface = in_future->get();
+            last_future                               = in_future;
+
+            if (in_future->had_fatal()) {
+                op.schedule_status_ = in_future->get_last_schedule_status();
+                op.fatal_           = true;
+                break;
+            }
+
+            status in_status = in_future->get_last_schedule_status();
+            if (status::Ok == in_status) {
+                surfaces.push_back(in_surface);
+            }
+            else if (status::EndOfStreamReached == in_status) {
+                surfaces.push_back(nullptr);
+                break;
+            }
+        }
+
+        // frames scheduled before the upstream failure are still valid
+        std::shared_ptr<future_bitstream_batch_t> f_out = process(surfaces, list);
+        if (op.fatal_)
+            f_out->add_operation(op);
+
+        if (last_future)
+            f_out->propagate_history(*(last_future.get()));
+        return f_out;
+    }
+
     /// @brief Retrieve encoder statistic
     /// @return Encoder statistic
     std::shared_ptr<encode_stat> getStat() {
@@ -696,8 +775,135 @@ public:
     }
 
 protected:
+    /// @brief Builds encode control structure from the list of extension buffers.
+    /// Control from the list is used as is, otherwise session's own control is reused for every call,
+    /// so no per-frame allocations happen.
+    /// @param[in] list List of extension buffers to use
+    /// @return Encode control or nullptr if list doesn't require it.
+    template <typename ListT>
+    mfxEncodeCtrl *make_encode_ctrl(ListT &list) {
+        mfxEncodeCtrl *ctrl = nullptr;
+
+        if (list.get_size() && list.template has_buffer<0>()) {
+            ctrl = list.template get_buffer<mfxEncodeCtrl, 0>();
+        }
+
+        // Asumption: Encoder will copy-in all extension buffers.
+        if (auto [buffers, size] = list.get_raw_ext_buffers(); size) {
+            if (!ctrl) {
+                ctrl_ = {};
+                ctrl  = &ctrl_;
+            }
+            ctrl->ExtParam    = buffers;
+            ctrl->NumExtParam = (mfxU16)size;
+        }
+        else if (ctrl) {
+            ctrl->ExtParam    = 0;
+            ctrl->NumExtParam = 0;
+        }
+        return ctrl;
+    }
+
+    /// @brief Submits batch of frames to the encoder.
+    /// @param[in] surfaces Surfaces to encode, null surface starts draining.
+    /// @param[in] list List of extension buffers to use
+    /// @param[out] out Batch to put scheduled bitstreams into.
+    /// @return Ok or end of stream. Errors are delivered as exceptions.
+    template <typename ListT>
+    status encode_batch(const std::vector<std::shared_ptr<frame_surface>> &surfaces,
+                        ListT &list,
+                        future_bitstream_batch_t &out) {
+        mfxEncodeCtrl *ctrl = make_encode_ctrl(list);
+        std::shared_ptr<bitstream_as_dst> bits;
+
+        // size output buffers once per batch by the encoder's working parameters
+        mfxVideoParam par = {};
+        uint32_t buffer_size = bitstream::buffer_len::DEFAULT_LENGHT;
+        detail::c_api_invoker p({ [](mfxStatus) { return false; } },
+                                MFXVideoENCODE_GetVideoParam,
+                                session_,
+                                &par);
+        if (MFX_ERR_NONE == p.sts_ && par.mfx.BufferSizeInKB) {
+            buffer_size = (uint32_t)par.mfx.BufferSizeInKB *
+                          std::max<uint32_t>(par.mfx.BRCParamMultiplier, 1) * 1000;
+        }
+
+        for (auto &in_surface : surfaces) {
+            mfxFrameSurface1 *surf = in_surface.get() ? in_surface.get()->get_raw_ptr() : nullptr;
+
+            if (nullptr == surf) {
+                state_ = state::Draining;
+            }
+
+            while (1) {
+                if (!bits) {
+                    bits = std::make_shared<bitstream_as_dst>((codec_format_fourcc)par.mfx.CodecId,
+                                                              buffer_size);
+                }
+
+                mfxSyncPoint sp = nullptr;
+                mfxStatus sts   = MFXVideoENCODE_EncodeFrameAsync(session_,
+                                                                ctrl,
+                                                                surf,
+                                                                (*bits.get())(),
+                                                                &sp);
+                if (MFX_WRN_DEVICE_BUSY == sts) {
+                    // let the oldest frame of the batch complete, or the frames submitted before it
+                    if (!out.wait_first_pending() && !wait_last_submitted())
+                        throw base_exception("Device is busy with no frame in flight",
+                                             MFX_WRN_DEVICE_BUSY);
+                    continue;
+                }
+                if (MFX_ERR_NOT_ENOUGH_BUFFER == sts) {
+                    bits->realloc();
+                    continue;
+                }
+                if (MFX_ERR_MORE_DATA == sts) {
+                    if (state_ == state::Draining) {
+                        state_ = state::Done;
+                        return status::EndOfStreamReached;
+                    }
+                    // frame is buffered, bitstream is reused for the next one
+                    break;
+                }
+                if (sts < MFX_ERR_NONE) {
+                    throw base_exception(sts);
+                }
+
+                if (sp) {
+                    bits->associate_context({ session_, sp });
+                    last_sp_ = sp;
+                    out.push(bits);
+                    bits.reset();
+                }
+
+                if (state_ != state::Draining)
+                    break;
+            }
+        }
+
+        return status::Ok;
+    }
+
+    /// @brief Waits for the last frame submitted to the encoder, so the encoder has free resources again.
+    /// @return false if no frame was submitted yet.
+    bool wait_last_submitted() {
+        if (!last_sp_)
+            return false;
+        detail::c_api_invoker e({ [](mfxStatus) { return false; } },
+                                MFXVideoCORE_SyncOperation,
+                                session_,
+                                last_sp_,
+                                MFX_INFINITE);
+        return true;
+    }
+
     /// @brief Raw freames reader
     frame_source_reader *rdr_;
+    /// @brief Encode control used when the list of extension buffers doesn't provide one
+    mfxEncodeCtrl ctrl_;
+    /// @brief Sync point of the last frame submitted to the encoder
+    mfxSyncPoint last_sp_;
 };
 
 /// @brief Manages VPP's sessions.
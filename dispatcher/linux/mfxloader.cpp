@@ -5,14 +5,17 @@
   ############################################################################*/
 
 #include <assert.h>
+#include <dirent.h>
 #include <dlfcn.h>
 #include <string.h>
 #include <unistd.h>
 
 #include <algorithm>
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -159,6 +162,110 @@ std::shared_ptr<void> make_dlopen(const char *filename, int flags) {
     });
 }
 
+// runtime library with resolved entrypoints, shared by all sessions using it
+struct LibraryCtx {
+    std::shared_ptr<void> dlh;
+    void *table[eFunctionsNum]{};
+    void *table2[eFunctionsNum2]{};
+};
+
+// Process-wide cache of device list and loaded runtimes. Sessions are created
+// and closed often, so only the first session pays for device enumeration,
+// dlopen() and dlsym() of the entrypoints.
+class LoaderCache {
+public:
+    static LoaderCache &Get();
+
+    mfxStatus GetDevices(std::vector<Device> &devices);
+
+    // returns nullptr if library cannot be loaded
+    std::shared_ptr<const LibraryCtx> GetLibrary(const std::string &lib);
+
+private:
+    void UpdateDevices();
+
+    std::mutex m_mutex;
+    bool m_bDevicesValid = false;
+    std::vector<std::string> m_renderNodes;
+    std::vector<Device> m_devices;
+    mfxStatus m_devicesStatus = MFX_ERR_NOT_FOUND;
+    std::map<std::string, std::shared_ptr<const LibraryCtx>> m_libs;
+};
+
+LoaderCache &LoaderCache::Get() {
+    // never destroyed, cached libraries stay loaded until process exit
+    static LoaderCache *cache = new LoaderCache;
+    return *cache;
+}
+
+// device list is re-read only if the set of DRM render nodes has changed
+void LoaderCache::UpdateDevices() {
+    std::vector<std::string> renderNodes;
+
+    DIR *dir = opendir("/sys/class/drm");
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (!strncmp(entry->d_name, "renderD", strlen("renderD")))
+                renderNodes.emplace_back(entry->d_name);
+        }
+        closedir(dir);
+    }
+    std::sort(renderNodes.begin(), renderNodes.end());
+
+    if (m_bDevicesValid && renderNodes == m_renderNodes)
+        return;
+
+    m_renderNodes = std::move(renderNodes);
+    m_devices.clear();
+    m_devicesStatus = get_devices(m_devices);
+    m_bDevicesValid = true;
+
+    // choice of runtime depends on devices, so libraries which failed to load are retried
+    for (auto it = m_libs.begin(); it != m_libs.end();) {
+        if (!it->second)
+            it = m_libs.erase(it);
+        else
+            ++it;
+    }
+}
+
+mfxStatus LoaderCache::GetDevices(std::vector<Device> &devices) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    UpdateDevices();
+    devices = m_devices;
+    return m_devicesStatus;
+}
+
+std::shared_ptr<const LibraryCtx> LoaderCache::GetLibrary(const std::string &lib) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_libs.find(lib);
+    if (it != m_libs.end())
+        return it->second;
+
+    std::shared_ptr<LibraryCtx> libCtx;
+
+    std::shared_ptr<void> hdl = make_dlopen(lib.c_str(), RTLD_LOCAL | RTLD_NOW);
+    if (hdl) {
+        // resolve all entrypoints, required ones are checked against API version on session init
+        libCtx = std::make_shared<LibraryCtx>();
+        for (int i = 0; i < eFunctionsNum; ++i) {
+            assert(i == g_mfxFuncTable[i].id);
+            libCtx->table[i] = dlsym(hdl.get(), g_mfxFuncTable[i].name);
+        }
+        for (int i = 0; i < eFunctionsNum2; ++i) {
+            assert(i == g_mfxFuncTable2[i].id);
+            libCtx->table2[i] = dlsym(hdl.get(), g_mfxFuncTable2[i].name);
+        }
+        libCtx->dlh = std::move(hdl);
+    }
+
+    m_libs[lib] = libCtx;
+    return libCtx;
+}
+
 mfxStatus LoaderCtx::Init(mfxInitParam &par,
                           mfxInitializationParam &vplParam,
                           mfxU16 *pDeviceID,
@@ -173,7 +280,7 @@ mfxStatus LoaderCtx::Init(mfxInitParam &par,
     // if it is found on list of legacy devices, load MSDK RT
     // otherwise load oneVPL RT
     mfxU16 deviceID = 0;
-    mfx_res         = get_devices(devices);
+    mfx_res         = LoaderCache::Get().GetDevices(devices);
     if (mfx_res == MFX_ERR_NOT_FOUND) {
         // query failed
         platform = MFX_HW_UNKNOWN;
@@ -223,14 +330,13 @@ mfxStatus LoaderCtx::Init(mfxInitParam &par,
     mfx_res = MFX_ERR_UNSUPPORTED;
 
     for (auto &lib : libs) {
-        std::shared_ptr<void> hdl = make_dlopen(lib.c_str(), RTLD_LOCAL | RTLD_NOW);
-        if (hdl) {
+        std::shared_ptr<const LibraryCtx> libCtx = LoaderCache::Get().GetLibrary(lib);
+        if (libCtx) {
             do {
                 /* Loading functions table */
                 bool wrong_version = false;
                 for (int i = 0; i < eFunctionsNum; ++i) {
-                    assert(i == g_mfxFuncTable[i].id);
-                    m_table[i] = dlsym(hdl.get(), g_mfxFuncTable[i].name);
+                    m_table[i] = libCtx->table[i];
                     if (!m_table[i] && ((g_mfxFuncTable[i].version <= par.Version))) {
                         wrong_version = true;
                         break;
@@ -240,8 +346,7 @@ mfxStatus LoaderCtx::Init(mfxInitParam &par,
                 // if version >= 2.0, load these functions as well
                 if (par.Version.Major >= 2) {
                     for (int i = 0; i < eFunctionsNum2; ++i) {
-                        assert(i == g_mfxFuncTable2[i].id);
-                        m_table2[i] = dlsym(hdl.get(), g_mfxFuncTable2[i].name);
+                        m_table2[i] = libCtx->table2[i];
                         if (!m_table2[i] && (g_mfxFuncTable2[i].version <= par.Version)) {
                             wrong_version = true;
                             break;
@@ -298,7 +403,7 @@ mfxStatus LoaderCtx::Init(mfxInitParam &par,
             } while (false);
 
             if (MFX_ERR_NONE == mfx_res) {
-                m_dlh = std::move(hdl);
+                m_dlh = libCtx->dlh;
                 break;
             }
             else {
@@ -14,16 +14,6 @@
 #include "src/caps_enc_none.h"
 #include "src/caps_vpp_none.h"
 
-// preferred entrypoint for 2.0 implementations (instead of MFXInitEx)
-mfxStatus MFXInitialize(mfxInitializationParam par, mfxSession *session) {
-    if (!session)
-        return MFX_ERR_NULL_PTR;
-
-    *session = (mfxSession)0x01;
-
-    return MFX_ERR_NONE;
-}
-
 #define NUM_CPU_IMPLS 1
 
 #define NUM_ACCELERATION_MODES_CPU 1
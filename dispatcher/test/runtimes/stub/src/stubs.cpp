@@ -4,80 +4,174 @@
   # SPDX-License-Identifier: MIT
   ############################################################################*/
 
+#include <stdint.h>
+#include <string.h>
+
 #include "vpl/mfx.h"
 
+#include "src/synthetic.h"
+
+// session handle is the synthetic session object, see config.cpp
+static inline SyntheticSession *GetSession(mfxSession session) {
+    return reinterpret_cast<SyntheticSession *>(session);
+}
+
+static inline mfxSyncPoint ToSyncPoint(mfxU64 task) {
+    return task ? reinterpret_cast<mfxSyncPoint>(static_cast<uintptr_t>(task)) : nullptr;
+}
+
+static inline mfxU64 FromSyncPoint(mfxSyncPoint syncp) {
+    return static_cast<mfxU64>(reinterpret_cast<uintptr_t>(syncp));
+}
+
+static mfxStatus CreateSession(mfxSession *session) {
+    if (!session)
+        return MFX_ERR_NULL_PTR;
+
+    SyntheticConfig config;
+    config.ReadEnvironment();
+
+    *session = reinterpret_cast<mfxSession>(new SyntheticSession(config));
+    return MFX_ERR_NONE;
+}
+
 mfxStatus MFXInit(mfxIMPL implParam, mfxVersion *ver, mfxSession *session) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    return CreateSession(session);
 }
 
 mfxStatus MFXInitEx(mfxInitParam par, mfxSession *session) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    return CreateSession(session);
+}
+
+// preferred entrypoint for 2.0 implementations (instead of MFXInitEx)
+mfxStatus MFXInitialize(mfxInitializationParam par, mfxSession *session) {
+    return CreateSession(session);
 }
 
 mfxStatus MFXClose(mfxSession session) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    delete GetSession(session);
+    return MFX_ERR_NONE;
 }
 
 mfxStatus MFXJoinSession(mfxSession session, mfxSession child) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session || !child)
+        return MFX_ERR_INVALID_HANDLE;
+
+    // every session emulates its own device, joined sessions just run in parallel
+    return MFX_ERR_NONE;
 }
 
 mfxStatus MFXDisjoinSession(mfxSession session) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return MFX_ERR_NONE;
 }
 
 mfxStatus MFXCloneSession(mfxSession session, mfxSession *clone) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!clone)
+        return MFX_ERR_NULL_PTR;
+
+    *clone = reinterpret_cast<mfxSession>(new SyntheticSession(GetSession(session)->GetConfig()));
+    return MFX_ERR_NONE;
 }
 
 mfxStatus MFXSetPriority(mfxSession session, mfxPriority priority) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return MFX_ERR_NONE;
 }
 
 mfxStatus MFXGetPriority(mfxSession session, mfxPriority *priority) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!priority)
+        return MFX_ERR_NULL_PTR;
+
+    *priority = MFX_PRIORITY_NORMAL;
+    return MFX_ERR_NONE;
 }
 
 mfxStatus MFXVideoCORE_SetFrameAllocator(mfxSession session, mfxFrameAllocator *allocator) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->SetFrameAllocator(allocator);
 }
 
 mfxStatus MFXVideoCORE_SetHandle(mfxSession session, mfxHandleType type, mfxHDL hdl) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->SetHandle(type, hdl);
 }
 
 mfxStatus MFXVideoCORE_GetHandle(mfxSession session, mfxHandleType type, mfxHDL *hdl) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->GetHandle(type, hdl);
 }
 
 mfxStatus MFXVideoCORE_QueryPlatform(mfxSession session, mfxPlatform *platform) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!platform)
+        return MFX_ERR_NULL_PTR;
+
+    memset(platform, 0, sizeof(*platform));
+    platform->MediaAdapterType = MFX_MEDIA_UNKNOWN;
+    return MFX_ERR_NONE;
 }
 
 mfxStatus MFXVideoCORE_SyncOperation(mfxSession session, mfxSyncPoint syncp, mfxU32 wait) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->SyncOperation(FromSyncPoint(syncp), wait);
 }
 
 mfxStatus MFXVideoDECODE_DecodeHeader(mfxSession session, mfxBitstream *bs, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->DecodeHeader(bs, par);
 }
 
 mfxStatus MFXVideoDECODE_Query(mfxSession session, mfxVideoParam *in, mfxVideoParam *out) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Query(SYNTHETIC_DECODE, in, out);
 }
 
 mfxStatus MFXVideoDECODE_QueryIOSurf(mfxSession session,
                                      mfxVideoParam *par,
                                      mfxFrameAllocRequest *request) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->QueryIOSurf(SYNTHETIC_DECODE, par, request);
 }
 
 mfxStatus MFXVideoDECODE_Init(mfxSession session, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Init(SYNTHETIC_DECODE, par);
 }
 
 mfxStatus MFXVideoDECODE_Close(mfxSession session) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Close(SYNTHETIC_DECODE);
 }
 
 mfxStatus MFXVideoDECODE_DecodeFrameAsync(mfxSession session,
@@ -85,29 +179,62 @@ mfxStatus MFXVideoDECODE_DecodeFrameAsync(mfxSession session,
                                           mfxFrameSurface1 *surface_work,
                                           mfxFrameSurface1 **surface_out,
                                           mfxSyncPoint *syncp) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!syncp)
+        return MFX_ERR_NULL_PTR;
+
+    mfxU64 task   = 0;
+    mfxStatus sts = GetSession(session)->DecodeFrameAsync(bs, surface_work, surface_out, &task);
+    *syncp        = ToSyncPoint(task);
+    return sts;
 }
 
 mfxStatus MFXVideoDECODE_GetVideoParam(mfxSession session, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->GetVideoParam(SYNTHETIC_DECODE, par);
 }
 
 mfxStatus MFXVideoDECODE_Reset(mfxSession session, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Reset(SYNTHETIC_DECODE, par);
 }
 
 mfxStatus MFXVideoDECODE_GetDecodeStat(mfxSession session, mfxDecodeStat *stat) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!stat)
+        return MFX_ERR_NULL_PTR;
+
+    memset(stat, 0, sizeof(*stat));
+    return GetSession(session)->GetFrameCount(SYNTHETIC_DECODE, &stat->NumFrame, nullptr);
 }
 
 mfxStatus MFXVideoDECODE_SetSkipMode(mfxSession session, mfxSkipMode mode) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return MFX_ERR_NONE;
 }
 
 mfxStatus MFXVideoDECODE_GetPayload(mfxSession session, mfxU64 *ts, mfxPayload *payload) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!ts || !payload)
+        return MFX_ERR_NULL_PTR;
+
+    // synthetic streams carry no SEI
+    *ts             = 0;
+    payload->NumBit = 0;
+    return MFX_ERR_NONE;
 }
 
+// decode with fused VPP is not emulated
+
 mfxStatus MFXVideoDECODE_VPP_Init(mfxSession session,
                                   mfxVideoParam *decode_par,
                                   mfxVideoChannelParam **vpp_par_array,
@@ -141,21 +268,33 @@ mfxStatus MFXVideoDECODE_VPP_Close(mfxSession session) {
 }
 
 mfxStatus MFXVideoENCODE_Query(mfxSession session, mfxVideoParam *in, mfxVideoParam *out) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Query(SYNTHETIC_ENCODE, in, out);
 }
 
 mfxStatus MFXVideoENCODE_QueryIOSurf(mfxSession session,
                                      mfxVideoParam *par,
                                      mfxFrameAllocRequest *request) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->QueryIOSurf(SYNTHETIC_ENCODE, par, request);
 }
 
 mfxStatus MFXVideoENCODE_Init(mfxSession session, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Init(SYNTHETIC_ENCODE, par);
 }
 
 mfxStatus MFXVideoENCODE_Close(mfxSession session) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Close(SYNTHETIC_ENCODE);
 }
 
 mfxStatus MFXVideoENCODE_EncodeFrameAsync(mfxSession session,
@@ -163,41 +302,76 @@ mfxStatus MFXVideoENCODE_EncodeFrameAsync(mfxSession session,
                                           mfxFrameSurface1 *surface,
                                           mfxBitstream *bs,
                                           mfxSyncPoint *syncp) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!syncp)
+        return MFX_ERR_NULL_PTR;
+
+    mfxU64 task   = 0;
+    mfxStatus sts = GetSession(session)->EncodeFrameAsync(ctrl, surface, bs, &task);
+    *syncp        = ToSyncPoint(task);
+    return sts;
 }
 
 mfxStatus MFXVideoENCODE_Reset(mfxSession session, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Reset(SYNTHETIC_ENCODE, par);
 }
 
 mfxStatus MFXVideoENCODE_GetVideoParam(mfxSession session, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->GetVideoParam(SYNTHETIC_ENCODE, par);
 }
 
 mfxStatus MFXVideoENCODE_GetEncodeStat(mfxSession session, mfxEncodeStat *stat) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!stat)
+        return MFX_ERR_NULL_PTR;
+
+    memset(stat, 0, sizeof(*stat));
+    return GetSession(session)->GetFrameCount(SYNTHETIC_ENCODE, &stat->NumFrame, &stat->NumBit);
 }
 
 mfxStatus MFXVideoVPP_Query(mfxSession session, mfxVideoParam *in, mfxVideoParam *out) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Query(SYNTHETIC_VPP, in, out);
 }
 
 mfxStatus MFXVideoVPP_QueryIOSurf(mfxSession session,
                                   mfxVideoParam *par,
                                   mfxFrameAllocRequest request[2]) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->QueryIOSurf(SYNTHETIC_VPP, par, request);
 }
 
 mfxStatus MFXVideoVPP_Init(mfxSession session, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Init(SYNTHETIC_VPP, par);
 }
 
 mfxStatus MFXVideoVPP_Close(mfxSession session) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Close(SYNTHETIC_VPP);
 }
 
 mfxStatus MFXVideoVPP_GetVideoParam(mfxSession session, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->GetVideoParam(SYNTHETIC_VPP, par);
 }
 
 mfxStatus MFXVideoVPP_RunFrameVPPAsync(mfxSession session,
@@ -205,38 +379,70 @@ mfxStatus MFXVideoVPP_RunFrameVPPAsync(mfxSession session,
                                        mfxFrameSurface1 *out,
                                        mfxExtVppAuxData *aux,
                                        mfxSyncPoint *syncp) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!syncp)
+        return MFX_ERR_NULL_PTR;
+
+    mfxU64 task   = 0;
+    mfxStatus sts = GetSession(session)->RunFrameVPPAsync(in, out, &task);
+    *syncp        = ToSyncPoint(task);
+    return sts;
 }
 
 mfxStatus MFXVideoVPP_Reset(mfxSession session, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->Reset(SYNTHETIC_VPP, par);
 }
 
 mfxStatus MFXVideoVPP_GetVPPStat(mfxSession session, mfxVPPStat *stat) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!stat)
+        return MFX_ERR_NULL_PTR;
+
+    memset(stat, 0, sizeof(*stat));
+    return GetSession(session)->GetFrameCount(SYNTHETIC_VPP, &stat->NumFrame, nullptr);
 }
 
 mfxStatus MFXVideoVPP_ProcessFrameAsync(mfxSession session,
                                         mfxFrameSurface1 *in,
                                         mfxFrameSurface1 **out) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->ProcessFrameAsync(in, out);
 }
 
 // memory functions are associated with initialized session
 mfxStatus MFXMemory_GetSurfaceForVPP(mfxSession session, mfxFrameSurface1 **surface) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->GetSurface(SYNTHETIC_VPP, surface);
 }
 
 mfxStatus MFXMemory_GetSurfaceForEncode(mfxSession session, mfxFrameSurface1 **surface) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->GetSurface(SYNTHETIC_ENCODE, surface);
 }
 
 mfxStatus MFXMemory_GetSurfaceForDecode(mfxSession session, mfxFrameSurface1 **surface) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->GetSurface(SYNTHETIC_DECODE, surface);
 }
 
 mfxStatus MFXMemory_GetSurfaceForVPPOut(mfxSession session, mfxFrameSurface1 **surface) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+
+    return GetSession(session)->GetSurface(SYNTHETIC_COMPONENTS, surface);
 }
 
 // DLL entry point
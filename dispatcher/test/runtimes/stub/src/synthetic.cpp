@@ -0,0 +1,1083 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "src/synthetic.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#define SYNTHETIC_CONFIG_ENV "ONEVPL_STUB_CONFIG"
+
+// guards reference counters of runtime allocated surfaces, they may outlive the session
+static std::mutex g_surfaceMutex;
+
+static bool IsDeviceFailure(mfxStatus sts) {
+    return MFX_ERR_GPU_HANG == sts || MFX_ERR_DEVICE_FAILED == sts || MFX_ERR_DEVICE_LOST == sts;
+}
+
+static mfxStatus ParseStatus(const std::string &value) {
+    if (value == "gpu_hang")
+        return MFX_ERR_GPU_HANG;
+    else if (value == "device_failed")
+        return MFX_ERR_DEVICE_FAILED;
+    else if (value == "device_lost")
+        return MFX_ERR_DEVICE_LOST;
+    else if (value == "aborted")
+        return MFX_ERR_ABORTED;
+    else if (value == "unknown")
+        return MFX_ERR_UNKNOWN;
+    else
+        return (mfxStatus)strtol(value.c_str(), NULL, 0);
+}
+
+static mfxU32 ParseComponent(const std::string &value) {
+    if (value == "decode")
+        return SYNTHETIC_DECODE;
+    else if (value == "vpp")
+        return SYNTHETIC_VPP;
+    else if (value == "encode")
+        return SYNTHETIC_ENCODE;
+    else
+        return SYNTHETIC_ANY;
+}
+
+SyntheticConfig::SyntheticConfig()
+        : jitter(0),
+          seed(1),
+          asyncDepth(4),
+          refFrames(0),
+          poolSize(0),
+          frameSize(1024),
+          width(1920),
+          height(1080),
+          fps(30),
+          fill(true),
+          error(MFX_ERR_NONE),
+          errorFrame(1),
+          errorOp(SYNTHETIC_ANY) {
+    for (mfxU32 i = 0; i < SYNTHETIC_COMPONENTS; i++)
+        latency[i] = 0;
+}
+
+void SyntheticConfig::ReadEnvironment() {
+    const char *env = getenv(SYNTHETIC_CONFIG_ENV);
+    if (!env)
+        return;
+
+    std::stringstream config(env);
+    std::string item;
+    while (std::getline(config, item, ',')) {
+        size_t pos = item.find('=');
+        if (pos == std::string::npos)
+            continue;
+
+        std::string key   = item.substr(0, pos);
+        std::string value = item.substr(pos + 1);
+        mfxU32 number     = (mfxU32)strtoul(value.c_str(), NULL, 0);
+
+        if (key == "latency_decode")
+            latency[SYNTHETIC_DECODE] = number;
+        else if (key == "latency_vpp")
+            latency[SYNTHETIC_VPP] = number;
+        else if (key == "latency_encode")
+            latency[SYNTHETIC_ENCODE] = number;
+        else if (key == "jitter")
+            jitter = number;
+        else if (key == "seed")
+            seed = number;
+        else if (key == "async_depth")
+            asyncDepth = (mfxU16)std::max(number, 1u);
+        else if (key == "ref_frames")
+            refFrames = (mfxU16)number;
+        else if (key == "pool_size")
+            poolSize = number;
+        else if (key == "frame_size")
+            frameSize = std::max(number, 1u);
+        else if (key == "width")
+            width = (mfxU16)number;
+        else if (key == "height")
+            height = (mfxU16)number;
+        else if (key == "fps")
+            fps = std::max(number, 1u);
+        else if (key == "fill")
+            fill = number != 0;
+        else if (key == "error")
+            error = ParseStatus(value);
+        else if (key == "error_frame")
+            errorFrame = number;
+        else if (key == "error_op")
+            errorOp = ParseComponent(value);
+    }
+}
+
+// sets plane pointers of system memory surface and allocates its buffer
+static mfxStatus AllocSurfaceBuffer(SyntheticSurface *s) {
+    const mfxFrameInfo &info = s->surface.Info;
+    mfxFrameData &data       = s->surface.Data;
+
+    size_t width  = (info.Width + 31) & ~31;
+    size_t height = (info.Height + 31) & ~31;
+    size_t pitch  = 0;
+    size_t size   = 0;
+
+    switch (info.FourCC) {
+        case MFX_FOURCC_NV12:
+        case MFX_FOURCC_IYUV:
+        case MFX_FOURCC_YV12:
+            pitch = width;
+            size  = pitch * height * 3 / 2;
+            break;
+        case MFX_FOURCC_P010:
+            pitch = width * 2;
+            size  = pitch * height * 3 / 2;
+            break;
+        case MFX_FOURCC_YUY2:
+            pitch = width * 2;
+            size  = pitch * height;
+            break;
+        case MFX_FOURCC_RGB4:
+        case MFX_FOURCC_BGR4:
+        case MFX_FOURCC_A2RGB10:
+            pitch = width * 4;
+            size  = pitch * height;
+            break;
+        default:
+            return MFX_ERR_UNSUPPORTED;
+    }
+
+    s->buffer.resize(size);
+    mfxU8 *base    = s->buffer.data();
+    data.PitchHigh = (mfxU16)(pitch >> 16);
+    data.PitchLow  = (mfxU16)(pitch & 0xffff);
+
+    switch (info.FourCC) {
+        case MFX_FOURCC_NV12:
+            data.Y = base;
+            data.U = data.Y + pitch * height;
+            data.V = data.U + 1;
+            break;
+        case MFX_FOURCC_P010:
+            data.Y = base;
+            data.U = data.Y + pitch * height;
+            data.V = data.U + 2;
+            break;
+        case MFX_FOURCC_IYUV:
+            data.Y = base;
+            data.U = data.Y + pitch * height;
+            data.V = data.U + pitch * height / 4;
+            break;
+        case MFX_FOURCC_YV12:
+            data.Y = base;
+            data.V = data.Y + pitch * height;
+            data.U = data.V + pitch * height / 4;
+            break;
+        case MFX_FOURCC_YUY2:
+            data.Y = base;
+            data.U = data.Y + 1;
+            data.V = data.Y + 3;
+            break;
+        case MFX_FOURCC_BGR4:
+            data.R = base;
+            data.G = data.R + 1;
+            data.B = data.R + 2;
+            data.A = data.R + 3;
+            break;
+        default:
+            data.B = base;
+            data.G = data.B + 1;
+            data.R = data.B + 2;
+            data.A = data.B + 3;
+            break;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+// mfxFrameSurfaceInterface of runtime allocated surfaces
+
+static SyntheticSurface *ToSynthetic(mfxFrameSurface1 *surface) {
+    if (!surface->FrameInterface)
+        return NULL;
+    return (SyntheticSurface *)surface->FrameInterface->Context;
+}
+
+static mfxStatus MFX_CDECL SurfaceAddRef(mfxFrameSurface1 *surface) {
+    if (!surface)
+        return MFX_ERR_NULL_PTR;
+
+    SyntheticSurface *s = ToSynthetic(surface);
+    if (!s)
+        return MFX_ERR_INVALID_HANDLE;
+
+    std::lock_guard<std::mutex> lock(g_surfaceMutex);
+    s->refCount++;
+    return MFX_ERR_NONE;
+}
+
+static mfxStatus MFX_CDECL SurfaceRelease(mfxFrameSurface1 *surface) {
+    if (!surface)
+        return MFX_ERR_NULL_PTR;
+
+    SyntheticSurface *s = ToSynthetic(surface);
+    if (!s)
+        return MFX_ERR_INVALID_HANDLE;
+
+    std::lock_guard<std::mutex> lock(g_surfaceMutex);
+    if (!s->refCount)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    // surface returns to the pool, or is destroyed if the pool is gone
+    if (!--s->refCount && !s->session)
+        delete s;
+    return MFX_ERR_NONE;
+}
+
+static mfxStatus MFX_CDECL SurfaceGetRefCounter(mfxFrameSurface1 *surface, mfxU32 *counter) {
+    if (!surface || !counter)
+        return MFX_ERR_NULL_PTR;
+
+    SyntheticSurface *s = ToSynthetic(surface);
+    if (!s)
+        return MFX_ERR_INVALID_HANDLE;
+
+    std::lock_guard<std::mutex> lock(g_surfaceMutex);
+    *counter = s->refCount;
+    return MFX_ERR_NONE;
+}
+
+static mfxStatus MFX_CDECL SurfaceMap(mfxFrameSurface1 *surface, mfxU32 flags) {
+    if (!surface)
+        return MFX_ERR_NULL_PTR;
+
+    // system memory is always mapped
+    return ToSynthetic(surface) ? MFX_ERR_NONE : MFX_ERR_INVALID_HANDLE;
+}
+
+static mfxStatus MFX_CDECL SurfaceUnmap(mfxFrameSurface1 *surface) {
+    if (!surface)
+        return MFX_ERR_NULL_PTR;
+
+    return ToSynthetic(surface) ? MFX_ERR_NONE : MFX_ERR_INVALID_HANDLE;
+}
+
+static mfxStatus MFX_CDECL SurfaceGetNativeHandle(mfxFrameSurface1 *surface,
+                                                  mfxHDL *resource,
+                                                  mfxResourceType *resource_type) {
+    if (!surface || !resource || !resource_type)
+        return MFX_ERR_NULL_PTR;
+
+    return MFX_ERR_UNSUPPORTED;
+}
+
+static mfxStatus MFX_CDECL SurfaceGetDeviceHandle(mfxFrameSurface1 *surface,
+                                                  mfxHDL *device_handle,
+                                                  mfxHandleType *device_type) {
+    if (!surface || !device_handle || !device_type)
+        return MFX_ERR_NULL_PTR;
+
+    return MFX_ERR_UNSUPPORTED;
+}
+
+static mfxStatus MFX_CDECL SurfaceSynchronize(mfxFrameSurface1 *surface, mfxU32 wait) {
+    if (!surface)
+        return MFX_ERR_NULL_PTR;
+
+    SyntheticSurface *s = ToSynthetic(surface);
+    if (!s)
+        return MFX_ERR_INVALID_HANDLE;
+
+    // nothing is pending for surfaces of closed session
+    if (!s->session)
+        return MFX_ERR_NONE;
+
+    return s->session->SyncSurface(s, wait);
+}
+
+static void MFX_CDECL SurfaceOnComplete(mfxStatus sts) {}
+
+// SyntheticSession
+
+SyntheticSession::SyntheticSession(const SyntheticConfig &config)
+        : m_config(config),
+          m_mutex(),
+          m_random(config.seed),
+          m_allocator(),
+          m_handles(),
+          m_numOps(0),
+          m_deviceStatus(MFX_ERR_NONE),
+          m_tasks(),
+          m_failedTasks(),
+          m_nextTask(1),
+          m_surfaceReady(),
+          m_refFrames(),
+          m_surfaces() {
+    for (mfxU32 i = 0; i < SYNTHETIC_COMPONENTS; i++) {
+        m_comp[i].initialized = false;
+        memset(&m_comp[i].par, 0, sizeof(m_comp[i].par));
+        m_comp[i].numSubmitted = 0;
+        m_comp[i].numFrame     = 0;
+        m_comp[i].numBit       = 0;
+        m_comp[i].inFlight     = 0;
+    }
+}
+
+SyntheticSession::~SyntheticSession() {
+    for (mfxU32 i = 0; i < SYNTHETIC_COMPONENTS; i++) {
+        if (m_comp[i].initialized)
+            Close((SyntheticComponent)i);
+    }
+
+    std::lock_guard<std::mutex> lock(g_surfaceMutex);
+    for (SyntheticSurface *s : m_surfaces) {
+        // surfaces still referenced by application are destroyed on their last release
+        if (s->refCount)
+            s->session = NULL;
+        else
+            delete s;
+    }
+}
+
+mfxStatus SyntheticSession::SetFrameAllocator(mfxFrameAllocator *allocator) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (allocator)
+        m_allocator = *allocator;
+    else
+        memset(&m_allocator, 0, sizeof(m_allocator));
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::SetHandle(mfxHandleType type, mfxHDL hdl) {
+    if (!hdl)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_handles.count(type))
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    m_handles[type] = hdl;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::GetHandle(mfxHandleType type, mfxHDL *hdl) {
+    if (!hdl)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_handles.find(type);
+    if (it == m_handles.end())
+        return MFX_ERR_NOT_FOUND;
+
+    *hdl = it->second;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::SyncOperation(mfxU64 task, mfxU32 wait) {
+    if (!task)
+        return MFX_ERR_NULL_PTR;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto it = m_tasks.find(task);
+    if (it == m_tasks.end())
+        return task < m_nextTask ? GetTaskStatus(task) : MFX_ERR_NULL_PTR;
+
+    TimePoint done = it->second.done;
+    if (MFX_INFINITE != wait &&
+        done > std::chrono::steady_clock::now() + std::chrono::milliseconds(wait)) {
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+        return MFX_WRN_IN_EXECUTION;
+    }
+
+    lock.unlock();
+    std::this_thread::sleep_until(done);
+    lock.lock();
+
+    // tasks submitted before and completed by now are retired as well
+    RetireTasks(std::max(done, std::chrono::steady_clock::now()));
+    return GetTaskStatus(task);
+}
+
+mfxStatus SyntheticSession::SyncSurface(SyntheticSurface *surface, mfxU32 wait) {
+    mfxU64 task = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        task = surface->task;
+    }
+
+    return task ? SyncOperation(task, wait) : MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::Query(SyntheticComponent comp, mfxVideoParam *in, mfxVideoParam *out) {
+    if (!out)
+        return MFX_ERR_NULL_PTR;
+
+    mfxExtBuffer **extParam = out->ExtParam;
+    mfxU16 numExtParam      = out->NumExtParam;
+
+    if (in) {
+        *out = *in;
+    }
+    else {
+        // mark configurable parameters
+        memset(out, 0, sizeof(*out));
+        out->AsyncDepth = 1;
+        out->IOPattern  = 1;
+        if (SYNTHETIC_VPP == comp) {
+            out->vpp.In.FourCC  = out->vpp.Out.FourCC = 1;
+            out->vpp.In.Width   = out->vpp.Out.Width = 1;
+            out->vpp.In.Height  = out->vpp.Out.Height = 1;
+        }
+        else {
+            out->mfx.CodecId          = 1;
+            out->mfx.FrameInfo.FourCC = 1;
+            out->mfx.FrameInfo.Width  = 1;
+            out->mfx.FrameInfo.Height = 1;
+        }
+    }
+
+    out->ExtParam    = extParam;
+    out->NumExtParam = numExtParam;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::QueryIOSurf(SyntheticComponent comp,
+                                        mfxVideoParam *par,
+                                        mfxFrameAllocRequest *request) {
+    if (!par || !request)
+        return MFX_ERR_NULL_PTR;
+
+    mfxU16 asyncDepth = par->AsyncDepth ? par->AsyncDepth : m_config.asyncDepth;
+
+    switch (comp) {
+        case SYNTHETIC_DECODE:
+            memset(request, 0, sizeof(*request));
+            request->Info = par->mfx.FrameInfo;
+            request->Type = MFX_MEMTYPE_FROM_DECODE | MFX_MEMTYPE_EXTERNAL_FRAME;
+            request->Type |= (par->IOPattern & MFX_IOPATTERN_OUT_VIDEO_MEMORY)
+                                 ? MFX_MEMTYPE_VIDEO_MEMORY_DECODER_TARGET
+                                 : MFX_MEMTYPE_SYSTEM_MEMORY;
+            // decoder keeps reference frames locked in addition to frames in flight
+            request->NumFrameMin = request->NumFrameSuggested =
+                asyncDepth + m_config.refFrames + 1;
+            break;
+        case SYNTHETIC_ENCODE:
+            memset(request, 0, sizeof(*request));
+            request->Info = par->mfx.FrameInfo;
+            request->Type = MFX_MEMTYPE_FROM_ENCODE | MFX_MEMTYPE_EXTERNAL_FRAME;
+            request->Type |= (par->IOPattern & MFX_IOPATTERN_IN_VIDEO_MEMORY)
+                                 ? MFX_MEMTYPE_VIDEO_MEMORY_DECODER_TARGET
+                                 : MFX_MEMTYPE_SYSTEM_MEMORY;
+            request->NumFrameMin = request->NumFrameSuggested = asyncDepth;
+            break;
+        default:
+            memset(request, 0, 2 * sizeof(*request));
+            request[0].Info = par->vpp.In;
+            request[0].Type = MFX_MEMTYPE_FROM_VPPIN | MFX_MEMTYPE_EXTERNAL_FRAME;
+            request[0].Type |= (par->IOPattern & MFX_IOPATTERN_IN_VIDEO_MEMORY)
+                                   ? MFX_MEMTYPE_VIDEO_MEMORY_PROCESSOR_TARGET
+                                   : MFX_MEMTYPE_SYSTEM_MEMORY;
+            request[0].NumFrameMin = request[0].NumFrameSuggested = asyncDepth;
+
+            request[1].Info = par->vpp.Out;
+            request[1].Type = MFX_MEMTYPE_FROM_VPPOUT | MFX_MEMTYPE_EXTERNAL_FRAME;
+            request[1].Type |= (par->IOPattern & MFX_IOPATTERN_OUT_VIDEO_MEMORY)
+                                   ? MFX_MEMTYPE_VIDEO_MEMORY_PROCESSOR_TARGET
+                                   : MFX_MEMTYPE_SYSTEM_MEMORY;
+            request[1].NumFrameMin = request[1].NumFrameSuggested = asyncDepth;
+            break;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::Init(SyntheticComponent comp, mfxVideoParam *par) {
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Component &c = m_comp[comp];
+    if (c.initialized)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    c.par             = *par;
+    c.par.ExtParam    = NULL;
+    c.par.NumExtParam = 0;
+
+    if (SYNTHETIC_ENCODE == comp) {
+        // application allocates bitstream buffers of this size
+        mfxU16 bufferSizeInKB = (mfxU16)((m_config.frameSize + 999) / 1000);
+        if (c.par.mfx.BufferSizeInKB < bufferSizeInKB)
+            c.par.mfx.BufferSizeInKB = bufferSizeInKB;
+    }
+
+    c.initialized  = true;
+    c.busyUntil    = std::chrono::steady_clock::now();
+    c.lastDone     = c.busyUntil;
+    c.numSubmitted = 0;
+    c.numFrame     = 0;
+    c.numBit       = 0;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::Reset(SyntheticComponent comp, mfxVideoParam *par) {
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    mfxStatus sts = CheckState(comp);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    WaitComponent(lock, comp);
+
+    Component &c      = m_comp[comp];
+    mfxU16 bufferSize = c.par.mfx.BufferSizeInKB;
+    c.par             = *par;
+    c.par.ExtParam    = NULL;
+    c.par.NumExtParam = 0;
+    if (SYNTHETIC_ENCODE == comp && c.par.mfx.BufferSizeInKB < bufferSize)
+        c.par.mfx.BufferSizeInKB = bufferSize;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::Close(SyntheticComponent comp) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (!m_comp[comp].initialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    // like real device, close waits for operations in flight
+    WaitComponent(lock, comp);
+
+    if (SYNTHETIC_DECODE == comp) {
+        for (mfxFrameSurface1 *surface : m_refFrames)
+            UnlockSurface(surface);
+        m_refFrames.clear();
+    }
+
+    m_comp[comp].initialized = false;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::GetVideoParam(SyntheticComponent comp, mfxVideoParam *par) {
+    if (!par)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_comp[comp].initialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    mfxExtBuffer **extParam = par->ExtParam;
+    mfxU16 numExtParam      = par->NumExtParam;
+
+    *par             = m_comp[comp].par;
+    par->ExtParam    = extParam;
+    par->NumExtParam = numExtParam;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::GetFrameCount(SyntheticComponent comp,
+                                          mfxU32 *numFrame,
+                                          mfxU64 *numBit) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_comp[comp].initialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    if (numFrame)
+        *numFrame = m_comp[comp].numFrame;
+    if (numBit)
+        *numBit = m_comp[comp].numBit;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::DecodeHeader(mfxBitstream *bs, mfxVideoParam *par) {
+    if (!bs || !par)
+        return MFX_ERR_NULL_PTR;
+
+    if (!bs->DataLength)
+        return MFX_ERR_MORE_DATA;
+
+    // stream content is not parsed, parameters come from configuration
+    mfxFrameInfo &info = par->mfx.FrameInfo;
+    memset(&info, 0, sizeof(info));
+    info.FourCC        = MFX_FOURCC_NV12;
+    info.ChromaFormat  = MFX_CHROMAFORMAT_YUV420;
+    info.Width         = (m_config.width + 15) & ~15;
+    info.Height        = (m_config.height + 15) & ~15;
+    info.CropW         = m_config.width;
+    info.CropH         = m_config.height;
+    info.FrameRateExtN = m_config.fps;
+    info.FrameRateExtD = 1;
+    info.AspectRatioW  = 1;
+    info.AspectRatioH  = 1;
+    info.PicStruct     = MFX_PICSTRUCT_PROGRESSIVE;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::DecodeFrameAsync(mfxBitstream *bs,
+                                             mfxFrameSurface1 *surface_work,
+                                             mfxFrameSurface1 **surface_out,
+                                             mfxU64 *task) {
+    if (!surface_out || !task)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    mfxStatus sts = CheckState(SYNTHETIC_DECODE);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    RetireTasks(std::chrono::steady_clock::now());
+
+    // no frames are buffered, so draining has nothing to return
+    if (!bs || !bs->DataLength)
+        return MFX_ERR_MORE_DATA;
+
+    // every frame takes frame_size bytes, tail of the stream is the last frame
+    if (bs->DataLength < m_config.frameSize && !(bs->DataFlag & MFX_BITSTREAM_EOS))
+        return MFX_ERR_MORE_DATA;
+
+    Component &c = m_comp[SYNTHETIC_DECODE];
+    if (c.inFlight >= GetAsyncDepth(SYNTHETIC_DECODE))
+        return MFX_WRN_DEVICE_BUSY;
+
+    SyntheticSurface *s = NULL;
+    if (!surface_work) {
+        sts = AllocSurface(SYNTHETIC_DECODE, &s);
+        if (MFX_ERR_NONE != sts)
+            return sts;
+        surface_work = &s->surface;
+    }
+    else if (surface_work->Data.Locked) {
+        return MFX_ERR_MORE_SURFACE;
+    }
+
+    mfxU32 size = std::min(bs->DataLength, m_config.frameSize);
+    bs->DataOffset += size;
+    bs->DataLength -= size;
+
+    surface_work->Data.TimeStamp  = bs->TimeStamp;
+    surface_work->Data.FrameOrder = c.numSubmitted;
+
+    Task t       = {};
+    t.comp       = SYNTHETIC_DECODE;
+    t.status     = MFX_ERR_NONE;
+    t.out        = surface_work;
+    t.frameOrder = c.numSubmitted++;
+    t.timeStamp  = bs->TimeStamp;
+
+    *task = SubmitTask(t);
+    if (s)
+        s->task = *task;
+
+    *surface_out = surface_work;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::RunFrameVPPAsync(mfxFrameSurface1 *in,
+                                             mfxFrameSurface1 *out,
+                                             mfxU64 *task) {
+    if (!task)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    mfxStatus sts = CheckState(SYNTHETIC_VPP);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    RetireTasks(std::chrono::steady_clock::now());
+
+    if (!in)
+        return MFX_ERR_MORE_DATA;
+
+    if (!out)
+        return MFX_ERR_NULL_PTR;
+
+    Component &c = m_comp[SYNTHETIC_VPP];
+    if (c.inFlight >= GetAsyncDepth(SYNTHETIC_VPP))
+        return MFX_WRN_DEVICE_BUSY;
+
+    out->Data.TimeStamp  = in->Data.TimeStamp;
+    out->Data.FrameOrder = in->Data.FrameOrder;
+
+    Task t       = {};
+    t.comp       = SYNTHETIC_VPP;
+    t.status     = MFX_ERR_NONE;
+    t.in         = in;
+    t.out        = out;
+    t.frameOrder = c.numSubmitted++;
+    t.timeStamp  = in->Data.TimeStamp;
+
+    *task = SubmitTask(t);
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::ProcessFrameAsync(mfxFrameSurface1 *in, mfxFrameSurface1 **out) {
+    if (!out)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    mfxStatus sts = CheckState(SYNTHETIC_VPP);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    RetireTasks(std::chrono::steady_clock::now());
+
+    if (!in)
+        return MFX_ERR_MORE_DATA;
+
+    SyntheticSurface *s = NULL;
+    sts                 = AllocSurface(SYNTHETIC_COMPONENTS, &s);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    s->surface.Data.TimeStamp  = in->Data.TimeStamp;
+    s->surface.Data.FrameOrder = in->Data.FrameOrder;
+
+    Component &c = m_comp[SYNTHETIC_VPP];
+    Task t       = {};
+    t.comp       = SYNTHETIC_VPP;
+    t.status     = MFX_ERR_NONE;
+    t.in         = in;
+    t.out        = &s->surface;
+    t.frameOrder = c.numSubmitted++;
+    t.timeStamp  = in->Data.TimeStamp;
+
+    s->task = SubmitTask(t);
+    *out    = &s->surface;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::EncodeFrameAsync(mfxEncodeCtrl *ctrl,
+                                             mfxFrameSurface1 *surface,
+                                             mfxBitstream *bs,
+                                             mfxU64 *task) {
+    if (!bs || !task)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    mfxStatus sts = CheckState(SYNTHETIC_ENCODE);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    RetireTasks(std::chrono::steady_clock::now());
+
+    // no frames are buffered, so draining has nothing to return
+    if (!surface)
+        return MFX_ERR_MORE_DATA;
+
+    if (!bs->Data || bs->MaxLength < bs->DataOffset + bs->DataLength + m_config.frameSize)
+        return MFX_ERR_NOT_ENOUGH_BUFFER;
+
+    Component &c = m_comp[SYNTHETIC_ENCODE];
+    if (c.inFlight >= GetAsyncDepth(SYNTHETIC_ENCODE))
+        return MFX_WRN_DEVICE_BUSY;
+
+    mfxU16 gopPicSize = c.par.mfx.GopPicSize;
+    bool bIntra = gopPicSize ? !(c.numSubmitted % gopPicSize) : !c.numSubmitted;
+
+    Task t       = {};
+    t.comp       = SYNTHETIC_ENCODE;
+    t.status     = MFX_ERR_NONE;
+    t.in         = surface;
+    t.bs         = bs;
+    t.frameOrder = c.numSubmitted++;
+    t.timeStamp  = surface->Data.TimeStamp;
+    t.frameType  = bIntra ? MFX_FRAMETYPE_I | MFX_FRAMETYPE_REF | MFX_FRAMETYPE_IDR
+                          : MFX_FRAMETYPE_P | MFX_FRAMETYPE_REF;
+    if (ctrl && ctrl->FrameType)
+        t.frameType = ctrl->FrameType;
+
+    *task = SubmitTask(t);
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::GetSurface(mfxU32 pool, mfxFrameSurface1 **surface) {
+    if (!surface)
+        return MFX_ERR_NULL_PTR;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    SyntheticComponent comp =
+        (SYNTHETIC_COMPONENTS == pool) ? SYNTHETIC_VPP : (SyntheticComponent)pool;
+    mfxStatus sts = CheckState(comp);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    RetireTasks(std::chrono::steady_clock::now());
+
+    SyntheticSurface *s = NULL;
+    sts                 = AllocSurface(pool, &s);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    *surface = &s->surface;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SyntheticSession::CheckState(SyntheticComponent comp) {
+    if (!m_comp[comp].initialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    return m_deviceStatus;
+}
+
+mfxU64 SyntheticSession::SubmitTask(Task &task) {
+    Component &c = m_comp[task.comp];
+
+    // operation starts when engine is free and input is ready
+    TimePoint start = std::max(std::chrono::steady_clock::now(), c.busyUntil);
+    if (task.in) {
+        auto it = m_surfaceReady.find(task.in);
+        if (it != m_surfaceReady.end())
+            start = std::max(start, it->second);
+    }
+
+    c.busyUntil = start + std::chrono::microseconds(m_config.latency[task.comp]);
+
+    TimePoint done = c.busyUntil;
+    if (m_config.jitter) {
+        std::uniform_int_distribution<mfxU32> jitter(0, m_config.jitter);
+        done += std::chrono::microseconds(jitter(m_random));
+    }
+    done       = std::max(done, c.lastDone);
+    c.lastDone = done;
+    task.done  = done;
+
+    if (SYNTHETIC_ANY == m_config.errorOp || task.comp == (SyntheticComponent)m_config.errorOp) {
+        if (++m_numOps == m_config.errorFrame)
+            task.status = m_config.error;
+    }
+
+    if (task.out)
+        m_surfaceReady[task.out] = done;
+
+    if (task.in)
+        LockSurface(task.in);
+    if (task.out)
+        LockSurface(task.out);
+    c.inFlight++;
+
+    mfxU64 id    = m_nextTask++;
+    m_tasks[id] = task;
+    return id;
+}
+
+void SyntheticSession::CompleteTask(Task &task) {
+    Component &c = m_comp[task.comp];
+    c.inFlight--;
+
+    if (MFX_ERR_NONE == task.status) {
+        if (task.out && m_config.fill)
+            FillSurface(task.out, (mfxU8)task.frameOrder);
+
+        if (task.bs) {
+            mfxBitstream *bs = task.bs;
+            memset(bs->Data + bs->DataOffset + bs->DataLength,
+                   (mfxU8)task.frameOrder,
+                   m_config.frameSize);
+            bs->DataLength += m_config.frameSize;
+            bs->TimeStamp       = task.timeStamp;
+            bs->DecodeTimeStamp = (mfxI64)task.timeStamp;
+            bs->FrameType       = task.frameType;
+            bs->PicStruct       = MFX_PICSTRUCT_PROGRESSIVE;
+            c.numBit += 8 * m_config.frameSize;
+        }
+
+        c.numFrame++;
+    }
+    else if (IsDeviceFailure(task.status)) {
+        m_deviceStatus = task.status;
+    }
+
+    if (task.in)
+        UnlockSurface(task.in);
+
+    if (task.out) {
+        if (SYNTHETIC_DECODE == task.comp && m_config.refFrames) {
+            // decoded frame stays locked as reference for following frames
+            m_refFrames.push_back(task.out);
+            if (m_refFrames.size() > m_config.refFrames) {
+                UnlockSurface(m_refFrames.front());
+                m_refFrames.pop_front();
+            }
+        }
+        else {
+            UnlockSurface(task.out);
+        }
+    }
+}
+
+void SyntheticSession::RetireTasks(TimePoint upTo) {
+    for (auto it = m_tasks.begin(); it != m_tasks.end();) {
+        if (it->second.done > upTo) {
+            ++it;
+            continue;
+        }
+
+        CompleteTask(it->second);
+        if (MFX_ERR_NONE != it->second.status)
+            m_failedTasks[it->first] = it->second.status;
+        it = m_tasks.erase(it);
+    }
+}
+
+mfxStatus SyntheticSession::GetTaskStatus(mfxU64 task) {
+    auto it = m_failedTasks.find(task);
+    if (it == m_failedTasks.end())
+        return MFX_ERR_NONE;
+
+    mfxStatus sts = it->second;
+    m_failedTasks.erase(it);
+    return sts;
+}
+
+void SyntheticSession::WaitComponent(std::unique_lock<std::mutex> &lock, SyntheticComponent comp) {
+    TimePoint done = m_comp[comp].lastDone;
+
+    lock.unlock();
+    std::this_thread::sleep_until(done);
+    lock.lock();
+
+    RetireTasks(std::max(done, std::chrono::steady_clock::now()));
+}
+
+mfxStatus SyntheticSession::AllocSurface(mfxU32 pool, SyntheticSurface **surface) {
+    mfxU32 poolSize = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_surfaceMutex);
+        for (SyntheticSurface *s : m_surfaces) {
+            if (s->pool != pool)
+                continue;
+
+            if (!s->refCount && !s->surface.Data.Locked) {
+                s->refCount = 1;
+                s->task     = 0;
+                *surface    = s;
+                return MFX_ERR_NONE;
+            }
+            poolSize++;
+        }
+    }
+
+    if (m_config.poolSize && poolSize >= m_config.poolSize)
+        return MFX_WRN_ALLOC_TIMEOUT_EXPIRED;
+
+    SyntheticSurface *s        = new SyntheticSurface();
+    s->surface.Version.Version = MFX_FRAMESURFACE1_VERSION;
+    if (SYNTHETIC_VPP == pool)
+        s->surface.Info = m_comp[SYNTHETIC_VPP].par.vpp.In;
+    else if (SYNTHETIC_COMPONENTS == pool)
+        s->surface.Info = m_comp[SYNTHETIC_VPP].par.vpp.Out;
+    else
+        s->surface.Info = m_comp[pool].par.mfx.FrameInfo;
+
+    mfxStatus sts = AllocSurfaceBuffer(s);
+    if (MFX_ERR_NONE != sts) {
+        delete s;
+        return sts;
+    }
+
+    s->iface.Context         = s;
+    s->iface.Version.Version = MFX_FRAMESURFACEINTERFACE_VERSION;
+    s->iface.AddRef          = SurfaceAddRef;
+    s->iface.Release         = SurfaceRelease;
+    s->iface.GetRefCounter   = SurfaceGetRefCounter;
+    s->iface.Map             = SurfaceMap;
+    s->iface.Unmap           = SurfaceUnmap;
+    s->iface.GetNativeHandle = SurfaceGetNativeHandle;
+    s->iface.GetDeviceHandle = SurfaceGetDeviceHandle;
+    s->iface.Synchronize     = SurfaceSynchronize;
+    s->iface.OnComplete      = SurfaceOnComplete;
+
+    s->surface.FrameInterface = &s->iface;
+    s->session                = this;
+    s->pool                   = pool;
+    s->refCount               = 1;
+    s->task                   = 0;
+
+    m_surfaces.push_back(s);
+    *surface = s;
+    return MFX_ERR_NONE;
+}
+
+void SyntheticSession::LockSurface(mfxFrameSurface1 *surface) {
+    surface->Data.Locked++;
+}
+
+void SyntheticSession::UnlockSurface(mfxFrameSurface1 *surface) {
+    if (surface->Data.Locked)
+        surface->Data.Locked--;
+}
+
+void SyntheticSession::FillSurface(mfxFrameSurface1 *surface, mfxU8 value) {
+    const mfxFrameInfo &info = surface->Info;
+    mfxFrameData data        = surface->Data;
+
+    // video memory surfaces are written through application allocator
+    bool bMapped = false;
+    if (!data.Y && !data.B) {
+        if (!m_allocator.Lock || !data.MemId)
+            return;
+        if (MFX_ERR_NONE != m_allocator.Lock(m_allocator.pthis, data.MemId, &data))
+            return;
+        bMapped = true;
+    }
+
+    mfxU8 *base    = NULL;
+    size_t rowSize = 0;
+    switch (info.FourCC) {
+        case MFX_FOURCC_NV12:
+        case MFX_FOURCC_IYUV:
+        case MFX_FOURCC_YV12:
+            base    = data.Y;
+            rowSize = info.Width;
+            break;
+        case MFX_FOURCC_P010:
+        case MFX_FOURCC_YUY2:
+            base    = data.Y;
+            rowSize = 2 * info.Width;
+            break;
+        case MFX_FOURCC_RGB4:
+        case MFX_FOURCC_BGR4:
+        case MFX_FOURCC_A2RGB10:
+            base    = std::min(data.B, data.R);
+            rowSize = 4 * info.Width;
+            break;
+        default:
+            break;
+    }
+
+    size_t pitch = ((size_t)data.PitchHigh << 16) | data.PitchLow;
+    if (base && pitch) {
+        for (mfxU16 row = 0; row < info.Height; row++)
+            memset(base + row * pitch, value, rowSize);
+    }
+
+    if (bMapped)
+        m_allocator.Unlock(m_allocator.pthis, data.MemId, &data);
+}
+
+mfxU16 SyntheticSession::GetAsyncDepth(SyntheticComponent comp) const {
+    mfxU16 asyncDepth = m_comp[comp].par.AsyncDepth;
+    return asyncDepth ? asyncDepth : m_config.asyncDepth;
+}
@@ -0,0 +1,187 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef DISPATCHER_TEST_RUNTIMES_STUB_SRC_SYNTHETIC_H_
+#define DISPATCHER_TEST_RUNTIMES_STUB_SRC_SYNTHETIC_H_
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "vpl/mfx.h"
+
+// Synthetic runtime: every session emulates a device which produces frames and
+// bitstreams with configurable latency, so sample pipelines can be run end to end
+// without a real implementation.
+//
+// Session parameters are read from the ONEVPL_STUB_CONFIG environment variable at
+// session creation, as comma separated key=value pairs:
+//     latency_decode, latency_vpp, latency_encode - time of one operation, us (0)
+//     jitter       - random completion delay added to every operation, us (0)
+//     seed         - seed of jitter generator (1)
+//     async_depth  - tasks in flight per component if AsyncDepth is 0 (4)
+//     ref_frames   - decoded surfaces held locked after completion (0)
+//     pool_size    - max surfaces in every internal pool, 0 - unlimited (0)
+//     frame_size   - bytes of one compressed frame, both decode and encode (1024)
+//     width, height, fps - stream parameters returned by DecodeHeader (1920, 1080, 30)
+//     fill         - write pattern into output surfaces (1)
+//     error        - status injected into the error_frame'th operation, either
+//                    a number or gpu_hang, device_failed, device_lost, aborted, unknown
+//     error_frame  - 1-based index of the operation failed with error (1)
+//     error_op     - decode, vpp, encode or any (any)
+// Device failures (gpu_hang, device_failed, device_lost) are sticky: all following
+// operations of the session fail with the same status.
+
+enum SyntheticComponent {
+    SYNTHETIC_DECODE = 0,
+    SYNTHETIC_VPP,
+    SYNTHETIC_ENCODE,
+    SYNTHETIC_COMPONENTS,
+
+    SYNTHETIC_ANY = SYNTHETIC_COMPONENTS,
+};
+
+struct SyntheticConfig {
+    SyntheticConfig();
+
+    // parses ONEVPL_STUB_CONFIG, unknown keys are ignored
+    void ReadEnvironment();
+
+    mfxU32 latency[SYNTHETIC_COMPONENTS];
+    mfxU32 jitter;
+    mfxU32 seed;
+    mfxU16 asyncDepth;
+    mfxU16 refFrames;
+    mfxU32 poolSize;
+    mfxU32 frameSize;
+    mfxU16 width;
+    mfxU16 height;
+    mfxU32 fps;
+    bool fill;
+    mfxStatus error;
+    mfxU32 errorFrame;
+    mfxU32 errorOp;
+};
+
+class SyntheticSession;
+
+// surface allocated by runtime for 2.x memory model
+struct SyntheticSurface {
+    mfxFrameSurface1 surface;
+    mfxFrameSurfaceInterface iface;
+
+    SyntheticSession *session; // NULL when session was closed before surface release
+    mfxU32 pool;
+    mfxU32 refCount;
+    mfxU64 task; // last task writing the surface
+    std::vector<mfxU8> buffer;
+};
+
+class SyntheticSession {
+public:
+    explicit SyntheticSession(const SyntheticConfig &config);
+    ~SyntheticSession();
+
+    const SyntheticConfig &GetConfig() const {
+        return m_config;
+    }
+
+    mfxStatus SetFrameAllocator(mfxFrameAllocator *allocator);
+    mfxStatus SetHandle(mfxHandleType type, mfxHDL hdl);
+    mfxStatus GetHandle(mfxHandleType type, mfxHDL *hdl);
+    mfxStatus SyncOperation(mfxU64 task, mfxU32 wait);
+    mfxStatus SyncSurface(SyntheticSurface *surface, mfxU32 wait);
+
+    mfxStatus Query(SyntheticComponent comp, mfxVideoParam *in, mfxVideoParam *out);
+    mfxStatus QueryIOSurf(SyntheticComponent comp,
+                          mfxVideoParam *par,
+                          mfxFrameAllocRequest *request);
+    mfxStatus Init(SyntheticComponent comp, mfxVideoParam *par);
+    mfxStatus Reset(SyntheticComponent comp, mfxVideoParam *par);
+    mfxStatus Close(SyntheticComponent comp);
+    mfxStatus GetVideoParam(SyntheticComponent comp, mfxVideoParam *par);
+    mfxStatus GetFrameCount(SyntheticComponent comp, mfxU32 *numFrame, mfxU64 *numBit);
+
+    mfxStatus DecodeHeader(mfxBitstream *bs, mfxVideoParam *par);
+    mfxStatus DecodeFrameAsync(mfxBitstream *bs,
+                               mfxFrameSurface1 *surface_work,
+                               mfxFrameSurface1 **surface_out,
+                               mfxU64 *task);
+    mfxStatus RunFrameVPPAsync(mfxFrameSurface1 *in, mfxFrameSurface1 *out, mfxU64 *task);
+    mfxStatus ProcessFrameAsync(mfxFrameSurface1 *in, mfxFrameSurface1 **out);
+    mfxStatus EncodeFrameAsync(mfxEncodeCtrl *ctrl,
+                               mfxFrameSurface1 *surface,
+                               mfxBitstream *bs,
+                               mfxU64 *task);
+
+    // pool is SyntheticComponent for input surfaces, SYNTHETIC_COMPONENTS for VPP output
+    mfxStatus GetSurface(mfxU32 pool, mfxFrameSurface1 **surface);
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct Task {
+        SyntheticComponent comp;
+        TimePoint done;
+        mfxStatus status;
+        mfxFrameSurface1 *in; // unlocked on completion
+        mfxFrameSurface1 *out; // filled and unlocked on completion
+        mfxBitstream *bs; // receives compressed frame on completion
+        mfxU32 frameOrder;
+        mfxU64 timeStamp;
+        mfxU16 frameType;
+    };
+
+    struct Component {
+        bool initialized;
+        mfxVideoParam par;
+        TimePoint busyUntil; // engine is busy with previous operations
+        TimePoint lastDone; // operations of one component complete in order
+        mfxU32 numSubmitted;
+        mfxU32 numFrame;
+        mfxU64 numBit;
+        mfxU32 inFlight;
+    };
+
+    mfxStatus CheckState(SyntheticComponent comp);
+    mfxU64 SubmitTask(Task &task);
+    void CompleteTask(Task &task);
+    void RetireTasks(TimePoint upTo);
+    mfxStatus GetTaskStatus(mfxU64 task);
+    void WaitComponent(std::unique_lock<std::mutex> &lock, SyntheticComponent comp);
+    mfxStatus AllocSurface(mfxU32 pool, SyntheticSurface **surface);
+    void LockSurface(mfxFrameSurface1 *surface);
+    void UnlockSurface(mfxFrameSurface1 *surface);
+    void FillSurface(mfxFrameSurface1 *surface, mfxU8 value);
+    mfxU16 GetAsyncDepth(SyntheticComponent comp) const;
+
+    SyntheticConfig m_config;
+    std::mutex m_mutex;
+    std::mt19937 m_random;
+
+    mfxFrameAllocator m_allocator;
+    std::map<mfxHandleType, mfxHDL> m_handles;
+
+    Component m_comp[SYNTHETIC_COMPONENTS];
+    mfxU32 m_numOps; // operations counted for error injection
+    mfxStatus m_deviceStatus; // sticky device failure
+
+    std::map<mfxU64, Task> m_tasks;
+    std::map<mfxU64, mfxStatus> m_failedTasks; // failed tasks retired before sync
+    mfxU64 m_nextTask;
+
+    std::map<mfxFrameSurface1 *, TimePoint> m_surfaceReady;
+    std::deque<mfxFrameSurface1 *> m_refFrames;
+    std::vector<SyntheticSurface *> m_surfaces;
+
+    SyntheticSession(const SyntheticSession &);
+    SyntheticSession &operator=(const SyntheticSession &);
+};
+
+#endif // DISPATCHER_TEST_RUNTIMES_STUB_SRC_SYNTHETIC_H_
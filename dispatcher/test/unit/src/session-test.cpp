@@ -11,7 +11,36 @@
 
 #include <gtest/gtest.h>
 
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+    #include <dlfcn.h>
+    #include <string.h>
+#endif
+
 #include "vpl/mfxdispatcher.h"
+#include "vpl/mfxvideo.h"
+
+#if defined(__linux__)
+static std::atomic<int> g_stubRuntimeOpens(0);
+
+// Counts loads of the stub runtime library by the dispatcher. The test executable interposes
+// dlopen() of libvpl, calls are forwarded to the system one.
+extern "C" void *dlopen(const char *filename, int flags) noexcept {
+    typedef void *(*dlopen_t)(const char *, int);
+    static dlopen_t systemDlopen = (dlopen_t)dlsym(RTLD_NEXT, "dlopen");
+
+    if (filename && strstr(filename, "vplstubrt"))
+        g_stubRuntimeOpens++;
+    return systemDlopen(filename, flags);
+}
+#endif
 
 TEST(CreateSession, SucceedsWithStubImpl) {
     mfxLoader loader = MFXLoad();
@@ -37,3 +66,161 @@ TEST(CreateSession, SucceedsWithStubImpl) {
     EXPECT_EQ(sts, MFX_ERR_NONE) << "MFXCreateSession failed with code " << sts;
     MFXUnload(loader);
 }
+
+TEST(CreateSession, RepeatedCreateCloseSucceeds) {
+    mfxLoader loader = MFXLoad();
+    ASSERT_NE(loader, nullptr) << "MFXLoad() returned null - no libraries found ";
+
+    // the first session loads runtime library, unless another test has done it already
+    mfxSession session = NULL;
+    mfxStatus sts      = MFXCreateSession(loader, 0, &session);
+    ASSERT_EQ(sts, MFX_ERR_NONE) << "MFXCreateSession failed with code " << sts;
+    sts = MFXClose(session);
+    ASSERT_EQ(sts, MFX_ERR_NONE) << "MFXClose failed with code " << sts;
+
+#if defined(__linux__)
+    g_stubRuntimeOpens = 0;
+#endif
+
+    // runtime library and entrypoints are loaded once and reused by following sessions
+    for (int i = 0; i < 16; i++) {
+        sts = MFXCreateSession(loader, 0, &session);
+        ASSERT_EQ(sts, MFX_ERR_NONE) << "MFXCreateSession failed with code " << sts;
+        sts = MFXClose(session);
+        ASSERT_EQ(sts, MFX_ERR_NONE) << "MFXClose failed with code " << sts;
+    }
+#if defined(__linux__)
+    EXPECT_EQ(0, g_stubRuntimeOpens.load()) << "runtime library was loaded again";
+#endif
+    MFXUnload(loader);
+}
+
+#ifdef ONEVPL_EXPERIMENTAL
+TEST(CreateSession, ReturnedSessionIsReused) {
+    mfxLoader loader = MFXLoad();
+    ASSERT_NE(loader, nullptr) << "MFXLoad() returned null - no libraries found ";
+
+    mfxSessionPoolParam poolPar = {};
+    poolPar.MaxIdleSessions     = 1;
+    ASSERT_EQ(MFX_ERR_NONE, MFXSetSessionPoolParam(loader, &poolPar));
+
+    mfxVideoParam par        = {};
+    par.mfx.CodecId          = MFX_CODEC_AVC;
+    par.mfx.FrameInfo.FourCC = MFX_FOURCC_NV12;
+    par.mfx.FrameInfo.Width  = 320;
+    par.mfx.FrameInfo.Height = 240;
+    par.IOPattern            = MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
+
+    // first job creates the session, following jobs reuse it
+    mfxSession first = NULL;
+    for (int i = 0; i < 3; i++) {
+        mfxSession session = NULL;
+        mfxU16 reused      = 0;
+        mfxStatus sts =
+            MFXCheckoutSession(loader, 0, MFX_SESSION_POOL_DECODE, &par, &session, &reused);
+        ASSERT_EQ(sts, MFX_ERR_NONE) << "MFXCheckoutSession failed with code " << sts;
+        if (i == 0) {
+            EXPECT_EQ(0, reused);
+            ASSERT_EQ(MFX_ERR_NONE, MFXVideoDECODE_Init(session, &par));
+            first = session;
+        }
+        else {
+            EXPECT_EQ(1, reused);
+            EXPECT_EQ(first, session);
+        }
+        ASSERT_EQ(MFX_ERR_NONE,
+                  MFXReturnSession(loader, 0, MFX_SESSION_POOL_DECODE, &par, session));
+    }
+
+    // different stream parameters miss the pool
+    mfxVideoParam otherPar       = par;
+    otherPar.mfx.FrameInfo.Width = 640;
+    mfxSession other             = NULL;
+    mfxU16 reused                = 0;
+    ASSERT_EQ(MFX_ERR_NONE,
+              MFXCheckoutSession(loader, 0, MFX_SESSION_POOL_DECODE, &otherPar, &other, &reused));
+    EXPECT_EQ(0, reused);
+    EXPECT_EQ(MFX_ERR_NONE, MFXClose(other));
+
+    mfxSessionPoolStat stat = {};
+    ASSERT_EQ(MFX_ERR_NONE, MFXGetSessionPoolStat(loader, &stat));
+    EXPECT_EQ(2u, stat.NumHits);
+    EXPECT_EQ(2u, stat.NumMisses);
+    EXPECT_EQ(0u, stat.NumEvictions);
+    EXPECT_EQ(1u, stat.NumIdleSessions);
+
+    // idle timeout closes the pooled session
+    poolPar.IdleTimeout = 1;
+    ASSERT_EQ(MFX_ERR_NONE, MFXSetSessionPoolParam(loader, &poolPar));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(MFX_ERR_NONE, MFXGetSessionPoolStat(loader, &stat));
+    EXPECT_EQ(1u, stat.NumEvictions);
+    EXPECT_EQ(0u, stat.NumIdleSessions);
+
+    MFXUnload(loader);
+}
+
+static void SetEnv(const char *name, const char *value) {
+    #if defined(_WIN32) || defined(_WIN64)
+    _putenv_s(name, value ? value : "");
+    #else
+    if (value)
+        setenv(name, value, 1);
+    else
+        unsetenv(name);
+    #endif
+}
+
+TEST(CreateSession, SucceedsFromCapsSnapshot) {
+    const char *snapshotFile = "vpl-caps-snapshot.bin";
+
+    mfxLoader loader = MFXLoad();
+    ASSERT_NE(loader, nullptr) << "MFXLoad() returned null - no libraries found ";
+    mfxStatus sts = MFXSaveCapsSnapshot(loader, snapshotFile);
+    ASSERT_EQ(sts, MFX_ERR_NONE) << "MFXSaveCapsSnapshot failed with code " << sts;
+
+    mfxImplDescription *idesc = nullptr;
+    ASSERT_EQ(MFX_ERR_NONE,
+              MFXEnumImplementations(loader,
+                                     0,
+                                     MFX_IMPLCAPS_IMPLDESCSTRUCTURE,
+                                     reinterpret_cast<mfxHDL *>(&idesc)));
+    std::string implName(idesc->ImplName);
+    mfxU16 numDecoders = idesc->Dec.NumCodecs;
+    MFXDispReleaseImplDescription(loader, idesc);
+    MFXUnload(loader);
+
+    // libraries are not searched when the snapshot is used
+    const char *searchPath = getenv("ONEVPL_SEARCH_PATH");
+    std::string savedSearchPath(searchPath ? searchPath : "");
+    SetEnv("ONEVPL_SEARCH_PATH", "/nonexistent");
+    SetEnv("ONEVPL_CAPS_SNAPSHOT", snapshotFile);
+
+    loader = MFXLoad();
+    ASSERT_NE(loader, nullptr);
+
+    idesc = nullptr;
+    sts   = MFXEnumImplementations(loader,
+                                 0,
+                                 MFX_IMPLCAPS_IMPLDESCSTRUCTURE,
+                                 reinterpret_cast<mfxHDL *>(&idesc));
+    EXPECT_EQ(sts, MFX_ERR_NONE) << "MFXEnumImplementations failed with code " << sts;
+    if (idesc) {
+        EXPECT_EQ(implName, idesc->ImplName);
+        EXPECT_EQ(numDecoders, idesc->Dec.NumCodecs);
+        MFXDispReleaseImplDescription(loader, idesc);
+    }
+
+    mfxSession session = NULL;
+    sts                = MFXCreateSession(loader, 0, &session);
+    EXPECT_EQ(sts, MFX_ERR_NONE) << "MFXCreateSession failed with code " << sts;
+    if (session) {
+        EXPECT_EQ(MFX_ERR_NONE, MFXClose(session));
+    }
+    MFXUnload(loader);
+
+    SetEnv("ONEVPL_CAPS_SNAPSHOT", nullptr);
+    SetEnv("ONEVPL_SEARCH_PATH", searchPath ? savedSearchPath.c_str() : nullptr);
+    remove(snapshotFile);
+}
+#endif
@@ -0,0 +1,194 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+///
+/// Unit tests for synthetic stub runtime.
+///
+/// @file
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "src/unit_api.h"
+
+static void SetStubConfig(const char *config) {
+#if defined(_WIN32) || defined(_WIN64)
+    _putenv_s("ONEVPL_STUB_CONFIG", config ? config : "");
+#else
+    if (config)
+        setenv("ONEVPL_STUB_CONFIG", config, 1);
+    else
+        unsetenv("ONEVPL_STUB_CONFIG");
+#endif
+}
+
+// creates session on stub runtime with given synthetic configuration
+static mfxSession CreateStubSession(mfxLoader loader, const char *config) {
+    mfxConfig cfg = MFXCreateConfig(loader);
+
+    mfxVariant vendorImplID;
+    vendorImplID.Type     = MFX_VARIANT_TYPE_U32;
+    vendorImplID.Data.U32 = 0xFFFF;
+    MFXSetConfigFilterProperty(cfg, (const mfxU8 *)"mfxImplDescription.VendorImplID", vendorImplID);
+
+    SetStubConfig(config);
+    mfxSession session = nullptr;
+    mfxStatus sts      = MFXCreateSession(loader, 0, &session);
+    SetStubConfig(nullptr);
+
+    return (MFX_ERR_NONE == sts) ? session : nullptr;
+}
+
+static void SetEncodeParams(mfxVideoParam *par, mfxU16 asyncDepth) {
+    memset(par, 0, sizeof(*par));
+    par->mfx.CodecId                 = MFX_CODEC_AVC;
+    par->mfx.GopPicSize              = 2;
+    par->mfx.FrameInfo.FourCC        = MFX_FOURCC_NV12;
+    par->mfx.FrameInfo.ChromaFormat  = MFX_CHROMAFORMAT_YUV420;
+    par->mfx.FrameInfo.Width         = 320;
+    par->mfx.FrameInfo.Height        = 240;
+    par->mfx.FrameInfo.FrameRateExtN = 30;
+    par->mfx.FrameInfo.FrameRateExtD = 1;
+    par->IOPattern                   = MFX_IOPATTERN_IN_SYSTEM_MEMORY;
+    par->AsyncDepth                  = asyncDepth;
+}
+
+TEST(Dispatcher_SyntheticRuntime, EncodesFramesOfConfiguredSize) {
+    SKIP_IF_DISP_SW_DISABLED();
+
+    mfxLoader loader = MFXLoad();
+    ASSERT_NE(loader, nullptr);
+    mfxSession session = CreateStubSession(loader, "frame_size=100");
+    ASSERT_NE(session, nullptr);
+
+    mfxVideoParam par;
+    SetEncodeParams(&par, 1);
+    ASSERT_EQ(MFX_ERR_NONE, MFXVideoENCODE_Init(session, &par));
+
+    std::vector<mfxU8> buffer(1000);
+    mfxBitstream bs = {};
+    bs.Data         = buffer.data();
+    bs.MaxLength    = (mfxU32)buffer.size();
+
+    for (mfxU16 i = 0; i < 3; i++) {
+        mfxFrameSurface1 *surface = nullptr;
+        ASSERT_EQ(MFX_ERR_NONE, MFXMemory_GetSurfaceForEncode(session, &surface));
+        surface->Data.TimeStamp = 100 + i;
+
+        mfxSyncPoint syncp = nullptr;
+        ASSERT_EQ(MFX_ERR_NONE, MFXVideoENCODE_EncodeFrameAsync(session, 0, surface, &bs, &syncp));
+        EXPECT_EQ(MFX_ERR_NONE, surface->FrameInterface->Release(surface));
+        ASSERT_EQ(MFX_ERR_NONE, MFXVideoCORE_SyncOperation(session, syncp, MFX_INFINITE));
+
+        EXPECT_EQ(100u * (i + 1), bs.DataLength);
+        EXPECT_EQ(100u + i, bs.TimeStamp);
+        EXPECT_EQ(i % 2 ? MFX_FRAMETYPE_P : MFX_FRAMETYPE_I, bs.FrameType & 0x7);
+        EXPECT_EQ(i, bs.Data[bs.DataLength - 1]);
+    }
+
+    // nothing is buffered in the encoder
+    mfxSyncPoint syncp = nullptr;
+    EXPECT_EQ(MFX_ERR_MORE_DATA, MFXVideoENCODE_EncodeFrameAsync(session, 0, 0, &bs, &syncp));
+
+    mfxEncodeStat stat = {};
+    EXPECT_EQ(MFX_ERR_NONE, MFXVideoENCODE_GetEncodeStat(session, &stat));
+    EXPECT_EQ(3u, stat.NumFrame);
+    EXPECT_EQ(2400u, stat.NumBit);
+
+    EXPECT_EQ(MFX_ERR_NONE, MFXVideoENCODE_Close(session));
+    EXPECT_EQ(MFX_ERR_NONE, MFXClose(session));
+    MFXUnload(loader);
+}
+
+TEST(Dispatcher_SyntheticRuntime, DecodeRespectsLatencyAndAsyncDepth) {
+    SKIP_IF_DISP_SW_DISABLED();
+
+    mfxLoader loader = MFXLoad();
+    ASSERT_NE(loader, nullptr);
+    mfxSession session =
+        CreateStubSession(loader, "latency_decode=50000,frame_size=10,width=176,height=144");
+    ASSERT_NE(session, nullptr);
+
+    mfxU8 data[100] = {};
+    mfxBitstream bs = {};
+    bs.Data         = data;
+    bs.DataLength   = sizeof(data);
+    bs.MaxLength    = sizeof(data);
+
+    mfxVideoParam par = {};
+    par.mfx.CodecId   = MFX_CODEC_HEVC;
+    par.AsyncDepth    = 2;
+    ASSERT_EQ(MFX_ERR_NONE, MFXVideoDECODE_DecodeHeader(session, &bs, &par));
+    EXPECT_EQ(176, par.mfx.FrameInfo.CropW);
+    EXPECT_EQ(144, par.mfx.FrameInfo.CropH);
+    ASSERT_EQ(MFX_ERR_NONE, MFXVideoDECODE_Init(session, &par));
+
+    mfxFrameSurface1 *out[2] = {};
+    mfxSyncPoint syncp[2]    = {};
+    for (int i = 0; i < 2; i++) {
+        ASSERT_EQ(MFX_ERR_NONE,
+                  MFXVideoDECODE_DecodeFrameAsync(session, &bs, nullptr, &out[i], &syncp[i]));
+    }
+    EXPECT_EQ(80u, bs.DataLength);
+
+    // both tasks are in flight
+    mfxFrameSurface1 *busy = nullptr;
+    mfxSyncPoint busySyncp = nullptr;
+    EXPECT_EQ(MFX_WRN_DEVICE_BUSY,
+              MFXVideoDECODE_DecodeFrameAsync(session, &bs, nullptr, &busy, &busySyncp));
+    EXPECT_EQ(MFX_WRN_IN_EXECUTION, MFXVideoCORE_SyncOperation(session, syncp[0], 1));
+
+    for (int i = 0; i < 2; i++) {
+        EXPECT_EQ(MFX_ERR_NONE, out[i]->FrameInterface->Synchronize(out[i], MFX_INFINITE));
+        EXPECT_EQ(i, out[i]->Data.Y[0]);
+        EXPECT_EQ(MFX_ERR_NONE, out[i]->FrameInterface->Release(out[i]));
+    }
+
+    EXPECT_EQ(MFX_ERR_NONE, MFXVideoDECODE_Close(session));
+    EXPECT_EQ(MFX_ERR_NONE, MFXClose(session));
+    MFXUnload(loader);
+}
+
+TEST(Dispatcher_SyntheticRuntime, InjectedGpuHangIsSticky) {
+    SKIP_IF_DISP_SW_DISABLED();
+
+    mfxLoader loader = MFXLoad();
+    ASSERT_NE(loader, nullptr);
+    mfxSession session = CreateStubSession(loader, "error=gpu_hang,error_frame=2,error_op=encode");
+    ASSERT_NE(session, nullptr);
+
+    mfxVideoParam par;
+    SetEncodeParams(&par, 0);
+    ASSERT_EQ(MFX_ERR_NONE, MFXVideoENCODE_Init(session, &par));
+
+    std::vector<mfxU8> buffer(4096);
+    mfxBitstream bs = {};
+    bs.Data         = buffer.data();
+    bs.MaxLength    = (mfxU32)buffer.size();
+
+    mfxFrameSurface1 *surface = nullptr;
+    ASSERT_EQ(MFX_ERR_NONE, MFXMemory_GetSurfaceForEncode(session, &surface));
+
+    mfxSyncPoint syncp = nullptr;
+    ASSERT_EQ(MFX_ERR_NONE, MFXVideoENCODE_EncodeFrameAsync(session, 0, surface, &bs, &syncp));
+    EXPECT_EQ(MFX_ERR_NONE, MFXVideoCORE_SyncOperation(session, syncp, MFX_INFINITE));
+
+    ASSERT_EQ(MFX_ERR_NONE, MFXVideoENCODE_EncodeFrameAsync(session, 0, surface, &bs, &syncp));
+    EXPECT_EQ(MFX_ERR_GPU_HANG, MFXVideoCORE_SyncOperation(session, syncp, MFX_INFINITE));
+    EXPECT_EQ(1024u, bs.DataLength);
+
+    EXPECT_EQ(MFX_ERR_GPU_HANG,
+              MFXVideoENCODE_EncodeFrameAsync(session, 0, surface, &bs, &syncp));
+
+    EXPECT_EQ(MFX_ERR_NONE, surface->FrameInterface->Release(surface));
+    EXPECT_EQ(MFX_ERR_NONE, MFXVideoENCODE_Close(session));
+    EXPECT_EQ(MFX_ERR_NONE, MFXClose(session));
+    MFXUnload(loader);
+}
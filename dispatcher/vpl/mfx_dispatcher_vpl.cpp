@@ -32,6 +32,11 @@ void MFXUnload(mfxLoader loader) {
     if (loader) {
         LoaderCtxVPL *loaderCtx = (LoaderCtxVPL *)loader;
 
+#ifdef ONEVPL_EXPERIMENTAL
+        // close pooled sessions while their implementations are still loaded
+        loaderCtx->m_sessionPool.Clear();
+#endif
+
         loaderCtx->UnloadAllLibraries();
 
         loaderCtx->FreeConfigFilters();
@@ -122,15 +127,9 @@ mfxStatus MFXEnumImplementations(mfxLoader loader,
     return sts;
 }
 
-// create a new session with implementation i
-mfxStatus MFXCreateSession(mfxLoader loader, mfxU32 i, mfxSession *session) {
-    if (!loader || !session)
-        return MFX_ERR_NULL_PTR;
-
-    LoaderCtxVPL *loaderCtx = (LoaderCtxVPL *)loader;
-
+// load libraries and update list of valid implementations before session creation
+static mfxStatus PrepareImplList(LoaderCtxVPL *loaderCtx) {
     DispatcherLogVPL *dispLog = loaderCtx->GetLogger();
-    DISP_LOG_FUNCTION(dispLog);
 
     mfxStatus sts = MFX_ERR_NONE;
 
@@ -168,6 +167,23 @@ mfxStatus MFXCreateSession(mfxLoader loader, mfxU32 i, mfxSession *session) {
         }
     }
 
+    return MFX_ERR_NONE;
+}
+
+// create a new session with implementation i
+mfxStatus MFXCreateSession(mfxLoader loader, mfxU32 i, mfxSession *session) {
+    if (!loader || !session)
+        return MFX_ERR_NULL_PTR;
+
+    LoaderCtxVPL *loaderCtx = (LoaderCtxVPL *)loader;
+
+    DispatcherLogVPL *dispLog = loaderCtx->GetLogger();
+    DISP_LOG_FUNCTION(dispLog);
+
+    mfxStatus sts = PrepareImplList(loaderCtx);
+    if (sts)
+        return sts;
+
     sts = loaderCtx->CreateSession(i, session);
 
     return sts;
@@ -187,3 +203,131 @@ mfxStatus MFXDispReleaseImplDescription(mfxLoader loader, mfxHDL hdl) {
 
     return sts;
 }
+
+#ifdef ONEVPL_EXPERIMENTAL
+// set size and idle timeout of the session pool
+mfxStatus MFXSetSessionPoolParam(mfxLoader loader, const mfxSessionPoolParam *par) {
+    if (!loader || !par)
+        return MFX_ERR_NULL_PTR;
+
+    LoaderCtxVPL *loaderCtx = (LoaderCtxVPL *)loader;
+
+    DispatcherLogVPL *dispLog = loaderCtx->GetLogger();
+    DISP_LOG_FUNCTION(dispLog);
+
+    try {
+        return loaderCtx->m_sessionPool.SetParam(par);
+    }
+    catch (...) {
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+}
+
+// reuse idle session with matching stream parameters, or create a new one
+mfxStatus MFXCheckoutSession(mfxLoader loader,
+                             mfxU32 i,
+                             mfxSessionPoolComponent comp,
+                             mfxVideoParam *par,
+                             mfxSession *session,
+                             mfxU16 *reused) {
+    if (!loader || !par || !session || !reused)
+        return MFX_ERR_NULL_PTR;
+
+    LoaderCtxVPL *loaderCtx = (LoaderCtxVPL *)loader;
+
+    DispatcherLogVPL *dispLog = loaderCtx->GetLogger();
+    DISP_LOG_FUNCTION(dispLog);
+
+    mfxStatus sts = PrepareImplList(loaderCtx);
+    if (sts)
+        return sts;
+
+    const ImplInfo *implInfo = loaderCtx->GetValidImpl(i);
+    if (!implInfo)
+        return MFX_ERR_NOT_FOUND;
+
+    try {
+        *session = loaderCtx->m_sessionPool.Checkout(implInfo, comp, par);
+    }
+    catch (...) {
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+
+    if (*session) {
+        DISP_LOG_MESSAGE(dispLog, "message:  reused pooled session");
+        *reused = 1;
+        return MFX_ERR_NONE;
+    }
+
+    *reused = 0;
+    sts     = loaderCtx->CreateSession(i, session);
+
+    return sts;
+}
+
+// keep session for a later MFXCheckoutSession() call
+mfxStatus MFXReturnSession(mfxLoader loader,
+                           mfxU32 i,
+                           mfxSessionPoolComponent comp,
+                           const mfxVideoParam *par,
+                           mfxSession session) {
+    if (!loader || !par || !session)
+        return MFX_ERR_NULL_PTR;
+
+    LoaderCtxVPL *loaderCtx = (LoaderCtxVPL *)loader;
+
+    DispatcherLogVPL *dispLog = loaderCtx->GetLogger();
+    DISP_LOG_FUNCTION(dispLog);
+
+    const ImplInfo *implInfo = loaderCtx->GetValidImpl(i);
+    if (!implInfo)
+        return MFXClose(session);
+
+    try {
+        return loaderCtx->m_sessionPool.Return(implInfo, comp, par, session);
+    }
+    catch (...) {
+        return MFXClose(session);
+    }
+}
+
+// pool hit/miss counters
+mfxStatus MFXGetSessionPoolStat(mfxLoader loader, mfxSessionPoolStat *stat) {
+    if (!loader || !stat)
+        return MFX_ERR_NULL_PTR;
+
+    LoaderCtxVPL *loaderCtx = (LoaderCtxVPL *)loader;
+
+    DispatcherLogVPL *dispLog = loaderCtx->GetLogger();
+    DISP_LOG_FUNCTION(dispLog);
+
+    try {
+        return loaderCtx->m_sessionPool.GetStat(stat);
+    }
+    catch (...) {
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+}
+
+// write binary snapshot of valid implementations for ONEVPL_CAPS_SNAPSHOT
+mfxStatus MFXSaveCapsSnapshot(mfxLoader loader, const mfxChar *path) {
+    if (!loader || !path)
+        return MFX_ERR_NULL_PTR;
+
+    LoaderCtxVPL *loaderCtx = (LoaderCtxVPL *)loader;
+
+    DispatcherLogVPL *dispLog = loaderCtx->GetLogger();
+    DISP_LOG_FUNCTION(dispLog);
+
+    mfxStatus sts = PrepareImplList(loaderCtx);
+    if (sts)
+        return sts;
+
+    try {
+        return loaderCtx->SaveCapsSnapshot(path);
+    }
+    catch (...) {
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+}
+#endif
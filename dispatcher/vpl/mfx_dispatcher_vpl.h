@@ -8,9 +8,11 @@
 #define DISPATCHER_VPL_MFX_DISPATCHER_VPL_H_
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -425,6 +427,9 @@ struct ImplInfo {
     // index of valid libraries - updates with every call to MFXSetConfigFilterProperty()
     mfxI32 validImplIdx;
 
+    // implDesc and implFuncs point into caps snapshot owned by loader, library is not loaded
+    bool bCapsSnapshot;
+
     // avoid warnings
     ImplInfo()
             : libInfo(nullptr),
@@ -435,9 +440,70 @@ struct ImplInfo {
               msdkImplIdx(0),
               adapterIdx(ADAPTER_IDX_UNKNOWN),
               libImplIdx(0),
-              validImplIdx(-1) {}
+              validImplIdx(-1),
+              bCapsSnapshot(false) {}
 };
 
+#ifdef ONEVPL_EXPERIMENTAL
+// idle sessions returned by application with MFXReturnSession()
+// sessions are matched by implementation, component and stream parameters and
+//   reused with a component reset instead of MFXClose() + MFXCreateSession() + Init
+class SessionPoolVPL {
+public:
+    SessionPoolVPL();
+    ~SessionPoolVPL();
+
+    mfxStatus SetParam(const mfxSessionPoolParam *par);
+    mfxStatus GetStat(mfxSessionPoolStat *stat);
+
+    // returns matching session with component reset to par, or nullptr on miss
+    mfxSession Checkout(const ImplInfo *implInfo,
+                        mfxSessionPoolComponent comp,
+                        mfxVideoParam *par);
+
+    // takes ownership of session, closes it if pooling is disabled
+    mfxStatus Return(const ImplInfo *implInfo,
+                     mfxSessionPoolComponent comp,
+                     const mfxVideoParam *par,
+                     mfxSession session);
+
+    // close all idle sessions (must be called before implementations are unloaded)
+    void Clear();
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct IdleSession {
+        const ImplInfo *implInfo;
+        mfxSessionPoolComponent comp;
+        mfxVideoParam par; // ExtParam is not kept
+        mfxSession session;
+        TimePoint returned;
+    };
+
+    static bool IsSameStream(const IdleSession &idle,
+                             const ImplInfo *implInfo,
+                             mfxSessionPoolComponent comp,
+                             const mfxVideoParam *par);
+    static mfxStatus ResetComponent(mfxSession session,
+                                    mfxSessionPoolComponent comp,
+                                    mfxVideoParam *par);
+
+    // move sessions exceeding timeout or pool size to evicted list, call with m_mutex locked
+    void EvictIdle(TimePoint now, std::list<IdleSession> &evicted);
+    static void CloseSessions(std::list<IdleSession> &sessions);
+
+    std::mutex m_mutex;
+    std::list<IdleSession> m_idle; // oldest first
+    mfxSessionPoolParam m_param;
+    mfxSessionPoolStat m_stat;
+
+    // make this class non-copyable
+    SessionPoolVPL(const SessionPoolVPL &);
+    void operator=(const SessionPoolVPL &);
+};
+#endif
+
 // loader class implementation
 class LoaderCtxVPL {
 public:
@@ -461,6 +527,7 @@ public:
 
     // create mfxSession
     mfxStatus CreateSession(mfxU32 idx, mfxSession *session);
+    const ImplInfo *GetValidImpl(mfxU32 idx);
 
     // manage configuration filters
     ConfigCtxVPL *AddConfigFilter();
@@ -474,11 +541,21 @@ public:
     mfxStatus LoadLibsLowLatency();
     mfxStatus UpdateLowLatency();
 
+#ifdef ONEVPL_EXPERIMENTAL
+    // binary snapshot of implementation descriptions
+    mfxStatus SaveCapsSnapshot(const mfxChar *path);
+    mfxStatus LoadCapsSnapshot();
+#endif
+
     bool m_bLowLatency;
     bool m_bNeedUpdateValidImpls;
     bool m_bNeedFullQuery;
     bool m_bNeedLowLatencyQuery;
 
+#ifdef ONEVPL_EXPERIMENTAL
+    SessionPoolVPL m_sessionPool;
+#endif
+
 private:
     // helper functions
     mfxStatus LoadSingleLibrary(LibInfo *libInfo);
@@ -525,6 +602,11 @@ private:
 
     // logger object - enabled with ONEVPL_DISPATCHER_LOG environment variable
     DispatcherLogVPL m_dispLog;
+
+#ifdef ONEVPL_EXPERIMENTAL
+    // relocated copy of caps snapshot file, referenced by implDesc and implFuncs
+    std::vector<mfxU64> m_capsSnapshot;
+#endif
 };
 
 #endif // DISPATCHER_VPL_MFX_DISPATCHER_VPL_H_
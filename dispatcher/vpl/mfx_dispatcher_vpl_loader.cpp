@@ -79,6 +79,17 @@ mfxStatus LoaderCtxVPL::FullLoadAndQuery() {
     // disable low latency mode
     m_bLowLatency = false;
 
+#ifdef ONEVPL_EXPERIMENTAL
+    // descriptions from ONEVPL_CAPS_SNAPSHOT file, if valid
+    // otherwise fall back to loading and querying all libraries
+    if (LoadCapsSnapshot() == MFX_ERR_NONE) {
+        m_bNeedFullQuery        = false;
+        m_bNeedUpdateValidImpls = true;
+
+        return MFX_ERR_NONE;
+    }
+#endif
+
     // search directories for candidate implementations based on search order in
     // spec
     mfxStatus sts = BuildListOfCandidateLibs();
@@ -729,7 +740,8 @@ mfxStatus LoaderCtxVPL::UnloadSingleImplementation(ImplInfo *implInfo) {
         //   was never called by the application
         // this is a valid scenario, e.g. app did not call MFXEnumImplementations()
         //   and just used the first available implementation provided by dispatcher
-        if (libInfo->libType == LibTypeVPL) {
+        // descriptions from caps snapshot are freed with loader
+        if (libInfo->libType == LibTypeVPL && !implInfo->bCapsSnapshot) {
             if (implInfo->implDesc) {
                 // MFX_IMPLCAPS_IMPLDESCSTRUCTURE;
                 (*(mfxStatus(MFX_CDECL *)(mfxHDL))pFunc)(implInfo->implDesc);
@@ -1239,8 +1251,8 @@ mfxStatus LoaderCtxVPL::ReleaseImpl(mfxHDL idesc) {
         if (m_bKeepCapsUntilUnload)
             return MFX_ERR_NONE;
 
-        // LibTypeMSDK does not require calling a release function
-        if (implInfo->libInfo->libType == LibTypeVPL) {
+        // LibTypeMSDK and caps snapshot do not require calling a release function
+        if (implInfo->libInfo->libType == LibTypeVPL && !implInfo->bCapsSnapshot) {
             // call MFXReleaseImplDescription() for this implementation
             VPLFunctionPtr pFunc = implInfo->libInfo->vplFuncTable[IdxMFXReleaseImplDescription];
 
@@ -1469,6 +1481,18 @@ mfxStatus LoaderCtxVPL::CreateSession(mfxU32 idx, mfxSession *session) {
     return MFX_ERR_NOT_FOUND;
 }
 
+// implementation with given valid index, or nullptr if idx is out of range
+const ImplInfo *LoaderCtxVPL::GetValidImpl(mfxU32 idx) {
+    std::list<ImplInfo *>::iterator it = m_implInfoList.begin();
+    while (it != m_implInfoList.end()) {
+        if ((*it)->validImplIdx == (mfxI32)idx)
+            return (*it);
+        it++;
+    }
+
+    return nullptr;
+}
+
 ConfigCtxVPL *LoaderCtxVPL::AddConfigFilter() {
     DISP_LOG_FUNCTION(&m_dispLog);
 
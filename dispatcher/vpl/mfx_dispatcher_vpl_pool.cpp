@@ -0,0 +1,207 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include <string.h>
+
+#include "vpl/mfx_dispatcher_vpl.h"
+
+#ifdef ONEVPL_EXPERIMENTAL
+
+// implementation of session pool (MFXCheckoutSession/MFXReturnSession)
+// short jobs with identical stream parameters skip runtime loading, device creation
+//   and component initialization by resetting a session returned by a previous job
+// idle sessions are evicted lazily on every pool call, there is no background thread
+
+SessionPoolVPL::SessionPoolVPL() : m_mutex(), m_idle(), m_param(), m_stat() {}
+
+SessionPoolVPL::~SessionPoolVPL() {
+    Clear();
+}
+
+mfxStatus SessionPoolVPL::SetParam(const mfxSessionPoolParam *par) {
+    std::list<IdleSession> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_param = *par;
+        EvictIdle(std::chrono::steady_clock::now(), evicted);
+    }
+    CloseSessions(evicted);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus SessionPoolVPL::GetStat(mfxSessionPoolStat *stat) {
+    std::list<IdleSession> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        EvictIdle(std::chrono::steady_clock::now(), evicted);
+        *stat = m_stat;
+    }
+    CloseSessions(evicted);
+
+    return MFX_ERR_NONE;
+}
+
+mfxSession SessionPoolVPL::Checkout(const ImplInfo *implInfo,
+                                    mfxSessionPoolComponent comp,
+                                    mfxVideoParam *par) {
+    std::list<IdleSession> evicted;
+    std::list<IdleSession> match;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        EvictIdle(std::chrono::steady_clock::now(), evicted);
+
+        // most recently returned session first
+        std::list<IdleSession>::iterator it = m_idle.end();
+        while (it != m_idle.begin()) {
+            it--;
+            if (IsSameStream(*it, implInfo, comp, par)) {
+                match.splice(match.begin(), m_idle, it);
+                m_stat.NumIdleSessions--;
+                break;
+            }
+        }
+    }
+    CloseSessions(evicted);
+
+    // reset outside of the lock, it may take a while
+    mfxSession session = nullptr;
+    bool bResetFailed  = false;
+    if (!match.empty()) {
+        if (ResetComponent(match.front().session, comp, par) >= MFX_ERR_NONE) {
+            session = match.front().session;
+        }
+        else {
+            CloseSessions(match);
+            bResetFailed = true;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (session) {
+        m_stat.NumHits++;
+    }
+    else {
+        m_stat.NumMisses++;
+        if (bResetFailed)
+            m_stat.NumEvictions++;
+    }
+
+    return session;
+}
+
+mfxStatus SessionPoolVPL::Return(const ImplInfo *implInfo,
+                                 mfxSessionPoolComponent comp,
+                                 const mfxVideoParam *par,
+                                 mfxSession session) {
+    std::list<IdleSession> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        IdleSession idle;
+        idle.implInfo        = implInfo;
+        idle.comp            = comp;
+        idle.par             = *par;
+        idle.par.NumExtParam = 0;
+        idle.par.ExtParam    = nullptr;
+        idle.session         = session;
+        idle.returned        = std::chrono::steady_clock::now();
+
+        if (m_param.MaxIdleSessions) {
+            m_idle.push_back(idle);
+            m_stat.NumIdleSessions++;
+        }
+        else {
+            // pooling disabled - behave like MFXClose()
+            evicted.push_back(idle);
+        }
+
+        EvictIdle(idle.returned, evicted);
+    }
+    CloseSessions(evicted);
+
+    return MFX_ERR_NONE;
+}
+
+void SessionPoolVPL::Clear() {
+    std::list<IdleSession> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        evicted.splice(evicted.end(), m_idle);
+        m_stat.NumIdleSessions = 0;
+    }
+    CloseSessions(evicted);
+}
+
+// stream parameters must match exactly, extension buffers are not compared
+//   and are applied by the component reset
+bool SessionPoolVPL::IsSameStream(const IdleSession &idle,
+                                  const ImplInfo *implInfo,
+                                  mfxSessionPoolComponent comp,
+                                  const mfxVideoParam *par) {
+    if (idle.implInfo != implInfo || idle.comp != comp)
+        return false;
+
+    if (idle.par.AsyncDepth != par->AsyncDepth || idle.par.Protected != par->Protected ||
+        idle.par.IOPattern != par->IOPattern)
+        return false;
+
+    if (comp == MFX_SESSION_POOL_VPP)
+        return !memcmp(&idle.par.vpp, &par->vpp, sizeof(par->vpp));
+
+    return !memcmp(&idle.par.mfx, &par->mfx, sizeof(par->mfx));
+}
+
+mfxStatus SessionPoolVPL::ResetComponent(mfxSession session,
+                                         mfxSessionPoolComponent comp,
+                                         mfxVideoParam *par) {
+    switch (comp) {
+        case MFX_SESSION_POOL_DECODE:
+            return MFXVideoDECODE_Reset(session, par);
+        case MFX_SESSION_POOL_ENCODE:
+            return MFXVideoENCODE_Reset(session, par);
+        case MFX_SESSION_POOL_VPP:
+            return MFXVideoVPP_Reset(session, par);
+        default:
+            return MFX_ERR_UNSUPPORTED;
+    }
+}
+
+void SessionPoolVPL::EvictIdle(TimePoint now, std::list<IdleSession> &evicted) {
+    std::list<IdleSession>::iterator it = m_idle.begin();
+    while (it != m_idle.end()) {
+        bool bTimeout = false;
+        if (m_param.IdleTimeout) {
+            bTimeout = (now - it->returned) >= std::chrono::milliseconds(m_param.IdleTimeout);
+        }
+
+        if (!bTimeout && m_stat.NumIdleSessions <= m_param.MaxIdleSessions)
+            break;
+
+        // list is ordered by return time, so oldest sessions go first
+        std::list<IdleSession>::iterator next = it;
+        next++;
+        evicted.splice(evicted.end(), m_idle, it);
+        m_stat.NumIdleSessions--;
+        m_stat.NumEvictions++;
+        it = next;
+    }
+}
+
+void SessionPoolVPL::CloseSessions(std::list<IdleSession> &sessions) {
+    std::list<IdleSession>::iterator it = sessions.begin();
+    while (it != sessions.end()) {
+        MFXClose(it->session);
+        it++;
+    }
+    sessions.clear();
+}
+
+#endif // ONEVPL_EXPERIMENTAL
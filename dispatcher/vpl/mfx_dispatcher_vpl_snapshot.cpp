@@ -0,0 +1,552 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "vpl/mfx_dispatcher_vpl.h"
+
+#ifdef ONEVPL_EXPERIMENTAL
+
+    #if !defined(_WIN32) && !defined(_WIN64)
+        #include <fcntl.h>
+        #include <sys/mman.h>
+    #endif
+
+// binary caps snapshot (MFXSaveCapsSnapshot, ONEVPL_CAPS_SNAPSHOT)
+// file layout:
+//   CapsSnapshotHeader
+//   CapsSnapshotImpl[numImpls]
+//   data - description structures in native layout, every pointer field holds the
+//     offset of the pointed array from the start of the file
+// the format follows the ABI of the dispatcher which wrote it (pointer and char size
+//   are checked on load), it is meant to be generated on the target system
+
+    #define CAPS_SNAPSHOT_MAGIC   "VPLCAPS"
+    #define CAPS_SNAPSHOT_VERSION 1
+
+struct CapsSnapshotHeader {
+    char magic[8];
+    mfxU32 version;
+    mfxU32 headerSize;
+    mfxU32 implSize;
+    mfxU32 pointerSize;
+    mfxU32 charSize;
+    mfxU32 numImpls;
+    mfxU64 fileSize;
+};
+
+struct CapsSnapshotImpl {
+    mfxU64 libPath; // offset of CHAR_TYPE string
+    mfxU64 libSize; // size and modification time of library, snapshot is stale if changed
+    mfxU64 libTime;
+    mfxU64 implDesc; // offset of mfxImplDescription
+    mfxU64 implFuncs; // offset of mfxImplementedFunctions, 0 if not available
+    mfxU32 libType;
+    mfxU32 libPriority;
+    mfxU32 libImplIdx;
+    mfxU32 msdkImplIdx;
+    mfxU32 adapterIdx;
+    mfxU32 msdkAdapter;
+    mfxU32 msdkAdapterD3D9;
+    mfxU32 version;
+    mfxU32 accelerationMode;
+    mfxU32 reserved;
+};
+
+    #define SNAPSHOT_ALIGN(x) (((x) + 7) & ~((size_t)7))
+
+    // descriptions of all implementations take a few hundred KB at most
+    #define MAX_CAPS_SNAPSHOT_SIZE (64 * 1024 * 1024)
+
+// calls fix(field, count) for every pointer field of the description
+// fix() returns address where the array can be accessed, or nullptr if it is empty
+template <class Fixer>
+static void WalkImplDesc(mfxImplDescription *desc, Fixer &fix) {
+    fix(desc->Dev.SubDevices, desc->Dev.NumSubDevices);
+
+    DecCodec *decCodecs = fix(desc->Dec.Codecs, desc->Dec.NumCodecs);
+    for (mfxU32 c = 0; decCodecs && c < desc->Dec.NumCodecs; c++) {
+        DecProfile *profiles = fix(decCodecs[c].Profiles, decCodecs[c].NumProfiles);
+        for (mfxU32 p = 0; profiles && p < decCodecs[c].NumProfiles; p++) {
+            DecMemDesc *memDesc = fix(profiles[p].MemDesc, profiles[p].NumMemTypes);
+            for (mfxU32 m = 0; memDesc && m < profiles[p].NumMemTypes; m++)
+                fix(memDesc[m].ColorFormats, memDesc[m].NumColorFormats);
+        }
+    }
+
+    EncCodec *encCodecs = fix(desc->Enc.Codecs, desc->Enc.NumCodecs);
+    for (mfxU32 c = 0; encCodecs && c < desc->Enc.NumCodecs; c++) {
+        EncProfile *profiles = fix(encCodecs[c].Profiles, encCodecs[c].NumProfiles);
+        for (mfxU32 p = 0; profiles && p < encCodecs[c].NumProfiles; p++) {
+            EncMemDesc *memDesc = fix(profiles[p].MemDesc, profiles[p].NumMemTypes);
+            for (mfxU32 m = 0; memDesc && m < profiles[p].NumMemTypes; m++)
+                fix(memDesc[m].ColorFormats, memDesc[m].NumColorFormats);
+        }
+    }
+
+    VPPFilter *filters = fix(desc->VPP.Filters, desc->VPP.NumFilters);
+    for (mfxU32 f = 0; filters && f < desc->VPP.NumFilters; f++) {
+        VPPMemDesc *memDesc = fix(filters[f].MemDesc, filters[f].NumMemTypes);
+        for (mfxU32 m = 0; memDesc && m < filters[f].NumMemTypes; m++) {
+            VPPFormat *formats = fix(memDesc[m].Formats, memDesc[m].NumInFormats);
+            for (mfxU32 i = 0; formats && i < memDesc[m].NumInFormats; i++)
+                fix(formats[i].OutFormats, formats[i].NumOutFormat);
+        }
+    }
+
+    // fields added in later versions of the structure
+    if (desc->Version.Version >= MFX_STRUCT_VERSION(1, 1)) {
+        fix(desc->AccelerationModeDescription.Mode,
+            desc->AccelerationModeDescription.NumAccelerationModes);
+    }
+
+    if (desc->Version.Version >= MFX_STRUCT_VERSION(1, 2))
+        fix(desc->PoolPolicies.Policy, desc->PoolPolicies.NumPoolPolicies);
+}
+
+template <class Fixer>
+static void WalkImplFuncs(mfxImplementedFunctions *funcs, Fixer &fix) {
+    mfxChar **names = fix(funcs->FunctionsName, funcs->NumFunctions);
+    for (mfxU32 i = 0; names && i < funcs->NumFunctions; i++)
+        fix.String(names[i]);
+}
+
+// first pass of writer - size of all arrays referenced by the description
+class SnapshotMeasure {
+public:
+    SnapshotMeasure() : m_size(0) {}
+
+    template <class T>
+    T *operator()(T *&field, size_t count) {
+        if (!field || !count)
+            return nullptr;
+        m_size += SNAPSHOT_ALIGN(count * sizeof(T));
+        return field;
+    }
+
+    void String(mfxChar *&field) {
+        if (field)
+            m_size += SNAPSHOT_ALIGN(strlen(field) + 1);
+    }
+
+    size_t m_size;
+};
+
+// second pass of writer - copies arrays into preallocated buffer and replaces
+//   pointers with offsets
+class SnapshotWrite {
+public:
+    explicit SnapshotWrite(std::vector<mfxU8> &data) : m_data(data) {}
+
+    // buffer must be reserved, so copies are not moved while walking
+    mfxU64 Append(const void *src, size_t size) {
+        mfxU64 offset = (mfxU64)m_data.size();
+        m_data.resize(m_data.size() + SNAPSHOT_ALIGN(size), 0);
+        memcpy(m_data.data() + offset, src, size);
+        return offset;
+    }
+
+    template <class T>
+    T *operator()(T *&field, size_t count) {
+        if (!field || !count) {
+            field = nullptr;
+            return nullptr;
+        }
+        mfxU64 offset = Append(field, count * sizeof(T));
+        field         = reinterpret_cast<T *>((uintptr_t)offset);
+        return reinterpret_cast<T *>(m_data.data() + offset);
+    }
+
+    void String(mfxChar *&field) {
+        if (field)
+            field = reinterpret_cast<mfxChar *>((uintptr_t)Append(field, strlen(field) + 1));
+    }
+
+private:
+    std::vector<mfxU8> &m_data;
+
+    void operator=(const SnapshotWrite &);
+};
+
+// loader - replaces offsets with pointers into the loaded snapshot, checking bounds
+class SnapshotRelocate {
+public:
+    SnapshotRelocate(mfxU8 *base, size_t size) : m_base(base), m_size(size), m_bError(false) {}
+
+    template <class T>
+    T *operator()(T *&field, size_t count) {
+        uintptr_t offset = reinterpret_cast<uintptr_t>(field);
+        if (!offset || !count) {
+            field = nullptr;
+            return nullptr;
+        }
+        if (offset % sizeof(mfxU64) || offset > m_size || count * sizeof(T) > m_size - offset) {
+            m_bError = true;
+            field    = nullptr;
+            return nullptr;
+        }
+        field = reinterpret_cast<T *>(m_base + offset);
+        return field;
+    }
+
+    void String(mfxChar *&field) {
+        uintptr_t offset = reinterpret_cast<uintptr_t>(field);
+        if (offset && offset < m_size && memchr(m_base + offset, 0, m_size - offset)) {
+            field = reinterpret_cast<mfxChar *>(m_base + offset);
+        }
+        else {
+            m_bError = true;
+            field    = nullptr;
+        }
+    }
+
+    mfxU8 *m_base;
+    size_t m_size;
+    bool m_bError;
+};
+
+// size and modification time of runtime library, used to detect stale snapshots
+static bool GetLibStamp(const STRING_TYPE &libPath, mfxU64 &size, mfxU64 &time) {
+    #if defined(_WIN32) || defined(_WIN64)
+    struct _stat64 st;
+    if (_wstat64(libPath.c_str(), &st))
+        return false;
+    #else
+    struct stat st;
+    if (stat(libPath.c_str(), &st))
+        return false;
+    #endif
+
+    size = (mfxU64)st.st_size;
+    time = (mfxU64)st.st_mtime;
+    return true;
+}
+
+// map snapshot file and copy it into data, so descriptions can be relocated
+//   without touching the shared pages
+static mfxStatus ReadSnapshotFile(const char *path, std::vector<mfxU64> &data) {
+    const mfxU8 *view = nullptr;
+    size_t size       = 0;
+
+    #if defined(_WIN32) || defined(_WIN64)
+    HANDLE hFile = CreateFileA(path,
+                               GENERIC_READ,
+                               FILE_SHARE_READ,
+                               nullptr,
+                               OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL,
+                               nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return MFX_ERR_NOT_FOUND;
+
+    LARGE_INTEGER fileSize = {};
+    HANDLE hMapping        = nullptr;
+    if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart >= sizeof(CapsSnapshotHeader))
+        hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(hFile);
+    if (!hMapping)
+        return MFX_ERR_UNSUPPORTED;
+
+    size = (size_t)fileSize.QuadPart;
+    view = (const mfxU8 *)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
+    if (!view)
+        return MFX_ERR_UNSUPPORTED;
+    #else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return MFX_ERR_NOT_FOUND;
+
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(CapsSnapshotHeader)) {
+        close(fd);
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    size        = (size_t)st.st_size;
+    void *pView = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pView == MAP_FAILED)
+        return MFX_ERR_UNSUPPORTED;
+    view = (const mfxU8 *)pView;
+    #endif
+
+    mfxStatus sts                    = MFX_ERR_NONE;
+    const CapsSnapshotHeader *header = (const CapsSnapshotHeader *)view;
+    if (memcmp(header->magic, CAPS_SNAPSHOT_MAGIC, sizeof(header->magic)) ||
+        header->version != CAPS_SNAPSHOT_VERSION ||
+        header->headerSize != sizeof(CapsSnapshotHeader) ||
+        header->implSize != sizeof(CapsSnapshotImpl) || header->pointerSize != sizeof(void *) ||
+        header->charSize != sizeof(CHAR_TYPE) || header->fileSize != size ||
+        header->fileSize > MAX_CAPS_SNAPSHOT_SIZE ||
+        header->numImpls > (size - sizeof(CapsSnapshotHeader)) / sizeof(CapsSnapshotImpl)) {
+        sts = MFX_ERR_UNSUPPORTED;
+    }
+    else {
+        data.resize((size + sizeof(mfxU64) - 1) / sizeof(mfxU64));
+        memcpy(data.data(), view, size);
+    }
+
+    #if defined(_WIN32) || defined(_WIN64)
+    UnmapViewOfFile(view);
+    #else
+    munmap((void *)view, size);
+    #endif
+
+    return sts;
+}
+
+// write descriptions of all valid implementations to snapshot file
+mfxStatus LoaderCtxVPL::SaveCapsSnapshot(const mfxChar *path) {
+    DISP_LOG_FUNCTION(&m_dispLog);
+
+    std::list<ImplInfo *> implList;
+    std::list<ImplInfo *>::iterator it = m_implInfoList.begin();
+    while (it != m_implInfoList.end()) {
+        ImplInfo *implInfo = (*it);
+        if (implInfo->validImplIdx >= 0) {
+            // not queried in low latency mode
+            if (!implInfo->implDesc)
+                return MFX_ERR_UNSUPPORTED;
+            implList.push_back(implInfo);
+        }
+        it++;
+    }
+
+    // pass 1 - measure
+    size_t size = sizeof(CapsSnapshotHeader) + implList.size() * sizeof(CapsSnapshotImpl);
+    for (it = implList.begin(); it != implList.end(); it++) {
+        ImplInfo *implInfo = (*it);
+
+        SnapshotMeasure measure;
+        mfxImplDescription desc = *(mfxImplDescription *)implInfo->implDesc;
+        WalkImplDesc(&desc, measure);
+        if (implInfo->implFuncs) {
+            mfxImplementedFunctions funcs = *(mfxImplementedFunctions *)implInfo->implFuncs;
+            WalkImplFuncs(&funcs, measure);
+        }
+
+        size += measure.m_size;
+        size += SNAPSHOT_ALIGN(sizeof(mfxImplDescription));
+        size += SNAPSHOT_ALIGN(sizeof(mfxImplementedFunctions));
+        size += SNAPSHOT_ALIGN((implInfo->libInfo->libNameFull.size() + 1) * sizeof(CHAR_TYPE));
+    }
+
+    // pass 2 - copy
+    std::vector<mfxU8> data;
+    data.reserve(size);
+    data.resize(sizeof(CapsSnapshotHeader) + implList.size() * sizeof(CapsSnapshotImpl), 0);
+
+    SnapshotWrite write(data);
+    mfxU32 idx = 0;
+    for (it = implList.begin(); it != implList.end(); it++, idx++) {
+        ImplInfo *implInfo = (*it);
+        LibInfo *libInfo   = implInfo->libInfo;
+
+        CapsSnapshotImpl impl = {};
+        if (!GetLibStamp(libInfo->libNameFull, impl.libSize, impl.libTime))
+            return MFX_ERR_UNSUPPORTED;
+
+        impl.libPath = write.Append(libInfo->libNameFull.c_str(),
+                                    (libInfo->libNameFull.size() + 1) * sizeof(CHAR_TYPE));
+
+        impl.implDesc = write.Append(implInfo->implDesc, sizeof(mfxImplDescription));
+        mfxImplDescription *desc = (mfxImplDescription *)(data.data() + impl.implDesc);
+        desc->NumExtParam        = 0;
+        desc->ExtParams.Reserved2 = 0;
+        WalkImplDesc(desc, write);
+
+        if (implInfo->implFuncs) {
+            impl.implFuncs = write.Append(implInfo->implFuncs, sizeof(mfxImplementedFunctions));
+            WalkImplFuncs((mfxImplementedFunctions *)(data.data() + impl.implFuncs), write);
+        }
+
+        impl.libType          = (mfxU32)libInfo->libType;
+        impl.libPriority      = libInfo->libPriority;
+        impl.libImplIdx       = implInfo->libImplIdx;
+        impl.msdkImplIdx      = implInfo->msdkImplIdx;
+        impl.adapterIdx       = implInfo->adapterIdx;
+        impl.msdkAdapter      = (mfxU32)libInfo->msdkCtx[implInfo->msdkImplIdx].m_msdkAdapter;
+        impl.msdkAdapterD3D9  = (mfxU32)libInfo->msdkCtx[implInfo->msdkImplIdx].m_msdkAdapterD3D9;
+        impl.version          = implInfo->version.Version;
+        impl.accelerationMode = (mfxU32)implInfo->vplParam.AccelerationMode;
+
+        memcpy(data.data() + sizeof(CapsSnapshotHeader) + idx * sizeof(CapsSnapshotImpl),
+               &impl,
+               sizeof(impl));
+    }
+
+    CapsSnapshotHeader header = {};
+    memcpy(header.magic, CAPS_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version     = CAPS_SNAPSHOT_VERSION;
+    header.headerSize  = sizeof(CapsSnapshotHeader);
+    header.implSize    = sizeof(CapsSnapshotImpl);
+    header.pointerSize = sizeof(void *);
+    header.charSize    = sizeof(CHAR_TYPE);
+    header.numImpls    = (mfxU32)implList.size();
+    header.fileSize    = (mfxU64)data.size();
+    memcpy(data.data(), &header, sizeof(header));
+
+    // write to temporary file and rename, so readers never see a partial snapshot
+    std::string tmpPath = std::string(path) + ".tmp";
+    FILE *f             = fopen(tmpPath.c_str(), "wb");
+    if (!f)
+        return MFX_ERR_NOT_FOUND;
+
+    bool bWritten = (fwrite(data.data(), 1, data.size(), f) == data.size());
+    bWritten      = (fclose(f) == 0) && bWritten;
+
+    #if defined(_WIN32) || defined(_WIN64)
+    if (bWritten)
+        bWritten = MoveFileExA(tmpPath.c_str(), path, MOVEFILE_REPLACE_EXISTING) != 0;
+    #else
+    if (bWritten)
+        bWritten = (rename(tmpPath.c_str(), path) == 0);
+    #endif
+
+    if (!bWritten) {
+        remove(tmpPath.c_str());
+        return MFX_ERR_UNKNOWN;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+// build implementation list from snapshot file set by ONEVPL_CAPS_SNAPSHOT
+// runtime libraries are not loaded until MFXCreateSession()
+mfxStatus LoaderCtxVPL::LoadCapsSnapshot() {
+    DISP_LOG_FUNCTION(&m_dispLog);
+
+    std::string snapshotPath;
+    #if defined(_WIN32) || defined(_WIN64)
+    char envPath[MAX_VPL_SEARCH_PATH] = "";
+    DWORD err = GetEnvironmentVariableA("ONEVPL_CAPS_SNAPSHOT", envPath, MAX_VPL_SEARCH_PATH);
+    if (err == 0 || err >= MAX_VPL_SEARCH_PATH)
+        return MFX_ERR_NOT_FOUND; // environment variable not defined or string too long
+    snapshotPath = envPath;
+    #else
+    const char *envPath = std::getenv("ONEVPL_CAPS_SNAPSHOT");
+    if (!envPath || !envPath[0])
+        return MFX_ERR_NOT_FOUND;
+    snapshotPath = envPath;
+    #endif
+
+    std::vector<mfxU64> snapshot;
+    mfxStatus sts = ReadSnapshotFile(snapshotPath.c_str(), snapshot);
+    if (sts != MFX_ERR_NONE) {
+        DISP_LOG_MESSAGE(&m_dispLog, "message:  caps snapshot %s not valid", snapshotPath.c_str());
+        return sts;
+    }
+
+    mfxU8 *base                  = (mfxU8 *)snapshot.data();
+    CapsSnapshotHeader *header   = (CapsSnapshotHeader *)base;
+    CapsSnapshotImpl *implTab    = (CapsSnapshotImpl *)(base + sizeof(CapsSnapshotHeader));
+    SnapshotRelocate relocate(base, (size_t)header->fileSize);
+
+    std::list<LibInfo *> libInfoList;
+    std::list<ImplInfo *> implInfoList;
+    mfxU32 implIdxNext = m_implIdxNext;
+    for (mfxU32 i = 0; i < header->numImpls && !relocate.m_bError; i++) {
+        CapsSnapshotImpl *impl = &implTab[i];
+
+        // library path - CHAR_TYPE string
+        CHAR_TYPE *libPath = nullptr;
+        mfxU64 maxLen      = 0;
+        if (impl->libPath && impl->libPath % sizeof(CHAR_TYPE) == 0 &&
+            impl->libPath < header->fileSize) {
+            libPath = (CHAR_TYPE *)(base + impl->libPath);
+            maxLen  = (header->fileSize - impl->libPath) / sizeof(CHAR_TYPE);
+        }
+        mfxU64 len = 0;
+        while (len < maxLen && libPath[len])
+            len++;
+
+        mfxImplDescription *implDesc       = (mfxImplDescription *)(uintptr_t)impl->implDesc;
+        mfxImplementedFunctions *implFuncs = (mfxImplementedFunctions *)(uintptr_t)impl->implFuncs;
+        relocate(implDesc, 1);
+        relocate(implFuncs, 1);
+
+        if (len == maxLen || !implDesc || impl->msdkImplIdx >= MAX_NUM_IMPL_MSDK ||
+            (impl->libType != LibTypeVPL && impl->libType != LibTypeMSDK)) {
+            relocate.m_bError = true;
+            break;
+        }
+
+        WalkImplDesc(implDesc, relocate);
+        if (implFuncs)
+            WalkImplFuncs(implFuncs, relocate);
+
+        // snapshot is stale if any runtime library was updated or removed
+        STRING_TYPE libNameFull(libPath, (size_t)len);
+        mfxU64 libSize = 0, libTime = 0;
+        if (!GetLibStamp(libNameFull, libSize, libTime) || libSize != impl->libSize ||
+            libTime != impl->libTime) {
+            DISP_LOG_MESSAGE(&m_dispLog, "message:  caps snapshot is stale");
+            relocate.m_bError = true;
+            break;
+        }
+
+        // one LibInfo per library, it is not loaded
+        LibInfo *libInfo = nullptr;
+        for (std::list<LibInfo *>::iterator it = libInfoList.begin(); it != libInfoList.end();
+             it++) {
+            if ((*it)->libNameFull == libNameFull)
+                libInfo = (*it);
+        }
+        if (!libInfo) {
+            libInfo              = new LibInfo;
+            libInfo->libNameFull = libNameFull;
+            libInfo->libPriority = impl->libPriority;
+            libInfo->libType     = (LibType)impl->libType;
+            UpdateImplPath(libInfo);
+            libInfoList.push_back(libInfo);
+        }
+        libInfo->msdkCtx[impl->msdkImplIdx].m_msdkAdapter     = (mfxIMPL)impl->msdkAdapter;
+        libInfo->msdkCtx[impl->msdkImplIdx].m_msdkAdapterD3D9 = (mfxIMPL)impl->msdkAdapterD3D9;
+
+        ImplInfo *implInfo                  = new ImplInfo;
+        implInfo->libInfo                   = libInfo;
+        implInfo->implDesc                  = implDesc;
+        implInfo->implFuncs                 = implFuncs;
+        implInfo->bCapsSnapshot             = true;
+        implInfo->vplParam.AccelerationMode = (mfxAccelerationMode)impl->accelerationMode;
+        implInfo->version.Version           = impl->version;
+        implInfo->msdkImplIdx               = impl->msdkImplIdx;
+        implInfo->adapterIdx                = impl->adapterIdx;
+        implInfo->libImplIdx                = impl->libImplIdx;
+        implInfo->validImplIdx              = implIdxNext++;
+        implInfoList.push_back(implInfo);
+    }
+
+    if (relocate.m_bError || implInfoList.empty()) {
+        while (!implInfoList.empty()) {
+            delete implInfoList.front();
+            implInfoList.pop_front();
+        }
+        while (!libInfoList.empty()) {
+            delete libInfoList.front();
+            libInfoList.pop_front();
+        }
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    m_implIdxNext = implIdxNext;
+
+    m_capsSnapshot.swap(snapshot);
+    m_libInfoList.splice(m_libInfoList.end(), libInfoList);
+    m_implInfoList.splice(m_implInfoList.end(), implInfoList);
+
+    PrioritizeImplList();
+
+    DISP_LOG_MESSAGE(&m_dispLog, "message:  loaded caps snapshot %s", snapshotPath.c_str());
+
+    return MFX_ERR_NONE;
+}
+
+#endif // ONEVPL_EXPERIMENTAL
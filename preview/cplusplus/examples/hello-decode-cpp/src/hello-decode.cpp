@@ -110,6 +110,10 @@ int main(int argc, char *argv[]) {
 
     std::cout << "Decoding " << cliParams.infileName << " -> " << OUTPUT_FILE << std::endl;
 
+    // per-frame buffers are attached without allocations
+    vpl::fixed_buffer_list<vpl::decoder_process_list, vpl::ExtDecodeErrorReport> process_list(
+        &err_report);
+
     // main decoder Loop
     while (is_stillgoing == true) {
         std::cout << "Decoding " << frame_num << " frame"
@@ -118,8 +122,7 @@ int main(int argc, char *argv[]) {
         std::shared_ptr<vpl::frame_surface> dec_surface_out =
             std::make_shared<vpl::frame_surface>();
         try {
-            ret = decoder->decode_frame(dec_surface_out,
-                                        oneapi::vpl::decoder_process_list{ &err_report });
+            ret = decoder->decode_frame(dec_surface_out, process_list);
         }
         // if error happened
         catch (vpl::base_exception &e) {
@@ -0,0 +1,258 @@
+//==============================================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+//==============================================================================
+
+///
+/// Tests of the batched encode API: encode_session::process with a vector of
+/// inputs and future_batch. Runs on the synthetic stub runtime, which is
+/// configured per session through ONEVPL_STUB_CONFIG.
+///
+/// @file
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "vpl/preview/vpl.hpp"
+
+using namespace oneapi::vpl; // NOLINT
+
+#define STUB_VENDOR_IMPL_ID 0xFFFF
+#define STUB_FRAME_SIZE     100
+
+#define TEST_CHECK(cond)                                                   \
+    if (!(cond)) {                                                         \
+        printf("\n   %s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        return -1;                                                         \
+    }
+
+static void SetStubConfig(const char *config) {
+#if defined(_WIN32) || defined(_WIN64)
+    _putenv_s("ONEVPL_STUB_CONFIG", config ? config : "");
+#else
+    if (config)
+        setenv("ONEVPL_STUB_CONFIG", config, 1);
+    else
+        unsetenv("ONEVPL_STUB_CONFIG");
+#endif
+}
+
+// creates encoder on the stub runtime with given synthetic configuration
+static std::shared_ptr<encode_session> CreateEncoder(const char *config) {
+    default_selector sel({ dprops::vendor_impl_id(STUB_VENDOR_IMPL_ID) });
+
+    SetStubConfig(config);
+    std::shared_ptr<encode_session> encoder = std::make_shared<encode_session>(sel);
+    SetStubConfig(nullptr);
+
+    encoder_video_param par;
+    frame_info info;
+    info.set_frame_rate({ 30, 1 });
+    info.set_frame_size({ 320, 240 });
+    info.set_FourCC(color_format_fourcc::nv12);
+    info.set_ChromaFormat(chroma_format_idc::yuv420);
+    info.set_PicStruct(pic_struct::progressive);
+
+    par.set_frame_info(info);
+    par.set_CodecId(codec_format_fourcc::avc);
+    par.set_IOPattern(io_pattern::in_system_memory);
+    encoder->Init(&par);
+
+    return encoder;
+}
+
+static std::vector<std::shared_ptr<frame_surface>> AllocInputs(encode_session &encoder,
+                                                               size_t count) {
+    std::vector<std::shared_ptr<frame_surface>> surfaces;
+    for (size_t i = 0; i < count; i++) {
+        surfaces.push_back(encoder.alloc_input());
+    }
+    return surfaces;
+}
+
+// every bitstream holds one frame of the stub, filled with its frame order
+static bool CheckBitstreams(std::vector<std::shared_ptr<bitstream_as_dst>> &bits) {
+    for (size_t i = 0; i < bits.size(); i++) {
+        auto [ptr, len] = bits[i]->get_valid_data();
+        if (len != STUB_FRAME_SIZE || ptr[0] != (uint8_t)i || ptr[len - 1] != (uint8_t)i) {
+            printf("\n   unexpected bitstream %zu: length %u, data %u\n",
+                   i,
+                   (unsigned)len,
+                   len ? (unsigned)ptr[0] : 0u);
+            return false;
+        }
+    }
+    return true;
+}
+
+// batch larger than async depth is scheduled completely and synced with one wait
+static int TestBatchWait() {
+    std::cout << "Test batch wait";
+
+    auto encoder  = CreateEncoder("latency_encode=1000,async_depth=2,frame_size=100");
+    auto surfaces = AllocInputs(*encoder, 8);
+
+    std::shared_ptr<future_bitstream_batch_t> batch = encoder->process(surfaces);
+    TEST_CHECK(!batch->had_fatal());
+    TEST_CHECK(status::Ok == batch->get_last_schedule_status());
+    TEST_CHECK(8 == batch->size());
+
+    TEST_CHECK(CheckBitstreams(batch->get()));
+    // already synced batch doesn't block
+    TEST_CHECK(async_op_status::ready == batch->wait_for(std::chrono::milliseconds(0)));
+
+    std::cout << " ...OK" << std::endl;
+    return 0;
+}
+
+// device busy with frames of the previous batch is resolved by waiting for them
+static int TestBatchBusyAcrossBatches() {
+    std::cout << "Test batch busy across batches";
+
+    auto encoder = CreateEncoder("latency_encode=20000,async_depth=2,frame_size=100");
+
+    std::shared_ptr<future_bitstream_batch_t> first = encoder->process(AllocInputs(*encoder, 2));
+    TEST_CHECK(2 == first->size());
+    // first batch occupies whole async depth and isn't synced yet
+    std::shared_ptr<future_bitstream_batch_t> second = encoder->process(AllocInputs(*encoder, 2));
+    TEST_CHECK(!second->had_fatal());
+    TEST_CHECK(2 == second->size());
+
+    TEST_CHECK(async_op_status::ready == first->wait_for(std::chrono::milliseconds(0)));
+    TEST_CHECK(async_op_status::ready == second->wait_for(std::chrono::seconds(10)));
+
+    std::cout << " ...OK" << std::endl;
+    return 0;
+}
+
+// wait_for reports the batch as not ready while its last frame is in flight
+static int TestBatchPartialCompletion() {
+    std::cout << "Test batch partial completion";
+
+    auto encoder  = CreateEncoder("latency_encode=200000,async_depth=4,frame_size=100");
+    auto surfaces = AllocInputs(*encoder, 3);
+
+    std::shared_ptr<future_bitstream_batch_t> batch = encoder->process(surfaces);
+    TEST_CHECK(3 == batch->size());
+
+    TEST_CHECK(async_op_status::timeout == batch->wait_for(std::chrono::milliseconds(1)));
+    TEST_CHECK(async_op_status::ready == batch->wait_for(std::chrono::seconds(10)));
+    TEST_CHECK(CheckBitstreams(batch->get()));
+
+    std::cout << " ...OK" << std::endl;
+    return 0;
+}
+
+// null surface drains the encoder and finishes the batch with end of stream
+static int TestBatchDrain() {
+    std::cout << "Test batch drain";
+
+    auto encoder  = CreateEncoder("frame_size=100");
+    auto surfaces = AllocInputs(*encoder, 2);
+    surfaces.push_back(nullptr);
+
+    std::shared_ptr<future_bitstream_batch_t> batch = encoder->process(surfaces);
+    TEST_CHECK(!batch->had_fatal());
+    TEST_CHECK(status::EndOfStreamReached == batch->get_last_schedule_status());
+    TEST_CHECK(2 == batch->size());
+    TEST_CHECK(CheckBitstreams(batch->get()));
+
+    batch = encoder->process(AllocInputs(*encoder, 1));
+    TEST_CHECK(status::EndOfStreamReached == batch->get_last_schedule_status());
+    TEST_CHECK(batch->empty());
+
+    std::cout << " ...OK" << std::endl;
+    return 0;
+}
+
+// execution failure is thrown by the batch wait, next batch is failed at scheduling
+static int TestBatchExecutionError() {
+    std::cout << "Test batch execution error";
+
+    auto encoder =
+        CreateEncoder("latency_encode=1000,error=gpu_hang,error_frame=2,error_op=encode");
+    auto surfaces = AllocInputs(*encoder, 3);
+    // surfaces can't be taken from the failed device
+    auto next = AllocInputs(*encoder, 1);
+
+    std::shared_ptr<future_bitstream_batch_t> batch = encoder->process(surfaces);
+    TEST_CHECK(!batch->had_fatal());
+    TEST_CHECK(3 == batch->size());
+
+    mfxStatus sts = MFX_ERR_NONE;
+    try {
+        batch->wait();
+    }
+    catch (base_exception &e) {
+        sts = e.get_status();
+    }
+    TEST_CHECK(MFX_ERR_GPU_HANG == sts);
+
+    batch = encoder->process(next);
+    TEST_CHECK(batch->had_fatal());
+    TEST_CHECK(batch->empty());
+    // failed batch is cancelled instead of blocking
+    TEST_CHECK(async_op_status::cancelled == batch->wait_for(std::chrono::seconds(10)));
+
+    std::cout << " ...OK" << std::endl;
+    return 0;
+}
+
+// upstream failure stops the batch, frames delivered before it are still scheduled
+static int TestBatchUpstreamError() {
+    std::cout << "Test batch upstream error";
+
+    auto encoder  = CreateEncoder("frame_size=100");
+    auto surfaces = AllocInputs(*encoder, 3);
+
+    std::vector<std::shared_ptr<future_surface_t>> in_futures;
+    for (size_t i = 0; i < surfaces.size(); i++) {
+        operation_status op(component::decoder, nullptr);
+        op.schedule_status_ = (1 == i) ? status::Unknown : status::Ok;
+        op.fatal_           = (1 == i);
+
+        auto f = std::make_shared<future_surface_t>(surfaces[i]);
+        f->add_operation(op);
+        in_futures.push_back(f);
+    }
+
+    std::shared_ptr<future_bitstream_batch_t> batch = encoder->process(in_futures);
+    TEST_CHECK(batch->had_fatal());
+    TEST_CHECK(status::Unknown == batch->get_last_schedule_status());
+    TEST_CHECK(1 == batch->size());
+    // history of the failed input is carried over
+    TEST_CHECK(component::decoder == batch->history_.front().component_);
+
+    std::cout << " ...OK" << std::endl;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int res = 0;
+
+    try {
+        res |= TestBatchWait();
+        res |= TestBatchBusyAcrossBatches();
+        res |= TestBatchPartialCompletion();
+        res |= TestBatchDrain();
+        res |= TestBatchExecutionError();
+        res |= TestBatchUpstreamError();
+    }
+    catch (base_exception &e) {
+        printf("\n   Got exception: %s. Error!\n", e.what());
+        res = -1;
+    }
+
+    if (res)
+        printf("\nErrors in batched encode\n");
+    else
+        printf("\nSuccess!\n");
+
+    return res;
+}
@@ -58,8 +58,20 @@ public:
                 "init_by_header",
                 &Class::init_by_header,
                 "Initialize the session by using bitream portion. This step can be omitted if the codec ID is known or we don't need to get SSP or PPS data from the bitstream.")
-            .def("decode_frame", &Class::decode_frame, "Decodes frame")
-            .def("process", &Class::process, "Decodes frame")
+            .def(
+                "decode_frame",
+                [](Class *self,
+                   std::shared_ptr<vpl::frame_surface> out_surface,
+                   vpl::decoder_process_list list) {
+                    return self->decode_frame(out_surface, list);
+                },
+                "Decodes frame")
+            .def(
+                "process",
+                [](Class *self, vpl::decoder_process_list list) {
+                    return self->process(list);
+                },
+                "Decodes frame")
             .def_property_readonly("Stat", &Class::getStat, "Retrieve decoder statistic")
             .def_property_readonly("Params", &Class::getParams, "Get video params")
             .def("__iter__",
@@ -121,18 +133,30 @@ void init_session(const py::module &m) {
              &vpl::encode_session::alloc_input,
              "Allocate and return shared pointer to the surface")
         //.def("sync", &vpl::encode_session::sync)
-        .def("encode_frame",
-             py::overload_cast<std::shared_ptr<vpl::frame_surface>,
-                               std::shared_ptr<vpl::bitstream_as_dst>,
-                               vpl::encoder_process_list>(&vpl::encode_session::encode_frame),
-             "Encodes frame")
-        .def("encode_frame",
-             py::overload_cast<std::shared_ptr<vpl::bitstream_as_dst>, vpl::encoder_process_list>(
-                 &vpl::encode_session::encode_frame),
-             "Encodes frame by using provided source reader to get data to encode")
+        .def(
+            "encode_frame",
+            [](vpl::encode_session *self,
+               std::shared_ptr<vpl::frame_surface> in_surface,
+               std::shared_ptr<vpl::bitstream_as_dst> bs,
+               vpl::encoder_process_list list) {
+                return self->encode_frame(in_surface, bs, list);
+            },
+            "Encodes frame")
+        .def(
+            "encode_frame",
+            [](vpl::encode_session *self,
+               std::shared_ptr<vpl::bitstream_as_dst> bs,
+               vpl::encoder_process_list list) {
+                return self->encode_frame(bs, list);
+            },
+            "Encodes frame by using provided source reader to get data to encode")
         .def(
             "process",
-            &vpl::encode_session::process,
+            [](vpl::encode_session *self,
+               std::shared_ptr<vpl::future_surface_t> in_future,
+               vpl::encoder_process_list list) {
+                return self->process(in_future, list);
+            },
             "Encode frame. Function returns the future object with the bitstream which will hold processed data. User needs to sync up the future object before accessing.")
         .def_property_readonly("Stat", &vpl::encode_session::getStat, "Retrieve encoder statistic")
         .def("__iter__",
@@ -232,15 +232,35 @@ int main(int argc, char *argv[]) {
 
     bool bPrintImplementedFunctions = false;
     bool bFullInfo                  = true;
-    if (argc == 2) {
-        if (!strncmp(argv[1], "-f", 2)) {
+    const char *snapshotFile        = nullptr;
+    for (int arg = 1; arg < argc; arg++) {
+        if (!strcmp(argv[arg], "-snapshot") && arg + 1 < argc) {
+            snapshotFile = argv[++arg];
+        }
+        else if (!strncmp(argv[arg], "-f", 2)) {
             bPrintImplementedFunctions = true;
         }
-        else if (!strncmp(argv[1], "-b", 2)) {
+        else if (!strncmp(argv[arg], "-b", 2)) {
             bFullInfo = false;
         }
     }
 
+#ifdef ONEVPL_EXPERIMENTAL
+    // write binary caps snapshot for use with ONEVPL_CAPS_SNAPSHOT
+    if (snapshotFile) {
+        mfxStatus sts = MFXSaveCapsSnapshot(loader, snapshotFile);
+        if (sts != MFX_ERR_NONE) {
+            printf("Error - MFXSaveCapsSnapshot() failed with code %d\n", sts);
+            MFXUnload(loader);
+            return -1;
+        }
+        printf("Caps snapshot written to %s\n", snapshotFile);
+    }
+#else
+    if (snapshotFile)
+        printf("Warning - caps snapshot requires dispatcher with ONEVPL_EXPERIMENTAL APIs\n");
+#endif
+
     int i = 0;
     mfxImplDescription *idesc;
     while (MFX_ERR_NONE == MFXEnumImplementations(loader,
@@ -22,9 +22,19 @@ typedef enum {
     CTT_USAGE_VIDEO_ENHANCEMENT = 3, // VEBOX
     CTT_USAGE_VIDEO2            = 4, // VDBOX2
     CTT_AVG_GT_FREQ             = 5, // Average GT frequency
-    CTT_MAX_METRIC_COUNT        = CTT_AVG_GT_FREQ + 1
+    CTT_MAX_METRIC_COUNT        = CTT_AVG_GT_FREQ + 1,
+
+    /* CPU metrics, reported when i915 instrumentation is not used. See CTTMetrics_Init() */
+    CTT_CPU_USAGE_PROCESS    = 0x100, // CPU usage of monitored process, % of one core
+    CTT_CPU_USAGE_THREAD_MAX = 0x101, // CPU usage of the busiest thread, % of one core
+    CTT_CPU_USAGE_SYSTEM     = 0x102, // Overall CPU usage, % of all cores
+    CTT_CONTEXT_SWITCHES     = 0x103, // Context switches of monitored process per second
+    CTT_MEM_BANDWIDTH        = 0x104 // Estimated memory traffic (LLC misses), MB per second
 } cttMetric;
 
+/* number of CPU metrics */
+#define CTT_MAX_CPU_METRIC_COUNT (CTT_MEM_BANDWIDTH - CTT_CPU_USAGE_PROCESS + 1)
+
 /*
     Error codes
 */
@@ -54,6 +64,12 @@ typedef enum {
 
 /*
     Initializes media metrics library.
+
+    device - Path to gfx device (like /dev/dri/card* or /dev/dri/renderD*) or NULL.
+             If device is NULL and i915 instrumentation is not available, CPU metrics
+             of the calling process are collected instead.
+             "cpu" or "cpu:<pid>" - collect CPU metrics of the calling process or of process <pid>.
+             "replay:<file>" - return metrics recorded by CTTMetrics_StartRecording().
 */
 cttStatus CTTMetrics_Init(const char* device);
 
@@ -105,6 +121,14 @@ cttStatus CTTMetrics_SetSamplePeriod(unsigned int in_period);
 */
 void CTTMetrics_Close();
 
+/*
+    Starts recording of metric values returned by CTTMetrics_GetValue() to the text file.
+    Must be called after CTTMetrics_Init(). Recording stops in CTTMetrics_Close().
+
+    file - Path to the record file. Existing file is overwritten.
+*/
+cttStatus CTTMetrics_StartRecording(const char* file);
+
 /*
     Returns metric values.
     Number of values equals to *count* - numbers of metric ids in CTTMetrics_Init().
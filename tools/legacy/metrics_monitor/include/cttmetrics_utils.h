@@ -7,7 +7,11 @@
 #ifndef __CTTMETRICS_UTILS_H__
 #define __CTTMETRICS_UTILS_H__
 
+#include <linux/perf_event.h>
 #include <stdio.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
 
 #include "cttmetrics.h"
 
@@ -28,4 +32,22 @@ extern cttStatus discover_path_to_gpu();
 
 extern int read_freq(int fd);
 
+static inline int perf_event_open(struct perf_event_attr* attr,
+                                  pid_t pid,
+                                  int cpu,
+                                  int group_fd,
+                                  unsigned long flags) {
+#ifndef __NR_perf_event_open
+    #if defined(__i386__)
+        #define __NR_perf_event_open 336
+    #elif defined(__x86_64__)
+        #define __NR_perf_event_open 298
+    #else
+        #define __NR_perf_event_open 0
+    #endif
+#endif
+    attr->size = sizeof(*attr);
+    return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+
 #endif // #ifndef __CTTMETRICS_UTILS_H__
@@ -30,7 +30,7 @@ void signal_handler(int signo) {
 
 static void usage(const char* appname) {
     printf(
-        "metrics_monitor - Monitors GPU usage per engine\n"
+        "metrics_monitor - Monitors GPU usage per engine or CPU usage of a process\n"
         "\n"
         "Usage: %s [OPTION]\n"
         "\n"
@@ -39,7 +39,10 @@ static void usage(const char* appname) {
         "\t[-s <num>]    Number of metric samples to collect during sampling period(valid range %u..%u, default %u).\n"
         "\t[-p <ms>]     Sampling period in milliseconds(valid range %u..%u, default %u).\n"
         "\t[-d <path>]   Path to gfx device (like /dev/dri/card* or /dev/dri/renderD*).\n"
-        "\t              If device is not set, the tool uses i915 render node device with smallest number."
+        "\t              If device is not set, the tool uses i915 render node device with smallest number.\n"
+        "\t              \"cpu:<pid>\" - monitor CPU usage of process <pid>.\n"
+        "\t              \"replay:<file>\" - print metrics recorded with -r option.\n"
+        "\t[-r <file>]   Record metrics to the file.\n"
         "\n",
         appname,
         MIN_NUMSAMPLES,
@@ -50,6 +53,67 @@ static void usage(const char* appname) {
         DEFAULT_PERIOD_MS);
 }
 
+static const char* cpu_metric_name(cttMetric metric) {
+    switch (metric) {
+        case CTT_CPU_USAGE_PROCESS:
+            return "CPU process usage";
+        case CTT_CPU_USAGE_THREAD_MAX:
+            return "CPU max thread usage";
+        case CTT_CPU_USAGE_SYSTEM:
+            return "CPU system usage";
+        case CTT_CONTEXT_SWITCHES:
+            return "Context switches/s";
+        case CTT_MEM_BANDWIDTH:
+            return "Memory MB/s";
+        default:
+            return "Unknown";
+    }
+}
+
+static cttStatus monitor_cpu(unsigned int metric_cnt,
+                             cttMetric* metrics_ids,
+                             unsigned int num_samples,
+                             unsigned int period_ms) {
+    cttStatus status = CTTMetrics_Subscribe(metric_cnt, metrics_ids);
+    if (CTT_ERR_NONE != status) {
+        fprintf(stderr, "ERROR: Failed to subscribe for metrics, error code %d\n", (int)status);
+        return status;
+    }
+
+    status = CTTMetrics_SetSampleCount(num_samples);
+    if (CTT_ERR_NONE != status) {
+        fprintf(stderr, "ERROR: Failed to set number of samples, error code %d\n", (int)status);
+        return status;
+    }
+
+    status = CTTMetrics_SetSamplePeriod(period_ms);
+    if (CTT_ERR_NONE != status) {
+        fprintf(stderr, "ERROR: Failed to set measure interval, error code %d\n", (int)status);
+        return status;
+    }
+
+    float metric_values[CTT_MAX_METRIC_COUNT] = {};
+
+    while (run) {
+        status = CTTMetrics_GetValue(metric_cnt, metric_values);
+        if (CTT_ERR_NO_DATA == status)
+            return CTT_ERR_NONE; // end of replayed record
+        if (CTT_ERR_NONE != status) {
+            fprintf(stderr, "ERROR: Failed to get metrics, error code %d\n", status);
+            return status;
+        }
+
+        for (unsigned int i = 0; i < metric_cnt; ++i)
+            printf("%s%s: %3.2f",
+                   i ? ",\t" : "",
+                   cpu_metric_name(metrics_ids[i]),
+                   metric_values[i]);
+        printf("\n");
+    }
+
+    return CTT_ERR_NONE;
+}
+
 int main(int argc, char* argv[]) {
     cttStatus status        = CTT_ERR_NONE;
     cttMetric metrics_ids[] = { CTT_USAGE_RENDER,
@@ -62,14 +126,18 @@ int main(int argc, char* argv[]) {
     unsigned int num_samples = DEFAULT_NUMSAMPLES;
     unsigned int period_ms   = DEFAULT_PERIOD_MS;
     char* device_path        = NULL;
+    char* record_path        = NULL;
     int ch;
 
     /* Parse options */
-    while ((ch = getopt(argc, argv, "d:s:p:h")) != -1) {
+    while ((ch = getopt(argc, argv, "d:s:p:r:h")) != -1) {
         switch (ch) {
             case 'd':
                 device_path = optarg;
                 break;
+            case 'r':
+                record_path = optarg;
+                break;
             case 's':
                 num_samples = atoi(optarg);
                 if (num_samples < MIN_NUMSAMPLES || num_samples > MAX_NUMSAMPLES) {
@@ -114,6 +182,9 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    if (metric_all_cnt > CTT_MAX_METRIC_COUNT)
+        metric_all_cnt = CTT_MAX_METRIC_COUNT; // replayed record may have more metrics
+
     cttMetric metric_all_ids[CTT_MAX_METRIC_COUNT] = { CTT_WRONG_METRIC_ID };
     status = CTTMetrics_GetMetricInfo(metric_all_cnt, metric_all_ids);
     if (CTT_ERR_NONE != status) {
@@ -121,7 +192,28 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    if (record_path) {
+        status = CTTMetrics_StartRecording(record_path);
+        if (CTT_ERR_NONE != status) {
+            fprintf(stderr, "ERROR: Failed to start recording, error code %d\n", (int)status);
+            return 1;
+        }
+    }
+
     unsigned int i;
+    bool isRender = false;
+    for (i = 0; i < metric_all_cnt; ++i) {
+        if (CTT_USAGE_RENDER == metric_all_ids[i])
+            isRender = true;
+    }
+
+    if (false == isRender) {
+        // no GPU metrics, CPU collector is used
+        status = monitor_cpu(metric_all_cnt, metric_all_ids, num_samples, period_ms);
+        CTTMetrics_Close();
+        return (CTT_ERR_NONE == status) ? 0 : 1;
+    }
+
     bool isVideo2 = false;
     for (i = 0; i < metric_all_cnt; ++i) {
         if (CTT_USAGE_VIDEO2 == metric_all_ids[i])
@@ -163,6 +255,8 @@ int main(int argc, char* argv[]) {
 
     while (run) {
         status = CTTMetrics_GetValue(metric_cnt, metric_values);
+        if (CTT_ERR_NO_DATA == status && device_path && !strncmp(device_path, "replay:", 7))
+            break; // end of record
         if (CTT_ERR_NONE != status) {
             fprintf(stderr, "ERROR: Failed to get metrics, error code %d\n", status);
             return 1;
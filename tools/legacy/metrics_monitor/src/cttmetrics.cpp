@@ -7,6 +7,9 @@
 #include "cttmetrics.h"
 
 #include <stdio.h>
+#include <string.h>
+
+#include <vector>
 
 struct CttMetricsCollector {
     cttStatus (*Init)(const char* device);
@@ -30,6 +33,7 @@ cttStatus CTTMetrics_Custom_Subscribe(unsigned int count, cttMetric* in_metric_i
 cttStatus CTTMetrics_Custom_GetValue(unsigned int count, float* out_metric_values);
 }
 
+#ifdef CTTMETRICS_I915_PMU
 extern "C" {
 cttStatus CTTMetrics_PMU_Init(const char* device);
 void CTTMetrics_PMU_Close();
@@ -40,10 +44,34 @@ cttStatus CTTMetrics_PMU_GetMetricInfo(unsigned int count, cttMetric* out_metric
 cttStatus CTTMetrics_PMU_Subscribe(unsigned int count, cttMetric* in_metric_id);
 cttStatus CTTMetrics_PMU_GetValue(unsigned int count, float* out_metric_values);
 }
+#endif
+
+extern "C" {
+cttStatus CTTMetrics_CPU_Init(const char* device);
+void CTTMetrics_CPU_Close();
+cttStatus CTTMetrics_CPU_SetSamplePeriod(unsigned int in_period);
+cttStatus CTTMetrics_CPU_SetSampleCount(unsigned int in_num);
+cttStatus CTTMetrics_CPU_GetMetricCount(unsigned int* out_count);
+cttStatus CTTMetrics_CPU_GetMetricInfo(unsigned int count, cttMetric* out_metric_ids);
+cttStatus CTTMetrics_CPU_Subscribe(unsigned int count, cttMetric* in_metric_id);
+cttStatus CTTMetrics_CPU_GetValue(unsigned int count, float* out_metric_values);
+}
+
+extern "C" {
+cttStatus CTTMetrics_Replay_Init(const char* device);
+void CTTMetrics_Replay_Close();
+cttStatus CTTMetrics_Replay_SetSamplePeriod(unsigned int in_period);
+cttStatus CTTMetrics_Replay_SetSampleCount(unsigned int in_num);
+cttStatus CTTMetrics_Replay_GetMetricCount(unsigned int* out_count);
+cttStatus CTTMetrics_Replay_GetMetricInfo(unsigned int count, cttMetric* out_metric_ids);
+cttStatus CTTMetrics_Replay_Subscribe(unsigned int count, cttMetric* in_metric_id);
+cttStatus CTTMetrics_Replay_GetValue(unsigned int count, float* out_metric_values);
+}
 
 // List of collectors in the priority order. Library will try to inialize
 // them one by one. First collector successfully initialized will be used.
 static CttMetricsCollector g_Collectors[] = {
+#ifdef CTTMETRICS_I915_PMU
     // This collector works thru i915 PMU API. It will work for:
     //  * User with root priviligies
     //  * Application with CAP_SYS_ADMIN capability (setcap cap_sys_admin+ep ./application)
@@ -56,6 +84,7 @@ static CttMetricsCollector g_Collectors[] = {
       CTTMetrics_PMU_GetMetricInfo,
       CTTMetrics_PMU_Subscribe,
       CTTMetrics_PMU_GetValue },
+#endif
     // This collector requires custom (patched) i915 driver.
     // It will work only for user with root priviligies (it access debugfs).
     { CTTMetrics_Custom_Init,
@@ -67,21 +96,72 @@ static CttMetricsCollector g_Collectors[] = {
       CTTMetrics_Custom_Subscribe,
       CTTMetrics_Custom_GetValue },
 };
+
+// This collector reads CPU usage and context switches of a process from /proc.
+// Memory bandwidth is estimated with perf LLC miss counters if they are accessible.
+// It is used when i915 instrumentation is not available or "cpu" device is requested.
+static CttMetricsCollector g_CpuCollector = { CTTMetrics_CPU_Init,
+                                              CTTMetrics_CPU_Close,
+                                              CTTMetrics_CPU_SetSamplePeriod,
+                                              CTTMetrics_CPU_SetSampleCount,
+                                              CTTMetrics_CPU_GetMetricCount,
+                                              CTTMetrics_CPU_GetMetricInfo,
+                                              CTTMetrics_CPU_Subscribe,
+                                              CTTMetrics_CPU_GetValue };
+
+// This collector returns values recorded by CTTMetrics_StartRecording().
+static CttMetricsCollector g_ReplayCollector = { CTTMetrics_Replay_Init,
+                                                 CTTMetrics_Replay_Close,
+                                                 CTTMetrics_Replay_SetSamplePeriod,
+                                                 CTTMetrics_Replay_SetSampleCount,
+                                                 CTTMetrics_Replay_GetMetricCount,
+                                                 CTTMetrics_Replay_GetMetricInfo,
+                                                 CTTMetrics_Replay_Subscribe,
+                                                 CTTMetrics_Replay_GetValue };
+
+static const char CPU_DEVICE_PREFIX[]    = "cpu";
+static const char REPLAY_DEVICE_PREFIX[] = "replay:";
+
 static CttMetricsCollector* g_SelectedCollector = NULL;
 
+static FILE* g_RecordFile = NULL;
+static std::vector<cttMetric> g_SubscribedMetrics;
+static bool g_RecordMetrics         = false; // subscription changed, record new metrics list
+static unsigned int g_RecordedCount = 0; // number of metrics in the last recorded list
+
+static bool has_prefix(const char* str, const char* prefix) {
+    return str && 0 == strncmp(str, prefix, strlen(prefix));
+}
+
+static cttStatus init_collector(CttMetricsCollector* collector, const char* device) {
+    cttStatus status = collector->Init(device);
+    if (status == CTT_ERR_NONE)
+        g_SelectedCollector = collector;
+    return status;
+}
+
 extern "C" cttStatus CTTMetrics_Init(const char* device) {
     cttStatus status = CTT_ERR_DRIVER_NO_INSTRUMENTATION;
 
     if (g_SelectedCollector)
         return CTT_ERR_ALREADY_INITIALIZED;
 
+    if (has_prefix(device, REPLAY_DEVICE_PREFIX))
+        return init_collector(&g_ReplayCollector, device + strlen(REPLAY_DEVICE_PREFIX));
+
+    if (has_prefix(device, CPU_DEVICE_PREFIX))
+        return init_collector(&g_CpuCollector, device);
+
     for (size_t i = 0; i < sizeof(g_Collectors) / sizeof(g_Collectors[0]); ++i) {
-        status = g_Collectors[i].Init(device);
-        if (status == CTT_ERR_NONE) {
-            g_SelectedCollector = &g_Collectors[i];
+        status = init_collector(&g_Collectors[i], device);
+        if (status == CTT_ERR_NONE)
             break;
-        }
     }
+
+    // no i915 instrumentation, monitor the calling process on CPU
+    if (status != CTT_ERR_NONE && !device)
+        status = init_collector(&g_CpuCollector, NULL);
+
     return status;
 }
 
@@ -90,6 +170,34 @@ extern "C" void CTTMetrics_Close() {
         return;
     g_SelectedCollector->Close();
     g_SelectedCollector = NULL;
+
+    if (g_RecordFile) {
+        fclose(g_RecordFile);
+        g_RecordFile = NULL;
+    }
+    g_SubscribedMetrics.clear();
+    g_RecordMetrics = false;
+    g_RecordedCount = 0;
+}
+
+extern "C" cttStatus CTTMetrics_StartRecording(const char* file) {
+    if (!g_SelectedCollector)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (!file)
+        return CTT_ERR_NULL_PTR;
+
+    if (g_RecordFile)
+        fclose(g_RecordFile);
+
+    g_RecordFile = fopen(file, "w");
+    if (!g_RecordFile)
+        return CTT_ERR_NOT_FOUND;
+
+    fprintf(g_RecordFile, "# cttmetrics record\n");
+    g_RecordMetrics = true;
+
+    return CTT_ERR_NONE;
 }
 
 extern "C" cttStatus CTTMetrics_SetSamplePeriod(unsigned int in_period) {
@@ -119,11 +227,41 @@ extern "C" cttStatus CTTMetrics_GetMetricInfo(unsigned int count, cttMetric* out
 extern "C" cttStatus CTTMetrics_Subscribe(unsigned int count, cttMetric* in_metric_ids) {
     if (!g_SelectedCollector)
         return CTT_ERR_NOT_INITIALIZED;
-    return g_SelectedCollector->Subscribe(count, in_metric_ids);
+
+    cttStatus status = g_SelectedCollector->Subscribe(count, in_metric_ids);
+    if (status >= CTT_ERR_NONE) {
+        g_SubscribedMetrics.assign(in_metric_ids, in_metric_ids + count);
+        g_RecordMetrics = true;
+    }
+    return status;
 }
 
 extern "C" cttStatus CTTMetrics_GetValue(unsigned int count, float* out_metric_values) {
     if (!g_SelectedCollector)
         return CTT_ERR_NOT_INITIALIZED;
-    return g_SelectedCollector->GetValue(count, out_metric_values);
+
+    cttStatus status = g_SelectedCollector->GetValue(count, out_metric_values);
+    if (status != CTT_ERR_NONE || !g_RecordFile)
+        return status;
+
+    // app may request first metrics only
+    if (count > g_SubscribedMetrics.size())
+        count = (unsigned int)g_SubscribedMetrics.size();
+
+    if (g_RecordMetrics || g_RecordedCount != count) {
+        fprintf(g_RecordFile, "metrics");
+        for (unsigned int i = 0; i < count; ++i)
+            fprintf(g_RecordFile, " %d", (int)g_SubscribedMetrics[i]);
+        fprintf(g_RecordFile, "\n");
+        g_RecordMetrics = false;
+        g_RecordedCount = count;
+    }
+
+    fprintf(g_RecordFile, "values");
+    for (unsigned int i = 0; i < count; ++i)
+        fprintf(g_RecordFile, " %.9g", out_metric_values[i]);
+    fprintf(g_RecordFile, "\n");
+    fflush(g_RecordFile);
+
+    return status;
 }
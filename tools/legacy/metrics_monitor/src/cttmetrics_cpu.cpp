@@ -0,0 +1,418 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "cttmetrics_utils.h"
+
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <map>
+#include <vector>
+
+static const uint64_t CACHE_LINE_SIZE = 64;
+
+struct thread_counters {
+    uint64_t ticks; /* utime + stime in clock ticks */
+    uint64_t ctx_switches; /* voluntary + nonvoluntary */
+};
+
+struct cpu_sample {
+    uint64_t time_ns;
+    uint64_t process_ticks;
+    uint64_t system_busy_ticks;
+    uint64_t system_total_ticks;
+    uint64_t llc_misses;
+    std::map<pid_t, thread_counters> threads;
+};
+
+struct cpu_collector_ctx_t {
+    bool initialized;
+    unsigned int sample_period_us;
+    unsigned int metrics_count;
+    long clock_ticks;
+
+    unsigned int user_idx_map[CTT_MAX_CPU_METRIC_COUNT];
+    cttMetric metrics[CTT_MAX_CPU_METRIC_COUNT];
+
+    pid_t pid;
+    std::vector<int> llc_fds; /* one system wide LLC misses counter per cpu */
+
+    cpu_sample start;
+    cpu_sample end;
+};
+
+static cpu_collector_ctx_t g_ctx;
+
+static uint64_t get_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* reads utime + stime from /proc/<pid>/stat or /proc/<pid>/task/<tid>/stat */
+static int read_stat_ticks(const char* path, uint64_t* ticks) {
+    char buf[1024];
+
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return -1;
+
+    size_t len = fread(buf, 1, sizeof(buf) - 1, file);
+    fclose(file);
+    buf[len] = '\0';
+
+    /* process name may contain spaces and brackets, fields are counted from the last ')' */
+    char* s = strrchr(buf, ')');
+    if (!s)
+        return -1;
+
+    unsigned long long utime = 0, stime = 0;
+    if (2 != sscanf(s + 1,
+                    " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                    &utime,
+                    &stime))
+        return -1;
+
+    *ticks = utime + stime;
+    return 0;
+}
+
+static int read_ctx_switches(const char* path, uint64_t* ctx_switches) {
+    char line[256];
+    unsigned long long value = 0;
+
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return -1;
+
+    *ctx_switches = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (1 == sscanf(line, "voluntary_ctxt_switches: %llu", &value) ||
+            1 == sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value))
+            *ctx_switches += value;
+    }
+    fclose(file);
+
+    return 0;
+}
+
+static int read_system_ticks(uint64_t* busy, uint64_t* total) {
+    unsigned long long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0,
+                       steal = 0;
+
+    FILE* file = fopen("/proc/stat", "r");
+    if (!file)
+        return -1;
+
+    int res = fscanf(file,
+                     "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+                     &user,
+                     &nice,
+                     &system,
+                     &idle,
+                     &iowait,
+                     &irq,
+                     &softirq,
+                     &steal);
+    fclose(file);
+    if (res < 4)
+        return -1;
+
+    /* guest time is already accounted in user time */
+    *total = user + nice + system + idle + iowait + irq + softirq + steal;
+    *busy  = *total - idle - iowait;
+    return 0;
+}
+
+static void read_threads(pid_t pid, std::map<pid_t, thread_counters>& threads) {
+    char path[64];
+
+    threads.clear();
+
+    snprintf(path, sizeof(path), "/proc/%d/task", (int)pid);
+    DIR* dir = opendir(path);
+    if (!dir)
+        return;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        pid_t tid = (pid_t)atoi(entry->d_name);
+        if (tid <= 0)
+            continue;
+
+        thread_counters counters = {};
+
+        snprintf(path, sizeof(path), "/proc/%d/task/%d/stat", (int)pid, (int)tid);
+        if (read_stat_ticks(path, &counters.ticks))
+            continue; // thread exited
+
+        snprintf(path, sizeof(path), "/proc/%d/task/%d/status", (int)pid, (int)tid);
+        read_ctx_switches(path, &counters.ctx_switches);
+
+        threads[tid] = counters;
+    }
+    closedir(dir);
+}
+
+static uint64_t read_llc_misses() {
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < g_ctx.llc_fds.size(); ++i) {
+        uint64_t value = 0;
+        if (sizeof(value) == read(g_ctx.llc_fds[i], &value, sizeof(value)))
+            total += value;
+    }
+
+    return total;
+}
+
+static int cpu_read(cpu_sample* sample) {
+    char path[64];
+
+    sample->time_ns = get_time_ns();
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)g_ctx.pid);
+    if (read_stat_ticks(path, &sample->process_ticks))
+        return -1;
+
+    if (read_system_ticks(&sample->system_busy_ticks, &sample->system_total_ticks))
+        return -1;
+
+    read_threads(g_ctx.pid, sample->threads);
+    sample->llc_misses = read_llc_misses();
+
+    return 0;
+}
+
+/* LLC misses are counted system wide, it requires perf_event_paranoid < 1 or CAP_PERFMON */
+static void llc_open() {
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (long cpu = 0; cpu < num_cpus; ++cpu) {
+        struct perf_event_attr attr = {};
+        attr.type                   = PERF_TYPE_HARDWARE;
+        attr.config                 = PERF_COUNT_HW_CACHE_MISSES;
+
+        int fd = perf_event_open(&attr, -1, (int)cpu, -1, 0);
+        if (fd < 0) {
+            // partial system coverage would report wrong bandwidth
+            for (size_t i = 0; i < g_ctx.llc_fds.size(); ++i)
+                close(g_ctx.llc_fds[i]);
+            g_ctx.llc_fds.clear();
+            return;
+        }
+        g_ctx.llc_fds.push_back(fd);
+    }
+}
+
+extern "C" cttStatus CTTMetrics_CPU_Init(const char* device) {
+    if (g_ctx.initialized)
+        return CTT_ERR_ALREADY_INITIALIZED;
+
+    g_ctx.sample_period_us = 500 * 1000;
+    g_ctx.metrics_count    = 0;
+    g_ctx.clock_ticks      = sysconf(_SC_CLK_TCK);
+    g_ctx.pid              = getpid();
+
+    /* device is "cpu:<pid>" to monitor other process */
+    const char* pid_str = device ? strchr(device, ':') : NULL;
+    if (pid_str) {
+        char* end = NULL;
+        long pid  = strtol(pid_str + 1, &end, 10);
+        if (pid <= 0 || *end)
+            return CTT_ERR_NOT_FOUND;
+        g_ctx.pid = (pid_t)pid;
+    }
+
+    if (g_ctx.clock_ticks <= 0)
+        return CTT_ERR_NO_DATA;
+
+    if (0 != cpu_read(&g_ctx.end))
+        return CTT_ERR_NOT_FOUND;
+
+    g_ctx.metrics[g_ctx.metrics_count++] = CTT_CPU_USAGE_PROCESS;
+    g_ctx.metrics[g_ctx.metrics_count++] = CTT_CPU_USAGE_THREAD_MAX;
+    g_ctx.metrics[g_ctx.metrics_count++] = CTT_CPU_USAGE_SYSTEM;
+    g_ctx.metrics[g_ctx.metrics_count++] = CTT_CONTEXT_SWITCHES;
+
+    llc_open();
+    if (!g_ctx.llc_fds.empty())
+        g_ctx.metrics[g_ctx.metrics_count++] = CTT_MEM_BANDWIDTH;
+
+    g_ctx.initialized = true;
+    return CTT_ERR_NONE;
+}
+
+extern "C" void CTTMetrics_CPU_Close() {
+    if (!g_ctx.initialized)
+        return;
+
+    for (size_t i = 0; i < g_ctx.llc_fds.size(); ++i)
+        close(g_ctx.llc_fds[i]);
+    g_ctx.llc_fds.clear();
+    g_ctx.start.threads.clear();
+    g_ctx.end.threads.clear();
+    g_ctx.metrics_count = 0;
+    g_ctx.initialized   = false;
+}
+
+extern "C" cttStatus CTTMetrics_CPU_SetSamplePeriod(unsigned int in_period) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (in_period > 1000 || in_period < 10)
+        return CTT_ERR_OUT_OF_RANGE;
+
+    g_ctx.sample_period_us = in_period * 1000;
+
+    return CTT_ERR_NONE;
+}
+
+extern "C" cttStatus CTTMetrics_CPU_SetSampleCount(unsigned int in_num) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (in_num > 1000 || in_num < 1)
+        return CTT_ERR_OUT_OF_RANGE;
+
+    // counters are accumulated by the kernel, sampling within the period is not needed
+    return CTT_ERR_NONE;
+}
+
+extern "C" cttStatus CTTMetrics_CPU_GetMetricCount(unsigned int* out_count) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (!out_count)
+        return CTT_ERR_NULL_PTR;
+
+    *out_count = g_ctx.metrics_count;
+    return CTT_ERR_NONE;
+}
+
+extern "C" cttStatus CTTMetrics_CPU_GetMetricInfo(unsigned int count, cttMetric* out_metric_ids) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (!out_metric_ids)
+        return CTT_ERR_NULL_PTR;
+
+    if (count > g_ctx.metrics_count)
+        return CTT_ERR_OUT_OF_RANGE;
+
+    for (unsigned int i = 0; i < count; ++i) {
+        out_metric_ids[i] = g_ctx.metrics[i];
+    }
+
+    return CTT_ERR_NONE;
+}
+
+extern "C" cttStatus CTTMetrics_CPU_Subscribe(unsigned int count, cttMetric* in_metric_ids) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (!in_metric_ids)
+        return CTT_ERR_NULL_PTR;
+
+    if (count > g_ctx.metrics_count)
+        return CTT_ERR_OUT_OF_RANGE;
+
+    unsigned int na_metric_cnt = 0;
+    for (unsigned int i = 0; i < count; ++i) {
+        g_ctx.user_idx_map[i] = g_ctx.metrics_count;
+
+        for (unsigned int j = 0; j < g_ctx.metrics_count; ++j) {
+            if (in_metric_ids[i] == g_ctx.metrics[j]) {
+                g_ctx.user_idx_map[i] = j;
+                break;
+            }
+        }
+        if (g_ctx.user_idx_map[i] == g_ctx.metrics_count)
+            ++na_metric_cnt;
+    }
+
+    return (na_metric_cnt) ? CTT_WRN_METRIC_UNAVAILABLE : CTT_ERR_NONE;
+}
+
+extern "C" cttStatus CTTMetrics_CPU_GetValue(unsigned int count, float* out_metric_values) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (!out_metric_values)
+        return CTT_ERR_NULL_PTR;
+
+    if (count > g_ctx.metrics_count)
+        return CTT_ERR_OUT_OF_RANGE;
+
+    if (0 != cpu_read(&g_ctx.start))
+        return CTT_ERR_NO_DATA;
+
+    usleep(g_ctx.sample_period_us);
+
+    if (0 != cpu_read(&g_ctx.end))
+        return CTT_ERR_NO_DATA;
+
+    double time  = (double)(g_ctx.end.time_ns - g_ctx.start.time_ns) / 1000000000;
+    double ticks = time * g_ctx.clock_ticks;
+
+    /* threads started during the period are accounted completely,
+       activity of threads exited during the period is lost */
+    uint64_t ctx_switches = 0, max_thread_ticks = 0;
+    for (std::map<pid_t, thread_counters>::const_iterator it = g_ctx.end.threads.begin();
+         it != g_ctx.end.threads.end();
+         ++it) {
+        thread_counters prev = {};
+        std::map<pid_t, thread_counters>::const_iterator prev_it =
+            g_ctx.start.threads.find(it->first);
+        if (prev_it != g_ctx.start.threads.end())
+            prev = prev_it->second;
+
+        uint64_t thread_ticks = it->second.ticks - prev.ticks;
+        if (thread_ticks > max_thread_ticks)
+            max_thread_ticks = thread_ticks;
+        ctx_switches += it->second.ctx_switches - prev.ctx_switches;
+    }
+
+    for (unsigned int i = 0; i < count; ++i) {
+        double value = 0.0; // not subscribed/unavailable metrics are always idle
+
+        if (g_ctx.metrics_count != g_ctx.user_idx_map[i] && time > 0) {
+            switch (g_ctx.metrics[g_ctx.user_idx_map[i]]) {
+                case CTT_CPU_USAGE_PROCESS:
+                    value = (g_ctx.end.process_ticks - g_ctx.start.process_ticks) * 100 / ticks;
+                    break;
+                case CTT_CPU_USAGE_THREAD_MAX:
+                    value = max_thread_ticks * 100 / ticks;
+                    break;
+                case CTT_CPU_USAGE_SYSTEM: {
+                    uint64_t total =
+                        g_ctx.end.system_total_ticks - g_ctx.start.system_total_ticks;
+                    uint64_t busy = g_ctx.end.system_busy_ticks - g_ctx.start.system_busy_ticks;
+                    value         = total ? (double)busy * 100 / total : 0.0;
+                    break;
+                }
+                case CTT_CONTEXT_SWITCHES:
+                    value = ctx_switches / time;
+                    break;
+                case CTT_MEM_BANDWIDTH:
+                    value = (double)(g_ctx.end.llc_misses - g_ctx.start.llc_misses) *
+                            CACHE_LINE_SIZE / (1024 * 1024) / time;
+                    break;
+                default:
+                    break; // if we are here - that's a bug
+            }
+        }
+
+        out_metric_values[i] = value;
+    }
+
+    return CTT_ERR_NONE;
+}
@@ -48,24 +48,6 @@ static int get_engine_id(uint64_t config) {
     return config & 0xffff0;
 }
 
-static inline int perf_event_open(struct perf_event_attr* attr,
-                                  pid_t pid,
-                                  int cpu,
-                                  int group_fd,
-                                  unsigned long flags) {
-#ifndef __NR_perf_event_open
-    #if defined(__i386__)
-        #define __NR_perf_event_open 336
-    #elif defined(__x86_64__)
-        #define __NR_perf_event_open 298
-    #else
-        #define __NR_perf_event_open 0
-    #endif
-#endif
-    attr->size = sizeof(*attr);
-    return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
-}
-
 static char* bus_address(int i915, char* path, int pathlen) {
     struct stat st = {};
     if (fstat(i915, &st) || !S_ISCHR(st.st_mode))
@@ -0,0 +1,215 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "cttmetrics_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/*
+    Record file is a text file:
+        # comment
+        metrics <id> <id> ...   - ids of metrics in following samples
+        values <val> <val> ...  - one sample, values of the last listed metrics
+*/
+
+typedef std::vector<std::pair<cttMetric, float>> replay_sample;
+
+struct replay_collector_ctx_t {
+    bool initialized;
+    size_t position;
+
+    std::vector<cttMetric> metrics;
+    std::vector<cttMetric> subscribed;
+    std::vector<replay_sample> samples;
+};
+
+static replay_collector_ctx_t g_ctx;
+
+static cttStatus replay_load(const char* file_name) {
+    char line[4096];
+    std::vector<cttMetric> ids;
+
+    FILE* file = fopen(file_name, "r");
+    if (!file)
+        return CTT_ERR_NOT_FOUND;
+
+    cttStatus status = CTT_ERR_NONE;
+    while (CTT_ERR_NONE == status && fgets(line, sizeof(line), file)) {
+        char* token = strtok(line, " \t\r\n");
+        if (!token || '#' == token[0])
+            continue;
+
+        if (0 == strcmp(token, "metrics")) {
+            ids.clear();
+            while ((token = strtok(NULL, " \t\r\n")) != NULL) {
+                cttMetric id = (cttMetric)strtol(token, NULL, 0);
+                ids.push_back(id);
+                if (std::find(g_ctx.metrics.begin(), g_ctx.metrics.end(), id) ==
+                    g_ctx.metrics.end())
+                    g_ctx.metrics.push_back(id);
+            }
+        }
+        else if (0 == strcmp(token, "values")) {
+            replay_sample sample;
+            while ((token = strtok(NULL, " \t\r\n")) != NULL && sample.size() < ids.size()) {
+                sample.push_back(std::make_pair(ids[sample.size()], strtof(token, NULL)));
+            }
+            if (sample.size() != ids.size())
+                status = CTT_ERR_NO_DATA;
+            g_ctx.samples.push_back(sample);
+        }
+        else {
+            status = CTT_ERR_NO_DATA;
+        }
+    }
+    fclose(file);
+
+    std::sort(g_ctx.metrics.begin(), g_ctx.metrics.end());
+
+    if (CTT_ERR_NONE == status && g_ctx.samples.empty())
+        status = CTT_ERR_NO_DATA;
+
+    return status;
+}
+
+extern "C" cttStatus CTTMetrics_Replay_Init(const char* device) {
+    if (g_ctx.initialized)
+        return CTT_ERR_ALREADY_INITIALIZED;
+
+    if (!device)
+        return CTT_ERR_NULL_PTR;
+
+    g_ctx.position = 0;
+    g_ctx.metrics.clear();
+    g_ctx.subscribed.clear();
+    g_ctx.samples.clear();
+
+    cttStatus status = replay_load(device);
+    if (CTT_ERR_NONE != status) {
+        g_ctx.metrics.clear();
+        g_ctx.samples.clear();
+        return status;
+    }
+
+    g_ctx.initialized = true;
+    return CTT_ERR_NONE;
+}
+
+extern "C" void CTTMetrics_Replay_Close() {
+    if (!g_ctx.initialized)
+        return;
+
+    g_ctx.metrics.clear();
+    g_ctx.subscribed.clear();
+    g_ctx.samples.clear();
+    g_ctx.initialized = false;
+}
+
+extern "C" cttStatus CTTMetrics_Replay_SetSamplePeriod(unsigned int in_period) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (in_period > 1000 || in_period < 10)
+        return CTT_ERR_OUT_OF_RANGE;
+
+    // recorded samples are returned without delay
+    return CTT_ERR_NONE;
+}
+
+extern "C" cttStatus CTTMetrics_Replay_SetSampleCount(unsigned int in_num) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (in_num > 1000 || in_num < 1)
+        return CTT_ERR_OUT_OF_RANGE;
+
+    return CTT_ERR_NONE;
+}
+
+extern "C" cttStatus CTTMetrics_Replay_GetMetricCount(unsigned int* out_count) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (!out_count)
+        return CTT_ERR_NULL_PTR;
+
+    *out_count = (unsigned int)g_ctx.metrics.size();
+    return CTT_ERR_NONE;
+}
+
+extern "C" cttStatus CTTMetrics_Replay_GetMetricInfo(unsigned int count,
+                                                     cttMetric* out_metric_ids) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (!out_metric_ids)
+        return CTT_ERR_NULL_PTR;
+
+    if (count > g_ctx.metrics.size())
+        return CTT_ERR_OUT_OF_RANGE;
+
+    for (unsigned int i = 0; i < count; ++i) {
+        out_metric_ids[i] = g_ctx.metrics[i];
+    }
+
+    return CTT_ERR_NONE;
+}
+
+extern "C" cttStatus CTTMetrics_Replay_Subscribe(unsigned int count, cttMetric* in_metric_ids) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (!in_metric_ids)
+        return CTT_ERR_NULL_PTR;
+
+    if (count > g_ctx.metrics.size())
+        return CTT_ERR_OUT_OF_RANGE;
+
+    unsigned int na_metric_cnt = 0;
+    g_ctx.subscribed.assign(in_metric_ids, in_metric_ids + count);
+    for (unsigned int i = 0; i < count; ++i) {
+        if (std::find(g_ctx.metrics.begin(), g_ctx.metrics.end(), in_metric_ids[i]) ==
+            g_ctx.metrics.end())
+            ++na_metric_cnt;
+    }
+
+    return (na_metric_cnt) ? CTT_WRN_METRIC_UNAVAILABLE : CTT_ERR_NONE;
+}
+
+extern "C" cttStatus CTTMetrics_Replay_GetValue(unsigned int count, float* out_metric_values) {
+    if (!g_ctx.initialized)
+        return CTT_ERR_NOT_INITIALIZED;
+
+    if (!out_metric_values)
+        return CTT_ERR_NULL_PTR;
+
+    if (count > g_ctx.subscribed.size())
+        return CTT_ERR_OUT_OF_RANGE;
+
+    // end of record
+    if (g_ctx.position >= g_ctx.samples.size())
+        return CTT_ERR_NO_DATA;
+
+    const replay_sample& sample = g_ctx.samples[g_ctx.position++];
+
+    for (unsigned int i = 0; i < count; ++i) {
+        out_metric_values[i] = 0.0; // metrics missing in the sample are idle
+
+        for (size_t j = 0; j < sample.size(); ++j) {
+            if (sample[j].first == g_ctx.subscribed[i]) {
+                out_metric_values[i] = sample[j].second;
+                break;
+            }
+        }
+    }
+
+    return CTT_ERR_NONE;
+}
@@ -0,0 +1,151 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "cttmetrics.h"
+#include "gtest/gtest.h"
+
+static const unsigned int TEST_PERIOD_MS = 1000;
+// CPU time burnt by the load thread, it is busy during the whole sample period however it is
+// scheduled, since it can't get more CPU time than wall time
+static const unsigned int LOAD_CPU_MS = 2 * TEST_PERIOD_MS;
+
+static double GetThreadCpuMs() {
+    struct timespec ts = {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// cttMetricsCpu test set checks CPU collector, it works without GPU
+
+TEST(cttMetricsCpu, reportsProcessMetrics) {
+    unsigned int count                                 = 0;
+    cttMetric metric_all_ids[CTT_MAX_CPU_METRIC_COUNT] = { CTT_WRONG_METRIC_ID };
+
+    ASSERT_EQ(CTT_ERR_NONE, CTTMetrics_Init("cpu"));
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_GetMetricCount(&count));
+    // memory bandwidth depends on perf_event_paranoid
+    EXPECT_GE(count, (unsigned int)(CTT_MAX_CPU_METRIC_COUNT - 1));
+    EXPECT_LE(count, (unsigned int)CTT_MAX_CPU_METRIC_COUNT);
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_GetMetricInfo(count, metric_all_ids));
+    EXPECT_EQ(CTT_CPU_USAGE_PROCESS, metric_all_ids[0]);
+
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_Subscribe(count, metric_all_ids));
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_SetSamplePeriod(TEST_PERIOD_MS));
+
+    // keep one thread busy during sampling period
+    std::atomic<bool> started(false), stop(false);
+    double load_cpu_ms = 0;
+    std::thread load([&]() {
+        volatile unsigned int counter = 0;
+        started                       = true;
+        while (!stop && GetThreadCpuMs() < LOAD_CPU_MS)
+            counter++;
+        load_cpu_ms = GetThreadCpuMs();
+    });
+    while (!started)
+        std::this_thread::yield();
+
+    float values[CTT_MAX_CPU_METRIC_COUNT] = {};
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_GetValue(count, values));
+
+    stop = true;
+    load.join();
+    ASSERT_GT(load_cpu_ms, 0.0);
+
+    // share of CPU the load gets depends on machine load, it is only known to be non-zero
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    EXPECT_GT(values[0], 0.0); // process
+    EXPECT_LE(values[0], 100.0 * num_cpus + 5.0); // tick granularity
+    EXPECT_GT(values[1], 0.0); // busiest thread
+    EXPECT_LE(values[1], 105.0);
+    EXPECT_LE(values[1], values[0] + 1.0);
+    EXPECT_GE(values[2], 0.0); // system
+    EXPECT_LE(values[2], 100.0);
+    EXPECT_GE(values[3], 0.0); // context switches
+
+    CTTMetrics_Close();
+}
+
+TEST(cttMetricsCpu, rejectsWrongProcess) {
+    EXPECT_EQ(CTT_ERR_NOT_FOUND, CTTMetrics_Init("cpu:abc"));
+    EXPECT_EQ(CTT_ERR_NOT_INITIALIZED, CTTMetrics_GetValue(0, NULL));
+
+    std::string device = "cpu:" + std::to_string(getpid());
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_Init(device.c_str()));
+    CTTMetrics_Close();
+}
+
+// cttMetricsReplay test set checks that recorded values are returned back
+
+TEST(cttMetricsReplay, replaysRecordedValues) {
+    const char* file_name  = "cttmetrics_replay_test.txt";
+    cttMetric metric_ids[] = { CTT_CPU_USAGE_PROCESS, CTT_CPU_USAGE_SYSTEM };
+    float recorded[3][2]   = {};
+    float replayed[2]      = {};
+
+    ASSERT_EQ(CTT_ERR_NONE, CTTMetrics_Init("cpu"));
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_Subscribe(2, metric_ids));
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_SetSamplePeriod(10));
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_StartRecording(file_name));
+    for (int i = 0; i < 3; ++i)
+        EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_GetValue(2, recorded[i]));
+    CTTMetrics_Close();
+
+    std::string device = std::string("replay:") + file_name;
+    ASSERT_EQ(CTT_ERR_NONE, CTTMetrics_Init(device.c_str()));
+
+    unsigned int count = 0;
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_GetMetricCount(&count));
+    EXPECT_EQ(2u, count);
+
+    // subscription order differs from the recorded one
+    cttMetric replay_ids[] = { CTT_CPU_USAGE_SYSTEM, CTT_CPU_USAGE_PROCESS };
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_Subscribe(2, replay_ids));
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_GetValue(2, replayed));
+        EXPECT_FLOAT_EQ(recorded[i][1], replayed[0]);
+        EXPECT_FLOAT_EQ(recorded[i][0], replayed[1]);
+    }
+    EXPECT_EQ(CTT_ERR_NO_DATA, CTTMetrics_GetValue(2, replayed));
+    CTTMetrics_Close();
+
+    remove(file_name);
+}
+
+TEST(cttMetricsReplay, replaysGpuMetrics) {
+    const char* file_name = "cttmetrics_replay_gpu_test.txt";
+
+    FILE* file = fopen(file_name, "w");
+    ASSERT_TRUE(file != NULL);
+    fprintf(file, "# cttmetrics record\nmetrics 0 1 5\nvalues 12.5 50 1100\n");
+    fclose(file);
+
+    std::string device = std::string("replay:") + file_name;
+    ASSERT_EQ(CTT_ERR_NONE, CTTMetrics_Init(device.c_str()));
+
+    cttMetric metric_ids[] = { CTT_USAGE_RENDER, CTT_USAGE_BLITTER, CTT_AVG_GT_FREQ };
+    float values[3]        = {};
+    EXPECT_EQ(CTT_WRN_METRIC_UNAVAILABLE, CTTMetrics_Subscribe(3, metric_ids));
+    EXPECT_EQ(CTT_ERR_NONE, CTTMetrics_GetValue(3, values));
+    EXPECT_FLOAT_EQ(12.5, values[0]);
+    EXPECT_FLOAT_EQ(0.0, values[1]);
+    EXPECT_FLOAT_EQ(1100.0, values[2]);
+    CTTMetrics_Close();
+
+    remove(file_name);
+}
+
+TEST(cttMetricsReplay, rejectsMissingFile) {
+    EXPECT_EQ(CTT_ERR_NOT_FOUND, CTTMetrics_Init("replay:cttmetrics_no_such_file.txt"));
+}
@@ -0,0 +1,103 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __BRC_SIM_H__
+#define __BRC_SIM_H__
+
+#include <vector>
+
+#include "brc_routines.h"
+#include "sample_defs.h"
+
+// Offline simulation of ExtBRC: frames of a recorded trace are "encoded" with QP chosen
+// by the BRC, coded size at that QP is predicted from the size recorded at trace QP.
+
+// one frame of a trace, in encoding order
+struct BrcTraceFrame {
+    mfxU16 FrameType; // MFX_FRAMETYPE_xxx
+    mfxU16 PyramidLayer;
+    mfxU32 DisplayOrder;
+    mfxI32 QP; // QP the frame was encoded with
+    mfxU32 Size; // coded size in bytes at QP
+    mfxU32 Complexity; // spatial complexity, 0 if not recorded
+};
+
+struct BrcTrace {
+    mfxU32 CodecId;
+    mfxU16 Width;
+    mfxU16 Height;
+    mfxU32 FrameRateExtN;
+    mfxU32 FrameRateExtD;
+    mfxU16 GopPicSize;
+    mfxU16 GopRefDist;
+    bool bPyramid;
+    std::vector<BrcTraceFrame> Frames;
+};
+
+// one point of the parameter sweep, rates are in kbps, sizes in KB as in mfxInfoMFX
+struct BrcSimConfig {
+    mfxU16 RateControlMethod;
+    mfxU32 TargetKbps;
+    mfxU32 MaxKbps;
+    mfxU32 BufferSizeInKB;
+    mfxU32 InitialDelayInKB;
+    mfxU16 WinBRCSize; // 0 - no sliding window
+    mfxU32 WinBRCMaxAvgKbps;
+    mfxU16 MinQP; // 0 - default QP range
+    mfxU16 MaxQP;
+    bool bHRD;
+    mfxU16 LookAheadDepth; // 0 - BRC without lookahead
+};
+
+struct BrcSimResult {
+    mfxStatus Status; // error returned by BRC, results are partial
+    mfxU32 NumFrames;
+    mfxU32 NumRecodes;
+    mfxU32 NumSkipped; // frames coded as skipped after MFX_BRC_PANIC_BIG_FRAME
+    mfxU32 NumPadded; // frames padded after MFX_BRC_PANIC_SMALL_FRAME
+
+    // HRD compliance, checked independently of BRC's own HRD model
+    mfxU32 NumUnderflows;
+    mfxU32 NumOverflows; // CBR only, VBR buffer just stays full
+    mfxF64 MinCpbFullness; // percent of buffer size
+    mfxU32 NumWinViolations; // sliding windows exceeding WinBRCMaxAvgKbps
+
+    mfxF64 BitrateKbps;
+    mfxF64 BitrateError; // percent of target bitrate
+
+    // QP stability
+    mfxF64 MeanQP;
+    mfxF64 StdDevQP;
+    mfxF64 MeanQPDelta; // mean QP change between consecutive frames of the same type
+    mfxI32 MinQP;
+    mfxI32 MaxQP;
+
+    bool IsCompliant() const {
+        return MFX_ERR_NONE == Status && !NumUnderflows && !NumOverflows && !NumWinViolations;
+    }
+};
+
+// Trace is a text file, '#' starts a comment. Stream description comes first:
+//   codec h264|h265
+//   resolution <width> <height>
+//   framerate <N> <D>
+//   gop <GopPicSize> <GopRefDist> [pyramid]
+// followed by one line per frame in encoding order:
+//   <IDR|I|P|B|Bref> <display order> <pyramid layer> <QP> <size in bytes> [complexity]
+mfxStatus LoadBrcTrace(const msdk_char* strFileName, BrcTrace& trace);
+
+// 1080p IPPP trace with scenes of random complexity, same seed gives the same trace
+void GenerateBrcTrace(mfxU32 nFrames, mfxU32 nSeed, BrcTrace& trace);
+
+// Runs whole trace through a new ExtBRC instance. Size model is
+// size(qp) = size(traceQP) * (Qstep(traceQP) / Qstep(qp)) ^ modelExp
+// Lookahead complexity is taken from trace sizes, as if frame analysis was ideal.
+mfxStatus SimulateBrc(const BrcTrace& trace,
+                      const BrcSimConfig& config,
+                      mfxF64 modelExp,
+                      BrcSimResult& result);
+
+#endif //__BRC_SIM_H__
@@ -0,0 +1,448 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "brc_sim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+
+#include "vm/file_defs.h"
+
+static mfxU16 ParseFrameType(const char* str) {
+    if (0 == strcmp(str, "IDR"))
+        return MFX_FRAMETYPE_I | MFX_FRAMETYPE_REF | MFX_FRAMETYPE_IDR;
+    if (0 == strcmp(str, "I"))
+        return MFX_FRAMETYPE_I | MFX_FRAMETYPE_REF;
+    if (0 == strcmp(str, "P"))
+        return MFX_FRAMETYPE_P | MFX_FRAMETYPE_REF;
+    if (0 == strcmp(str, "Bref"))
+        return MFX_FRAMETYPE_B | MFX_FRAMETYPE_REF;
+    if (0 == strcmp(str, "B"))
+        return MFX_FRAMETYPE_B;
+    return MFX_FRAMETYPE_UNKNOWN;
+}
+
+mfxStatus LoadBrcTrace(const msdk_char* strFileName, BrcTrace& trace) {
+    MSDK_CHECK_POINTER(strFileName, MFX_ERR_NULL_PTR);
+
+    trace = BrcTrace();
+
+    FILE* file = NULL;
+    MSDK_FOPEN(file, strFileName, MSDK_STRING("r"));
+    if (!file) {
+        msdk_printf(MSDK_STRING("ERROR: can't open trace %s\n"), strFileName);
+        return MFX_ERR_NOT_FOUND;
+    }
+
+    mfxStatus sts = MFX_ERR_NONE;
+    char line[1024];
+    for (mfxU32 nLine = 1; MFX_ERR_NONE == sts && fgets(line, sizeof(line), file); nLine++) {
+        char* comment = strchr(line, '#');
+        if (comment)
+            *comment = 0;
+
+        char key[16]        = {};
+        char option[16]     = {};
+        unsigned int val[5] = {};
+        int n               = sscanf(line, "%15s", key);
+        if (n <= 0)
+            continue;
+
+        if (0 == strcmp(key, "codec")) {
+            n = sscanf(line, "%*s %15s", option);
+            if (1 == n && 0 == strcmp(option, "h264"))
+                trace.CodecId = MFX_CODEC_AVC;
+            else if (1 == n && 0 == strcmp(option, "h265"))
+                trace.CodecId = MFX_CODEC_HEVC;
+            else
+                sts = MFX_ERR_UNSUPPORTED;
+        }
+        else if (0 == strcmp(key, "resolution")) {
+            if (2 == sscanf(line, "%*s %u %u", &val[0], &val[1]) && val[0] && val[1] &&
+                val[0] <= 0xffff && val[1] <= 0xffff) {
+                trace.Width  = (mfxU16)val[0];
+                trace.Height = (mfxU16)val[1];
+            }
+            else
+                sts = MFX_ERR_UNSUPPORTED;
+        }
+        else if (0 == strcmp(key, "framerate")) {
+            if (2 == sscanf(line, "%*s %u %u", &val[0], &val[1]) && val[0] && val[1]) {
+                trace.FrameRateExtN = val[0];
+                trace.FrameRateExtD = val[1];
+            }
+            else
+                sts = MFX_ERR_UNSUPPORTED;
+        }
+        else if (0 == strcmp(key, "gop")) {
+            n = sscanf(line, "%*s %u %u %15s", &val[0], &val[1], option);
+            if (n >= 2 && val[1] && val[0] <= 0xffff && val[1] <= 0xffff) {
+                trace.GopPicSize = (mfxU16)val[0];
+                trace.GopRefDist = (mfxU16)val[1];
+                trace.bPyramid   = (3 == n && 0 == strcmp(option, "pyramid"));
+            }
+            else
+                sts = MFX_ERR_UNSUPPORTED;
+        }
+        else {
+            BrcTraceFrame frame = {};
+            frame.FrameType     = ParseFrameType(key);
+            n                   = sscanf(line,
+                       "%*s %u %u %u %u %u",
+                       &val[0],
+                       &val[1],
+                       &val[2],
+                       &val[3],
+                       &val[4]);
+            if (MFX_FRAMETYPE_UNKNOWN != frame.FrameType && n >= 4 && val[2] <= 51 + 12 &&
+                val[3]) {
+                frame.DisplayOrder = val[0];
+                frame.PyramidLayer = (mfxU16)val[1];
+                frame.QP           = (mfxI32)val[2];
+                frame.Size         = val[3];
+                frame.Complexity   = (5 == n) ? val[4] : 0;
+                trace.Frames.push_back(frame);
+            }
+            else
+                sts = MFX_ERR_UNSUPPORTED;
+        }
+
+        if (MFX_ERR_NONE != sts)
+            msdk_printf(MSDK_STRING("ERROR: can't parse line %u of trace %s\n"),
+                        nLine,
+                        strFileName);
+    }
+    fclose(file);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    if (!trace.CodecId || !trace.Width || !trace.FrameRateExtN || !trace.GopRefDist ||
+        trace.Frames.empty()) {
+        msdk_printf(MSDK_STRING("ERROR: trace %s misses stream description or frames\n"),
+                    strFileName);
+        return MFX_ERR_UNSUPPORTED;
+    }
+    return MFX_ERR_NONE;
+}
+
+void GenerateBrcTrace(mfxU32 nFrames, mfxU32 nSeed, BrcTrace& trace) {
+    trace               = BrcTrace();
+    trace.CodecId       = MFX_CODEC_HEVC;
+    trace.Width         = 1920;
+    trace.Height        = 1080;
+    trace.FrameRateExtN = 30;
+    trace.FrameRateExtD = 1;
+    trace.GopPicSize    = 60;
+    trace.GopRefDist    = 1;
+    trace.bPyramid      = false;
+
+    // raw generator output is the same on every platform, unlike std distributions
+    std::mt19937 rnd(nSeed);
+    auto uniform = [&rnd]() {
+        return rnd() / 4294967296.0;
+    };
+
+    const mfxU32 nBlocks = (trace.Width / 16) * (trace.Height / 16);
+    mfxF64 intraSize     = 0; // bytes of intra frame at QP 30
+    mfxF64 interRatio    = 0; // inter / intra size, amount of motion
+    mfxU32 nSceneLeft    = 0;
+
+    trace.Frames.resize(nFrames);
+    for (mfxU32 i = 0; i < nFrames; i++) {
+        bool bSceneChange = !nSceneLeft;
+        if (bSceneChange) {
+            nSceneLeft = 30 + rnd() % 270;
+            intraSize  = 40000 + 260000 * uniform();
+            interRatio = 0.05 + 0.35 * uniform();
+        }
+        nSceneLeft--;
+
+        BrcTraceFrame& frame = trace.Frames[i];
+        bool bIntra          = !(i % trace.GopPicSize);
+        mfxF64 size          = bIntra         ? intraSize
+                               : bSceneChange ? intraSize * 0.8
+                                              : intraSize * interRatio;
+
+        frame.FrameType    = bIntra ? MFX_FRAMETYPE_I | MFX_FRAMETYPE_REF | MFX_FRAMETYPE_IDR
+                                    : MFX_FRAMETYPE_P | MFX_FRAMETYPE_REF;
+        frame.PyramidLayer = 0;
+        frame.DisplayOrder = i % trace.GopPicSize;
+        frame.QP           = 30;
+        frame.Size         = (mfxU32)(size * (0.85 + 0.3 * uniform()));
+        frame.Complexity   = (mfxU32)(intraSize * 8 / nBlocks); // intra bits per block
+    }
+}
+
+static mfxU32 PredictFrameSize(const BrcTraceFrame& frame,
+                               mfxI32 qp,
+                               mfxF64 modelExp,
+                               mfxU32 maxSize) {
+    // Qstep doubles every 6 QP
+    mfxF64 size = frame.Size * pow(2.0, (frame.QP - qp) * modelExp / 6.0);
+    return (mfxU32)mfx::clamp(size, 1.0, (mfxF64)maxSize);
+}
+
+// complexity known for all frames of the trace in advance
+class TraceLookAhead : public BRCLookAhead {
+public:
+    TraceLookAhead(const BrcTrace& trace, mfxU32 nDepth) : m_nDepth(nDepth), m_cmplx() {
+        const mfxU32 nFrames = (mfxU32)trace.Frames.size();
+        std::vector<bool> bIntra(nFrames);
+
+        // display order from the beginning of the stream, see ExtBRC::GetLookAheadQP
+        mfxU32 idrOrder = 0;
+        m_cmplx.resize(nFrames);
+        for (mfxU32 i = 0; i < nFrames; i++) {
+            const BrcTraceFrame& frame = trace.Frames[i];
+            if (frame.FrameType & MFX_FRAMETYPE_IDR)
+                idrOrder = i - frame.DisplayOrder;
+            mfxU32 order = idrOrder + frame.DisplayOrder;
+            if (order >= nFrames)
+                continue;
+
+            // bits * Qstep, Qstep is 1.0 at QP 4
+            mfxF64 cost              = frame.Size * 8.0 * pow(2.0, (frame.QP - 4) / 6.0);
+            m_cmplx[order].IntraCost = cost;
+            m_cmplx[order].InterCost = cost;
+            bIntra[order]            = !!(frame.FrameType & MFX_FRAMETYPE_I);
+        }
+        // size of intra frame tells nothing about inter cost, assume it didn't change
+        for (mfxU32 i = 1; i < nFrames; i++) {
+            if (bIntra[i])
+                m_cmplx[i].InterCost = std::min(m_cmplx[i].IntraCost, m_cmplx[i - 1].InterCost);
+        }
+    }
+
+    virtual mfxU32 GetDepth() const {
+        return m_nDepth;
+    }
+    virtual mfxU32 GetComplexity(mfxU32 nOrder, mfxU32 nCount, BRCFrameComplexity* pCmplx) {
+        if (nOrder >= m_cmplx.size())
+            return 0;
+        nCount = std::min(nCount, (mfxU32)m_cmplx.size() - nOrder);
+        std::copy(m_cmplx.begin() + nOrder, m_cmplx.begin() + nOrder + nCount, pCmplx);
+        return nCount;
+    }
+
+protected:
+    mfxU32 m_nDepth;
+    std::vector<BRCFrameComplexity> m_cmplx;
+};
+
+mfxStatus SimulateBrc(const BrcTrace& trace,
+                      const BrcSimConfig& config,
+                      mfxF64 modelExp,
+                      BrcSimResult& result) {
+    result        = BrcSimResult();
+    result.MinQP  = 0xffff;
+    result.Status = MFX_ERR_NONE;
+
+    // mfxInfoMFX keeps rates in 16 bits
+    mfxU32 nMaxValue = std::max({ config.TargetKbps,
+                                  config.MaxKbps,
+                                  config.BufferSizeInKB,
+                                  config.InitialDelayInKB,
+                                  config.WinBRCMaxAvgKbps });
+    mfxU16 k         = (mfxU16)(nMaxValue / 0x10000 + 1);
+
+    mfxExtCodingOption co   = {};
+    co.Header.BufferId      = MFX_EXTBUFF_CODING_OPTION;
+    co.Header.BufferSz      = sizeof(co);
+    co.NalHrdConformance    = config.bHRD ? MFX_CODINGOPTION_ON : MFX_CODINGOPTION_OFF;
+    co.VuiNalHrdParameters  = co.NalHrdConformance;
+    mfxExtCodingOption2 co2 = {};
+    co2.Header.BufferId     = MFX_EXTBUFF_CODING_OPTION2;
+    co2.Header.BufferSz     = sizeof(co2);
+    co2.BRefType            = trace.bPyramid ? MFX_B_REF_PYRAMID : MFX_B_REF_OFF;
+    // bounds are applied independently, the other one stays at BRC's default;
+    // ExtBRC silently ignores a range it can't use, so such point is reported invalid
+    if (config.MinQP || config.MaxQP) {
+        mfxU16 minQP = config.MinQP ? config.MinQP : 1;
+        mfxU16 maxQP = config.MaxQP ? config.MaxQP : 51;
+        if (maxQP > 51 || minQP >= maxQP) {
+            result.Status = MFX_ERR_INVALID_VIDEO_PARAM;
+            return result.Status;
+        }
+        co2.MinQPI = co2.MinQPP = co2.MinQPB = (mfxU8)minQP;
+        co2.MaxQPI = co2.MaxQPP = co2.MaxQPB = (mfxU8)maxQP;
+    }
+    mfxExtCodingOption3 co3 = {};
+    co3.Header.BufferId     = MFX_EXTBUFF_CODING_OPTION3;
+    co3.Header.BufferSz     = sizeof(co3);
+    co3.WinBRCSize          = config.WinBRCSize;
+    co3.WinBRCMaxAvgKbps    = (mfxU16)(config.WinBRCMaxAvgKbps / k);
+    mfxExtBuffer* extParam[] = { &co.Header, &co2.Header, &co3.Header };
+
+    mfxVideoParam par                = {};
+    par.mfx.CodecId                  = trace.CodecId;
+    par.mfx.RateControlMethod        = config.RateControlMethod;
+    par.mfx.BRCParamMultiplier       = k;
+    par.mfx.TargetKbps               = (mfxU16)(config.TargetKbps / k);
+    par.mfx.MaxKbps                  = (mfxU16)(config.MaxKbps / k);
+    par.mfx.BufferSizeInKB           = (mfxU16)(config.BufferSizeInKB / k);
+    par.mfx.InitialDelayInKB         = (mfxU16)(config.InitialDelayInKB / k);
+    par.mfx.GopPicSize               = trace.GopPicSize;
+    par.mfx.GopRefDist               = trace.GopRefDist;
+    par.mfx.FrameInfo.Width          = trace.Width;
+    par.mfx.FrameInfo.Height         = trace.Height;
+    par.mfx.FrameInfo.FrameRateExtN  = trace.FrameRateExtN;
+    par.mfx.FrameInfo.FrameRateExtD  = trace.FrameRateExtD;
+    par.mfx.FrameInfo.ChromaFormat   = MFX_CHROMAFORMAT_YUV420;
+    par.mfx.FrameInfo.PicStruct      = MFX_PICSTRUCT_PROGRESSIVE;
+    par.ExtParam                     = extParam;
+    par.NumExtParam                  = sizeof(extParam) / sizeof(extParam[0]);
+
+    ExtBRC brc;
+    std::unique_ptr<TraceLookAhead> lookAhead;
+    if (config.LookAheadDepth) {
+        lookAhead.reset(new TraceLookAhead(trace, config.LookAheadDepth));
+        brc.SetLookAhead(lookAhead.get());
+    }
+    // errors are reported in results, sweep may have thousands of failing points
+    result.Status = brc.Init(&par);
+    if (MFX_ERR_NONE != result.Status)
+        return result.Status;
+
+    const mfxF64 frameRate = (mfxF64)trace.FrameRateExtN / trace.FrameRateExtD;
+    const mfxU32 maxSize   = (mfxU32)trace.Width * trace.Height * 3;
+    // skipped frame costs about a bit per 16x16 block
+    const mfxU32 skipSize = std::max<mfxU32>(1, maxSize / (3 * 16 * 16 * 8));
+
+    // CPB is filled at peak rate and drained by frames at their removal times
+    const mfxF64 cpbSize = config.BufferSizeInKB * 8000.0;
+    const mfxF64 cpbInput =
+        ((MFX_RATECONTROL_CBR == config.RateControlMethod) ? config.TargetKbps
+                                                           : std::max(config.MaxKbps,
+                                                                      config.TargetKbps)) *
+        1000.0 / frameRate;
+    mfxF64 cpbFullness    = config.InitialDelayInKB * 8000.0;
+    result.MinCpbFullness = 100.0;
+
+    std::vector<mfxU32> window(config.WinBRCSize);
+    mfxU64 windowBits     = 0;
+    const mfxF64 winLimit = config.WinBRCMaxAvgKbps * 1000.0 * config.WinBRCSize / frameRate;
+
+    mfxU64 totalBits   = 0;
+    mfxF64 sumQP       = 0;
+    mfxF64 sumQP2      = 0;
+    mfxF64 sumQPDelta  = 0;
+    mfxU32 nQPDeltas   = 0;
+    mfxI32 lastQP[3]   = {}; // per I, P, B
+    bool bHaveLastQP[3] = {};
+
+    for (mfxU32 i = 0; i < (mfxU32)trace.Frames.size(); i++) {
+        const BrcTraceFrame& frame = trace.Frames[i];
+
+        mfxBRCFrameParam frameParam = {};
+        frameParam.EncodedOrder     = i;
+        frameParam.DisplayOrder     = frame.DisplayOrder;
+        frameParam.FrameType        = frame.FrameType;
+        frameParam.PyramidLayer     = frame.PyramidLayer;
+        frameParam.FrameCmplx       = frame.Complexity;
+
+        mfxBRCFrameCtrl frameCtrl     = {};
+        mfxBRCFrameStatus frameStatus = {};
+        mfxU32 forcedSize             = 0; // skipped or padded frame
+        for (;; frameParam.NumRecode++) {
+            frameCtrl     = {};
+            result.Status = brc.GetFrameCtrl(&frameParam, &frameCtrl);
+            if (MFX_ERR_NONE != result.Status)
+                return result.Status;
+
+            frameParam.CodedFrameSize =
+                forcedSize ? forcedSize
+                           : PredictFrameSize(frame, frameCtrl.QpY, modelExp, maxSize);
+
+            frameStatus   = {};
+            result.Status = brc.Update(&frameParam, &frameCtrl, &frameStatus);
+            if (MFX_ERR_NONE != result.Status)
+                return result.Status;
+
+            if (MFX_BRC_OK == frameStatus.BRCStatus)
+                break;
+
+            result.NumRecodes++;
+            // encoders give up and skip or pad a frame in a few attempts
+            if (frameParam.NumRecode >= 16) {
+                result.Status = MFX_ERR_UNDEFINED_BEHAVIOR;
+                return result.Status;
+            }
+            if (MFX_BRC_PANIC_BIG_FRAME == frameStatus.BRCStatus) {
+                forcedSize = skipSize;
+                result.NumSkipped++;
+            }
+            else if (MFX_BRC_PANIC_SMALL_FRAME == frameStatus.BRCStatus) {
+                // MinFrameSize is reported in bits
+                forcedSize = std::max(frameParam.CodedFrameSize, (frameStatus.MinFrameSize + 7) / 8);
+                result.NumPadded++;
+            }
+        }
+
+        const mfxU32 bits = frameParam.CodedFrameSize * 8;
+        totalBits += bits;
+        result.NumFrames++;
+
+        if (cpbSize > 0) {
+            if (bits > cpbFullness) {
+                result.NumUnderflows++;
+                cpbFullness = 0;
+            }
+            else {
+                cpbFullness -= bits;
+            }
+            result.MinCpbFullness = std::min(result.MinCpbFullness, 100.0 * cpbFullness / cpbSize);
+
+            cpbFullness += cpbInput;
+            if (cpbFullness > cpbSize) {
+                if (MFX_RATECONTROL_CBR == config.RateControlMethod)
+                    result.NumOverflows++;
+                cpbFullness = cpbSize;
+            }
+        }
+
+        if (config.WinBRCSize) {
+            mfxU32& oldest = window[i % config.WinBRCSize];
+            windowBits     = windowBits - oldest + bits;
+            oldest         = bits;
+            if (i + 1 >= config.WinBRCSize && windowBits > winLimit)
+                result.NumWinViolations++;
+        }
+
+        mfxI32 qp = frameCtrl.QpY;
+        sumQP += qp;
+        sumQP2 += (mfxF64)qp * qp;
+        result.MinQP = std::min(result.MinQP, qp);
+        result.MaxQP = std::max(result.MaxQP, qp);
+
+        mfxU32 type = (frame.FrameType & MFX_FRAMETYPE_I)   ? 0
+                      : (frame.FrameType & MFX_FRAMETYPE_P) ? 1
+                                                            : 2;
+        if (bHaveLastQP[type]) {
+            sumQPDelta += abs(qp - lastQP[type]);
+            nQPDeltas++;
+        }
+        lastQP[type]      = qp;
+        bHaveLastQP[type] = true;
+    }
+
+    if (result.NumFrames) {
+        result.BitrateKbps  = totalBits * frameRate / result.NumFrames / 1000.0;
+        result.BitrateError = config.TargetKbps
+                                  ? 100.0 * (result.BitrateKbps - config.TargetKbps) /
+                                        config.TargetKbps
+                                  : 0;
+        result.MeanQP       = sumQP / result.NumFrames;
+        result.StdDevQP =
+            sqrt(std::max(0.0, sumQP2 / result.NumFrames - result.MeanQP * result.MeanQP));
+        result.MeanQPDelta = nQPDeltas ? sumQPDelta / nQPDeltas : 0;
+    }
+
+    return MFX_ERR_NONE;
+}
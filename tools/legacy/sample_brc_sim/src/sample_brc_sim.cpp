@@ -0,0 +1,497 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "brc_sim.h"
+#include "sample_utils.h"
+#include "version.h"
+#include "vm/file_defs.h"
+#include "vm/time_defs.h"
+
+#ifndef MFX_VERSION
+    #error MFX_VERSION not defined
+#endif
+
+// values of swept parameter, "a,b,c" or "first:last[:step]" or mix of both
+typedef std::vector<mfxU32> SweepList;
+
+// limits of the sweep, every combination keeps its config and result in memory
+#define MAX_SWEEP_VALUES  1000
+#define MAX_SWEEP_CONFIGS 100000
+
+struct sInputParams {
+    msdk_char strTraceFile[MSDK_MAX_FILENAME_LEN];
+    msdk_char strOutputFile[MSDK_MAX_FILENAME_LEN];
+    mfxU32 nSyntheticFrames;
+    mfxU32 nSeed;
+    mfxU32 nThreads;
+    mfxF64 modelExp;
+    bool bHRD;
+
+    std::vector<mfxU16> rateControl;
+    SweepList targetKbps;
+    SweepList maxKbps;
+    SweepList bufferSizeInKB;
+    SweepList initialDelay; // percent of buffer size
+    SweepList winSize;
+    SweepList winMaxKbps;
+    SweepList minQP;
+    SweepList maxQP;
+    SweepList laDepth;
+};
+
+void PrintHelp(msdk_char* strAppName, const msdk_char* strErrorMessage, ...) {
+    msdk_printf(MSDK_STRING("BRC Simulation Sample Version %s\n\n"),
+                GetMSDKSampleVersion().c_str());
+
+    if (strErrorMessage) {
+        va_list args;
+        msdk_printf(MSDK_STRING("ERROR: "));
+        va_start(args, strErrorMessage);
+        msdk_vprintf(strErrorMessage, args);
+        va_end(args);
+        msdk_printf(MSDK_STRING("\n\n"));
+    }
+
+    msdk_printf(MSDK_STRING("Usage: %s -i TraceFile|-synthetic frames -b kbps [<options>]\n"),
+                strAppName);
+    msdk_printf(MSDK_STRING("\n"));
+    msdk_printf(MSDK_STRING("Replays per-frame trace through sample ExtBRC for every combination\n"));
+    msdk_printf(MSDK_STRING("of swept parameters and reports HRD compliance, bitrate error and\n"));
+    msdk_printf(MSDK_STRING("QP stability in CSV, one line per combination.\n"));
+    msdk_printf(MSDK_STRING("Swept parameters take list \"a,b,c\" or range \"first:last[:step]\"\n"));
+    msdk_printf(MSDK_STRING("with up to %u values, up to %u combinations are simulated\n"),
+                MAX_SWEEP_VALUES,
+                MAX_SWEEP_CONFIGS);
+    msdk_printf(MSDK_STRING("\n"));
+    msdk_printf(MSDK_STRING("Options:\n"));
+    msdk_printf(MSDK_STRING("   [-i TraceFile]       - trace of encoded frames, see brc_sim.h for format\n"));
+    msdk_printf(MSDK_STRING("   [-synthetic frames]  - generate 1080p30 IPPP trace instead of reading it\n"));
+    msdk_printf(MSDK_STRING("   [-seed value]        - seed of synthetic trace, default is 1\n"));
+    msdk_printf(MSDK_STRING("   [-o CsvFile]         - write results to file instead of stdout\n"));
+    msdk_printf(MSDK_STRING("   [-rc cbr|vbr|cbr,vbr] - rate control methods, default is cbr\n"));
+    msdk_printf(MSDK_STRING("   [-b kbps]            - target bitrate (swept)\n"));
+    msdk_printf(MSDK_STRING("   [-MaxKbps kbps]      - max bitrate for VBR (swept), default is target\n"));
+    msdk_printf(MSDK_STRING("   [-BufferSizeInKB KB] - CPB size (swept), default is 1 second at max rate\n"));
+    msdk_printf(MSDK_STRING("   [-InitialDelay pct]  - initial CPB fullness in percent of CPB size (swept), default is 50\n"));
+    msdk_printf(MSDK_STRING("   [-WinBRCSize frames] - sliding window size (swept), default is 0 (off)\n"));
+    msdk_printf(MSDK_STRING("   [-WinBRCMaxAvgKbps kbps] - max bitrate within sliding window (swept)\n"));
+    msdk_printf(MSDK_STRING("   [-MinQP qp]          - lower QP bound (swept), default is BRC's own\n"));
+    msdk_printf(MSDK_STRING("   [-MaxQP qp]          - upper QP bound (swept), default is BRC's own\n"));
+    msdk_printf(MSDK_STRING("   [-la depth]          - BRC lookahead depth in frames (swept), default is 0 (off)\n"));
+    msdk_printf(MSDK_STRING("   [-hrd:<on,off>]      - HRD conformance, default is on\n"));
+    msdk_printf(MSDK_STRING("   [-model_exp value]   - exponent of size to Qstep model, default is 1.0\n"));
+    msdk_printf(MSDK_STRING("   [-threads num]       - number of simulation threads, default is number of cores\n"));
+    msdk_printf(MSDK_STRING("\n"));
+    msdk_printf(MSDK_STRING("Example: %s -synthetic 3000 -rc cbr,vbr -b 2000:10000:500 -BufferSizeInKB 500,1000,2000\n"),
+                strAppName);
+}
+
+#define VAL_CHECK(val, argIdx, argName)                                                       \
+    {                                                                                         \
+        if (val) {                                                                            \
+            PrintHelp(NULL,                                                                   \
+                      MSDK_STRING("Input argument number %d \"%s\" require more parameters"), \
+                      argIdx,                                                                 \
+                      argName);                                                               \
+            return MFX_ERR_UNSUPPORTED;                                                       \
+        }                                                                                     \
+    }
+
+// returns MFX_ERR_NOT_ENOUGH_BUFFER if there are more than MAX_SWEEP_VALUES values
+static mfxStatus ParseSweepList(const msdk_char* strInput, SweepList& values) {
+    values.clear();
+    for (const msdk_char* str = strInput; *str;) {
+        // long is 32 bit on Windows, values are parsed as 64 bit to check the mfxU32 range
+        msdk_char* end = NULL;
+        mfxI64 first   = msdk_strtoll(str, &end, 10);
+        mfxI64 last    = first;
+        mfxI64 step    = 1;
+        if (end == str || first < 0 || first > 0xFFFFFFFF)
+            return MFX_ERR_UNSUPPORTED;
+
+        if (MSDK_CHAR(':') == *end) {
+            str  = end + 1;
+            last = msdk_strtoll(str, &end, 10);
+            if (end == str || last < first || last > 0xFFFFFFFF)
+                return MFX_ERR_UNSUPPORTED;
+
+            if (MSDK_CHAR(':') == *end) {
+                str  = end + 1;
+                step = msdk_strtoll(str, &end, 10);
+                if (end == str || step <= 0)
+                    return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        // size is checked before the range is expanded
+        if ((mfxU64)(last - first) / step >= MAX_SWEEP_VALUES - values.size())
+            return MFX_ERR_NOT_ENOUGH_BUFFER;
+        for (mfxI64 v = first; v <= last; v += step) {
+            values.push_back((mfxU32)v);
+        }
+
+        if (MSDK_CHAR(',') == *end)
+            end++;
+        else if (*end)
+            return MFX_ERR_UNSUPPORTED;
+        str = end;
+    }
+    return values.empty() ? MFX_ERR_UNSUPPORTED : MFX_ERR_NONE;
+}
+
+// number of combinations built by BuildConfigs, counting stops above MAX_SWEEP_CONFIGS
+static mfxU64 CountConfigs(const sInputParams& params) {
+    mfxU64 total = 0;
+    for (mfxU16 rc : params.rateControl) {
+        size_t sizes[] = {
+            params.targetKbps.size(),
+            (MFX_RATECONTROL_VBR == rc && !params.maxKbps.empty()) ? params.maxKbps.size() : 1,
+            params.bufferSizeInKB.empty() ? 1 : params.bufferSizeInKB.size(),
+            params.initialDelay.size(),
+            params.winSize.size(),
+            params.winMaxKbps.size(),
+            params.minQP.size(),
+            params.maxQP.size(),
+            params.laDepth.size(),
+        };
+
+        // every list is shorter than MAX_SWEEP_VALUES, so the product can't overflow
+        mfxU64 count = 1;
+        for (size_t size : sizes) {
+            count *= size;
+            if (count > MAX_SWEEP_CONFIGS)
+                return MAX_SWEEP_CONFIGS + 1;
+        }
+        total += count;
+    }
+    return std::min<mfxU64>(total, MAX_SWEEP_CONFIGS + 1);
+}
+
+mfxStatus ParseInputString(msdk_char* strInput[], mfxU32 nArgNum, sInputParams* pParams) {
+    if (1 == nArgNum) {
+        PrintHelp(strInput[0], NULL);
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    MSDK_CHECK_POINTER(pParams, MFX_ERR_NULL_PTR);
+
+    pParams->nSeed    = 1;
+    pParams->modelExp = 1.0;
+    pParams->bHRD     = true;
+    pParams->rateControl.push_back(MFX_RATECONTROL_CBR);
+    pParams->initialDelay.push_back(50);
+    pParams->winSize.push_back(0);
+    pParams->winMaxKbps.push_back(0);
+    pParams->minQP.push_back(0);
+    pParams->maxQP.push_back(0);
+    pParams->laDepth.push_back(0);
+
+    // swept options
+    struct {
+        const msdk_char* option;
+        SweepList* values;
+    } lists[] = {
+        { MSDK_STRING("-b"), &pParams->targetKbps },
+        { MSDK_STRING("-MaxKbps"), &pParams->maxKbps },
+        { MSDK_STRING("-BufferSizeInKB"), &pParams->bufferSizeInKB },
+        { MSDK_STRING("-InitialDelay"), &pParams->initialDelay },
+        { MSDK_STRING("-WinBRCSize"), &pParams->winSize },
+        { MSDK_STRING("-WinBRCMaxAvgKbps"), &pParams->winMaxKbps },
+        { MSDK_STRING("-MinQP"), &pParams->minQP },
+        { MSDK_STRING("-MaxQP"), &pParams->maxQP },
+        { MSDK_STRING("-la"), &pParams->laDepth },
+    };
+
+    for (mfxU32 i = 1; i < nArgNum; i++) {
+        MSDK_CHECK_POINTER(strInput[i], MFX_ERR_NULL_PTR);
+
+        bool bList = false;
+        for (auto& list : lists) {
+            if (0 == msdk_strcmp(strInput[i], list.option)) {
+                VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+                mfxStatus sts = ParseSweepList(strInput[++i], *list.values);
+                if (MFX_ERR_NOT_ENOUGH_BUFFER == sts) {
+                    PrintHelp(strInput[0],
+                              MSDK_STRING("Too many values of %s, at most %u are allowed"),
+                              strInput[i - 1],
+                              MAX_SWEEP_VALUES);
+                    return MFX_ERR_UNSUPPORTED;
+                }
+                if (MFX_ERR_NONE != sts) {
+                    PrintHelp(strInput[0],
+                              MSDK_STRING("Invalid values of %s"),
+                              strInput[i - 1]);
+                    return MFX_ERR_UNSUPPORTED;
+                }
+                bList = true;
+                break;
+            }
+        }
+        if (bList)
+            continue;
+
+        if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-i"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->strTraceFile)) {
+                PrintHelp(strInput[0], MSDK_STRING("Trace file name is too long"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-o"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->strOutputFile)) {
+                PrintHelp(strInput[0], MSDK_STRING("Output file name is too long"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-synthetic"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nSyntheticFrames) ||
+                !pParams->nSyntheticFrames) {
+                PrintHelp(strInput[0], MSDK_STRING("Invalid number of synthetic frames"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-seed"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nSeed)) {
+                PrintHelp(strInput[0], MSDK_STRING("Invalid seed"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-threads"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nThreads)) {
+                PrintHelp(strInput[0], MSDK_STRING("Invalid number of threads"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-model_exp"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->modelExp) ||
+                pParams->modelExp <= 0) {
+                PrintHelp(strInput[0], MSDK_STRING("Invalid model exponent"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-rc"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            msdk_string rc(strInput[++i]);
+            pParams->rateControl.clear();
+            if (rc.find(MSDK_STRING("cbr")) != msdk_string::npos)
+                pParams->rateControl.push_back(MFX_RATECONTROL_CBR);
+            if (rc.find(MSDK_STRING("vbr")) != msdk_string::npos)
+                pParams->rateControl.push_back(MFX_RATECONTROL_VBR);
+            if (pParams->rateControl.empty()) {
+                PrintHelp(strInput[0], MSDK_STRING("Unsupported rate control method"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-hrd:on"))) {
+            pParams->bHRD = true;
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-hrd:off"))) {
+            pParams->bHRD = false;
+        }
+        else {
+            PrintHelp(strInput[0], MSDK_STRING("Unknown option: %s"), strInput[i]);
+            return MFX_ERR_UNSUPPORTED;
+        }
+    }
+
+    if (!pParams->nSyntheticFrames == !msdk_strlen(pParams->strTraceFile)) {
+        PrintHelp(strInput[0], MSDK_STRING("Either trace file or synthetic trace is required"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+    if (pParams->targetKbps.empty()) {
+        PrintHelp(strInput[0], MSDK_STRING("Target bitrate is required"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+    if (CountConfigs(*pParams) > MAX_SWEEP_CONFIGS) {
+        PrintHelp(strInput[0],
+                  MSDK_STRING("Too many combinations of swept parameters, at most %u are allowed"),
+                  MAX_SWEEP_CONFIGS);
+        return MFX_ERR_UNSUPPORTED;
+    }
+    if (!pParams->nThreads)
+        pParams->nThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    return MFX_ERR_NONE;
+}
+
+// cartesian product of swept parameters
+static void BuildConfigs(const sInputParams& params, std::vector<BrcSimConfig>& configs) {
+    SweepList noMaxKbps(1, 0);
+    SweepList noBufferSize(1, 0);
+
+    configs.reserve((size_t)CountConfigs(params));
+
+    for (mfxU16 rc : params.rateControl) {
+        // max bitrate matters for VBR only
+        const SweepList& maxKbps = (MFX_RATECONTROL_VBR == rc && !params.maxKbps.empty())
+                                       ? params.maxKbps
+                                       : noMaxKbps;
+        const SweepList& bufferSize =
+            params.bufferSizeInKB.empty() ? noBufferSize : params.bufferSizeInKB;
+
+        for (mfxU32 target : params.targetKbps)
+            for (mfxU32 maxRate : maxKbps)
+                for (mfxU32 buffer : bufferSize)
+                    for (mfxU32 delay : params.initialDelay)
+                        for (mfxU32 win : params.winSize)
+                            for (mfxU32 winMax : params.winMaxKbps)
+                                for (mfxU32 minQP : params.minQP)
+                                    for (mfxU32 maxQP : params.maxQP)
+                                        for (mfxU32 la : params.laDepth) {
+                                            BrcSimConfig config      = {};
+                                            config.RateControlMethod = rc;
+                                            config.TargetKbps        = target;
+                                            config.MaxKbps = std::max(maxRate, target);
+                                            // one second of data at max rate, kbps / 8 = KB
+                                            config.BufferSizeInKB =
+                                                buffer ? buffer : (config.MaxKbps + 7) / 8;
+                                            config.InitialDelayInKB =
+                                                config.BufferSizeInKB * std::min(delay, 100u) /
+                                                100;
+                                            config.WinBRCSize = (mfxU16)(winMax ? win : 0);
+                                            config.WinBRCMaxAvgKbps = win ? winMax : 0;
+                                            config.MinQP            = (mfxU16)minQP;
+                                            config.MaxQP            = (mfxU16)maxQP;
+                                            config.bHRD             = params.bHRD;
+                                            config.LookAheadDepth   = (mfxU16)la;
+                                            configs.push_back(config);
+                                        }
+    }
+}
+
+static void PrintResult(FILE* file, const BrcSimConfig& config, const BrcSimResult& result) {
+    fprintf(file,
+            "%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%d,%u,%.2f,%.2f,%u,%u,%u,%.1f,%u,%u,%u,%.2f,%.2f,%.2f,%d,%d\n",
+            (MFX_RATECONTROL_CBR == config.RateControlMethod) ? "CBR" : "VBR",
+            config.TargetKbps,
+            config.MaxKbps,
+            config.BufferSizeInKB,
+            config.InitialDelayInKB,
+            config.WinBRCSize,
+            config.WinBRCMaxAvgKbps,
+            config.MinQP,
+            config.MaxQP,
+            config.LookAheadDepth,
+            result.Status,
+            result.NumFrames,
+            result.BitrateKbps,
+            result.BitrateError,
+            result.NumUnderflows,
+            result.NumOverflows,
+            result.NumWinViolations,
+            result.MinCpbFullness,
+            result.NumRecodes,
+            result.NumSkipped,
+            result.NumPadded,
+            result.MeanQP,
+            result.StdDevQP,
+            result.MeanQPDelta,
+            result.NumFrames ? result.MinQP : 0,
+            result.MaxQP);
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+int _tmain(int argc, msdk_char* argv[])
+#else
+int main(int argc, char* argv[])
+#endif
+{
+    sInputParams Params = {};
+
+    mfxStatus sts = ParseInputString(argv, (mfxU32)argc, &Params);
+    MSDK_CHECK_PARSE_RESULT(sts, MFX_ERR_NONE, 1);
+
+    BrcTrace trace;
+    if (Params.nSyntheticFrames) {
+        GenerateBrcTrace(Params.nSyntheticFrames, Params.nSeed, trace);
+    }
+    else {
+        sts = LoadBrcTrace(Params.strTraceFile, trace);
+        MSDK_CHECK_STATUS(sts, "LoadBrcTrace failed");
+    }
+
+    std::vector<BrcSimConfig> configs;
+    BuildConfigs(Params, configs);
+    std::vector<BrcSimResult> results(configs.size());
+
+    FILE* output = stdout;
+    if (msdk_strlen(Params.strOutputFile)) {
+        MSDK_FOPEN(output, Params.strOutputFile, MSDK_STRING("w"));
+        MSDK_CHECK_POINTER(output, MFX_ERR_NULL_PTR);
+    }
+
+    msdk_fprintf(stderr,
+                 MSDK_STRING("Simulating %u frames with %u configurations on %u threads\n"),
+                 (mfxU32)trace.Frames.size(),
+                 (mfxU32)configs.size(),
+                 Params.nThreads);
+
+    // simulations are independent, workers take them in order and results keep their place
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < configs.size(); i = next++) {
+            SimulateBrc(trace, configs[i], Params.modelExp, results[i]);
+        }
+    };
+
+    msdk_tick startTime = msdk_time_get_tick();
+    std::vector<std::thread> threads;
+    for (mfxU32 i = 1; i < std::min<mfxU32>(Params.nThreads, (mfxU32)configs.size()); i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    mfxF64 elapsed = (mfxF64)(msdk_time_get_tick() - startTime) / msdk_time_get_frequency();
+
+    fprintf(output,
+            "rc,target_kbps,max_kbps,cpb_kb,init_delay_kb,win_size,win_max_kbps,min_qp,max_qp,"
+            "la_depth,status,frames,bitrate_kbps,bitrate_err_pct,underflows,overflows,win_violations,"
+            "min_cpb_pct,recodes,skipped,padded,qp_mean,qp_stddev,qp_delta_mean,qp_min,qp_max\n");
+
+    size_t best      = configs.size();
+    mfxU32 compliant = 0;
+    for (size_t i = 0; i < configs.size(); i++) {
+        PrintResult(output, configs[i], results[i]);
+
+        if (!results[i].IsCompliant())
+            continue;
+        compliant++;
+        // most accurate bitrate, then most stable QP
+        if (best == configs.size() ||
+            fabs(results[i].BitrateError) < fabs(results[best].BitrateError) - 0.01 ||
+            (fabs(results[i].BitrateError) < fabs(results[best].BitrateError) + 0.01 &&
+             results[i].StdDevQP < results[best].StdDevQP))
+            best = i;
+    }
+    if (output != stdout)
+        fclose(output);
+
+    msdk_fprintf(stderr,
+                 MSDK_STRING("Done in %.2f sec, %.0f frames/sec, %u of %u configurations are compliant\n"),
+                 elapsed,
+                 elapsed > 0 ? configs.size() * trace.Frames.size() / elapsed : 0,
+                 compliant,
+                 (mfxU32)configs.size());
+    if (best != configs.size()) {
+        msdk_fprintf(stderr, MSDK_STRING("Best compliant configuration:\n"));
+        PrintResult(stderr, configs[best], results[best]);
+    }
+
+    return 0;
+}
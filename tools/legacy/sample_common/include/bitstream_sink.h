@@ -0,0 +1,110 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __BITSTREAM_SINK_H__
+#define __BITSTREAM_SINK_H__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sample_defs.h"
+#include "sample_utils.h"
+
+// Writes are collected in a few large buffers which are handed to a background thread,
+// so small NAL units turn into large writes and egress I/O overlaps with encoding.
+// Write blocks only while all buffers are in flight.
+class CBufferedSink : public CBitstreamSink {
+public:
+    // bSubmitOnFlush - send partially filled buffer at the end of every frame
+    CBufferedSink(mfxU32 nBufferSize, bool bSubmitOnFlush);
+    virtual ~CBufferedSink();
+
+    virtual mfxStatus Write(const mfxU8* pData, mfxU32 nSize);
+    virtual mfxStatus Flush();
+    virtual void Close();
+
+protected:
+    struct Buffer {
+        std::vector<mfxU8> storage;
+        mfxU8* pData; // aligned start within storage
+        mfxU32 nSize; // filled bytes
+    };
+
+    // called by Init of derived classes once the destination is opened
+    mfxStatus Start();
+    mfxStatus Submit();
+    void WriterRoutine();
+
+    // run on the background thread
+    virtual mfxStatus Output(const mfxU8* pData, mfxU32 nSize) = 0;
+    virtual void CloseOutput() = 0;
+
+    mfxU32 m_nBufferSize;
+    bool m_bSubmitOnFlush;
+
+    std::vector<Buffer> m_buffers;
+    Buffer* m_pCurrent;
+    std::deque<Buffer*> m_ready; // waiting for output
+    std::vector<Buffer*> m_free;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_bStop;
+    mfxStatus m_error; // first output error, returned by the next Write
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CBufferedSink);
+};
+
+// File written from the background thread, optionally bypassing page cache
+class CFileSink : public CBufferedSink {
+public:
+    CFileSink(mfxU32 nBufferSize, bool bDirect);
+    virtual ~CFileSink();
+
+    virtual mfxStatus Init(const msdk_char* strName);
+
+protected:
+    virtual mfxStatus Output(const mfxU8* pData, mfxU32 nSize);
+    virtual void CloseOutput();
+
+    bool m_bDirect;
+#if defined(_WIN32) || defined(_WIN64)
+    FILE* m_fDest;
+#else
+    int m_fd;
+#endif
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CFileSink);
+};
+
+// Stream sent to tcp://host:port or udp://host:port, e.g. to a packager on localhost.
+// Frame boundaries are kept: data is sent at the end of every frame.
+class CSocketSink : public CBufferedSink {
+public:
+    explicit CSocketSink(mfxU32 nBufferSize);
+    virtual ~CSocketSink();
+
+    static bool IsSocketName(const msdk_char* strName);
+
+    virtual mfxStatus Init(const msdk_char* strName);
+
+protected:
+    virtual mfxStatus Output(const mfxU8* pData, mfxU32 nSize);
+    virtual void CloseOutput();
+
+    bool m_bUDP;
+    int m_socket;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CSocketSink);
+};
+
+#endif //__BITSTREAM_SINK_H__
@@ -0,0 +1,78 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __BRC_FRAME_ANALYZER_H__
+#define __BRC_FRAME_ANALYZER_H__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "brc_routines.h"
+#include "sample_defs.h"
+#include "sample_utils.h"
+
+// Lookahead for ExtBRC: complexity of input frames is estimated on a background thread as soon
+// as they are loaded, ahead of the encoder. Luma is downscaled 4x, every 8x8 block of it gives
+// intra cost (sum of absolute deviations from block mean) and inter cost (SAD to the same block
+// of the previous frame, no motion search). Frames must be in system memory.
+class CBRCFrameAnalyzer : public BRCLookAhead {
+public:
+    CBRCFrameAnalyzer();
+    virtual ~CBRCFrameAnalyzer();
+
+    static bool IsSupported(mfxU32 fourCC);
+
+    // nDepth - number of frames after the current one given to BRC
+    mfxStatus Init(const mfxFrameInfo& info, mfxU32 nDepth);
+    void Close();
+
+    // Frames must come in display order. Surface stays locked until it is analyzed.
+    mfxStatus Submit(mfxFrameSurface1* pSurface);
+
+    virtual mfxU32 GetDepth() const;
+    // waits for submitted frames which are not analyzed yet
+    virtual mfxU32 GetComplexity(mfxU32 nOrder, mfxU32 nCount, BRCFrameComplexity* pCmplx);
+
+protected:
+    struct Result {
+        mfxU32 Order;
+        BRCFrameComplexity Cmplx;
+    };
+
+    void AnalyzerRoutine();
+    void Downscale(const mfxFrameSurface1& surface);
+    BRCFrameComplexity Analyze();
+
+    mfxU32 m_nDepth;
+    mfxU32 m_nWidth; // downscaled luma, multiple of block size
+    mfxU32 m_nHeight;
+    std::vector<mfxU16> m_rowSum; // sum of 4 input rows
+    // per column of a row of blocks
+    std::vector<mfxU16> m_colSum;
+    std::vector<mfxU16> m_colIntra;
+    std::vector<mfxU16> m_colInter;
+    std::vector<mfxU8> m_mean; // mean of the block the column belongs to
+    std::vector<mfxU8> m_cur;
+    std::vector<mfxU8> m_prev;
+    bool m_bPrev;
+
+    std::vector<Result> m_results; // ring indexed by display order
+    std::deque<mfxFrameSurface1*> m_queue;
+    mfxU32 m_nSubmitted;
+    mfxU32 m_nAnalyzed;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_bStop;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CBRCFrameAnalyzer);
+};
+
+#endif //__BRC_FRAME_ANALYZER_H__
@@ -16,6 +16,7 @@
 #include "vpl/mfxbrc.h"
 
 #include <algorithm>
+#include <vector>
 
 #define MFX_CHECK_NULL_PTR1(pointer) MSDK_CHECK_POINTER(pointer, MFX_ERR_NULL_PTR);
 
@@ -376,8 +377,34 @@ private:
     double m_taf_prv; // final arrival time of prev unit
 };
 
+// Complexity of a frame estimated before encoding. Costs of all frames are in the same units.
+struct BRCFrameComplexity {
+    mfxF64 IntraCost; // cost of coding the frame without references
+    mfxF64 InterCost; // cost of coding from the previous frame, not above IntraCost
+};
+
+// Source of complexity of frames which are not encoded yet. Frames are numbered in display
+// order from the beginning of the stream. Called from encoder threads.
+class BRCLookAhead {
+public:
+    virtual ~BRCLookAhead() {}
+    // number of frames after the current one BRC looks at
+    virtual mfxU32 GetDepth() const = 0;
+    // fills complexity of up to nCount frames starting from nOrder, returns number of filled frames
+    virtual mfxU32 GetComplexity(mfxU32 nOrder, mfxU32 nCount, BRCFrameComplexity* pCmplx) = 0;
+};
+
 class ExtBRC {
 private:
+    // frame between GetFrameCtrl and Update, cost is used to learn the size model
+    struct LookAheadFrame {
+        mfxU32 EncOrder;
+        mfxF64 Cost; // cost for frame type
+        mfxF64 InterCost;
+        mfxI32 QpOffset; // added to QP of reactive BRC
+        mfxI32 TotalOffset; // QpOffset and changes for recode and padding thresholds
+    };
+
     cBRCParams m_par;
     std::unique_ptr<HRDCodecSpec> m_hrdSpec;
     bool m_bInit;
@@ -387,6 +414,14 @@ private:
     std::vector<mfxU8> m_MBQPBuff;
     std::vector<mfxExtBuffer*> m_ExtBuff;
 
+    BRCLookAhead* m_pLA;
+    mfxU32 m_laIdrOrder; // display order of last IDR from the beginning of the stream
+    mfxF64 m_laAlpha[3]; // bits * qstep / cost for I, P and B frames, 0 - not known yet
+    mfxF64 m_laRefCost; // average inter cost of encoded frames, current QP is tuned for it
+    mfxF64 m_laBitsGain; // bits saved by lookahead QP changes, negative if overspent
+    std::vector<BRCFrameComplexity> m_laWindow;
+    std::vector<LookAheadFrame> m_laFrames;
+
 public:
     ExtBRC()
             : m_par(),
@@ -396,7 +431,14 @@ public:
               m_avg(),
               m_MBQP(),
               m_MBQPBuff(),
-              m_ExtBuff() {}
+              m_ExtBuff(),
+              m_pLA(NULL),
+              m_laIdrOrder(0),
+              m_laAlpha(),
+              m_laRefCost(0),
+              m_laBitsGain(0),
+              m_laWindow(),
+              m_laFrames() {}
     mfxStatus Init(mfxVideoParam* par);
     mfxStatus Reset(mfxVideoParam* par);
     mfxStatus Close() {
@@ -406,8 +448,19 @@ public:
     mfxStatus GetFrameCtrl(mfxBRCFrameParam* par, mfxBRCFrameCtrl* ctrl);
     mfxStatus Update(mfxBRCFrameParam* par, mfxBRCFrameCtrl* ctrl, mfxBRCFrameStatus* status);
 
+    // Complexity of upcoming frames turns QP allocation from reactive to proactive: QP follows
+    // complexity of the window and is raised for frames predicted to need a recode.
+    // Must outlive the BRC, set before Init.
+    void SetLookAhead(BRCLookAhead* pLA) {
+        m_pLA = pLA;
+    }
+
 protected:
     mfxI32 GetCurQP(mfxU32 type, mfxI32 layer);
+    mfxF64 GetRecodeFrameSize(bool bIntra, mfxU32 encOrder);
+    mfxI32 GetLookAheadQP(mfxBRCFrameParam* par, mfxU32 type, mfxI32 qp);
+    mfxI32 GetLookAheadQPOffset(mfxU32 encOrder);
+    void UpdateLookAheadModel(mfxU32 encOrder, mfxU32 type, mfxI32 bits, mfxF64 qstep, bool bSH);
 };
 
 namespace HEVCExtBRC {
@@ -436,9 +489,13 @@ inline mfxStatus Update(mfxHDL pthis,
     return ((ExtBRC*)pthis)->Update(par, ctrl, status);
 }
 
-inline mfxStatus Create(mfxExtBRC& m_BRC) {
+inline mfxStatus Create(mfxExtBRC& m_BRC, BRCLookAhead* pLA = NULL) {
     MFX_CHECK(m_BRC.pthis == NULL, MFX_ERR_UNDEFINED_BEHAVIOR);
-    m_BRC.pthis        = new ExtBRC;
+    // reported here rather than in Init, BRC simulation initializes thousands of instances
+    printf("Sample BRC is used\n");
+    ExtBRC* pBRC = new ExtBRC;
+    pBRC->SetLookAhead(pLA);
+    m_BRC.pthis        = pBRC;
     m_BRC.Init         = Init;
     m_BRC.Reset        = Reset;
     m_BRC.Close        = Close;
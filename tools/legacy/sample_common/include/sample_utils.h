@@ -9,8 +9,11 @@
 
 #include <stdio.h>
 #include <algorithm>
+#include <cstddef>
+#include <deque>
 #include <fstream>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <stdexcept>
@@ -430,22 +433,29 @@ public:
 
 /** ExtBufHolder is an utility class which
  *  provide interface for mfxExtBuffer objects management in any mfx structure (e.g. mfxVideoParam)
+ *
+ *  Extension buffers are bump-allocated from an arena owned by the holder. Arena blocks never move,
+ *  so pointers returned by AddExtBuffer stay valid until ClearBuffers. ClearBuffers (and so every
+ *  assignment) rewinds the arena and keeps its memory, so refilling a holder with the same set of
+ *  buffers, e.g. per-frame encode controls, needs no heap allocations. Buffers are found through
+ *  an index sorted by ID.
  */
 template <typename T>
 class ExtBufHolder : public T {
 public:
-    ExtBufHolder() : T() {
+    ExtBufHolder() : T(), m_ext_buf(), m_index(), m_blocks(), m_cur_block(0), m_block_used(0) {
         m_ext_buf.reserve(max_num_ext_buffers);
     }
 
-    ~ExtBufHolder() // only buffers allocated by wrapper can be released
-    {
-        for (auto it = m_ext_buf.begin(); it != m_ext_buf.end(); it++) {
-            delete[](mfxU8*)(*it);
-        }
-    }
+    ~ExtBufHolder() {} // arena blocks are released by their owners
 
-    ExtBufHolder(const ExtBufHolder& ref) {
+    ExtBufHolder(const ExtBufHolder& ref)
+            : T(),
+              m_ext_buf(),
+              m_index(),
+              m_blocks(),
+              m_cur_block(0),
+              m_block_used(0) {
         m_ext_buf.reserve(max_num_ext_buffers);
         *this = ref; // call to operator=
     }
@@ -455,7 +465,13 @@ public:
         return operator   =(*src_base);
     }
 
-    ExtBufHolder(const T& ref) {
+    ExtBufHolder(const T& ref)
+            : T(),
+              m_ext_buf(),
+              m_index(),
+              m_blocks(),
+              m_cur_block(0),
+              m_block_used(0) {
         *this = ref; // call to operator=
     }
 
@@ -470,7 +486,8 @@ public:
 
         const auto ref_ = ExtParamAccessor<T>(ref);
 
-        //reproduce list of extension buffers and copy its content
+        // validate source and make arena fit all buffers in one block
+        size_t total = 0;
         for (size_t i = 0; i < ref_.NumExtParam; ++i) {
             const auto src_buf = ref_.ExtParam[i];
             if (!src_buf)
@@ -480,6 +497,13 @@ public:
                     "Deep copy of '" + Fourcc2Str(src_buf->BufferId) + "' extBuffer is not allowed";
                 throw mfxError(MFX_ERR_UNDEFINED_BEHAVIOR, msg);
             }
+            total += AlignArenaSize(src_buf->BufferSz);
+        }
+        ReserveArena(total);
+
+        //reproduce list of extension buffers and copy its content
+        for (size_t i = 0; i < ref_.NumExtParam; ++i) {
+            const auto src_buf = ref_.ExtParam[i];
 
             // 'false' below is because here we just copy extBuffer's one by one
             auto dst_buf = AddExtBuffer(src_buf->BufferId, src_buf->BufferSz, false);
@@ -501,24 +525,22 @@ public:
         return (TB*)b;
     }
 
+    // Memory of removed buffer is reused after ClearBuffers only
     template <typename TB>
     void RemoveExtBuffer() {
-        auto it = std::find_if(m_ext_buf.begin(),
-                               m_ext_buf.end(),
-                               CmpExtBufById(mfx_ext_buffer_id<TB>::id));
-        if (it != m_ext_buf.end()) {
-            delete[](mfxU8*)(*it);
-            it = m_ext_buf.erase(it);
+        size_t pos = FindExtBufferPos(mfx_ext_buffer_id<TB>::id);
+        if (pos != NO_POS) {
+            auto it = m_ext_buf.erase(m_ext_buf.begin() + pos);
 
             if (IsPairedMfxExtBuffer<TB>::value) {
                 if (it == m_ext_buf.end() || (*it)->BufferId != mfx_ext_buffer_id<TB>::id)
                     throw mfxError(MFX_ERR_NULL_PTR,
                                    "RemoveExtBuffer: ExtBuffer's parity has been broken");
 
-                delete[](mfxU8*)(*it);
                 m_ext_buf.erase(it);
             }
 
+            RebuildIndex();
             RefreshBuffers();
         }
     }
@@ -539,14 +561,28 @@ public:
     }
 
 private:
+    enum : size_t { NO_POS = (size_t)-1, ARENA_BLOCK_SIZE = 4096 };
+
+    struct ArenaBlock {
+        std::unique_ptr<mfxU8[]> data;
+        size_t size;
+    };
+
+    // position of the first buffer with given ID in m_ext_buf
+    struct IndexEntry {
+        mfxU32 id;
+        size_t pos;
+    };
+
     mfxExtBuffer* AddExtBuffer(mfxU32 id, mfxU32 size, bool isPairedExtBuffer) {
         if (!size || !id)
             throw mfxError(MFX_ERR_NULL_PTR, "AddExtBuffer: wrong size or id!");
 
-        auto it = std::find_if(m_ext_buf.begin(), m_ext_buf.end(), CmpExtBufById(id));
-        if (it == m_ext_buf.end()) {
-            auto buf = (mfxExtBuffer*)new mfxU8[size];
-            memset(buf, 0, size);
+        size_t pos = FindExtBufferPos(id);
+        if (pos == NO_POS) {
+            pos = m_ext_buf.size();
+
+            auto buf = (mfxExtBuffer*)AllocateFromArena(size);
             m_ext_buf.push_back(buf);
 
             buf->BufferId = id;
@@ -554,31 +590,107 @@ private:
 
             if (isPairedExtBuffer) {
                 // Allocate the other mfxExtBuffer _right_after_ the first one ...
-                buf = (mfxExtBuffer*)new mfxU8[size];
-                memset(buf, 0, size);
+                buf = (mfxExtBuffer*)AllocateFromArena(size);
                 m_ext_buf.push_back(buf);
 
                 buf->BufferId = id;
                 buf->BufferSz = size;
-
-                RefreshBuffers();
-                return m_ext_buf[m_ext_buf.size() - 2]; // ... and return a pointer to the first one
             }
 
+            AddToIndex(id, pos);
             RefreshBuffers();
-            return m_ext_buf.back();
+            return m_ext_buf[pos]; // ... and return a pointer to the first one
         }
 
-        return *it;
+        return m_ext_buf[pos];
+    }
+
+    size_t FindExtBufferPos(mfxU32 id) const {
+        auto it = LowerBound(id);
+        return (it != m_index.end() && it->id == id) ? it->pos : NO_POS;
     }
 
     mfxExtBuffer* FindExtBuffer(mfxU32 id, uint32_t fieldId) const {
-        auto it = std::find_if(m_ext_buf.begin(), m_ext_buf.end(), CmpExtBufById(id));
-        if (fieldId && it != m_ext_buf.end()) {
-            ++it;
-            return it != m_ext_buf.end() ? *it : nullptr;
+        size_t pos = FindExtBufferPos(id);
+        if (pos == NO_POS)
+            return nullptr;
+        if (fieldId)
+            ++pos;
+        return pos < m_ext_buf.size() ? m_ext_buf[pos] : nullptr;
+    }
+
+    typename std::vector<IndexEntry>::const_iterator LowerBound(mfxU32 id) const {
+        return std::lower_bound(m_index.begin(),
+                                m_index.end(),
+                                id,
+                                [](const IndexEntry& e, mfxU32 val) {
+                                    return e.id < val;
+                                });
+    }
+
+    void AddToIndex(mfxU32 id, size_t pos) {
+        auto it = m_index.begin() + (LowerBound(id) - m_index.cbegin());
+        m_index.insert(it, IndexEntry{ id, pos });
+    }
+
+    void RebuildIndex() {
+        m_index.clear();
+        for (size_t i = 0; i < m_ext_buf.size(); ++i) {
+            if (FindExtBufferPos(m_ext_buf[i]->BufferId) == NO_POS)
+                AddToIndex(m_ext_buf[i]->BufferId, i);
+        }
+    }
+
+    static size_t AlignArenaSize(size_t size) {
+        const size_t align = alignof(std::max_align_t);
+        return (size + align - 1) & ~(align - 1);
+    }
+
+    // returns zeroed memory, never moves previously allocated buffers
+    mfxU8* AllocateFromArena(size_t size) {
+        size = AlignArenaSize(size);
+
+        for (; m_cur_block < m_blocks.size(); ++m_cur_block, m_block_used = 0) {
+            ArenaBlock& block = m_blocks[m_cur_block];
+            if (block.size - m_block_used >= size) {
+                mfxU8* p = block.data.get() + m_block_used;
+                m_block_used += size;
+                memset(p, 0, size);
+                return p;
+            }
+        }
+
+        size_t block_size = std::max(size, (size_t)ARENA_BLOCK_SIZE);
+        if (!m_blocks.empty())
+            block_size = std::max(block_size, 2 * m_blocks.back().size);
+
+        m_blocks.push_back(ArenaBlock{ std::unique_ptr<mfxU8[]>(new mfxU8[block_size]), block_size });
+        m_cur_block  = m_blocks.size() - 1;
+        m_block_used = size;
+        memset(m_blocks.back().data.get(), 0, size);
+        return m_blocks.back().data.get();
+    }
+
+    // arena must be rewound, makes first block hold at least size bytes
+    void ReserveArena(size_t size) {
+        if (!size || (!m_blocks.empty() && m_blocks[0].size >= size))
+            return;
+
+        m_blocks.clear();
+        m_blocks.push_back(ArenaBlock{ std::unique_ptr<mfxU8[]>(new mfxU8[size]), size });
+    }
+
+    // all buffers are released, arena memory is kept and merged into one block
+    void RewindArena() {
+        if (m_blocks.size() > 1) {
+            size_t total = 0;
+            for (auto& block : m_blocks)
+                total += block.size;
+            m_blocks.clear();
+            ReserveArena(total);
         }
-        return it != m_ext_buf.end() ? *it : nullptr;
+        m_cur_block  = 0;
+        m_block_used = 0;
     }
 
     void RefreshBuffers() {
@@ -588,12 +700,9 @@ private:
     }
 
     void ClearBuffers() {
-        if (m_ext_buf.size()) {
-            for (auto it = m_ext_buf.begin(); it != m_ext_buf.end(); it++) {
-                delete[](mfxU8*)(*it);
-            }
-            m_ext_buf.clear();
-        }
+        m_ext_buf.clear();
+        m_index.clear();
+        RewindArena();
         RefreshBuffers();
     }
 
@@ -614,16 +723,6 @@ private:
         return it != std::end(allowed);
     }
 
-    struct CmpExtBufById {
-        mfxU32 id;
-
-        CmpExtBufById(mfxU32 _id) : id(_id){};
-
-        bool operator()(mfxExtBuffer* b) {
-            return (b && b->BufferId == id);
-        };
-    };
-
     static std::string Fourcc2Str(mfxU32 fourcc) {
         std::string s;
         for (size_t i = 0; i < 4; i++) {
@@ -633,6 +732,10 @@ private:
     }
 
     std::vector<mfxExtBuffer*> m_ext_buf;
+    std::vector<IndexEntry> m_index; // sorted by id
+    std::vector<ArenaBlock> m_blocks;
+    size_t m_cur_block; // block used for allocations
+    size_t m_block_used; // bytes taken in the current block
 };
 
 using MfxVideoParamsWrapper = ExtBufHolder<mfxVideoParam>;
@@ -640,38 +743,147 @@ using mfxEncodeCtrlWrap     = ExtBufHolder<mfxEncodeCtrl>;
 using mfxInitParamlWrap     = ExtBufHolder<mfxInitParam>;
 using mfxFrameSurfaceWrap   = ExtBufHolder<mfxFrameSurface1>;
 
+// Slab of equal slots for output bitstreams of one pipeline. Free slots are linked into a list,
+// so a slot is acquired and released in O(1), a block grows in place by taking the following
+// free slots. Arena is not thread-safe and must outlive bitstreams using it.
+class CBitstreamArena {
+public:
+    CBitstreamArena();
+    ~CBitstreamArena();
+
+    mfxStatus Init(mfxU32 nSlots, mfxU32 nSlotSize);
+    void Close();
+    bool IsInitialized() const {
+        return m_pBuffer != nullptr;
+    }
+    mfxU32 GetSlotSize() const {
+        return m_nSlotSize;
+    }
+    mfxU32 GetFreeSlots() const {
+        return m_nFreeSlots;
+    }
+
+    // returns nullptr if there is no free space for nBytes
+    mfxU8* Acquire(mfxU32 nBytes, mfxU32* pCapacity);
+    // returns false if the block can't be extended without moving
+    bool Grow(mfxU8* pBlock, mfxU32 nBytes, mfxU32* pCapacity);
+    void Release(mfxU8* pBlock);
+
+private:
+    static const mfxU32 NO_SLOT = 0xFFFFFFFF;
+
+    void LinkFree(mfxU32 slot);
+    void UnlinkFree(mfxU32 slot);
+
+    std::unique_ptr<mfxU8[]> m_pBuffer;
+    mfxU32 m_nSlots;
+    mfxU32 m_nSlotSize;
+    mfxU32 m_nFreeSlots;
+    mfxU32 m_freeHead;
+    std::vector<mfxU32> m_nextFree;
+    std::vector<mfxU32> m_prevFree;
+    std::vector<mfxU32> m_blockSlots; // number of slots in the block starting at the slot
+
+    DISALLOW_COPY_AND_ASSIGN(CBitstreamArena);
+};
+
 class mfxBitstreamWrapper : public ExtBufHolder<mfxBitstream> {
     typedef ExtBufHolder<mfxBitstream> base;
 
 public:
-    mfxBitstreamWrapper() : base(), m_data() {}
+    mfxBitstreamWrapper() : base(), m_data(), m_pArena(nullptr), m_pBlock(nullptr) {}
 
-    mfxBitstreamWrapper(mfxU32 n_bytes) : base(), m_data() {
+    mfxBitstreamWrapper(mfxU32 n_bytes)
+            : base(),
+              m_data(),
+              m_pArena(nullptr),
+              m_pBlock(nullptr) {
         Extend(n_bytes);
     }
 
+    // copy is attached to the same arena, but its data is kept on the heap
     mfxBitstreamWrapper(const mfxBitstreamWrapper& bs_wrapper)
             : base(bs_wrapper),
-              m_data(bs_wrapper.m_data) {
+              m_data(bs_wrapper.m_data),
+              m_pArena(bs_wrapper.m_pArena),
+              m_pBlock(nullptr) {
+        if (bs_wrapper.m_pBlock)
+            m_data.assign(bs_wrapper.m_pBlock, bs_wrapper.m_pBlock + bs_wrapper.MaxLength);
         Data = m_data.data();
     }
 
+    // own block goes back to the arena, the arena set by SetArena() is kept
     mfxBitstreamWrapper& operator=(mfxBitstreamWrapper const& bs_wrapper) {
+        if (this == &bs_wrapper)
+            return *this;
+
+        CBitstreamArena* pArena = m_pArena ? m_pArena : bs_wrapper.m_pArena;
         mfxBitstreamWrapper tmp(bs_wrapper);
 
-        *this = std::move(tmp);
+        *this    = std::move(tmp);
+        m_pArena = pArena;
+
+        return *this;
+    }
+
+    mfxBitstreamWrapper(mfxBitstreamWrapper&& bs_wrapper)
+            : base(std::move(bs_wrapper)),
+              m_data(std::move(bs_wrapper.m_data)),
+              m_pArena(bs_wrapper.m_pArena),
+              m_pBlock(bs_wrapper.m_pBlock) {
+        bs_wrapper.Detach();
+    }
+
+    mfxBitstreamWrapper& operator=(mfxBitstreamWrapper&& bs_wrapper) {
+        if (this == &bs_wrapper)
+            return *this;
+
+        ReleaseBlock();
+        base::operator=(std::move(bs_wrapper));
+        m_data   = std::move(bs_wrapper.m_data);
+        m_pArena = bs_wrapper.m_pArena;
+        m_pBlock = bs_wrapper.m_pBlock;
+        bs_wrapper.Detach();
 
         return *this;
     }
 
-    mfxBitstreamWrapper(mfxBitstreamWrapper&& bs_wrapper) = default;
-    mfxBitstreamWrapper& operator=(mfxBitstreamWrapper&& bs_wrapper) = default;
-    ~mfxBitstreamWrapper()                                           = default;
+    ~mfxBitstreamWrapper() {
+        ReleaseBlock();
+    }
+
+    // buffers are taken from the arena first, heap is used when the arena is full
+    void SetArena(CBitstreamArena* pArena) {
+        m_pArena = pArena;
+    }
 
     void Extend(mfxU32 n_bytes) {
         if (MaxLength >= n_bytes)
             return;
 
+        if (m_pArena && m_pArena->IsInitialized()) {
+            mfxU32 capacity = 0;
+            if (m_pBlock && m_pArena->Grow(m_pBlock, n_bytes, &capacity)) {
+                MaxLength = capacity;
+                return;
+            }
+
+            if (!m_pBlock && m_data.empty()) {
+                m_pBlock = m_pArena->Acquire(n_bytes, &capacity);
+                if (m_pBlock) {
+                    Data      = m_pBlock;
+                    MaxLength = capacity;
+                    return;
+                }
+            }
+        }
+
+        if (m_pBlock) {
+            // block can't grow in place, its content moves to the heap
+            m_data.assign(m_pBlock, m_pBlock + MaxLength);
+            ReleaseBlock();
+        }
+
         m_data.resize(n_bytes);
 
         Data      = m_data.data();
@@ -679,7 +891,22 @@ public:
     }
 
 private:
+    void ReleaseBlock() {
+        if (m_pBlock && m_pArena)
+            m_pArena->Release(m_pBlock);
+        m_pBlock = nullptr;
+    }
+
+    void Detach() {
+        m_pArena  = nullptr;
+        m_pBlock  = nullptr;
+        Data      = nullptr;
+        MaxLength = 0;
+    }
+
     std::vector<mfxU8> m_data;
+    CBitstreamArena* m_pArena;
+    mfxU8* m_pBlock;
 };
 
 class CSmplYUVReader {
@@ -697,11 +924,226 @@ public:
     virtual void Reset();
     mfxU32 m_ColorFormat; // color format of input YUV data, YUV420 or NV12
 
+    // nFrames - number of frames read ahead per input file on background threads (0 - disabled),
+    // must be called before Init
+    void SetPrefetchParams(mfxU32 nFrames);
+
 protected:
+    // reads count elements of given size for view vid, returns number of elements read
+    virtual mfxU32 ReadData(void* ptr, mfxU32 size, mfxU32 count, mfxU32 vid);
+
+    // raw data of one input file read ahead in frame sized chunks
+    struct PrefetchQueue {
+        PrefetchQueue()
+                : thread(),
+                  mutex(),
+                  cond(),
+                  ready(),
+                  free(),
+                  current(),
+                  readPos(0),
+                  bStarted(false),
+                  bEOF(false),
+                  bStop(false) {}
+
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::deque<std::vector<mfxU8>> ready; // chunks read from the file
+        std::vector<std::vector<mfxU8>> free; // consumed chunks, reused by the reading thread
+        std::vector<mfxU8> current; // chunk being parsed by LoadNextFrame
+        size_t readPos;
+        bool bStarted;
+        bool bEOF;
+        bool bStop;
+    };
+
+    void StartPrefetch(mfxU32 vid);
+    void StopPrefetch();
+    void StopPrefetch(mfxU32 vid);
+    void PrefetchRoutine(mfxU32 vid);
+    mfxU32 ReadPrefetched(void* ptr, mfxU32 size, mfxU32 count, mfxU32 vid);
+
     std::vector<FILE*> m_files;
 
     bool shouldShift10BitsHigh;
     bool m_bInited;
+
+    mfxU32 m_nPrefetchFrames;
+    mfxU32 m_nPrefetchChunk; // bytes of one input frame
+    std::vector<std::unique_ptr<PrefetchQueue>> m_prefetch;
+};
+
+// Source of caller-owned raw frames in system memory. Frames are imported into
+// mfxFrameSurface1 by pointing its planes at the owner's buffer, nothing is copied.
+// Buffer must stay valid until ReleaseFrame() is called for the surface, which happens
+// once tasks using the surface are synchronized and its Data.Locked drops to 0.
+class CExternalFrameSource {
+public:
+    virtual ~CExternalFrameSource() {}
+
+    // points planes of pSurface at the next frame, MFX_ERR_MORE_DATA if there are no more frames
+    virtual mfxStatus ImportFrame(mfxFrameSurface1* pSurface) = 0;
+    // returns imported buffer to the owner, does nothing if pSurface holds no imported frame
+    virtual void ReleaseFrame(mfxFrameSurface1* pSurface) = 0;
+    // restarts the source from the first frame
+    virtual void Reset() = 0;
+};
+
+// Maps raw input file or shared memory object (e.g. /dev/shm/...) and hands out its frames
+// without a copy. Data must be in the surface color format. File frames are CropW x CropH,
+// CropW must be equal to the surface Width, surface Height may be padded: encoder reads of
+// the padded rows stay inside the mapping, which is extended with zero pages.
+class CMappedYUVFrameSource : public CExternalFrameSource {
+public:
+    CMappedYUVFrameSource();
+    virtual ~CMappedYUVFrameSource();
+
+    // info - frame info of the surfaces which frames are imported into
+    mfxStatus Init(const msdk_string& input, const mfxFrameInfo& info);
+    void Close();
+
+    virtual mfxStatus ImportFrame(mfxFrameSurface1* pSurface);
+    virtual void ReleaseFrame(mfxFrameSurface1* pSurface);
+    virtual void Reset();
+
+protected:
+    mfxU8* m_pData;
+    size_t m_nSize; // size of the input data
+    size_t m_nMapSize; // size of the mapping, includes padding after the input data
+    size_t m_nNextFrame; // offset of the next frame in the mapping
+    mfxFrameInfo m_FrameInfo;
+    mfxU32 m_nFrameLength; // bytes of one frame in the input
+    mfxU32 m_nPitch;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CMappedYUVFrameSource);
+};
+
+// Walks over nItems preloaded items nLoops times (0 - infinitely)
+class CPreloadedLoop {
+public:
+    CPreloadedLoop() : m_nItems(0), m_nLoops(0), m_nLoop(0), m_nItem(0), m_nPosition(0) {}
+
+    void Init(mfxU32 nItems, mfxU32 nLoops) {
+        m_nItems = nItems;
+        m_nLoops = nLoops;
+        Reset();
+    }
+    void Reset() {
+        m_nLoop     = 0;
+        m_nItem     = 0;
+        m_nPosition = 0;
+    }
+    // returns index of the next item or MFX_ERR_MORE_DATA when all loops are done
+    mfxStatus Next(mfxU32& index) {
+        mfxStatus sts = Peek(index);
+        if (m_nItems && m_nItem == m_nItems) {
+            m_nItem = 0;
+            m_nLoop++;
+        }
+        if (MFX_ERR_NONE != sts)
+            return sts;
+
+        m_nItem++;
+        m_nPosition++;
+        return MFX_ERR_NONE;
+    }
+    // the same as Next() but doesn't move to the next item
+    mfxStatus Peek(mfxU32& index) const {
+        if (!m_nItems)
+            return MFX_ERR_MORE_DATA;
+
+        const bool bWrap = (m_nItem == m_nItems);
+        if (m_nLoops && m_nLoop + (bWrap ? 1 : 0) >= m_nLoops)
+            return MFX_ERR_MORE_DATA;
+
+        index = bWrap ? 0 : m_nItem;
+        return MFX_ERR_NONE;
+    }
+    bool IsLastLoop() const {
+        return m_nLoops && m_nLoop + 1 >= m_nLoops;
+    }
+    mfxU32 GetLoop() const {
+        return m_nLoop;
+    }
+    // number of items returned since the last reset
+    mfxU64 GetPosition() const {
+        return m_nPosition;
+    }
+
+protected:
+    mfxU32 m_nItems;
+    mfxU32 m_nLoops;
+    mfxU32 m_nLoop;
+    mfxU32 m_nItem;
+    mfxU64 m_nPosition;
+};
+
+// YUV reader which keeps input frames in memory and replays them in a loop,
+// so pipeline throughput can be measured without file I/O.
+// Frames are parsed by CSmplYUVReader, so all its color formats are supported.
+class CPreloadedYUVReader : public CSmplYUVReader {
+public:
+    CPreloadedYUVReader();
+    virtual ~CPreloadedYUVReader();
+
+    // nFrames - number of frames kept in memory per view (0 - whole file),
+    // nLoops - number of passes over the preloaded frames (0 - infinite),
+    // bRewriteTimeStamps - set TimeStamp of every returned surface from its frame rate,
+    // so time stamps keep growing across loops
+    void SetPreloadParams(mfxU32 nFrames, mfxU32 nLoops, bool bRewriteTimeStamps = false);
+    bool IsPreloadEnabled() const {
+        return m_bPreload;
+    }
+
+    virtual void Close();
+    virtual void Reset();
+    virtual mfxStatus SkipNframesFromBeginning(mfxU16 w, mfxU16 h, mfxU32 viewId, mfxU32 nframes);
+    virtual mfxStatus LoadNextFrame(mfxFrameSurface1* pSurface);
+
+protected:
+    struct PreloadedView {
+        PreloadedView() : data(), frameOffsets(), loop(), readPos(0), bLoaded(false) {}
+
+        std::vector<mfxU8> data;
+        std::vector<size_t> frameOffsets;
+        CPreloadedLoop loop;
+        size_t readPos;
+        bool bLoaded;
+    };
+
+    virtual mfxU32 ReadData(void* ptr, mfxU32 size, mfxU32 count, mfxU32 vid);
+    mfxStatus Preload(mfxFrameSurface1* pSurface, PreloadedView& view);
+
+    std::vector<PreloadedView> m_views;
+    bool m_bPreload;
+    bool m_bRecording;
+    mfxU32 m_nFramesToPreload;
+    mfxU32 m_nLoops;
+    bool m_bRewriteTimeStamps;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CPreloadedYUVReader);
+};
+
+enum BitstreamSinkType {
+    SINK_STDIO = 0, // fwrite of every frame on the calling thread
+    SINK_ASYNC, // writes batched into large buffers and issued by a background thread
+    SINK_DIRECT // as SINK_ASYNC, but file is opened with O_DIRECT (Linux only)
+};
+
+// Destination of encoded data, implementations are in bitstream_sink.h
+class CBitstreamSink {
+public:
+    virtual ~CBitstreamSink() {}
+
+    virtual mfxStatus Init(const msdk_char* strName) = 0;
+    // data may be reused by the caller as soon as the call returns
+    virtual mfxStatus Write(const mfxU8* pData, mfxU32 nSize) = 0;
+    // end of frame, sinks with message boundaries send out what they have
+    virtual mfxStatus Flush() = 0;
+    virtual void Close() = 0;
 };
 
 class CSmplBitstreamWriter {
@@ -709,6 +1151,10 @@ public:
     CSmplBitstreamWriter();
     virtual ~CSmplBitstreamWriter();
 
+    // must be called before Init, tcp://host:port and udp://host:port names
+    // always go to a socket sink
+    void SetSinkParams(BitstreamSinkType type, mfxU32 nBufferSize = 0);
+
     virtual mfxStatus Init(const msdk_char* strFileName);
     virtual void ForceInitStatus(bool status);
     virtual mfxStatus WriteNextFrame(mfxBitstream* pMfxBitstream,
@@ -720,9 +1166,16 @@ public:
     bool m_bSkipWriting;
 
 protected:
+    // returns nullptr sink for SINK_STDIO
+    mfxStatus CreateSink(const msdk_char* strFileName, std::unique_ptr<CBitstreamSink>& sink);
+    mfxStatus WriteData(const mfxU8* pData, mfxU32 nSize);
+
     FILE* m_fSource;
     bool m_bInited;
     msdk_string m_sFile;
+    BitstreamSinkType m_SinkType;
+    mfxU32 m_nSinkBufferSize; // 0 - default
+    std::unique_ptr<CBitstreamSink> m_pSink; // replaces m_fSource if set
 };
 
 class CSmplYUVWriter {
@@ -764,6 +1217,30 @@ protected:
     bool m_bInited;
 };
 
+// Bitstream reader which keeps the whole input file in memory and replays it in a loop
+class CPreloadedBitstreamReader : public CSmplBitstreamReader {
+public:
+    CPreloadedBitstreamReader();
+    virtual ~CPreloadedBitstreamReader();
+
+    // nLoops - number of passes over the stream (0 - infinite)
+    void SetLoops(mfxU32 nLoops);
+
+    virtual void Reset();
+    virtual void Close();
+    virtual mfxStatus Init(const msdk_char* strFileName);
+    virtual mfxStatus ReadNextFrame(mfxBitstream* pBS);
+
+protected:
+    std::vector<mfxU8> m_data;
+    size_t m_readPos;
+    CPreloadedLoop m_loop;
+    mfxU32 m_nLoops;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CPreloadedBitstreamReader);
+};
+
 class CH264FrameReader : public CSmplBitstreamReader {
 public:
     CH264FrameReader();
@@ -850,6 +1327,7 @@ public:
 
 protected:
     FILE* m_fSourceDuplicate;
+    std::shared_ptr<CBitstreamSink> m_pSinkDuplicate; // replaces m_fSourceDuplicate if set
     bool m_bJoined;
 };
 
@@ -0,0 +1,198 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SHM_TRANSPORT_H__
+#define __SHM_TRANSPORT_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sample_defs.h"
+#include "sample_utils.h"
+
+// Frames and bitstreams exchanged between processes through POSIX shared memory.
+// Segment holds a single producer / single consumer ring of fixed size slots,
+// producer writes payload straight into a slot and consumer uses it in place,
+// both sides sleep on futexes while the ring is full or empty. Each side refreshes
+// its heartbeat in the segment from a background thread, so a crashed peer is noticed.
+// Supported on Linux only, Init/Create return MFX_ERR_UNSUPPORTED elsewhere.
+
+enum ShmPayloadType { SHM_PAYLOAD_FRAMES = 1, SHM_PAYLOAD_BITSTREAM = 2 };
+
+// per slot description of the payload
+struct ShmSlotInfo {
+    mfxU64 TimeStamp;
+    mfxI64 DecodeTimeStamp;
+    mfxU32 DataLength;
+    mfxU16 FrameType; // bitstreams only
+    mfxU16 PicStruct;
+    mfxU32 FourCC; // frames only
+    mfxU32 Pitch;
+    mfxU16 Width;
+    mfxU16 Height;
+    mfxU16 CropW;
+    mfxU16 CropH;
+    mfxU32 reserved[4];
+};
+
+struct ShmRingHeader;
+
+class CShmRing {
+public:
+    CShmRing();
+    ~CShmRing();
+
+    // producer side, nSlotSize is payload capacity of one slot
+    mfxStatus Create(const msdk_char* name, mfxU32 payloadType, mfxU32 nSlots, mfxU32 nSlotSize);
+    // consumer side, waits up to nTimeout ms for the producer to create the segment
+    mfxStatus Open(const msdk_char* name, mfxU32 payloadType, mfxU32 nTimeout);
+    void Close();
+
+    // returns free slot or nullptr if consumer has gone
+    mfxU8* AcquireWrite(mfxU32* pCapacity);
+    void CommitWrite(const ShmSlotInfo& info);
+    void SetEndOfStream();
+
+    // returns MFX_ERR_MORE_DATA when producer finished and all slots are consumed,
+    // MFX_ERR_ABORTED when producer died without finishing the stream
+    mfxStatus AcquireRead(mfxU32* pSlot, mfxU8** ppData, ShmSlotInfo* pInfo);
+    // slots may be released in any order, producer gets them back in ring order
+    void ReleaseRead(mfxU32 slot);
+
+    bool IsOpened() const {
+        return nullptr != m_pHeader;
+    }
+
+protected:
+    mfxU8* SlotData(mfxU32 slot) const;
+    ShmSlotInfo* SlotInfo(mfxU32 slot) const;
+
+    void StartHeartbeat();
+    void StopHeartbeat();
+    void HeartbeatRoutine();
+    bool IsPeerAlive() const;
+
+    ShmRingHeader* m_pHeader;
+    size_t m_nSize;
+    bool m_bProducer;
+    msdk_string m_sName;
+    mfxU32 m_nNextRead; // consumer: next slot to hand out
+    std::vector<bool> m_released; // consumer: slots released out of ring order
+
+    std::thread m_heartbeat;
+    std::mutex m_beatMutex;
+    std::condition_variable m_beatCond;
+    bool m_bStopBeat;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CShmRing);
+};
+
+// Encoded frames written to shared memory, one frame per slot.
+// Partial encoder output is copied into the slot as it arrives, slot is committed
+// with the last chunk of the frame.
+class CShmBitstreamWriter : public CSmplBitstreamWriter {
+public:
+    CShmBitstreamWriter();
+    virtual ~CShmBitstreamWriter();
+
+    // must be called before Init
+    void SetRingParams(mfxU32 nSlots, mfxU32 nSlotSize);
+
+    virtual mfxStatus Init(const msdk_char* strFileName);
+    virtual mfxStatus WriteNextFrame(mfxBitstream* pMfxBitstream,
+                                     bool isPrint         = true,
+                                     bool isCompleteFrame = true);
+    virtual mfxStatus Reset();
+    virtual void Close();
+
+protected:
+    CShmRing m_ring;
+    mfxU32 m_nSlots;
+    mfxU32 m_nSlotSize;
+    mfxU8* m_pSlot; // slot being filled with partial output
+    mfxU32 m_nSlotFill; // bytes of the current frame already in m_pSlot
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CShmBitstreamWriter);
+};
+
+// Encoded frames read from shared memory, appended to decoder's bitstream
+class CShmBitstreamReader : public CSmplBitstreamReader {
+public:
+    CShmBitstreamReader();
+    virtual ~CShmBitstreamReader();
+
+    // stream can't be rewound
+    virtual void Reset() {}
+    virtual void Close();
+    virtual mfxStatus Init(const msdk_char* strFileName);
+    virtual mfxStatus ReadNextFrame(mfxBitstream* pBS);
+
+protected:
+    CShmRing m_ring;
+    bool m_bHaveSlot; // slot is partially consumed
+    mfxU32 m_nSlot;
+    mfxU8* m_pSlotData;
+    ShmSlotInfo m_slotInfo;
+    mfxU32 m_nSlotPos;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CShmBitstreamReader);
+};
+
+// Raw frames written to shared memory, whole Width x Height area with compact pitch.
+// Ring is created on the first frame when frame size is known.
+class CShmYUVWriter : public CSmplYUVWriter {
+public:
+    CShmYUVWriter();
+    virtual ~CShmYUVWriter();
+
+    // must be called before Init
+    void SetRingParams(mfxU32 nSlots);
+
+    virtual void Close();
+    virtual mfxStatus Init(const msdk_char* strFileName, const mfxU32 numViews);
+    virtual mfxStatus Reset();
+    virtual mfxStatus WriteNextFrame(mfxFrameSurface1* pSurface);
+    virtual mfxStatus WriteNextFrameI420(mfxFrameSurface1* pSurface);
+
+protected:
+    CShmRing m_ring;
+    mfxU32 m_nSlots;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CShmYUVWriter);
+};
+
+// Raw frames read from shared memory and imported into surfaces without a copy,
+// slot is given back to the producer when ReleaseFrame() is called for the surface
+class CShmFrameSource : public CExternalFrameSource {
+public:
+    CShmFrameSource();
+    virtual ~CShmFrameSource();
+
+    mfxStatus Init(const msdk_string& name);
+    void Close();
+
+    virtual mfxStatus ImportFrame(mfxFrameSurface1* pSurface);
+    virtual void ReleaseFrame(mfxFrameSurface1* pSurface);
+    // live stream can't be rewound
+    virtual void Reset() {}
+
+protected:
+    CShmRing m_ring;
+    std::map<mfxFrameSurface1*, mfxU32> m_imported; // surface -> slot
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CShmFrameSource);
+};
+
+#endif //__SHM_TRANSPORT_H__
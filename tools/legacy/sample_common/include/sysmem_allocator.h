@@ -23,8 +23,19 @@ struct sFrame {
 };
 
 struct SysMemAllocatorParams : mfxAllocatorParams {
-    SysMemAllocatorParams() : mfxAllocatorParams(), pBufferAllocator(NULL) {}
+    SysMemAllocatorParams()
+            : mfxAllocatorParams(),
+              pBufferAllocator(NULL),
+              bUseSlab(false),
+              bUseHugePages(false),
+              nNumaNode(-1) {}
     MFXBufferAllocator* pBufferAllocator;
+    // all frames of a request are placed into one contiguous slab, buffer allocator isn't used
+    bool bUseSlab;
+    // slab is backed by huge pages where available, implies bUseSlab
+    bool bUseHugePages;
+    // slab memory is bound to the NUMA node, -1 - no binding, implies bUseSlab
+    mfxI32 nNumaNode;
 };
 
 class SysMemFrameAllocator : public BaseFrameAllocator {
@@ -52,7 +63,22 @@ protected:
 
     std::vector<mfxFrameAllocResponse*> m_vResp;
 
-    mfxMemId* GetMidHolder(mfxMemId mid);
+    mfxMemId* GetMidHolder(mfxMemId mid, mfxMemId** ppMids = NULL);
+
+    struct sSlab {
+        mfxMemId* mids; // slab is released together with the response owning these mids
+        mfxU8* ptr;
+        size_t size;
+    };
+
+    mfxStatus AllocSlab(size_t size, mfxMemId* mids, mfxU8** ptr);
+    void FreeSlab(const sSlab& slab);
+
+    bool m_bUseSlab;
+    bool m_bUseHugePages;
+    mfxI32 m_nNumaNode;
+    bool m_bHugePagesFailed;
+    std::vector<sSlab> m_vSlabs;
 };
 
 class SysMemBufferAllocator : public MFXBufferAllocator {
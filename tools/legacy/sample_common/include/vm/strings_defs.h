@@ -38,6 +38,7 @@ typedef TCHAR msdk_char;
     #define msdk_strstr               _tcsstr
     #define msdk_atoi                 _ttoi
     #define msdk_strtol               _tcstol
+    #define msdk_strtoll              _tcstoi64
     #define msdk_strtod               _tcstod
     #define msdk_strchr               _tcschr
     #define msdk_strnlen(str, lenmax) strnlen_s(str, lenmax)
@@ -81,6 +82,7 @@ typedef char msdk_char;
     #define msdk_atoi                 atoi
     #define msdk_atoll                atoll
     #define msdk_strtol               strtol
+    #define msdk_strtoll              strtoll
     #define msdk_strtod               strtod
     #define msdk_strnlen(str, maxlen) strlen(str)
     #define msdk_sscanf               sscanf
@@ -8,6 +8,7 @@
 #define __VPL_IMPLEMENTATION_LOADER_H__
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "vpl/mfxdispatcher.h"
@@ -25,6 +26,8 @@ class VPLImplementationLoader {
     mfxI32 m_adapterNum;
     mfxVersion m_MinVersion;
 
+    std::recursive_mutex m_mutex;
+
 public:
     VPLImplementationLoader();
     ~VPLImplementationLoader();
@@ -47,6 +50,9 @@ public:
     std::pair<mfxI16, mfxI32> GetDeviceIDAndAdapter() const;
     mfxU16 GetAdapterType() const;
     void SetMinVersion(mfxVersion const& version);
+    // serializes session creation with loader reconfiguration when sessions are created
+    // from several threads, the caller may hold it over CreateSession
+    std::recursive_mutex& GetMutex();
 };
 
 class MainVideoSession : public MFXVideoSession {
@@ -0,0 +1,361 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "bitstream_sink.h"
+
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <sys/socket.h>
+    #include <sys/types.h>
+    #include <unistd.h>
+#endif
+
+const mfxU32 SINK_DEFAULT_BUFFER_SIZE = 4 * 1024 * 1024;
+const mfxU32 SINK_BUFFERS             = 3;
+// O_DIRECT needs buffer address, size and file offset aligned to logical block size
+const mfxU32 SINK_ALIGNMENT = 4096;
+// 7 MPEG-TS packets, what UDP receivers usually expect
+const mfxU32 SINK_UDP_PAYLOAD = 1316;
+
+CBufferedSink::CBufferedSink(mfxU32 nBufferSize, bool bSubmitOnFlush)
+        : m_nBufferSize(MSDK_ALIGN(nBufferSize ? nBufferSize : SINK_DEFAULT_BUFFER_SIZE,
+                                   SINK_ALIGNMENT)),
+          m_bSubmitOnFlush(bSubmitOnFlush),
+          m_buffers(),
+          m_pCurrent(nullptr),
+          m_ready(),
+          m_free(),
+          m_thread(),
+          m_mutex(),
+          m_cond(),
+          m_bStop(false),
+          m_error(MFX_ERR_NONE) {}
+
+CBufferedSink::~CBufferedSink() {
+    // derived classes close the sink, output can't be called from here
+}
+
+mfxStatus CBufferedSink::Start() {
+    m_buffers.resize(SINK_BUFFERS);
+    for (mfxU32 i = 0; i < SINK_BUFFERS; i++) {
+        Buffer& buffer = m_buffers[i];
+        buffer.storage.resize(m_nBufferSize + SINK_ALIGNMENT);
+        buffer.pData =
+            buffer.storage.data() +
+            (SINK_ALIGNMENT - (size_t)buffer.storage.data() % SINK_ALIGNMENT) % SINK_ALIGNMENT;
+        buffer.nSize = 0;
+        if (i)
+            m_free.push_back(&buffer);
+    }
+    m_pCurrent = &m_buffers[0];
+    m_bStop    = false;
+    m_error    = MFX_ERR_NONE;
+
+    m_thread = std::thread(&CBufferedSink::WriterRoutine, this);
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CBufferedSink::Write(const mfxU8* pData, mfxU32 nSize) {
+    MSDK_CHECK_POINTER(m_pCurrent, MFX_ERR_NOT_INITIALIZED);
+    MSDK_CHECK_POINTER(pData, MFX_ERR_NULL_PTR);
+
+    while (nSize) {
+        mfxU32 nCopy = std::min(nSize, m_nBufferSize - m_pCurrent->nSize);
+        MSDK_MEMCPY(m_pCurrent->pData + m_pCurrent->nSize, pData, nCopy);
+        m_pCurrent->nSize += nCopy;
+        pData += nCopy;
+        nSize -= nCopy;
+
+        if (m_pCurrent->nSize == m_nBufferSize) {
+            mfxStatus sts = Submit();
+            MSDK_CHECK_STATUS(sts, "Submit failed");
+        }
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CBufferedSink::Flush() {
+    MSDK_CHECK_POINTER(m_pCurrent, MFX_ERR_NOT_INITIALIZED);
+
+    if (m_bSubmitOnFlush && m_pCurrent->nSize)
+        return Submit();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
+}
+
+mfxStatus CBufferedSink::Submit() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_ready.push_back(m_pCurrent);
+    m_cond.notify_all();
+
+    // back pressure: all buffers are queued for output
+    m_cond.wait(lock, [this] {
+        return !m_free.empty();
+    });
+    m_pCurrent = m_free.back();
+    m_free.pop_back();
+    m_pCurrent->nSize = 0;
+
+    return m_error;
+}
+
+void CBufferedSink::WriterRoutine() {
+    for (;;) {
+        Buffer* pBuffer = nullptr;
+        mfxStatus sts   = MFX_ERR_NONE;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] {
+                return m_bStop || !m_ready.empty();
+            });
+            if (m_ready.empty())
+                break;
+
+            pBuffer = m_ready.front();
+            m_ready.pop_front();
+            sts = m_error;
+        }
+
+        // after an error buffers are only recycled, so the encoder doesn't block
+        if (MFX_ERR_NONE == sts)
+            sts = Output(pBuffer->pData, pBuffer->nSize);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (MFX_ERR_NONE == m_error)
+            m_error = sts;
+        m_free.push_back(pBuffer);
+        m_cond.notify_all();
+    }
+}
+
+void CBufferedSink::Close() {
+    if (m_thread.joinable()) {
+        if (m_pCurrent && m_pCurrent->nSize) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_ready.push_back(m_pCurrent);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStop = true;
+            m_cond.notify_all();
+        }
+        m_thread.join();
+
+        if (MFX_ERR_NONE != m_error)
+            msdk_printf(MSDK_STRING("ERROR: bitstream output failed, output is incomplete\n"));
+    }
+
+    CloseOutput();
+
+    m_pCurrent = nullptr;
+    m_ready.clear();
+    m_free.clear();
+    m_buffers.clear();
+}
+
+CFileSink::CFileSink(mfxU32 nBufferSize, bool bDirect)
+        : CBufferedSink(nBufferSize, false),
+          m_bDirect(bDirect),
+#if defined(_WIN32) || defined(_WIN64)
+          m_fDest(NULL)
+#else
+          m_fd(-1)
+#endif
+{
+}
+
+CFileSink::~CFileSink() {
+    Close();
+}
+
+mfxStatus CFileSink::Init(const msdk_char* strName) {
+    MSDK_CHECK_POINTER(strName, MFX_ERR_NULL_PTR);
+
+    Close();
+
+#if defined(_WIN32) || defined(_WIN64)
+    MSDK_FOPEN(m_fDest, strName, MSDK_STRING("wb"));
+    MSDK_CHECK_POINTER(m_fDest, MFX_ERR_NULL_PTR);
+#else
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    if (m_bDirect) {
+        m_fd = open(strName, flags | O_DIRECT, 0644);
+        // e.g. tmpfs
+        if (m_fd < 0 && EINVAL == errno)
+            msdk_printf(MSDK_STRING("WARNING: %s doesn't support O_DIRECT, page cache is used\n"),
+                        strName);
+    }
+    if (m_fd < 0)
+        m_fd = open(strName, flags, 0644);
+    if (m_fd < 0)
+        return MFX_ERR_NULL_PTR;
+#endif
+
+    return Start();
+}
+
+mfxStatus CFileSink::Output(const mfxU8* pData, mfxU32 nSize) {
+#if defined(_WIN32) || defined(_WIN64)
+    mfxU32 nBytesWritten = (mfxU32)fwrite(pData, 1, nSize, m_fDest);
+    MSDK_CHECK_NOT_EQUAL(nBytesWritten, nSize, MFX_ERR_UNDEFINED_BEHAVIOR);
+#else
+    // only the tail of the stream isn't a multiple of the block size
+    if (m_bDirect && (nSize % SINK_ALIGNMENT)) {
+        int flags = fcntl(m_fd, F_GETFL);
+        if (flags >= 0)
+            fcntl(m_fd, F_SETFL, flags & ~O_DIRECT);
+    }
+
+    while (nSize) {
+        ssize_t nBytesWritten = write(m_fd, pData, nSize);
+        if (nBytesWritten < 0) {
+            if (EINTR == errno)
+                continue;
+            return MFX_ERR_UNDEFINED_BEHAVIOR;
+        }
+        pData += nBytesWritten;
+        nSize -= (mfxU32)nBytesWritten;
+    }
+#endif
+
+    return MFX_ERR_NONE;
+}
+
+void CFileSink::CloseOutput() {
+#if defined(_WIN32) || defined(_WIN64)
+    if (m_fDest) {
+        fclose(m_fDest);
+        m_fDest = NULL;
+    }
+#else
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+}
+
+CSocketSink::CSocketSink(mfxU32 nBufferSize)
+        : CBufferedSink(nBufferSize, true),
+          m_bUDP(false),
+          m_socket(-1) {}
+
+CSocketSink::~CSocketSink() {
+    Close();
+}
+
+bool CSocketSink::IsSocketName(const msdk_char* strName) {
+    return strName && (0 == msdk_strncmp(strName, MSDK_STRING("tcp://"), 6) ||
+                       0 == msdk_strncmp(strName, MSDK_STRING("udp://"), 6));
+}
+
+mfxStatus CSocketSink::Init(const msdk_char* strName) {
+    MSDK_CHECK_POINTER(strName, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_ERROR(IsSocketName(strName), false, MFX_ERR_UNSUPPORTED);
+
+    Close();
+
+#if defined(_WIN32) || defined(_WIN64)
+    msdk_printf(MSDK_STRING("ERROR: socket output is supported on Linux only\n"));
+    return MFX_ERR_UNSUPPORTED;
+#else
+    m_bUDP = (0 == msdk_strncmp(strName, MSDK_STRING("udp://"), 6));
+
+    // host:port
+    std::string address(strName + 6);
+    size_t pos = address.rfind(':');
+    if (std::string::npos == pos || !pos || pos + 1 == address.size()) {
+        msdk_printf(MSDK_STRING("ERROR: %s should be tcp://host:port or udp://host:port\n"),
+                    strName);
+        return MFX_ERR_UNSUPPORTED;
+    }
+    std::string host = address.substr(0, pos);
+    std::string port = address.substr(pos + 1);
+
+    struct addrinfo hints = {};
+    hints.ai_family       = AF_UNSPEC;
+    hints.ai_socktype     = m_bUDP ? SOCK_DGRAM : SOCK_STREAM;
+
+    struct addrinfo* pResult = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &pResult)) {
+        msdk_printf(MSDK_STRING("ERROR: can't resolve %s\n"), strName);
+        return MFX_ERR_NOT_FOUND;
+    }
+
+    for (struct addrinfo* p = pResult; p && m_socket < 0; p = p->ai_next) {
+        m_socket = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        if (m_socket < 0)
+            continue;
+        // udp socket is connected too, so send() can be used for both
+        if (connect(m_socket, p->ai_addr, p->ai_addrlen)) {
+            close(m_socket);
+            m_socket = -1;
+        }
+    }
+    freeaddrinfo(pResult);
+
+    if (m_socket < 0) {
+        msdk_printf(MSDK_STRING("ERROR: can't connect to %s\n"), strName);
+        return MFX_ERR_NOT_FOUND;
+    }
+
+    if (!m_bUDP) {
+        // frames are already batched, don't wait for more data
+        int flag = 1;
+        setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+
+    return Start();
+#endif
+}
+
+mfxStatus CSocketSink::Output(const mfxU8* pData, mfxU32 nSize) {
+#if defined(_WIN32) || defined(_WIN64)
+    (void)pData;
+    (void)nSize;
+    return MFX_ERR_UNSUPPORTED;
+#else
+    while (nSize) {
+        mfxU32 nChunk     = m_bUDP ? std::min(nSize, SINK_UDP_PAYLOAD) : nSize;
+        ssize_t nBytesSent = send(m_socket, pData, nChunk, MSG_NOSIGNAL);
+        if (nBytesSent < 0) {
+            if (EINTR == errno)
+                continue;
+            // receiver isn't listening yet, datagrams are just lost
+            if (m_bUDP && ECONNREFUSED == errno)
+                nBytesSent = nChunk;
+            else
+                return MFX_ERR_ABORTED;
+        }
+        pData += nBytesSent;
+        nSize -= (mfxU32)nBytesSent;
+    }
+
+    return MFX_ERR_NONE;
+#endif
+}
+
+void CSocketSink::CloseOutput() {
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (m_socket >= 0) {
+        close(m_socket);
+        m_socket = -1;
+    }
+#endif
+}
@@ -0,0 +1,273 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "brc_frame_analyzer.h"
+
+#include <stdlib.h>
+#include <algorithm>
+
+#include "vm/atomic_defs.h"
+
+const mfxU32 ANALYZER_SCALE = 4;
+const mfxU32 ANALYZER_BLOCK = 8;
+// results are kept for frames submitted but not encoded yet
+const mfxU32 ANALYZER_MIN_HISTORY = 128;
+
+// Downscales one row: 4 input rows are summed first, then groups of 4 columns. Both loops are
+// simple enough for the compiler to vectorize. shift brings samples to 8 bits.
+template <class T>
+static void DownscaleRow(const mfxU8* pSrc,
+                         mfxU32 pitch,
+                         mfxU32 shift,
+                         mfxU16* pRowSum,
+                         mfxU8* pDst,
+                         mfxU32 width) {
+    const T* pRow0 = (const T*)pSrc;
+    const T* pRow1 = (const T*)(pSrc + pitch);
+    const T* pRow2 = (const T*)(pSrc + 2 * pitch);
+    const T* pRow3 = (const T*)(pSrc + 3 * pitch);
+
+    for (mfxU32 x = 0; x < width * ANALYZER_SCALE; x++) {
+        pRowSum[x] = (mfxU16)((pRow0[x] >> shift) + (pRow1[x] >> shift) + (pRow2[x] >> shift) +
+                              (pRow3[x] >> shift));
+    }
+    for (mfxU32 x = 0; x < width; x++) {
+        const mfxU16* pSum = pRowSum + x * ANALYZER_SCALE;
+        pDst[x]            = (mfxU8)((pSum[0] + pSum[1] + pSum[2] + pSum[3] + 8) >> 4);
+    }
+}
+
+CBRCFrameAnalyzer::CBRCFrameAnalyzer()
+        : m_nDepth(0),
+          m_nWidth(0),
+          m_nHeight(0),
+          m_rowSum(),
+          m_colSum(),
+          m_colIntra(),
+          m_colInter(),
+          m_mean(),
+          m_cur(),
+          m_prev(),
+          m_bPrev(false),
+          m_results(),
+          m_queue(),
+          m_nSubmitted(0),
+          m_nAnalyzed(0),
+          m_thread(),
+          m_mutex(),
+          m_cond(),
+          m_bStop(false) {}
+
+CBRCFrameAnalyzer::~CBRCFrameAnalyzer() {
+    Close();
+}
+
+bool CBRCFrameAnalyzer::IsSupported(mfxU32 fourCC) {
+    return MFX_FOURCC_NV12 == fourCC || MFX_FOURCC_YV12 == fourCC || MFX_FOURCC_I420 == fourCC ||
+           MFX_FOURCC_P010 == fourCC;
+}
+
+mfxStatus CBRCFrameAnalyzer::Init(const mfxFrameInfo& info, mfxU32 nDepth) {
+    MSDK_CHECK_ERROR(IsSupported(info.FourCC), false, MFX_ERR_UNSUPPORTED);
+    MSDK_CHECK_ERROR(m_thread.joinable(), true, MFX_ERR_UNDEFINED_BEHAVIOR);
+
+    mfxU32 width  = info.CropW ? info.CropW : info.Width;
+    mfxU32 height = info.CropH ? info.CropH : info.Height;
+    m_nWidth      = width / ANALYZER_SCALE / ANALYZER_BLOCK * ANALYZER_BLOCK;
+    m_nHeight     = height / ANALYZER_SCALE / ANALYZER_BLOCK * ANALYZER_BLOCK;
+    MSDK_CHECK_ERROR(m_nWidth * m_nHeight, 0, MFX_ERR_UNSUPPORTED);
+
+    m_nDepth = nDepth;
+    m_rowSum.resize(m_nWidth * ANALYZER_SCALE);
+    m_colSum.resize(m_nWidth);
+    m_colIntra.resize(m_nWidth);
+    m_colInter.resize(m_nWidth);
+    m_mean.resize(m_nWidth);
+    m_cur.assign(m_nWidth * m_nHeight, 0);
+    m_prev.assign(m_nWidth * m_nHeight, 0);
+    m_bPrev = false;
+
+    Result empty = { mfxU32(-1), {} };
+    m_results.assign(std::max(ANALYZER_MIN_HISTORY, 4 * (nDepth + 1)), empty);
+    m_queue.clear();
+    m_nSubmitted = 0;
+    m_nAnalyzed  = 0;
+    m_bStop      = false;
+
+    m_thread = std::thread(&CBRCFrameAnalyzer::AnalyzerRoutine, this);
+    return MFX_ERR_NONE;
+}
+
+void CBRCFrameAnalyzer::Close() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStop = true;
+        }
+        m_cond.notify_all();
+        m_thread.join();
+    }
+
+    for (mfxFrameSurface1* pSurface : m_queue) {
+        msdk_atomic_dec16((volatile mfxU16*)&pSurface->Data.Locked);
+    }
+    m_queue.clear();
+}
+
+mfxStatus CBRCFrameAnalyzer::Submit(mfxFrameSurface1* pSurface) {
+    MSDK_CHECK_POINTER(pSurface, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_POINTER(pSurface->Data.Y, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_ERROR(m_thread.joinable(), false, MFX_ERR_NOT_INITIALIZED);
+
+    // the same way as encoder holds frames, so the application doesn't overwrite it
+    msdk_atomic_inc16((volatile mfxU16*)&pSurface->Data.Locked);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(pSurface);
+        m_nSubmitted++;
+    }
+    m_cond.notify_all();
+    return MFX_ERR_NONE;
+}
+
+mfxU32 CBRCFrameAnalyzer::GetDepth() const {
+    return m_nDepth;
+}
+
+mfxU32 CBRCFrameAnalyzer::GetComplexity(mfxU32 nOrder,
+                                        mfxU32 nCount,
+                                        BRCFrameComplexity* pCmplx) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (nOrder >= m_nSubmitted)
+        return 0;
+
+    mfxU32 nEnd = nOrder + std::min(nCount, m_nSubmitted - nOrder);
+    m_cond.wait(lock, [&]() {
+        return m_bStop || m_nAnalyzed >= nEnd;
+    });
+    nEnd = std::min(nEnd, m_nAnalyzed);
+
+    mfxU32 n = 0;
+    for (mfxU32 order = nOrder; order < nEnd; order++, n++) {
+        const Result& result = m_results[order % m_results.size()];
+        if (result.Order != order)
+            break; // too old
+        pCmplx[n] = result.Cmplx;
+    }
+    return n;
+}
+
+void CBRCFrameAnalyzer::AnalyzerRoutine() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cond.wait(lock, [this]() {
+            return m_bStop || !m_queue.empty();
+        });
+        if (m_bStop)
+            break;
+
+        mfxFrameSurface1* pSurface = m_queue.front();
+        lock.unlock();
+
+        Downscale(*pSurface);
+        BRCFrameComplexity cmplx = Analyze();
+        std::swap(m_cur, m_prev);
+        m_bPrev = true;
+
+        lock.lock();
+        m_queue.pop_front();
+        msdk_atomic_dec16((volatile mfxU16*)&pSurface->Data.Locked);
+
+        Result& result = m_results[m_nAnalyzed % m_results.size()];
+        result.Order   = m_nAnalyzed;
+        result.Cmplx   = cmplx;
+        m_nAnalyzed++;
+        m_cond.notify_all();
+    }
+}
+
+void CBRCFrameAnalyzer::Downscale(const mfxFrameSurface1& surface) {
+    const mfxFrameInfo& info = surface.Info;
+    const mfxU32 pitch       = ((mfxU32)surface.Data.PitchHigh << 16) + surface.Data.PitchLow;
+    const bool b16bit        = MFX_FOURCC_P010 == info.FourCC;
+    // P010 is either shifted to MSBs or not
+    const mfxU32 shift = b16bit ? (info.Shift ? 8 : 2) : 0;
+
+    const mfxU8* pSrc =
+        surface.Data.Y + info.CropY * pitch + info.CropX * (b16bit ? sizeof(mfxU16) : 1);
+    for (mfxU32 y = 0; y < m_nHeight; y++) {
+        const mfxU8* pRow = pSrc + y * ANALYZER_SCALE * pitch;
+        mfxU8* pDst       = &m_cur[y * m_nWidth];
+        if (b16bit)
+            DownscaleRow<mfxU16>(pRow, pitch, shift, m_rowSum.data(), pDst, m_nWidth);
+        else
+            DownscaleRow<mfxU8>(pRow, pitch, shift, m_rowSum.data(), pDst, m_nWidth);
+    }
+}
+
+// Works on rows of blocks: per column sums over block height first, then per block sums over
+// its width, so that the loops over the whole width vectorize.
+BRCFrameComplexity CBRCFrameAnalyzer::Analyze() {
+    mfxU16* pColSum   = m_colSum.data();
+    mfxU16* pColIntra = m_colIntra.data();
+    mfxU16* pColInter = m_colInter.data();
+    mfxU8* pMean      = m_mean.data();
+
+    mfxU64 intraCost = 0;
+    mfxU64 interCost = 0;
+
+    for (mfxU32 by = 0; by < m_nHeight; by += ANALYZER_BLOCK) {
+        const mfxU8* pCur  = &m_cur[by * m_nWidth];
+        const mfxU8* pPrev = &m_prev[by * m_nWidth];
+
+        std::fill(m_colSum.begin(), m_colSum.end(), 0);
+        for (mfxU32 y = 0; y < ANALYZER_BLOCK; y++) {
+            const mfxU8* pRow = pCur + y * m_nWidth;
+            for (mfxU32 x = 0; x < m_nWidth; x++)
+                pColSum[x] += pRow[x];
+        }
+        for (mfxU32 bx = 0; bx < m_nWidth; bx += ANALYZER_BLOCK) {
+            mfxU32 sum = 0;
+            for (mfxU32 x = 0; x < ANALYZER_BLOCK; x++)
+                sum += pColSum[bx + x];
+            std::fill(pMean + bx,
+                      pMean + bx + ANALYZER_BLOCK,
+                      (mfxU8)((sum + ANALYZER_BLOCK * ANALYZER_BLOCK / 2) /
+                              (ANALYZER_BLOCK * ANALYZER_BLOCK)));
+        }
+
+        std::fill(m_colIntra.begin(), m_colIntra.end(), 0);
+        std::fill(m_colInter.begin(), m_colInter.end(), 0);
+        for (mfxU32 y = 0; y < ANALYZER_BLOCK; y++) {
+            const mfxU8* pRow     = pCur + y * m_nWidth;
+            const mfxU8* pPrevRow = pPrev + y * m_nWidth;
+            for (mfxU32 x = 0; x < m_nWidth; x++) {
+                pColIntra[x] += (mfxU16)abs(pRow[x] - pMean[x]);
+                pColInter[x] += (mfxU16)abs(pRow[x] - pPrevRow[x]);
+            }
+        }
+        for (mfxU32 bx = 0; bx < m_nWidth; bx += ANALYZER_BLOCK) {
+            mfxU32 intra = 0;
+            mfxU32 inter = 0;
+            for (mfxU32 x = 0; x < ANALYZER_BLOCK; x++) {
+                intra += pColIntra[bx + x];
+                inter += pColInter[bx + x];
+            }
+            intraCost += intra;
+            // encoder codes the block as intra if it is cheaper
+            interCost += m_bPrev ? std::min(intra, inter) : intra;
+        }
+    }
+
+    // per pixel of downscaled frame
+    const mfxF64 nPixels     = (mfxF64)m_nWidth * m_nHeight;
+    BRCFrameComplexity cmplx = {};
+    cmplx.IntraCost          = intraCost / nPixels;
+    cmplx.InterCost          = interCost / nPixels;
+    return cmplx;
+}
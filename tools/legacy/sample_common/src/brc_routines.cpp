@@ -16,6 +16,12 @@
 #define BRC_SCENE_CHANGE_RATIO1 20.0
 #define BRC_SCENE_CHANGE_RATIO2 5.0
 
+#define BRC_LA_FRAMES_IN_FLIGHT 64 // frames between GetFrameCtrl and Update
+#define BRC_LA_MAX_DQP          2 // QP change for complexity of the window
+#define BRC_LA_MODEL_PERIOD     4.0 // number of frames to average size model
+#define BRC_LA_SIZE_MARGIN      0.8 // predicted frame size to recode threshold, model is rough
+#define BRC_LA_GAIN_PERIOD      4.0 // number of frames to give back bits saved by lookahead
+
 static mfxU32 hevcBitRateScale(mfxU32 bitrate) {
     mfxU32 bit_rate_scale = 0;
     while (bit_rate_scale < 16 && (bitrate & ((1 << (6 + bit_rate_scale + 1)) - 1)) == 0)
@@ -44,7 +50,6 @@ mfxExtBuffer* Hevc_GetExtBuffer(mfxExtBuffer** extBuf, mfxU32 numExtBuf, mfxU32
 }
 
 mfxStatus cBRCParams::Init(mfxVideoParam* par, bool bField) {
-    printf("Sample BRC is used\n");
     MFX_CHECK_NULL_PTR1(par);
     MFX_CHECK(par->mfx.RateControlMethod == MFX_RATECONTROL_CBR ||
                   par->mfx.RateControlMethod == MFX_RATECONTROL_VBR,
@@ -380,6 +385,15 @@ mfxStatus ExtBRC::Init(mfxVideoParam* par) {
 
     m_ctx.dQuantAb = qp > 0 ? 1. / qp : 1.0; //kw
 
+    m_laIdrOrder = 0;
+    std::fill(m_laAlpha, m_laAlpha + 3, 0.0);
+    m_laRefCost  = 0;
+    m_laBitsGain = 0;
+    if (m_pLA) {
+        m_laWindow.resize(m_pLA->GetDepth() + 1);
+        m_laFrames.assign(BRC_LA_FRAMES_IN_FLIGHT, LookAheadFrame({ mfxU32(-1), 0, 0, 0, 0 }));
+    }
+
     if (m_par.WinBRCSize) {
         m_avg.reset(new AVGBitrate(m_par.WinBRCSize,
                                    (mfxU32)(m_par.WinBRCMaxAvgKbps * 1000.0 / m_par.frameRate),
@@ -554,6 +568,138 @@ mfxI32 ExtBRC::GetCurQP(mfxU32 type, mfxI32 layer) {
     return qp;
 }
 
+static mfxU32 GetTypeIdx(mfxU32 type) {
+    return (type == MFX_FRAMETYPE_I) ? 0 : (type == MFX_FRAMETYPE_P) ? 1 : 2;
+}
+
+// frame size above which Update asks for recoding, mirrors its checks without scene change
+mfxF64 ExtBRC::GetRecodeFrameSize(bool bIntra, mfxU32 encOrder) {
+    mfxF64 targetFrameSize = std::max<mfxF64>((mfxF64)m_par.inputBitsPerFrame, m_ctx.fAbLong);
+    mfxF64 maxFrameSize    = (encOrder == 0 ? 6.0 : bIntra ? 8.0 : 4.0) * targetFrameSize *
+                          (m_par.bPyr ? 1.5 : 1.0);
+    mfxF64 frameSizeLim = 0xfffffff;
+
+    if (m_avg.get())
+        frameSizeLim = std::min<mfxF64>(frameSizeLim, m_avg->GetMaxFrameSize(false, bIntra, 0));
+    if (m_par.maxFrameSizeInBits)
+        frameSizeLim = std::min<mfxF64>(frameSizeLim, m_par.maxFrameSizeInBits);
+    maxFrameSize = std::min(maxFrameSize, frameSizeLim);
+
+    if (m_par.HRDConformance != MFX_BRC_NO_HRD) {
+        mfxF64 maxFrameSizeHrd = m_hrdSpec->GetMaxFrameSizeInBits(encOrder, bIntra);
+        if (bIntra)
+            maxFrameSize =
+                std::min(maxFrameSize, 3.5 / 9. * maxFrameSizeHrd + 5.5 / 9. * targetFrameSize);
+        else
+            maxFrameSize =
+                std::min(maxFrameSize, 2.5 / 9. * maxFrameSizeHrd + 6.5 / 9. * targetFrameSize);
+        frameSizeLim = std::min(frameSizeLim, maxFrameSizeHrd);
+    }
+    maxFrameSize = std::max(maxFrameSize, targetFrameSize);
+
+    return std::min(maxFrameSize, frameSizeLim);
+}
+
+mfxI32 ExtBRC::GetLookAheadQP(mfxBRCFrameParam* par, mfxU32 type, mfxI32 qp) {
+    // frames preceding IDR in display order are encoded before it and none of the following,
+    // so display order of IDR from the beginning of the stream is its encoded order
+    if (par->FrameType & MFX_FRAMETYPE_IDR)
+        m_laIdrOrder = par->EncodedOrder - par->DisplayOrder;
+
+    mfxU32 n = m_pLA->GetComplexity(m_laIdrOrder + par->DisplayOrder,
+                                    (mfxU32)m_laWindow.size(),
+                                    m_laWindow.data());
+    if (!n)
+        return qp;
+
+    bool bIntra           = type == MFX_FRAMETYPE_I;
+    LookAheadFrame& frame = m_laFrames[par->EncodedOrder % m_laFrames.size()];
+    frame.EncOrder        = par->EncodedOrder;
+    frame.Cost            = bIntra ? m_laWindow[0].IntraCost : m_laWindow[0].InterCost;
+    frame.InterCost       = m_laWindow[0].InterCost;
+    frame.QpOffset        = 0;
+
+    mfxI32 quantMin = (type == MFX_FRAMETYPE_I)   ? m_par.quantMinI
+                      : (type == MFX_FRAMETYPE_P) ? m_par.quantMinP
+                                                  : m_par.quantMinB;
+    mfxI32 quantMax = (type == MFX_FRAMETYPE_I)   ? m_par.quantMaxI
+                      : (type == MFX_FRAMETYPE_P) ? m_par.quantMaxP
+                                                  : m_par.quantMaxB;
+    mfxI32 qpNew = qp;
+
+    if (m_laRefCost > 0) {
+        // Size is inversely proportional to qstep, which doubles every 6 QP. Half of the change
+        // is made in advance, reactive part of BRC catches up when the window is encoded.
+        mfxF64 winCost = 0;
+        for (mfxU32 i = 0; i < n; i++)
+            winCost += m_laWindow[i].InterCost;
+        winCost = std::max(winCost / n, m_laRefCost / 16);
+
+        // QP raised before recode thresholds saves bits the reactive part doesn't get back,
+        // stream would undershoot, so saved bits are spent on the following frames
+        mfxF64 gain = m_laBitsGain / (BRC_LA_GAIN_PERIOD * m_par.inputBitsPerFrame);
+        gain        = mfx::clamp(gain, -0.5, 3.0);
+
+        mfxI32 dQP =
+            (mfxI32)floor(3.0 * log2(winCost / m_laRefCost) - 6.0 * log2(1.0 + gain) + 0.5);
+        dQP        = mfx::clamp(dQP, -BRC_LA_MAX_DQP, BRC_LA_MAX_DQP);
+        qpNew      = mfx::clamp(qp + dQP, quantMin, quantMax);
+        // only this part is taken back in Update, thresholds are not a change of complexity
+        frame.QpOffset = qpNew - qp;
+    }
+
+    // keep predicted frame size away from recode thresholds, recode costs a whole frame time
+    mfxF64 alpha = m_laAlpha[GetTypeIdx(type)];
+    if (alpha > 0 && frame.Cost > 0) {
+        mfxF64 maxFrameSize = BRC_LA_SIZE_MARGIN * GetRecodeFrameSize(bIntra, par->EncodedOrder);
+        while (qpNew < quantMax &&
+               alpha * frame.Cost / QP2Qstep(qpNew, m_par.quantOffset) > maxFrameSize)
+            qpNew++;
+
+        // CPB overflow, frame would be padded
+        if (m_par.HRDConformance != MFX_BRC_NO_HRD) {
+            mfxF64 minFrameSize =
+                m_hrdSpec->GetMinFrameSizeInBits(par->EncodedOrder, bIntra) / BRC_LA_SIZE_MARGIN;
+            while (qpNew > quantMin &&
+                   alpha * frame.Cost / QP2Qstep(qpNew, m_par.quantOffset) < minFrameSize)
+                qpNew--;
+        }
+    }
+    qpNew             = mfx::clamp(qpNew, quantMin, quantMax);
+    frame.TotalOffset = qpNew - qp;
+    return qpNew;
+}
+
+mfxI32 ExtBRC::GetLookAheadQPOffset(mfxU32 encOrder) {
+    const LookAheadFrame& frame = m_laFrames[encOrder % m_laFrames.size()];
+    return (frame.EncOrder == encOrder) ? frame.QpOffset : 0;
+}
+
+void ExtBRC::UpdateLookAheadModel(mfxU32 encOrder,
+                                  mfxU32 type,
+                                  mfxI32 bits,
+                                  mfxF64 qstep,
+                                  bool bSH) {
+    LookAheadFrame& frame = m_laFrames[encOrder % m_laFrames.size()];
+    if (frame.EncOrder != encOrder || frame.Cost <= 0)
+        return;
+
+    // size at QP of the reactive part minus actual size, qstep doubles every 6 QP
+    m_laBitsGain += bits * (pow(2.0, frame.TotalOffset / 6.0) - 1.0);
+
+    mfxF64 alpha  = bits * qstep / frame.Cost;
+    mfxF64& model = m_laAlpha[GetTypeIdx(type)];
+    model         = (model > 0) ? model + (alpha - model) / BRC_LA_MODEL_PERIOD : alpha;
+
+    // cost of the frame starting a scene is not comparable to the following frames
+    if (bSH)
+        m_laRefCost = 0;
+    else if (m_laRefCost > 0)
+        m_laRefCost += (frame.InterCost - m_laRefCost) / m_par.fAbPeriodShort;
+    else
+        m_laRefCost = frame.InterCost;
+}
+
 inline mfxU16 CheckHrdAndUpdateQP(HRDCodecSpec& hrd,
                                   mfxU32 frameSizeInBits,
                                   mfxU32 eo,
@@ -862,6 +1008,13 @@ mfxStatus ExtBRC::Update(mfxBRCFrameParam* frame_par,
     else {
         // no recoding are needed. Save context params
 
+        if (m_pLA) {
+            // reactive part continues from its own QP, otherwise it accumulates lookahead offsets
+            m_ctx.Quant = mfx::clamp(m_ctx.Quant - GetLookAheadQPOffset(frame_par->EncodedOrder),
+                                     m_ctx.QuantMin,
+                                     m_ctx.QuantMax);
+        }
+
         mfxF64 k          = 1. / m_ctx.Quant;
         mfxF64 dqAbPeriod = m_par.dqAbPeriod;
         if (m_ctx.bToRecode)
@@ -899,6 +1052,9 @@ mfxStatus ExtBRC::Update(mfxBRCFrameParam* frame_par,
 
         m_ctx.totalDeviation += ((mfxF64)bitsEncoded - m_par.inputBitsPerFrame);
 
+        if (m_pLA && !m_ctx.bPanic)
+            UpdateLookAheadModel(frame_par->EncodedOrder, picType, bitsEncoded, qstep, bSHStart);
+
         //printf("-- %d (%d)) Total deviation %f, old scene %d, bNeedUpdateQP %d, m_ctx.Quant %d, type %d\n", frame_par->EncodedOrder, frame_par->DisplayOrder,m_ctx.totalDeviation, oldScene , bNeedUpdateQP, m_ctx.Quant,picType);
 
         if (!m_ctx.bPanic && (!oldScene) && bNeedUpdateQP) {
@@ -1005,6 +1161,8 @@ mfxStatus ExtBRC::GetFrameCtrl(mfxBRCFrameParam* par, mfxBRCFrameCtrl* ctrl) {
     else {
         mfxU16 type = GetFrameType(par->FrameType, par->PyramidLayer, m_par.gopRefDist);
         qp          = GetCurQP(type, par->PyramidLayer);
+        if (m_pLA && !m_par.bFieldMode)
+            qp = GetLookAheadQP(par, type, qp);
     }
     ctrl->QpY = qp - m_par.quantOffset;
     if (m_par.HRDConformance != MFX_BRC_NO_HRD) {
@@ -11,6 +11,7 @@
 #include <iostream>
 #include <map>
 
+#include "bitstream_sink.h"
 #include "sample_defs.h"
 #include "sample_utils.h"
 #include "time_statistics.h"
@@ -39,7 +40,11 @@
 
 #else
 
+    #include <fcntl.h>
     #include <link.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
     #include <string>
 
     #if defined(__x86_64__)
@@ -105,7 +110,14 @@ CSmplYUVReader::CSmplYUVReader()
         : m_ColorFormat(MFX_FOURCC_YV12),
           m_files(),
           shouldShift10BitsHigh(false),
-          m_bInited(false) {}
+          m_bInited(false),
+          m_nPrefetchFrames(0),
+          m_nPrefetchChunk(0),
+          m_prefetch() {}
+
+void CSmplYUVReader::SetPrefetchParams(mfxU32 nFrames) {
+    m_nPrefetchFrames = nFrames;
+}
 
 mfxStatus CSmplYUVReader::Init(std::list<msdk_string> inputs,
                                mfxU32 ColorFormat,
@@ -141,6 +153,12 @@ mfxStatus CSmplYUVReader::Init(std::list<msdk_string> inputs,
         m_files.push_back(f);
     }
 
+    if (m_nPrefetchFrames) {
+        m_prefetch.resize(m_files.size());
+        for (auto& queue : m_prefetch)
+            queue.reset(new PrefetchQueue());
+    }
+
     m_ColorFormat = ColorFormat;
 
     m_bInited = true;
@@ -148,11 +166,150 @@ mfxStatus CSmplYUVReader::Init(std::list<msdk_string> inputs,
     return MFX_ERR_NONE;
 }
 
+// slots start at page boundary, so slots that are never used don't take physical memory
+const mfxU32 BITSTREAM_ARENA_ALIGNMENT = 4096;
+
+CBitstreamArena::CBitstreamArena()
+        : m_pBuffer(),
+          m_nSlots(0),
+          m_nSlotSize(0),
+          m_nFreeSlots(0),
+          m_freeHead(NO_SLOT),
+          m_nextFree(),
+          m_prevFree(),
+          m_blockSlots() {}
+
+CBitstreamArena::~CBitstreamArena() {
+    Close();
+}
+
+mfxStatus CBitstreamArena::Init(mfxU32 nSlots, mfxU32 nSlotSize) {
+    MSDK_CHECK_ERROR(nSlots, 0, MFX_ERR_UNDEFINED_BEHAVIOR);
+    MSDK_CHECK_ERROR(nSlotSize, 0, MFX_ERR_UNDEFINED_BEHAVIOR);
+
+    Close();
+
+    m_nSlotSize = (mfxU32)MSDK_ALIGN(nSlotSize, BITSTREAM_ARENA_ALIGNMENT);
+    m_nSlots    = nSlots;
+
+    // memory is not initialized, pages are committed on first write
+    m_pBuffer.reset(new mfxU8[(size_t)m_nSlots * m_nSlotSize]);
+    MSDK_CHECK_POINTER(m_pBuffer, MFX_ERR_MEMORY_ALLOC);
+
+    m_nextFree.assign(m_nSlots, NO_SLOT);
+    m_prevFree.assign(m_nSlots, NO_SLOT);
+    m_blockSlots.assign(m_nSlots, 0);
+
+    // lower slots are taken first
+    for (mfxU32 slot = m_nSlots; slot > 0; slot--)
+        LinkFree(slot - 1);
+
+    return MFX_ERR_NONE;
+}
+
+void CBitstreamArena::Close() {
+    m_pBuffer.reset();
+    m_nSlots     = 0;
+    m_nSlotSize  = 0;
+    m_nFreeSlots = 0;
+    m_freeHead   = NO_SLOT;
+    m_nextFree.clear();
+    m_prevFree.clear();
+    m_blockSlots.clear();
+}
+
+void CBitstreamArena::LinkFree(mfxU32 slot) {
+    m_prevFree[slot] = NO_SLOT;
+    m_nextFree[slot] = m_freeHead;
+    if (NO_SLOT != m_freeHead)
+        m_prevFree[m_freeHead] = slot;
+    m_freeHead = slot;
+    m_nFreeSlots++;
+}
+
+void CBitstreamArena::UnlinkFree(mfxU32 slot) {
+    if (NO_SLOT != m_prevFree[slot])
+        m_nextFree[m_prevFree[slot]] = m_nextFree[slot];
+    else
+        m_freeHead = m_nextFree[slot];
+
+    if (NO_SLOT != m_nextFree[slot])
+        m_prevFree[m_nextFree[slot]] = m_prevFree[slot];
+
+    m_nextFree[slot] = NO_SLOT;
+    m_prevFree[slot] = NO_SLOT;
+    m_nFreeSlots--;
+}
+
+mfxU8* CBitstreamArena::Acquire(mfxU32 nBytes, mfxU32* pCapacity) {
+    if (!pCapacity || NO_SLOT == m_freeHead)
+        return nullptr;
+
+    mfxU32 slot = m_freeHead;
+    UnlinkFree(slot);
+    m_blockSlots[slot] = 1;
+
+    mfxU8* pBlock = m_pBuffer.get() + (size_t)slot * m_nSlotSize;
+    *pCapacity    = m_nSlotSize;
+
+    if (nBytes > m_nSlotSize && !Grow(pBlock, nBytes, pCapacity)) {
+        Release(pBlock);
+        return nullptr;
+    }
+
+    return pBlock;
+}
+
+bool CBitstreamArena::Grow(mfxU8* pBlock, mfxU32 nBytes, mfxU32* pCapacity) {
+    if (!pBlock || !pCapacity || !m_pBuffer)
+        return false;
+
+    mfxU32 slot   = (mfxU32)((pBlock - m_pBuffer.get()) / m_nSlotSize);
+    mfxU32 nSlots = m_blockSlots[slot];
+    mfxU32 nNeed  = (mfxU32)(((mfxU64)nBytes + m_nSlotSize - 1) / m_nSlotSize);
+
+    if (nNeed > m_nSlots - slot)
+        return false;
+
+    // following slots must be free, otherwise the block has to move
+    for (mfxU32 i = slot + nSlots; i < slot + nNeed; i++) {
+        bool bFree = NO_SLOT != m_prevFree[i] || m_freeHead == i;
+        if (!bFree)
+            return false;
+    }
+
+    for (mfxU32 i = slot + nSlots; i < slot + nNeed; i++)
+        UnlinkFree(i);
+
+    if (nNeed > nSlots)
+        m_blockSlots[slot] = nNeed;
+
+    *pCapacity = m_blockSlots[slot] * m_nSlotSize;
+    return true;
+}
+
+void CBitstreamArena::Release(mfxU8* pBlock) {
+    if (!pBlock || !m_pBuffer)
+        return;
+
+    mfxU32 slot   = (mfxU32)((pBlock - m_pBuffer.get()) / m_nSlotSize);
+    mfxU32 nSlots = m_blockSlots[slot];
+
+    m_blockSlots[slot] = 0;
+
+    for (mfxU32 i = slot + nSlots; i > slot; i--)
+        LinkFree(i - 1);
+}
+
 CSmplYUVReader::~CSmplYUVReader() {
     Close();
 }
 
 void CSmplYUVReader::Close() {
+    StopPrefetch();
+    m_prefetch.clear();
+    m_nPrefetchChunk = 0;
+
     for (mfxU32 i = 0; i < m_files.size(); i++) {
         fclose(m_files[i]);
     }
@@ -161,6 +318,7 @@ void CSmplYUVReader::Close() {
 }
 
 void CSmplYUVReader::Reset() {
+    StopPrefetch();
     for (mfxU32 i = 0; i < m_files.size(); i++) {
         fseek(m_files[i], 0, SEEK_SET);
     }
@@ -179,12 +337,154 @@ mfxStatus CSmplYUVReader::SkipNframesFromBeginning(mfxU16 w,
         return MFX_ERR_UNSUPPORTED;
     }
 
+    // read ahead data of this view doesn't match the new position, other views keep theirs
+    if (viewId < m_prefetch.size())
+        StopPrefetch(viewId);
+
     if (0 != fseek(m_files[viewId], frameLength * nframes, SEEK_SET))
         return MFX_ERR_MORE_DATA;
 
     return MFX_ERR_NONE;
 }
 
+mfxU32 CSmplYUVReader::ReadData(void* ptr, mfxU32 size, mfxU32 count, mfxU32 vid) {
+    if (m_nPrefetchFrames)
+        return ReadPrefetched(ptr, size, count, vid);
+
+    return (mfxU32)fread(ptr, size, count, m_files[vid]);
+}
+
+// used when frame size can't be derived from the input color format
+const mfxU32 PREFETCH_DEFAULT_CHUNK = 1024 * 1024;
+
+void CSmplYUVReader::StartPrefetch(mfxU32 vid) {
+    PrefetchQueue& queue = *m_prefetch[vid];
+
+    if (!m_nPrefetchChunk)
+        m_nPrefetchChunk = PREFETCH_DEFAULT_CHUNK;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    // input is read strictly sequentially, let the kernel use larger readahead
+    posix_fadvise(fileno(m_files[vid]), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    queue.bStarted = true;
+    queue.thread   = std::thread(&CSmplYUVReader::PrefetchRoutine, this, vid);
+}
+
+void CSmplYUVReader::StopPrefetch() {
+    for (mfxU32 vid = 0; vid < m_prefetch.size(); vid++) {
+        StopPrefetch(vid);
+    }
+}
+
+void CSmplYUVReader::StopPrefetch(mfxU32 vid) {
+    PrefetchQueue& queue = *m_prefetch[vid];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.bStop = true;
+    }
+    queue.cond.notify_all();
+
+    if (queue.thread.joinable())
+        queue.thread.join();
+
+    // file position is ahead of the parsed data, callers reposition the file
+    queue.ready.clear();
+    queue.free.clear();
+    queue.current.clear();
+    queue.readPos  = 0;
+    queue.bStarted = false;
+    queue.bEOF     = false;
+    queue.bStop    = false;
+}
+
+void CSmplYUVReader::PrefetchRoutine(mfxU32 vid) {
+    PrefetchQueue& queue = *m_prefetch[vid];
+    FILE* file           = m_files[vid];
+
+    for (;;) {
+        std::vector<mfxU8> chunk;
+        {
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            queue.cond.wait(lock, [&] {
+                return queue.bStop || queue.ready.size() < m_nPrefetchFrames;
+            });
+            if (queue.bStop)
+                return;
+
+            if (!queue.free.empty()) {
+                chunk.swap(queue.free.back());
+                queue.free.pop_back();
+            }
+        }
+
+        chunk.resize(m_nPrefetchChunk);
+        size_t nRead = fread(chunk.data(), 1, chunk.size(), file);
+        chunk.resize(nRead);
+
+#if !defined(_WIN32) && !defined(_WIN64)
+        if (nRead == m_nPrefetchChunk) {
+            // ask for the next window while the consumer parses this one
+            off_t offset = (off_t)ftell(file);
+            posix_fadvise(fileno(file),
+                          offset,
+                          (off_t)m_nPrefetchChunk * m_nPrefetchFrames,
+                          POSIX_FADV_WILLNEED);
+        }
+#endif
+
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (nRead)
+                queue.ready.push_back(std::move(chunk));
+            if (nRead < m_nPrefetchChunk)
+                queue.bEOF = true;
+        }
+        queue.cond.notify_all();
+
+        if (nRead < m_nPrefetchChunk)
+            return;
+    }
+}
+
+mfxU32 CSmplYUVReader::ReadPrefetched(void* ptr, mfxU32 size, mfxU32 count, mfxU32 vid) {
+    PrefetchQueue& queue = *m_prefetch[vid];
+
+    if (!queue.bStarted)
+        StartPrefetch(vid);
+
+    mfxU8* dst    = (mfxU8*)ptr;
+    size_t nBytes = (size_t)size * count;
+    size_t nDone  = 0;
+
+    while (nDone < nBytes) {
+        if (queue.readPos == queue.current.size()) {
+            {
+                std::unique_lock<std::mutex> lock(queue.mutex);
+                queue.cond.wait(lock, [&] {
+                    return !queue.ready.empty() || queue.bEOF;
+                });
+                if (queue.ready.empty())
+                    break;
+
+                queue.free.push_back(std::move(queue.current));
+                queue.current = std::move(queue.ready.front());
+                queue.ready.pop_front();
+                queue.readPos = 0;
+            }
+            queue.cond.notify_all();
+        }
+
+        size_t n = std::min(nBytes - nDone, queue.current.size() - queue.readPos);
+        MSDK_MEMCPY(dst + nDone, queue.current.data() + queue.readPos, n);
+        queue.readPos += n;
+        nDone += n;
+    }
+
+    return (mfxU32)(nDone / size);
+}
+
 mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
     // check if reader is initialized
     MSDK_CHECK_ERROR(m_bInited, false, MFX_ERR_NOT_INITIALIZED);
@@ -214,6 +514,12 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
         h = pInfo.Height;
     }
 
+    if (m_nPrefetchFrames && !m_nPrefetchChunk) {
+        // input frame size is known from the first surface only
+        if (MFX_ERR_NONE != GetFrameLength(w, h, m_ColorFormat, m_nPrefetchChunk))
+            m_nPrefetchChunk = PREFETCH_DEFAULT_CHUNK;
+    }
+
     mfxU32 nBytesPerPixel = (pInfo.FourCC == MFX_FOURCC_P010 || pInfo.FourCC == MFX_FOURCC_P210 ||
                              pInfo.FourCC == MFX_FOURCC_P016 || pInfo.FourCC == MFX_FOURCC_I010)
                                 ? 2
@@ -235,7 +541,7 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                 ptr   = ptr + pInfo.CropX * 4 + pInfo.CropY * pData.Pitch;
 
                 for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr + i * pitch, 1, 4 * w, m_files[vid]);
+                    nBytesRead = ReadData(ptr + i * pitch, 1, 4 * w, vid);
 
                     if ((mfxU32)4 * w != nBytesRead) {
                         return MFX_ERR_MORE_DATA;
@@ -250,7 +556,7 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                           : pData.U + pInfo.CropX + pInfo.CropY * pData.Pitch;
 
                 for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr + i * pitch, 2, w, m_files[vid]);
+                    nBytesRead = ReadData(ptr + i * pitch, 2, w, vid);
 
                     if ((mfxU32)w != nBytesRead) {
                         return MFX_ERR_MORE_DATA;
@@ -267,7 +573,7 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                       pInfo.CropX * 4 + pInfo.CropY * pData.Pitch;
 
                 for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr + i * pitch, 1, 4 * w, m_files[vid]);
+                    nBytesRead = ReadData(ptr + i * pitch, 1, 4 * w, vid);
 
                     if ((mfxU32)4 * w != nBytesRead) {
                         return MFX_ERR_MORE_DATA;
@@ -296,7 +602,7 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
 
         // read luminance plane
         for (i = 0; i < h; i++) {
-            nBytesRead = (mfxU32)fread(ptr + i * pitch, nBytesPerPixel, w, m_files[vid]);
+            nBytesRead = ReadData(ptr + i * pitch, nBytesPerPixel, w, vid);
 
             if (w != nBytesRead) {
                 return MFX_ERR_MORE_DATA;
@@ -341,7 +647,7 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
 
                         // load first chroma plane: U (input == I420) or V (input == YV12)
                         for (i = 0; i < h; i++) {
-                            nBytesRead = (mfxU32)fread(buf, 1, w, m_files[vid]);
+                            nBytesRead = ReadData(buf, 1, w, vid);
                             if (w != nBytesRead) {
                                 return MFX_ERR_MORE_DATA;
                             }
@@ -352,7 +658,7 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
 
                         // load second chroma plane: V (input == I420) or U (input == YV12)
                         for (i = 0; i < h; i++) {
-                            nBytesRead = (mfxU32)fread(buf, 1, w, m_files[vid]);
+                            nBytesRead = ReadData(buf, 1, w, vid);
 
                             if (w != nBytesRead) {
                                 return MFX_ERR_MORE_DATA;
@@ -379,14 +685,14 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                         }
 
                         for (i = 0; i < h; i++) {
-                            nBytesRead = (mfxU32)fread(ptr + i * pitch, 1, w, m_files[vid]);
+                            nBytesRead = ReadData(ptr + i * pitch, 1, w, vid);
 
                             if (w != nBytesRead) {
                                 return MFX_ERR_MORE_DATA;
                             }
                         }
                         for (i = 0; i < h; i++) {
-                            nBytesRead = (mfxU32)fread(ptr2 + i * pitch, 1, w, m_files[vid]);
+                            nBytesRead = ReadData(ptr2 + i * pitch, 1, w, vid);
 
                             if (w != nBytesRead) {
                                 return MFX_ERR_MORE_DATA;
@@ -406,14 +712,14 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                 ptr2 = pData.V + (pInfo.CropX / 2) + (pInfo.CropY / 2) * pitch;
 
                 for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr + i * pitch, 1, w, m_files[vid]);
+                    nBytesRead = ReadData(ptr + i * pitch, 1, w, vid);
 
                     if (w != nBytesRead) {
                         return MFX_ERR_MORE_DATA;
                     }
                 }
                 for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr2 + i * pitch, 1, w, m_files[vid]);
+                    nBytesRead = ReadData(ptr2 + i * pitch, 1, w, vid);
 
                     if (w != nBytesRead) {
                         return MFX_ERR_MORE_DATA;
@@ -429,7 +735,7 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                 }
                 ptr = pData.UV + pInfo.CropX + (pInfo.CropY / 2) * pitch;
                 for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr + i * pitch, nBytesPerPixel, w, m_files[vid]);
+                    nBytesRead = ReadData(ptr + i * pitch, nBytesPerPixel, w, vid);
 
                     if (w != nBytesRead) {
                         return MFX_ERR_MORE_DATA;
@@ -455,12 +761,348 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
     return MFX_ERR_NONE;
 }
 
+CMappedYUVFrameSource::CMappedYUVFrameSource()
+        : m_pData(nullptr),
+          m_nSize(0),
+          m_nMapSize(0),
+          m_nNextFrame(0),
+          m_FrameInfo(),
+          m_nFrameLength(0),
+          m_nPitch(0) {}
+
+CMappedYUVFrameSource::~CMappedYUVFrameSource() {
+    Close();
+}
+
+mfxStatus CMappedYUVFrameSource::Init(const msdk_string& input, const mfxFrameInfo& info) {
+    Close();
+
+    mfxU32 ColorFormat = info.FourCC;
+    mfxU32 pitch       = 0;
+    switch (ColorFormat) {
+        case MFX_FOURCC_NV12:
+            pitch = info.Width;
+            break;
+        case MFX_FOURCC_P010:
+        case MFX_FOURCC_YUY2:
+            pitch = 2 * info.Width;
+            break;
+        case MFX_FOURCC_RGB4:
+            pitch = 4 * info.Width;
+            break;
+        default:
+            msdk_printf(MSDK_STRING("ERROR: color format %s is unsupported with zero-copy input\n"),
+                        ColorFormatToStr(ColorFormat));
+            return MFX_ERR_UNSUPPORTED;
+    }
+
+    // input rows are used as surface rows, so only the height of the surface may be padded
+    mfxU16 width  = info.CropW ? info.CropW : info.Width;
+    mfxU16 height = info.CropH ? info.CropH : info.Height;
+    if (info.CropX || info.CropY || width != info.Width || height > info.Height) {
+        msdk_printf(MSDK_STRING(
+                        "ERROR: zero-copy input of %ux%u doesn't fit encoder surface %ux%u, "
+                        "input width must be aligned to 16\n"),
+                    width,
+                    height,
+                    info.Width,
+                    info.Height);
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    mfxU32 frameLength = 0;
+    mfxStatus sts      = GetFrameLength(width, height, ColorFormat, frameLength);
+    MSDK_CHECK_STATUS(sts, "GetFrameLength failed");
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    int fd = open(input.c_str(), O_RDONLY);
+    if (fd < 0)
+        return MFX_ERR_NOT_FOUND;
+
+    struct stat st = {};
+    if (fstat(fd, &st) || !st.st_size) {
+        close(fd);
+        return MFX_ERR_NOT_FOUND;
+    }
+
+    // encoder reads padded rows of the last frame past the end of the input,
+    // zero pages are reserved behind the input for them
+    size_t page    = (size_t)sysconf(_SC_PAGESIZE);
+    size_t padding = (size_t)pitch * (info.Height - height);
+    size_t mapSize = ((size_t)st.st_size + padding + page - 1) / page * page;
+
+    void* pBase = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == pBase) {
+        close(fd);
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+
+    // input is only read, pages are taken straight from the page cache
+    void* pData = mmap(pBase, (size_t)st.st_size, PROT_READ, MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == pData) {
+        munmap(pBase, mapSize);
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+
+    madvise(pData, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    m_pData        = (mfxU8*)pData;
+    m_nSize        = (size_t)st.st_size;
+    m_nMapSize     = mapSize;
+    m_nFrameLength = frameLength;
+    m_nPitch       = pitch;
+
+    m_FrameInfo       = info;
+    m_FrameInfo.CropW = width;
+    m_FrameInfo.CropH = height;
+
+    return MFX_ERR_NONE;
+#else
+    (void)input;
+    msdk_printf(MSDK_STRING("ERROR: zero-copy input is not supported on this platform\n"));
+    return MFX_ERR_UNSUPPORTED;
+#endif
+}
+
+void CMappedYUVFrameSource::Close() {
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (m_pData)
+        munmap(m_pData, m_nMapSize);
+#endif
+    m_pData      = nullptr;
+    m_nSize      = 0;
+    m_nMapSize   = 0;
+    m_nNextFrame = 0;
+}
+
+void CMappedYUVFrameSource::Reset() {
+    m_nNextFrame = 0;
+}
+
+mfxStatus CMappedYUVFrameSource::ImportFrame(mfxFrameSurface1* pSurface) {
+    MSDK_CHECK_POINTER(pSurface, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_POINTER(m_pData, MFX_ERR_NOT_INITIALIZED);
+
+    mfxFrameInfo& info = pSurface->Info;
+    mfxFrameData& data = pSurface->Data;
+
+    // padding of the mapping is prepared for the surface size given to Init
+    if (info.FourCC != m_FrameInfo.FourCC || info.Width != m_FrameInfo.Width ||
+        info.Height != m_FrameInfo.Height)
+        return MFX_ERR_UNSUPPORTED;
+
+    if (m_nNextFrame + m_nFrameLength > m_nSize)
+        return MFX_ERR_MORE_DATA;
+
+    mfxU8* ptr = m_pData + m_nNextFrame;
+    m_nNextFrame += m_nFrameLength;
+
+    // chroma follows CropH rows of luma, padded luma rows overlap it
+    size_t lumaSize = (size_t)m_nPitch * m_FrameInfo.CropH;
+
+    data.PitchHigh = (mfxU16)(m_nPitch >> 16);
+    data.PitchLow  = (mfxU16)(m_nPitch & 0xffff);
+    switch (m_FrameInfo.FourCC) {
+        case MFX_FOURCC_NV12:
+            data.Y  = ptr;
+            data.UV = ptr + lumaSize;
+            data.V  = data.UV + 1;
+            break;
+        case MFX_FOURCC_P010:
+            data.Y  = ptr;
+            data.UV = ptr + lumaSize;
+            data.V  = data.UV + 2;
+            break;
+        case MFX_FOURCC_YUY2:
+            data.Y = ptr;
+            data.U = ptr + 1;
+            data.V = ptr + 3;
+            break;
+        case MFX_FOURCC_RGB4:
+            data.B = ptr;
+            data.G = ptr + 1;
+            data.R = ptr + 2;
+            data.A = ptr + 3;
+            break;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+void CMappedYUVFrameSource::ReleaseFrame(mfxFrameSurface1* pSurface) {
+    if (!pSurface || !pSurface->Data.Y)
+        return;
+
+    // mapping lives until Close(), only the surface is detached
+    pSurface->Data.Y         = nullptr;
+    pSurface->Data.U         = nullptr;
+    pSurface->Data.V         = nullptr;
+    pSurface->Data.A         = nullptr;
+    pSurface->Data.PitchHigh = 0;
+    pSurface->Data.PitchLow  = 0;
+}
+
+CPreloadedYUVReader::CPreloadedYUVReader()
+        : CSmplYUVReader(),
+          m_views(),
+          m_bPreload(false),
+          m_bRecording(false),
+          m_nFramesToPreload(0),
+          m_nLoops(0),
+          m_bRewriteTimeStamps(false) {}
+
+CPreloadedYUVReader::~CPreloadedYUVReader() {
+    Close();
+}
+
+void CPreloadedYUVReader::SetPreloadParams(mfxU32 nFrames, mfxU32 nLoops, bool bRewriteTimeStamps) {
+    m_bPreload           = true;
+    m_nFramesToPreload   = nFrames;
+    m_nLoops             = nLoops;
+    m_bRewriteTimeStamps = bRewriteTimeStamps;
+    m_views.clear();
+}
+
+void CPreloadedYUVReader::Close() {
+    m_views.clear();
+    CSmplYUVReader::Close();
+}
+
+void CPreloadedYUVReader::Reset() {
+    if (!m_bPreload) {
+        CSmplYUVReader::Reset();
+        return;
+    }
+
+    // preloaded frames are kept, replay starts from the first one
+    for (auto& view : m_views) {
+        view.loop.Reset();
+    }
+}
+
+mfxStatus CPreloadedYUVReader::SkipNframesFromBeginning(mfxU16 w,
+                                                        mfxU16 h,
+                                                        mfxU32 viewId,
+                                                        mfxU32 nframes) {
+    if (m_bPreload) {
+        msdk_printf(MSDK_STRING("ERROR: frames skipping is not supported with preloaded input\n"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    return CSmplYUVReader::SkipNframesFromBeginning(w, h, viewId, nframes);
+}
+
+mfxU32 CPreloadedYUVReader::ReadData(void* ptr, mfxU32 size, mfxU32 count, mfxU32 vid) {
+    if (!m_bPreload)
+        return CSmplYUVReader::ReadData(ptr, size, count, vid);
+
+    PreloadedView& view = m_views[vid];
+
+    if (m_bRecording) {
+        mfxU32 nRead = CSmplYUVReader::ReadData(ptr, size, count, vid);
+        view.data.insert(view.data.end(), (mfxU8*)ptr, (mfxU8*)ptr + (size_t)nRead * size);
+        return nRead;
+    }
+
+    size_t nAvailable = (view.data.size() - view.readPos) / size;
+    mfxU32 nRead      = (mfxU32)std::min((size_t)count, nAvailable);
+
+    MSDK_MEMCPY(ptr, view.data.data() + view.readPos, (size_t)nRead * size);
+    view.readPos += (size_t)nRead * size;
+
+    return nRead;
+}
+
+mfxStatus CPreloadedYUVReader::Preload(mfxFrameSurface1* pSurface, PreloadedView& view) {
+    mfxStatus sts = MFX_ERR_NONE;
+
+    // frames are parsed into the caller's surface while their raw data is recorded,
+    // the surface content is overwritten by the first replayed frame afterwards
+    m_bRecording = true;
+    for (mfxU32 i = 0; !m_nFramesToPreload || i < m_nFramesToPreload; i++) {
+        size_t offset = view.data.size();
+
+        sts = CSmplYUVReader::LoadNextFrame(pSurface);
+        if (MFX_ERR_NONE != sts) {
+            // drop incomplete frame
+            view.data.resize(offset);
+            break;
+        }
+        view.frameOffsets.push_back(offset);
+    }
+    m_bRecording = false;
+
+    MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
+    MSDK_CHECK_STATUS(sts, "CSmplYUVReader::LoadNextFrame failed");
+
+    if (view.frameOffsets.empty())
+        return MFX_ERR_MORE_DATA;
+
+    msdk_printf(MSDK_STRING("Preloaded %u frames (%.2f MB) of view %u\n"),
+                (mfxU32)view.frameOffsets.size(),
+                (mfxF64)view.data.size() / (1024 * 1024),
+                (mfxU32)pSurface->Info.FrameId.ViewId);
+
+    view.loop.Init((mfxU32)view.frameOffsets.size(), m_nLoops);
+    view.bLoaded = true;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CPreloadedYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
+    if (!m_bPreload)
+        return CSmplYUVReader::LoadNextFrame(pSurface);
+
+    MSDK_CHECK_ERROR(m_bInited, false, MFX_ERR_NOT_INITIALIZED);
+    MSDK_CHECK_POINTER(pSurface, MFX_ERR_NULL_PTR);
+
+    mfxU32 vid = pSurface->Info.FrameId.ViewId;
+    if (vid >= m_files.size())
+        return MFX_ERR_UNSUPPORTED;
+
+    if (m_views.size() < m_files.size())
+        m_views.resize(m_files.size());
+
+    PreloadedView& view = m_views[vid];
+    mfxStatus sts       = MFX_ERR_NONE;
+
+    if (!view.bLoaded) {
+        sts = Preload(pSurface, view);
+        if (MFX_ERR_NONE != sts)
+            return sts;
+    }
+
+    mfxU64 position = view.loop.GetPosition();
+    mfxU32 index    = 0;
+
+    sts = view.loop.Next(index);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    view.readPos = view.frameOffsets[index];
+    sts          = CSmplYUVReader::LoadNextFrame(pSurface);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    if (m_bRewriteTimeStamps && pSurface->Info.FrameRateExtN) {
+        // 90 kHz clock
+        pSurface->Data.TimeStamp = (mfxU64)(position * 90000 * pSurface->Info.FrameRateExtD /
+                                            pSurface->Info.FrameRateExtN);
+    }
+
+    return MFX_ERR_NONE;
+}
+
 CSmplBitstreamWriter::CSmplBitstreamWriter()
         : m_nProcessedFramesNum(0),
           m_bSkipWriting(false),
           m_fSource(NULL),
           m_bInited(false),
-          m_sFile() {}
+          m_sFile(),
+          m_SinkType(SINK_STDIO),
+          m_nSinkBufferSize(0),
+          m_pSink() {}
 
 CSmplBitstreamWriter::~CSmplBitstreamWriter() {
     Close();
@@ -471,10 +1113,46 @@ void CSmplBitstreamWriter::Close() {
         fclose(m_fSource);
         m_fSource = NULL;
     }
+    if (m_pSink) {
+        m_pSink->Close();
+        m_pSink.reset();
+    }
 
     m_bInited = false;
 }
 
+void CSmplBitstreamWriter::SetSinkParams(BitstreamSinkType type, mfxU32 nBufferSize) {
+    m_SinkType        = type;
+    m_nSinkBufferSize = nBufferSize;
+}
+
+mfxStatus CSmplBitstreamWriter::CreateSink(const msdk_char* strFileName,
+                                           std::unique_ptr<CBitstreamSink>& sink) {
+    if (CSocketSink::IsSocketName(strFileName))
+        sink.reset(new CSocketSink(m_nSinkBufferSize));
+    else if (SINK_STDIO != m_SinkType)
+        sink.reset(new CFileSink(m_nSinkBufferSize, SINK_DIRECT == m_SinkType));
+    else
+        sink.reset();
+
+    if (!sink)
+        return MFX_ERR_NONE;
+
+    mfxStatus sts = sink->Init(strFileName);
+    if (MFX_ERR_NONE != sts)
+        sink.reset();
+    return sts;
+}
+
+mfxStatus CSmplBitstreamWriter::WriteData(const mfxU8* pData, mfxU32 nSize) {
+    if (m_pSink)
+        return m_pSink->Write(pData, nSize);
+
+    mfxU32 nBytesWritten = (mfxU32)fwrite(pData, 1, nSize, m_fSource);
+    MSDK_CHECK_NOT_EQUAL(nBytesWritten, nSize, MFX_ERR_UNDEFINED_BEHAVIOR);
+    return MFX_ERR_NONE;
+}
+
 mfxStatus CSmplBitstreamWriter::Init(const msdk_char* strFileName) {
     MSDK_CHECK_POINTER(strFileName, MFX_ERR_NULL_PTR);
     if (!msdk_strlen(strFileName))
@@ -482,9 +1160,14 @@ mfxStatus CSmplBitstreamWriter::Init(const msdk_char* strFileName) {
 
     Close();
 
+    mfxStatus sts = CreateSink(strFileName, m_pSink);
+    MSDK_CHECK_STATUS(sts, "CreateSink failed");
+
     //init file to write encoded data
-    MSDK_FOPEN(m_fSource, strFileName, MSDK_STRING("wb+"));
-    MSDK_CHECK_POINTER(m_fSource, MFX_ERR_NULL_PTR);
+    if (!m_pSink) {
+        MSDK_FOPEN(m_fSource, strFileName, MSDK_STRING("wb+"));
+        MSDK_CHECK_POINTER(m_fSource, MFX_ERR_NULL_PTR);
+    }
 
     m_sFile = msdk_string(strFileName);
     //set init state to true in case of success
@@ -511,13 +1194,13 @@ mfxStatus CSmplBitstreamWriter::WriteNextFrame(mfxBitstream* pMfxBitstream,
     MSDK_CHECK_POINTER(pMfxBitstream, MFX_ERR_NULL_PTR);
 
     if (isCompleteFrame) {
-        mfxU32 nBytesWritten = 0;
-
-        nBytesWritten = (mfxU32)fwrite(pMfxBitstream->Data + pMfxBitstream->DataOffset,
-                                       1,
-                                       pMfxBitstream->DataLength,
-                                       m_fSource);
-        MSDK_CHECK_NOT_EQUAL(nBytesWritten, pMfxBitstream->DataLength, MFX_ERR_UNDEFINED_BEHAVIOR);
+        mfxStatus sts =
+            WriteData(pMfxBitstream->Data + pMfxBitstream->DataOffset, pMfxBitstream->DataLength);
+        MSDK_CHECK_STATUS(sts, "WriteData failed");
+        if (m_pSink) {
+            sts = m_pSink->Flush();
+            MSDK_CHECK_STATUS(sts, "m_pSink->Flush failed");
+        }
 
         // mark that we don't need bit stream data any more
         pMfxBitstream->DataLength = 0;
@@ -537,7 +1220,9 @@ mfxStatus CSmplBitstreamWriter::WriteNextFrame(mfxBitstream* pMfxBitstream,
     return MFX_ERR_NONE;
 }
 
-CSmplBitstreamDuplicateWriter::CSmplBitstreamDuplicateWriter() : CSmplBitstreamWriter() {
+CSmplBitstreamDuplicateWriter::CSmplBitstreamDuplicateWriter()
+        : CSmplBitstreamWriter(),
+          m_pSinkDuplicate() {
     m_fSourceDuplicate = NULL;
     m_bJoined          = false;
 }
@@ -546,12 +1231,26 @@ mfxStatus CSmplBitstreamDuplicateWriter::InitDuplicate(const msdk_char* strFileN
     MSDK_CHECK_POINTER(strFileName, MFX_ERR_NULL_PTR);
     MSDK_CHECK_ERROR(msdk_strlen(strFileName), 0, MFX_ERR_NOT_INITIALIZED);
 
-    if (m_fSourceDuplicate) {
+    if (m_fSourceDuplicate && !m_bJoined) {
         fclose(m_fSourceDuplicate);
-        m_fSourceDuplicate = NULL;
     }
-    MSDK_FOPEN(m_fSourceDuplicate, strFileName, MSDK_STRING("wb+"));
-    MSDK_CHECK_POINTER(m_fSourceDuplicate, MFX_ERR_NULL_PTR);
+    m_fSourceDuplicate = NULL;
+    if (m_pSinkDuplicate && !m_bJoined) {
+        m_pSinkDuplicate->Close();
+    }
+    m_pSinkDuplicate.reset();
+
+    std::unique_ptr<CBitstreamSink> sink;
+    mfxStatus sts = CreateSink(strFileName, sink);
+    MSDK_CHECK_STATUS(sts, "CreateSink failed");
+
+    if (sink) {
+        m_pSinkDuplicate.reset(sink.release());
+    }
+    else {
+        MSDK_FOPEN(m_fSourceDuplicate, strFileName, MSDK_STRING("wb+"));
+        MSDK_CHECK_POINTER(m_fSourceDuplicate, MFX_ERR_NULL_PTR);
+    }
 
     m_bJoined = false; // mark we own the file handle
 
@@ -560,23 +1259,36 @@ mfxStatus CSmplBitstreamDuplicateWriter::InitDuplicate(const msdk_char* strFileN
 
 mfxStatus CSmplBitstreamDuplicateWriter::JoinDuplicate(CSmplBitstreamDuplicateWriter* pJoinee) {
     MSDK_CHECK_POINTER(pJoinee, MFX_ERR_NULL_PTR);
-    MSDK_CHECK_ERROR(pJoinee->m_fSourceDuplicate, NULL, MFX_ERR_NOT_INITIALIZED);
+    if (!pJoinee->m_fSourceDuplicate && !pJoinee->m_pSinkDuplicate)
+        return MFX_ERR_NOT_INITIALIZED;
 
+    // both writers feed the same merged output, data is passed to it without extra copies
     m_fSourceDuplicate = pJoinee->m_fSourceDuplicate;
+    m_pSinkDuplicate   = pJoinee->m_pSinkDuplicate;
     m_bJoined          = true; // mark we do not own the file handle
 
     return MFX_ERR_NONE;
 }
 
 mfxStatus CSmplBitstreamDuplicateWriter::WriteNextFrame(mfxBitstream* pMfxBitstream, bool isPrint) {
-    MSDK_CHECK_ERROR(m_fSourceDuplicate, NULL, MFX_ERR_NOT_INITIALIZED);
+    if (!m_fSourceDuplicate && !m_pSinkDuplicate)
+        return MFX_ERR_NOT_INITIALIZED;
     MSDK_CHECK_POINTER(pMfxBitstream, MFX_ERR_NULL_PTR);
 
-    mfxU32 nBytesWritten = (mfxU32)fwrite(pMfxBitstream->Data + pMfxBitstream->DataOffset,
-                                          1,
-                                          pMfxBitstream->DataLength,
-                                          m_fSourceDuplicate);
-    MSDK_CHECK_NOT_EQUAL(nBytesWritten, pMfxBitstream->DataLength, MFX_ERR_UNDEFINED_BEHAVIOR);
+    if (m_pSinkDuplicate) {
+        mfxStatus sts = m_pSinkDuplicate->Write(pMfxBitstream->Data + pMfxBitstream->DataOffset,
+                                                pMfxBitstream->DataLength);
+        MSDK_CHECK_STATUS(sts, "m_pSinkDuplicate->Write failed");
+        sts = m_pSinkDuplicate->Flush();
+        MSDK_CHECK_STATUS(sts, "m_pSinkDuplicate->Flush failed");
+    }
+    else {
+        mfxU32 nBytesWritten = (mfxU32)fwrite(pMfxBitstream->Data + pMfxBitstream->DataOffset,
+                                              1,
+                                              pMfxBitstream->DataLength,
+                                              m_fSourceDuplicate);
+        MSDK_CHECK_NOT_EQUAL(nBytesWritten, pMfxBitstream->DataLength, MFX_ERR_UNDEFINED_BEHAVIOR);
+    }
 
     CSmplBitstreamWriter::WriteNextFrame(pMfxBitstream, isPrint);
 
@@ -587,9 +1299,13 @@ void CSmplBitstreamDuplicateWriter::Close() {
     if (m_fSourceDuplicate && !m_bJoined) {
         fclose(m_fSourceDuplicate);
     }
+    if (m_pSinkDuplicate && !m_bJoined) {
+        m_pSinkDuplicate->Close();
+    }
 
     m_fSourceDuplicate = NULL;
-    m_bJoined          = false;
+    m_pSinkDuplicate.reset();
+    m_bJoined = false;
 
     CSmplBitstreamWriter::Close();
 }
@@ -665,6 +1381,94 @@ mfxStatus CSmplBitstreamReader::ReadNextFrame(mfxBitstream* pBS) {
     return MFX_ERR_NONE;
 }
 
+CPreloadedBitstreamReader::CPreloadedBitstreamReader()
+        : CSmplBitstreamReader(),
+          m_data(),
+          m_readPos(0),
+          m_loop(),
+          m_nLoops(1) {}
+
+CPreloadedBitstreamReader::~CPreloadedBitstreamReader() {
+    Close();
+}
+
+void CPreloadedBitstreamReader::SetLoops(mfxU32 nLoops) {
+    m_nLoops = nLoops;
+    m_loop.Init(1, m_nLoops);
+}
+
+void CPreloadedBitstreamReader::Close() {
+    m_data.clear();
+    m_readPos = 0;
+    CSmplBitstreamReader::Close();
+}
+
+void CPreloadedBitstreamReader::Reset() {
+    m_readPos = 0;
+    m_loop.Reset();
+}
+
+mfxStatus CPreloadedBitstreamReader::Init(const msdk_char* strFileName) {
+    mfxStatus sts = CSmplBitstreamReader::Init(strFileName);
+    MSDK_CHECK_STATUS(sts, "CSmplBitstreamReader::Init failed");
+
+    if (!m_bInited)
+        return MFX_ERR_NONE;
+
+    mfxU8 buf[64 * 1024];
+    size_t nRead = 0;
+    while ((nRead = fread(buf, 1, sizeof(buf), m_fSource)) > 0) {
+        m_data.insert(m_data.end(), buf, buf + nRead);
+    }
+
+    msdk_printf(MSDK_STRING("Preloaded %.2f MB of input bitstream\n"),
+                (mfxF64)m_data.size() / (1024 * 1024));
+
+    m_loop.Init(1, m_nLoops);
+    Reset();
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CPreloadedBitstreamReader::ReadNextFrame(mfxBitstream* pBS) {
+    if (!m_bInited)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    MSDK_CHECK_POINTER(pBS, MFX_ERR_NULL_PTR);
+
+    // Not enough memory to read new chunk of data
+    if (pBS->MaxLength == pBS->DataLength)
+        return MFX_ERR_NOT_ENOUGH_BUFFER;
+
+    memmove(pBS->Data, pBS->Data + pBS->DataOffset, pBS->DataLength);
+    pBS->DataOffset = 0;
+
+    // start the next pass when the previous one is consumed
+    if (0 == m_readPos || m_readPos == m_data.size()) {
+        mfxU32 index = 0;
+        if (MFX_ERR_NONE != m_loop.Next(index)) {
+            pBS->DataFlag |= MFX_BITSTREAM_EOS;
+            return MFX_ERR_MORE_DATA;
+        }
+        m_readPos = 0;
+    }
+
+    size_t nBytesRead =
+        std::min((size_t)(pBS->MaxLength - pBS->DataLength), m_data.size() - m_readPos);
+    MSDK_MEMCPY(pBS->Data + pBS->DataLength, m_data.data() + m_readPos, nBytesRead);
+    m_readPos += nBytesRead;
+
+    if (m_readPos == m_data.size() && m_loop.IsLastLoop())
+        pBS->DataFlag |= MFX_BITSTREAM_EOS;
+
+    if (0 == nBytesRead)
+        return MFX_ERR_MORE_DATA;
+
+    pBS->DataLength += (mfxU32)nBytesRead;
+
+    return MFX_ERR_NONE;
+}
+
 mfxU32 CJPEGFrameReader::FindMarker(mfxBitstream* pBS,
                                     mfxU32 startOffset,
                                     CJPEGFrameReader::JPEGMarker marker) {
@@ -791,21 +1595,20 @@ CIVFFrameWriter::CIVFFrameWriter() {
 }
 
 mfxStatus CIVFFrameWriter::WriteStreamHeader() {
-    mfxU32 nBytesWritten = (mfxU32)fwrite(&m_streamHeader, 1, sizeof(m_streamHeader), m_fSource);
-    if (nBytesWritten != sizeof(m_streamHeader))
+    if (MFX_ERR_NONE != WriteData((const mfxU8*)&m_streamHeader, sizeof(m_streamHeader)))
         return MFX_ERR_MORE_BITSTREAM;
 
     return MFX_ERR_NONE;
 }
 
 mfxStatus CIVFFrameWriter::WriteFrameHeader() {
-    mfxU32 nBytesWritten = (mfxU32)fwrite(&m_frameHeader, 1, sizeof(m_frameHeader), m_fSource);
-    if (nBytesWritten != sizeof(m_frameHeader))
+    if (MFX_ERR_NONE != WriteData((const mfxU8*)&m_frameHeader, sizeof(m_frameHeader)))
         return MFX_ERR_MORE_BITSTREAM;
 
     return MFX_ERR_NONE;
 }
 
+// sinks can't seek, frame count in their stream header stays as written by Init
 void CIVFFrameWriter::UpdateNumberOfFrames() {
     if (m_fSource) {
         fseek(m_fSource, 24, SEEK_SET);
@@ -846,7 +1649,8 @@ mfxStatus CIVFFrameWriter::Init(const msdk_char* strFileName,
 
 // write a complete frame into given bitstream
 mfxStatus CIVFFrameWriter::WriteNextFrame(mfxBitstream* pMfxBitstream, bool isPrint) {
-    MSDK_CHECK_ERROR(m_fSource, NULL, MFX_ERR_NOT_INITIALIZED);
+    if (!m_fSource && !m_pSink)
+        return MFX_ERR_NOT_INITIALIZED;
     MSDK_CHECK_POINTER(pMfxBitstream, MFX_ERR_NULL_PTR);
 
     if (pMfxBitstream->DataLength) {
@@ -0,0 +1,845 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "shm_transport.h"
+
+#include <string.h>
+
+#if defined(LINUX32) || defined(LINUX64)
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <limits.h>
+    #include <linux/futex.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <time.h>
+    #include <unistd.h>
+#endif
+
+// 'VSHM'
+const mfxU32 SHM_RING_MAGIC   = MFX_MAKEFOURCC('V', 'S', 'H', 'M');
+const mfxU32 SHM_RING_VERSION = 2;
+// payload starts at page boundary, so frames are suitably aligned for SIMD copies
+const mfxU32 SHM_PAGE_SIZE = 4096;
+// how often sleeping side rechecks end of stream and disconnect flags,
+// also the heartbeat period
+const mfxU32 SHM_WAIT_SLICE = 100;
+// peer whose heartbeat is older than this is considered dead
+const mfxU64 SHM_PEER_TIMEOUT = 2000;
+
+const mfxU32 SHM_FLAG_EOS             = 1;
+const mfxU32 SHM_FLAG_CONSUMER_CLOSED = 2;
+
+// default ring geometry
+const mfxU32 SHM_DEFAULT_SLOTS          = 16;
+const mfxU32 SHM_DEFAULT_BITSTREAM_SLOT = 4 * 1024 * 1024;
+
+struct ShmRingHeader {
+    mfxU32 magic; // written last by the producer
+    mfxU32 version;
+    mfxU32 payloadType;
+    mfxU32 nSlots;
+    mfxU32 nSlotSize; // payload capacity, multiple of page size
+    mfxU32 nDataOffset; // offset of the first slot payload
+    mfxU64 nSegmentSize;
+    // CLOCK_MONOTONIC time in ms, refreshed by the heartbeat thread of each side
+    std::atomic<mfxU64> producerBeat;
+    std::atomic<mfxU64> consumerBeat; // 0 until consumer attaches
+    // monotonic counters, slot index is counter % nSlots, used as futex words
+    std::atomic<mfxU32> writeIdx;
+    std::atomic<mfxU32> readIdx;
+    std::atomic<mfxU32> flags;
+    // slot descriptions follow the header
+};
+
+#if defined(LINUX32) || defined(LINUX64)
+
+static void FutexWait(std::atomic<mfxU32>* word, mfxU32 value, mfxU32 timeoutMs) {
+    struct timespec ts;
+    ts.tv_sec  = timeoutMs / 1000;
+    ts.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+    // shared futex: waiters and wakers are in different processes
+    syscall(SYS_futex, (mfxU32*)word, FUTEX_WAIT, value, &ts, nullptr, 0);
+}
+
+static void FutexWake(std::atomic<mfxU32>* word) {
+    syscall(SYS_futex, (mfxU32*)word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+static mfxU64 GetMonotonicMs() {
+    struct timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (mfxU64)ts.tv_sec * 1000 + (mfxU64)ts.tv_nsec / 1000000;
+}
+
+// peer crash must not leave the other side waiting forever,
+// zero beat means the peer has not attached yet
+static bool IsBeatAlive(mfxU64 beat) {
+    return !beat || GetMonotonicMs() - beat < SHM_PEER_TIMEOUT;
+}
+
+static std::string ShmName(const msdk_char* name) {
+    std::string shmName(name);
+    if (shmName.empty() || shmName[0] != '/')
+        shmName.insert(0, "/");
+    return shmName;
+}
+
+#endif
+
+CShmRing::CShmRing()
+        : m_pHeader(nullptr),
+          m_nSize(0),
+          m_bProducer(false),
+          m_sName(),
+          m_nNextRead(0),
+          m_released(),
+          m_heartbeat(),
+          m_beatMutex(),
+          m_beatCond(),
+          m_bStopBeat(false) {}
+
+CShmRing::~CShmRing() {
+    Close();
+}
+
+mfxU8* CShmRing::SlotData(mfxU32 slot) const {
+    return (mfxU8*)m_pHeader + m_pHeader->nDataOffset + (size_t)slot * m_pHeader->nSlotSize;
+}
+
+ShmSlotInfo* CShmRing::SlotInfo(mfxU32 slot) const {
+    return (ShmSlotInfo*)((mfxU8*)m_pHeader + sizeof(ShmRingHeader)) + slot;
+}
+
+void CShmRing::StartHeartbeat() {
+    m_bStopBeat = false;
+    m_heartbeat = std::thread(&CShmRing::HeartbeatRoutine, this);
+}
+
+void CShmRing::StopHeartbeat() {
+    if (!m_heartbeat.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_beatMutex);
+        m_bStopBeat = true;
+    }
+    m_beatCond.notify_one();
+    m_heartbeat.join();
+}
+
+void CShmRing::HeartbeatRoutine() {
+#if defined(LINUX32) || defined(LINUX64)
+    std::atomic<mfxU64>& beat = m_bProducer ? m_pHeader->producerBeat : m_pHeader->consumerBeat;
+
+    std::unique_lock<std::mutex> lock(m_beatMutex);
+    while (!m_bStopBeat) {
+        beat.store(GetMonotonicMs());
+        m_beatCond.wait_for(lock, std::chrono::milliseconds(SHM_WAIT_SLICE));
+    }
+#endif
+}
+
+bool CShmRing::IsPeerAlive() const {
+#if defined(LINUX32) || defined(LINUX64)
+    return IsBeatAlive(m_bProducer ? m_pHeader->consumerBeat.load()
+                                   : m_pHeader->producerBeat.load());
+#else
+    return false;
+#endif
+}
+
+mfxStatus CShmRing::Create(const msdk_char* name,
+                           mfxU32 payloadType,
+                           mfxU32 nSlots,
+                           mfxU32 nSlotSize) {
+    MSDK_CHECK_POINTER(name, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_ERROR(nSlots, 0, MFX_ERR_UNDEFINED_BEHAVIOR);
+    MSDK_CHECK_ERROR(nSlotSize, 0, MFX_ERR_UNDEFINED_BEHAVIOR);
+
+    Close();
+
+#if defined(LINUX32) || defined(LINUX64)
+    std::string shmName = ShmName(name);
+
+    size_t nDataOffset = MSDK_ALIGN(sizeof(ShmRingHeader) + nSlots * sizeof(ShmSlotInfo),
+                                    SHM_PAGE_SIZE);
+    size_t nSlotStride = MSDK_ALIGN((size_t)nSlotSize, SHM_PAGE_SIZE);
+    size_t nSize       = nDataOffset + nSlots * nSlotStride;
+
+    int fd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && EEXIST == errno) {
+        // only a segment left by a crashed producer may be replaced, never a live ring
+        bool bStale = false;
+        int fdOld   = shm_open(shmName.c_str(), O_RDONLY, 0);
+        if (fdOld >= 0) {
+            struct stat st = {};
+            if (!fstat(fdOld, &st) && (size_t)st.st_size >= sizeof(ShmRingHeader)) {
+                void* pOld = mmap(nullptr, sizeof(ShmRingHeader), PROT_READ, MAP_SHARED, fdOld, 0);
+                if (MAP_FAILED != pOld) {
+                    ShmRingHeader* pHeader = (ShmRingHeader*)pOld;
+                    if (SHM_RING_MAGIC == pHeader->magic && SHM_RING_VERSION == pHeader->version)
+                        bStale = !IsBeatAlive(pHeader->producerBeat.load());
+                    munmap(pOld, sizeof(ShmRingHeader));
+                }
+            }
+            close(fdOld);
+        }
+
+        if (!bStale) {
+            msdk_printf(MSDK_STRING("ERROR: shared memory %s is already in use\n"), name);
+            return MFX_ERR_DEVICE_FAILED;
+        }
+
+        shm_unlink(shmName.c_str());
+        fd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+    if (fd < 0)
+        return MFX_ERR_DEVICE_FAILED;
+
+    // tmpfs pages are allocated on first write
+    if (ftruncate(fd, (off_t)nSize)) {
+        close(fd);
+        shm_unlink(shmName.c_str());
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+
+    void* pData = mmap(nullptr, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == pData) {
+        shm_unlink(shmName.c_str());
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+
+    m_pHeader               = (ShmRingHeader*)pData;
+    m_nSize                 = nSize;
+    m_bProducer             = true;
+    m_sName                 = shmName;
+    m_pHeader->version      = SHM_RING_VERSION;
+    m_pHeader->payloadType  = payloadType;
+    m_pHeader->nSlots       = nSlots;
+    m_pHeader->nSlotSize    = (mfxU32)nSlotStride;
+    m_pHeader->nDataOffset  = (mfxU32)nDataOffset;
+    m_pHeader->nSegmentSize = nSize;
+    m_pHeader->writeIdx.store(0);
+    m_pHeader->readIdx.store(0);
+    m_pHeader->flags.store(0);
+    m_pHeader->producerBeat.store(GetMonotonicMs());
+    m_pHeader->consumerBeat.store(0);
+    StartHeartbeat();
+
+    std::atomic_thread_fence(std::memory_order_release);
+    m_pHeader->magic = SHM_RING_MAGIC;
+
+    return MFX_ERR_NONE;
+#else
+    (void)payloadType;
+    return MFX_ERR_UNSUPPORTED;
+#endif
+}
+
+mfxStatus CShmRing::Open(const msdk_char* name, mfxU32 payloadType, mfxU32 nTimeout) {
+    MSDK_CHECK_POINTER(name, MFX_ERR_NULL_PTR);
+
+    Close();
+
+#if defined(LINUX32) || defined(LINUX64)
+    std::string shmName = ShmName(name);
+
+    // producer may start later than consumer
+    for (mfxU32 waited = 0;; waited += SHM_WAIT_SLICE) {
+        int fd = shm_open(shmName.c_str(), O_RDWR, 0);
+        if (fd >= 0) {
+            struct stat st = {};
+            void* pData    = MAP_FAILED;
+            if (!fstat(fd, &st) && (size_t)st.st_size >= sizeof(ShmRingHeader))
+                pData = mmap(nullptr,
+                             (size_t)st.st_size,
+                             PROT_READ | PROT_WRITE,
+                             MAP_SHARED,
+                             fd,
+                             0);
+            close(fd);
+
+            if (MAP_FAILED != pData) {
+                ShmRingHeader* pHeader = (ShmRingHeader*)pData;
+                bool bReady            = SHM_RING_MAGIC == pHeader->magic;
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                // segment left by a crashed producer will be replaced, keep waiting
+                if (bReady && pHeader->nSegmentSize == (mfxU64)st.st_size &&
+                    (SHM_RING_VERSION != pHeader->version ||
+                     IsBeatAlive(pHeader->producerBeat.load()))) {
+                    if (SHM_RING_VERSION != pHeader->version ||
+                        payloadType != pHeader->payloadType) {
+                        munmap(pData, (size_t)st.st_size);
+                        msdk_printf(MSDK_STRING("ERROR: shared memory %s carries other data\n"),
+                                    name);
+                        return MFX_ERR_UNSUPPORTED;
+                    }
+
+                    m_pHeader   = pHeader;
+                    m_nSize     = (size_t)st.st_size;
+                    m_bProducer = false;
+                    m_sName     = shmName;
+                    m_nNextRead = m_pHeader->readIdx.load();
+                    m_pHeader->consumerBeat.store(GetMonotonicMs());
+                    StartHeartbeat();
+                    m_released.assign(m_pHeader->nSlots, false);
+                    return MFX_ERR_NONE;
+                }
+                munmap(pData, (size_t)st.st_size);
+            }
+        }
+
+        if (waited >= nTimeout)
+            return MFX_ERR_NOT_FOUND;
+        MSDK_SLEEP(SHM_WAIT_SLICE);
+    }
+#else
+    (void)payloadType;
+    (void)nTimeout;
+    return MFX_ERR_UNSUPPORTED;
+#endif
+}
+
+void CShmRing::Close() {
+#if defined(LINUX32) || defined(LINUX64)
+    if (!m_pHeader)
+        return;
+
+    // heartbeat thread writes to the segment
+    StopHeartbeat();
+
+    if (m_bProducer) {
+        SetEndOfStream();
+        // consumer keeps its own mapping, name is not needed anymore
+        shm_unlink(m_sName.c_str());
+    }
+    else {
+        m_pHeader->flags.fetch_or(SHM_FLAG_CONSUMER_CLOSED);
+        FutexWake(&m_pHeader->readIdx);
+    }
+
+    munmap(m_pHeader, m_nSize);
+#endif
+    m_pHeader = nullptr;
+    m_nSize   = 0;
+    m_sName.clear();
+    m_released.clear();
+}
+
+mfxU8* CShmRing::AcquireWrite(mfxU32* pCapacity) {
+    if (!m_pHeader || !m_bProducer || !pCapacity)
+        return nullptr;
+
+#if defined(LINUX32) || defined(LINUX64)
+    mfxU32 writeIdx = m_pHeader->writeIdx.load(std::memory_order_relaxed);
+    for (;;) {
+        if (m_pHeader->flags.load() & SHM_FLAG_CONSUMER_CLOSED)
+            return nullptr;
+
+        mfxU32 readIdx = m_pHeader->readIdx.load(std::memory_order_acquire);
+        if (writeIdx - readIdx < m_pHeader->nSlots)
+            break;
+
+        FutexWait(&m_pHeader->readIdx, readIdx, SHM_WAIT_SLICE);
+        if (!IsPeerAlive())
+            return nullptr;
+    }
+
+    *pCapacity = m_pHeader->nSlotSize;
+    return SlotData(writeIdx % m_pHeader->nSlots);
+#else
+    return nullptr;
+#endif
+}
+
+void CShmRing::CommitWrite(const ShmSlotInfo& info) {
+    if (!m_pHeader || !m_bProducer)
+        return;
+
+#if defined(LINUX32) || defined(LINUX64)
+    mfxU32 writeIdx = m_pHeader->writeIdx.load(std::memory_order_relaxed);
+    *SlotInfo(writeIdx % m_pHeader->nSlots) = info;
+
+    m_pHeader->writeIdx.store(writeIdx + 1, std::memory_order_release);
+    FutexWake(&m_pHeader->writeIdx);
+#else
+    (void)info;
+#endif
+}
+
+void CShmRing::SetEndOfStream() {
+    if (!m_pHeader || !m_bProducer)
+        return;
+
+#if defined(LINUX32) || defined(LINUX64)
+    m_pHeader->flags.fetch_or(SHM_FLAG_EOS);
+    FutexWake(&m_pHeader->writeIdx);
+#endif
+}
+
+mfxStatus CShmRing::AcquireRead(mfxU32* pSlot, mfxU8** ppData, ShmSlotInfo* pInfo) {
+    MSDK_CHECK_POINTER(m_pHeader, MFX_ERR_NOT_INITIALIZED);
+    MSDK_CHECK_POINTER(pSlot, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_POINTER(ppData, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_POINTER(pInfo, MFX_ERR_NULL_PTR);
+
+#if defined(LINUX32) || defined(LINUX64)
+    for (;;) {
+        mfxU32 writeIdx = m_pHeader->writeIdx.load(std::memory_order_acquire);
+        if (writeIdx != m_nNextRead)
+            break;
+
+        if (m_pHeader->flags.load() & SHM_FLAG_EOS) {
+            // last frames may be committed right before the flag
+            if (m_pHeader->writeIdx.load(std::memory_order_acquire) == m_nNextRead)
+                return MFX_ERR_MORE_DATA;
+            continue;
+        }
+
+        FutexWait(&m_pHeader->writeIdx, writeIdx, SHM_WAIT_SLICE);
+        if (!(m_pHeader->flags.load() & SHM_FLAG_EOS) && !IsPeerAlive()) {
+            msdk_printf(MSDK_STRING("ERROR: shared memory producer has gone\n"));
+            return MFX_ERR_ABORTED;
+        }
+    }
+
+    *pSlot  = m_nNextRead % m_pHeader->nSlots;
+    *ppData = SlotData(*pSlot);
+    *pInfo  = *SlotInfo(*pSlot);
+    m_nNextRead++;
+
+    if (pInfo->DataLength > m_pHeader->nSlotSize)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    return MFX_ERR_NONE;
+#else
+    return MFX_ERR_UNSUPPORTED;
+#endif
+}
+
+void CShmRing::ReleaseRead(mfxU32 slot) {
+    if (!m_pHeader || m_bProducer || slot >= m_released.size())
+        return;
+
+#if defined(LINUX32) || defined(LINUX64)
+    m_released[slot] = true;
+
+    // hand back the longest run of released slots starting from the oldest one
+    mfxU32 readIdx = m_pHeader->readIdx.load(std::memory_order_relaxed);
+    mfxU32 nFreed  = 0;
+    while (readIdx + nFreed != m_nNextRead &&
+           m_released[(readIdx + nFreed) % m_pHeader->nSlots]) {
+        m_released[(readIdx + nFreed) % m_pHeader->nSlots] = false;
+        nFreed++;
+    }
+
+    if (nFreed) {
+        m_pHeader->readIdx.store(readIdx + nFreed, std::memory_order_release);
+        FutexWake(&m_pHeader->readIdx);
+    }
+#endif
+}
+
+CShmBitstreamWriter::CShmBitstreamWriter()
+        : CSmplBitstreamWriter(),
+          m_ring(),
+          m_nSlots(SHM_DEFAULT_SLOTS),
+          m_nSlotSize(SHM_DEFAULT_BITSTREAM_SLOT),
+          m_pSlot(nullptr),
+          m_nSlotFill(0) {}
+
+CShmBitstreamWriter::~CShmBitstreamWriter() {
+    Close();
+}
+
+void CShmBitstreamWriter::SetRingParams(mfxU32 nSlots, mfxU32 nSlotSize) {
+    m_nSlots    = nSlots;
+    m_nSlotSize = nSlotSize;
+}
+
+mfxStatus CShmBitstreamWriter::Init(const msdk_char* strFileName) {
+    MSDK_CHECK_POINTER(strFileName, MFX_ERR_NULL_PTR);
+    if (!msdk_strlen(strFileName))
+        return MFX_ERR_NONE;
+
+    Close();
+
+    mfxStatus sts = m_ring.Create(strFileName, SHM_PAYLOAD_BITSTREAM, m_nSlots, m_nSlotSize);
+    MSDK_CHECK_STATUS(sts, "m_ring.Create failed");
+
+    m_sFile   = msdk_string(strFileName);
+    m_bInited = true;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CShmBitstreamWriter::Reset() {
+    // consumer reads a continuous stream, ring is kept
+    return MFX_ERR_NONE;
+}
+
+void CShmBitstreamWriter::Close() {
+    m_pSlot     = nullptr;
+    m_nSlotFill = 0;
+    m_ring.Close();
+    CSmplBitstreamWriter::Close();
+}
+
+mfxStatus CShmBitstreamWriter::WriteNextFrame(mfxBitstream* pMfxBitstream,
+                                              bool isPrint,
+                                              bool isCompleteFrame) {
+    if (m_bSkipWriting)
+        return MFX_ERR_NONE;
+
+    MSDK_CHECK_ERROR(m_bInited, false, MFX_ERR_NOT_INITIALIZED);
+    MSDK_CHECK_POINTER(pMfxBitstream, MFX_ERR_NULL_PTR);
+
+    // slot stays acquired while the frame arrives in chunks
+    mfxU32 nCapacity = 0;
+    mfxU8* pSlot     = m_ring.AcquireWrite(&nCapacity);
+    if (!pSlot)
+        return MFX_ERR_ABORTED;
+    if (pSlot != m_pSlot) {
+        m_pSlot     = pSlot;
+        m_nSlotFill = 0;
+    }
+
+    if (pMfxBitstream->DataLength > nCapacity) {
+        msdk_printf(MSDK_STRING("ERROR: frame of %u bytes doesn't fit into shared memory slot\n"),
+                    (unsigned int)pMfxBitstream->DataLength);
+        return MFX_ERR_NOT_ENOUGH_BUFFER;
+    }
+
+    // encoder appends partial output to the bitstream, only the new chunk is copied
+    if (pMfxBitstream->DataLength > m_nSlotFill) {
+        MSDK_MEMCPY(pSlot + m_nSlotFill,
+                    pMfxBitstream->Data + pMfxBitstream->DataOffset + m_nSlotFill,
+                    pMfxBitstream->DataLength - m_nSlotFill);
+        m_nSlotFill = pMfxBitstream->DataLength;
+    }
+
+    if (!isCompleteFrame)
+        return MFX_ERR_NONE;
+
+    ShmSlotInfo info     = {};
+    info.TimeStamp       = pMfxBitstream->TimeStamp;
+    info.DecodeTimeStamp = pMfxBitstream->DecodeTimeStamp;
+    info.DataLength      = pMfxBitstream->DataLength;
+    info.FrameType       = pMfxBitstream->FrameType;
+    info.PicStruct       = pMfxBitstream->PicStruct;
+    m_ring.CommitWrite(info);
+    m_pSlot     = nullptr;
+    m_nSlotFill = 0;
+
+    pMfxBitstream->DataLength = 0;
+    pMfxBitstream->DataOffset = 0;
+
+    m_nProcessedFramesNum++;
+
+    if (isPrint && (1 == m_nProcessedFramesNum || (0 == (m_nProcessedFramesNum % 100)))) {
+        msdk_printf(MSDK_STRING("Frame number: %u\r"), (unsigned int)m_nProcessedFramesNum);
+    }
+
+    return MFX_ERR_NONE;
+}
+
+// consumer waits this long for the producer process to start
+const mfxU32 SHM_OPEN_TIMEOUT = 10000;
+
+CShmBitstreamReader::CShmBitstreamReader()
+        : CSmplBitstreamReader(),
+          m_ring(),
+          m_bHaveSlot(false),
+          m_nSlot(0),
+          m_pSlotData(nullptr),
+          m_slotInfo(),
+          m_nSlotPos(0) {}
+
+CShmBitstreamReader::~CShmBitstreamReader() {
+    Close();
+}
+
+void CShmBitstreamReader::Close() {
+    m_ring.Close();
+    m_bHaveSlot = false;
+    CSmplBitstreamReader::Close();
+}
+
+mfxStatus CShmBitstreamReader::Init(const msdk_char* strFileName) {
+    MSDK_CHECK_POINTER(strFileName, MFX_ERR_NULL_PTR);
+    if (!msdk_strlen(strFileName))
+        return MFX_ERR_NONE;
+
+    Close();
+
+    mfxStatus sts = m_ring.Open(strFileName, SHM_PAYLOAD_BITSTREAM, SHM_OPEN_TIMEOUT);
+    MSDK_CHECK_STATUS(sts, "m_ring.Open failed");
+
+    m_bInited = true;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CShmBitstreamReader::ReadNextFrame(mfxBitstream* pBS) {
+    if (!m_bInited)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    MSDK_CHECK_POINTER(pBS, MFX_ERR_NULL_PTR);
+
+    if (pBS->MaxLength == pBS->DataLength)
+        return MFX_ERR_NOT_ENOUGH_BUFFER;
+
+    if (!m_bHaveSlot) {
+        mfxStatus sts = m_ring.AcquireRead(&m_nSlot, &m_pSlotData, &m_slotInfo);
+        if (MFX_ERR_MORE_DATA == sts)
+            pBS->DataFlag |= MFX_BITSTREAM_EOS;
+        if (MFX_ERR_NONE != sts)
+            return sts;
+
+        m_bHaveSlot = true;
+        m_nSlotPos  = 0;
+
+        // time stamp belongs to the first frame in the buffer
+        if (!pBS->DataLength) {
+            pBS->TimeStamp       = m_slotInfo.TimeStamp;
+            pBS->DecodeTimeStamp = m_slotInfo.DecodeTimeStamp;
+        }
+    }
+
+    memmove(pBS->Data, pBS->Data + pBS->DataOffset, pBS->DataLength);
+    pBS->DataOffset = 0;
+
+    // frame larger than free space is delivered over several calls
+    mfxU32 nCopy = std::min(m_slotInfo.DataLength - m_nSlotPos, pBS->MaxLength - pBS->DataLength);
+    MSDK_MEMCPY(pBS->Data + pBS->DataLength, m_pSlotData + m_nSlotPos, nCopy);
+    pBS->DataLength += nCopy;
+    m_nSlotPos += nCopy;
+
+    if (m_nSlotPos == m_slotInfo.DataLength) {
+        m_ring.ReleaseRead(m_nSlot);
+        m_bHaveSlot = false;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+// returns bytes per row and number of rows of the planes of Width x Height frame
+static mfxStatus GetShmFrameLayout(mfxU32 fourcc,
+                                   mfxU16 width,
+                                   mfxU16 height,
+                                   mfxU32& rowBytes,
+                                   mfxU32& chromaRows) {
+    switch (fourcc) {
+        case MFX_FOURCC_NV12:
+            rowBytes   = width;
+            chromaRows = height / 2;
+            break;
+        case MFX_FOURCC_P010:
+            rowBytes   = 2 * width;
+            chromaRows = height / 2;
+            break;
+        case MFX_FOURCC_YUY2:
+            rowBytes   = 2 * width;
+            chromaRows = 0;
+            break;
+        case MFX_FOURCC_RGB4:
+            rowBytes   = 4 * width;
+            chromaRows = 0;
+            break;
+        default:
+            return MFX_ERR_UNSUPPORTED;
+    }
+    return MFX_ERR_NONE;
+}
+
+CShmYUVWriter::CShmYUVWriter() : CSmplYUVWriter(), m_ring(), m_nSlots(SHM_DEFAULT_SLOTS) {}
+
+CShmYUVWriter::~CShmYUVWriter() {
+    Close();
+}
+
+void CShmYUVWriter::SetRingParams(mfxU32 nSlots) {
+    m_nSlots = nSlots;
+}
+
+void CShmYUVWriter::Close() {
+    m_ring.Close();
+    CSmplYUVWriter::Close();
+}
+
+mfxStatus CShmYUVWriter::Init(const msdk_char* strFileName, const mfxU32 numViews) {
+    MSDK_CHECK_POINTER(strFileName, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_ERROR(msdk_strlen(strFileName), 0, MFX_ERR_NOT_INITIALIZED);
+
+    if (numViews > 1) {
+        msdk_printf(MSDK_STRING("ERROR: multi-view output to shared memory is not supported\n"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    Close();
+
+    m_sFile   = msdk_string(strFileName);
+    m_nViews  = numViews;
+    m_bInited = true;
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CShmYUVWriter::Reset() {
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CShmYUVWriter::WriteNextFrame(mfxFrameSurface1* pSurface) {
+    MSDK_CHECK_ERROR(m_bInited, false, MFX_ERR_NOT_INITIALIZED);
+    MSDK_CHECK_POINTER(pSurface, MFX_ERR_NULL_PTR);
+
+    mfxFrameInfo& info = pSurface->Info;
+    mfxFrameData& data = pSurface->Data;
+
+    mfxU32 rowBytes = 0, chromaRows = 0;
+    mfxStatus sts = GetShmFrameLayout(info.FourCC, info.Width, info.Height, rowBytes, chromaRows);
+    if (MFX_ERR_NONE != sts) {
+        msdk_printf(MSDK_STRING("ERROR: color format %s isn't supported by shared memory output\n"),
+                    ColorFormatToStr(info.FourCC));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    mfxU32 frameLength = rowBytes * (info.Height + chromaRows);
+
+    // frame size is known with the first frame only
+    if (!m_ring.IsOpened()) {
+        sts = m_ring.Create(m_sFile.c_str(), SHM_PAYLOAD_FRAMES, m_nSlots, frameLength);
+        MSDK_CHECK_STATUS(sts, "m_ring.Create failed");
+    }
+
+    mfxU32 nCapacity = 0;
+    mfxU8* pSlot     = m_ring.AcquireWrite(&nCapacity);
+    if (!pSlot)
+        return MFX_ERR_ABORTED;
+    if (frameLength > nCapacity)
+        return MFX_ERR_NOT_ENOUGH_BUFFER;
+
+    mfxU32 pitch = ((mfxU32)data.PitchHigh << 16) + data.PitchLow;
+    mfxU8* pSrc  = (MFX_FOURCC_RGB4 == info.FourCC) ? std::min({ data.R, data.G, data.B }) : data.Y;
+    MSDK_CHECK_POINTER(pSrc, MFX_ERR_NOT_INITIALIZED);
+
+    // this is the only copy of the frame on its way to the consumer
+    for (mfxU32 i = 0; i < info.Height; i++)
+        MSDK_MEMCPY(pSlot + (size_t)i * rowBytes, pSrc + (size_t)i * pitch, rowBytes);
+    for (mfxU32 i = 0; i < chromaRows; i++)
+        MSDK_MEMCPY(pSlot + (size_t)(info.Height + i) * rowBytes,
+                    data.UV + (size_t)i * pitch,
+                    rowBytes);
+
+    ShmSlotInfo slotInfo = {};
+    slotInfo.TimeStamp   = data.TimeStamp;
+    slotInfo.DataLength  = frameLength;
+    slotInfo.PicStruct   = info.PicStruct;
+    slotInfo.FourCC      = info.FourCC;
+    slotInfo.Pitch       = rowBytes;
+    slotInfo.Width       = info.Width;
+    slotInfo.Height      = info.Height;
+    slotInfo.CropW       = info.CropW;
+    slotInfo.CropH       = info.CropH;
+    m_ring.CommitWrite(slotInfo);
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CShmYUVWriter::WriteNextFrameI420(mfxFrameSurface1* pSurface) {
+    (void)pSurface;
+    msdk_printf(MSDK_STRING("ERROR: I420 output to shared memory is not supported\n"));
+    return MFX_ERR_UNSUPPORTED;
+}
+
+CShmFrameSource::CShmFrameSource() : m_ring(), m_imported() {}
+
+CShmFrameSource::~CShmFrameSource() {
+    Close();
+}
+
+mfxStatus CShmFrameSource::Init(const msdk_string& name) {
+    Close();
+    return m_ring.Open(name.c_str(), SHM_PAYLOAD_FRAMES, SHM_OPEN_TIMEOUT);
+}
+
+void CShmFrameSource::Close() {
+    m_imported.clear();
+    m_ring.Close();
+}
+
+mfxStatus CShmFrameSource::ImportFrame(mfxFrameSurface1* pSurface) {
+    MSDK_CHECK_POINTER(pSurface, MFX_ERR_NULL_PTR);
+
+    // surface may still hold the previous frame if the caller skipped ReleaseFrame()
+    ReleaseFrame(pSurface);
+
+    mfxU32 slot      = 0;
+    mfxU8* ptr       = nullptr;
+    ShmSlotInfo info = {};
+    mfxStatus sts    = m_ring.AcquireRead(&slot, &ptr, &info);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    mfxFrameInfo& surfInfo = pSurface->Info;
+    mfxFrameData& data     = pSurface->Data;
+
+    // producer frame must cover the whole surface
+    if (info.FourCC != surfInfo.FourCC || info.Width < surfInfo.Width ||
+        info.Height < surfInfo.Height) {
+        m_ring.ReleaseRead(slot);
+        msdk_printf(MSDK_STRING("ERROR: shared memory frame doesn't match encoder input\n"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    data.PitchHigh = (mfxU16)(info.Pitch >> 16);
+    data.PitchLow  = (mfxU16)(info.Pitch & 0xffff);
+    switch (info.FourCC) {
+        case MFX_FOURCC_NV12:
+            data.Y  = ptr;
+            data.UV = ptr + (size_t)info.Pitch * info.Height;
+            data.V  = data.UV + 1;
+            break;
+        case MFX_FOURCC_P010:
+            data.Y  = ptr;
+            data.UV = ptr + (size_t)info.Pitch * info.Height;
+            data.V  = data.UV + 2;
+            break;
+        case MFX_FOURCC_YUY2:
+            data.Y = ptr;
+            data.U = ptr + 1;
+            data.V = ptr + 3;
+            break;
+        case MFX_FOURCC_RGB4:
+            data.B = ptr;
+            data.G = ptr + 1;
+            data.R = ptr + 2;
+            data.A = ptr + 3;
+            break;
+    }
+    data.TimeStamp = info.TimeStamp;
+
+    m_imported[pSurface] = slot;
+    return MFX_ERR_NONE;
+}
+
+void CShmFrameSource::ReleaseFrame(mfxFrameSurface1* pSurface) {
+    std::map<mfxFrameSurface1*, mfxU32>::iterator it = m_imported.find(pSurface);
+    if (it == m_imported.end())
+        return;
+
+    pSurface->Data.Y     = nullptr;
+    pSurface->Data.U     = nullptr;
+    pSurface->Data.V     = nullptr;
+    pSurface->Data.A     = nullptr;
+    pSurface->Data.Pitch = 0;
+
+    m_ring.ReleaseRead(it->second);
+    m_imported.erase(it);
+}
@@ -7,13 +7,41 @@
 #include "sysmem_allocator.h"
 #include "sample_utils.h"
 
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
 #define MSDK_ALIGN32(X) (((mfxU32)((X) + 31)) & (~(mfxU32)31))
 #define ID_BUFFER       MFX_MAKEFOURCC('B', 'U', 'F', 'F')
 #define ID_FRAME        MFX_MAKEFOURCC('F', 'R', 'M', 'E')
 
+#if !defined(_WIN32) && !defined(_WIN64)
+    #ifndef MAP_HUGE_SHIFT
+        #define MAP_HUGE_SHIFT 26
+    #endif
+    #define MPOL_BIND_MODE 2 // MPOL_BIND from linux/mempolicy.h
+#endif
+
+static size_t AlignSize(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// slab frames start at page boundary, frame header takes one cache line before the planes
+static const size_t SLAB_FRAME_ALIGNMENT = 4096;
+static const size_t SLAB_HEADER_SIZE     = AlignSize(sizeof(sFrame), 64);
+
 SysMemFrameAllocator::SysMemFrameAllocator()
         : m_pBufferAllocator(0),
-          m_bOwnBufferAllocator(false) {}
+          m_bOwnBufferAllocator(false),
+          m_bUseSlab(false),
+          m_bUseHugePages(false),
+          m_nNumaNode(-1),
+          m_bHugePagesFailed(false),
+          m_vSlabs() {}
 
 SysMemFrameAllocator::~SysMemFrameAllocator() {
     Close();
@@ -29,6 +57,10 @@ mfxStatus SysMemFrameAllocator::Init(mfxAllocatorParams* pParams) {
 
         m_pBufferAllocator    = pSysMemParams->pBufferAllocator;
         m_bOwnBufferAllocator = false;
+
+        m_bUseHugePages = pSysMemParams->bUseHugePages;
+        m_nNumaNode     = pSysMemParams->nNumaNode;
+        m_bUseSlab      = pSysMemParams->bUseSlab || m_bUseHugePages || m_nNumaNode >= 0;
     }
 
     // if buffer allocator wasn't passed from application create own
@@ -46,6 +78,10 @@ mfxStatus SysMemFrameAllocator::Init(mfxAllocatorParams* pParams) {
 mfxStatus SysMemFrameAllocator::Close() {
     mfxStatus sts = BaseFrameAllocator::Close();
 
+    for (const sSlab& slab : m_vSlabs)
+        FreeSlab(slab);
+    m_vSlabs.clear();
+
     if (m_bOwnBufferAllocator) {
         delete m_pBufferAllocator;
         m_pBufferAllocator = 0;
@@ -53,118 +89,98 @@ mfxStatus SysMemFrameAllocator::Close() {
     return sts;
 }
 
-mfxStatus SysMemFrameAllocator::LockFrame(mfxMemId mid, mfxFrameData* ptr) {
-    if (!m_pBufferAllocator)
-        return MFX_ERR_NOT_INITIALIZED;
+// sets plane pointers and pitch of the frame with planes starting at base
+static mfxStatus SetFramePointers(const mfxFrameInfo& info, mfxU8* base, mfxFrameData* ptr) {
+    mfxU16 Width2  = (mfxU16)MSDK_ALIGN32(info.Width);
+    mfxU16 Height2 = (mfxU16)MSDK_ALIGN32(info.Height);
+    ptr->B = ptr->Y = base;
 
-    if (!ptr)
-        return MFX_ERR_NULL_PTR;
-
-    // If allocator uses pointers instead of mids, no further action is required
-    if (!mid && ptr->Y)
-        return MFX_ERR_NONE;
-
-    sFrame* fs    = 0;
-    mfxStatus sts = m_pBufferAllocator->Lock(m_pBufferAllocator->pthis, mid, (mfxU8**)&fs);
-
-    if (MFX_ERR_NONE != sts)
-        return sts;
-
-    if (ID_FRAME != fs->id) {
-        m_pBufferAllocator->Unlock(m_pBufferAllocator->pthis, mid);
-        return MFX_ERR_INVALID_HANDLE;
-    }
-
-    mfxU16 Width2  = (mfxU16)MSDK_ALIGN32(fs->info.Width);
-    mfxU16 Height2 = (mfxU16)MSDK_ALIGN32(fs->info.Height);
-    ptr->B = ptr->Y = (mfxU8*)fs + MSDK_ALIGN32(sizeof(sFrame));
-
-    switch (fs->info.FourCC) {
+    switch (info.FourCC) {
         case MFX_FOURCC_NV12:
             ptr->U         = ptr->Y + Width2 * Height2;
             ptr->V         = ptr->U + 1;
             ptr->PitchHigh = 0;
-            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(fs->info.Width);
+            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(info.Width);
             break;
         case MFX_FOURCC_NV16:
             ptr->U         = ptr->Y + Width2 * Height2;
             ptr->V         = ptr->U + 1;
             ptr->PitchHigh = 0;
-            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(fs->info.Width);
+            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(info.Width);
             break;
         case MFX_FOURCC_I420:
             ptr->U         = ptr->Y + Width2 * Height2;
             ptr->V         = ptr->U + (Width2 >> 1) * (Height2 >> 1);
             ptr->PitchHigh = 0;
-            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(fs->info.Width);
+            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(info.Width);
             break;
         case MFX_FOURCC_I422:
             ptr->U         = ptr->Y + Width2 * Height2;
             ptr->V         = ptr->U + (Width2 >> 1) * (Height2);
             ptr->PitchHigh = 0;
-            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(fs->info.Width);
+            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(info.Width);
             break;
         case MFX_FOURCC_YV12:
             ptr->V         = ptr->Y + Width2 * Height2;
             ptr->U         = ptr->V + (Width2 >> 1) * (Height2 >> 1);
             ptr->PitchHigh = 0;
-            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(fs->info.Width);
+            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(info.Width);
             break;
         case MFX_FOURCC_UYVY:
             ptr->U         = ptr->Y;
             ptr->Y         = ptr->U + 1;
             ptr->V         = ptr->U + 2;
-            ptr->PitchHigh = (mfxU16)((2 * MSDK_ALIGN32(fs->info.Width)) / (1 << 16));
-            ptr->PitchLow  = (mfxU16)((2 * MSDK_ALIGN32(fs->info.Width)) % (1 << 16));
+            ptr->PitchHigh = (mfxU16)((2 * MSDK_ALIGN32(info.Width)) / (1 << 16));
+            ptr->PitchLow  = (mfxU16)((2 * MSDK_ALIGN32(info.Width)) % (1 << 16));
             break;
         case MFX_FOURCC_YUY2:
             ptr->U         = ptr->Y + 1;
             ptr->V         = ptr->Y + 3;
-            ptr->PitchHigh = (mfxU16)((2 * MSDK_ALIGN32(fs->info.Width)) / (1 << 16));
-            ptr->PitchLow  = (mfxU16)((2 * MSDK_ALIGN32(fs->info.Width)) % (1 << 16));
+            ptr->PitchHigh = (mfxU16)((2 * MSDK_ALIGN32(info.Width)) / (1 << 16));
+            ptr->PitchLow  = (mfxU16)((2 * MSDK_ALIGN32(info.Width)) % (1 << 16));
             break;
         case MFX_FOURCC_RGB565:
             ptr->G         = ptr->B;
             ptr->R         = ptr->B;
-            ptr->PitchHigh = (mfxU16)((2 * MSDK_ALIGN32(fs->info.Width)) / (1 << 16));
-            ptr->PitchLow  = (mfxU16)((2 * MSDK_ALIGN32(fs->info.Width)) % (1 << 16));
+            ptr->PitchHigh = (mfxU16)((2 * MSDK_ALIGN32(info.Width)) / (1 << 16));
+            ptr->PitchLow  = (mfxU16)((2 * MSDK_ALIGN32(info.Width)) % (1 << 16));
             break;
         case MFX_FOURCC_RGB3:
             ptr->G         = ptr->B + 1;
             ptr->R         = ptr->B + 2;
-            ptr->PitchHigh = (mfxU16)((3 * MSDK_ALIGN32(fs->info.Width)) / (1 << 16));
-            ptr->PitchLow  = (mfxU16)((3 * MSDK_ALIGN32(fs->info.Width)) % (1 << 16));
+            ptr->PitchHigh = (mfxU16)((3 * MSDK_ALIGN32(info.Width)) / (1 << 16));
+            ptr->PitchLow  = (mfxU16)((3 * MSDK_ALIGN32(info.Width)) % (1 << 16));
             break;
         case MFX_FOURCC_RGBP:
             ptr->G         = ptr->R + Width2 * Height2;
             ptr->B         = ptr->G + Width2 * Height2;
-            ptr->PitchHigh = (mfxU16)((MSDK_ALIGN32(fs->info.Width)) / (1 << 16));
-            ptr->PitchLow  = (mfxU16)((MSDK_ALIGN32(fs->info.Width)) % (1 << 16));
+            ptr->PitchHigh = (mfxU16)((MSDK_ALIGN32(info.Width)) / (1 << 16));
+            ptr->PitchLow  = (mfxU16)((MSDK_ALIGN32(info.Width)) % (1 << 16));
             break;
         case MFX_FOURCC_RGB4:
         case MFX_FOURCC_A2RGB10:
             ptr->G         = ptr->B + 1;
             ptr->R         = ptr->B + 2;
             ptr->A         = ptr->B + 3;
-            ptr->PitchHigh = (mfxU16)((4 * MSDK_ALIGN32(fs->info.Width)) / (1 << 16));
-            ptr->PitchLow  = (mfxU16)((4 * MSDK_ALIGN32(fs->info.Width)) % (1 << 16));
+            ptr->PitchHigh = (mfxU16)((4 * MSDK_ALIGN32(info.Width)) / (1 << 16));
+            ptr->PitchLow  = (mfxU16)((4 * MSDK_ALIGN32(info.Width)) % (1 << 16));
             break;
         case MFX_FOURCC_R16:
             ptr->Y16       = (mfxU16*)ptr->B;
-            ptr->PitchHigh = (mfxU16)((2 * MSDK_ALIGN32(fs->info.Width)) / (1 << 16));
-            ptr->PitchLow  = (mfxU16)((2 * MSDK_ALIGN32(fs->info.Width)) % (1 << 16));
+            ptr->PitchHigh = (mfxU16)((2 * MSDK_ALIGN32(info.Width)) / (1 << 16));
+            ptr->PitchLow  = (mfxU16)((2 * MSDK_ALIGN32(info.Width)) % (1 << 16));
             break;
         case MFX_FOURCC_I010:
             ptr->U         = ptr->Y + Width2 * Height2 * 2;
             ptr->V         = ptr->U + Width2 * (Height2 >> 1);
             ptr->PitchHigh = 0;
-            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(fs->info.Width * 2);
+            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(info.Width * 2);
             break;
         case MFX_FOURCC_I210:
             ptr->U         = ptr->Y + Width2 * Height2 * 2;
             ptr->V         = ptr->U + Width2 * Height2;
             ptr->PitchHigh = 0;
-            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(fs->info.Width * 2);
+            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(info.Width * 2);
             break;
 #if (MFX_VERSION >= MFX_VERSION_NEXT)
         case MFX_FOURCC_P016:
@@ -173,21 +189,21 @@ mfxStatus SysMemFrameAllocator::LockFrame(mfxMemId mid, mfxFrameData* ptr) {
             ptr->U         = ptr->Y + Width2 * Height2 * 2;
             ptr->V         = ptr->U + 2;
             ptr->PitchHigh = 0;
-            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(fs->info.Width * 2);
+            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(info.Width * 2);
             break;
         case MFX_FOURCC_P210:
             ptr->U         = ptr->Y + Width2 * Height2 * 2;
             ptr->V         = ptr->U + 2;
             ptr->PitchHigh = 0;
-            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(fs->info.Width * 2);
+            ptr->PitchLow  = (mfxU16)MSDK_ALIGN32(info.Width * 2);
             break;
         case MFX_FOURCC_AYUV:
             ptr->V         = ptr->B;
             ptr->U         = ptr->V + 1;
             ptr->Y         = ptr->V + 2;
             ptr->A         = ptr->V + 3;
-            ptr->PitchHigh = (mfxU16)((4 * MSDK_ALIGN32(fs->info.Width)) / (1 << 16));
-            ptr->PitchLow  = (mfxU16)((4 * MSDK_ALIGN32(fs->info.Width)) % (1 << 16));
+            ptr->PitchHigh = (mfxU16)((4 * MSDK_ALIGN32(info.Width)) / (1 << 16));
+            ptr->PitchLow  = (mfxU16)((4 * MSDK_ALIGN32(info.Width)) % (1 << 16));
             break;
 #if (MFX_VERSION >= MFX_VERSION_NEXT)
         case MFX_FOURCC_Y416:
@@ -195,8 +211,8 @@ mfxStatus SysMemFrameAllocator::LockFrame(mfxMemId mid, mfxFrameData* ptr) {
             ptr->Y16       = ptr->U16 + 1;
             ptr->V16       = ptr->Y16 + 1;
             ptr->A         = (mfxU8*)(ptr->V16 + 1);
-            ptr->PitchHigh = (mfxU16)(8 * MSDK_ALIGN32(fs->info.Width) / (1 << 16));
-            ptr->PitchLow  = (mfxU16)(8 * MSDK_ALIGN32(fs->info.Width) % (1 << 16));
+            ptr->PitchHigh = (mfxU16)(8 * MSDK_ALIGN32(info.Width) / (1 << 16));
+            ptr->PitchLow  = (mfxU16)(8 * MSDK_ALIGN32(info.Width) % (1 << 16));
             break;
         case MFX_FOURCC_Y216:
 #endif
@@ -205,13 +221,13 @@ mfxStatus SysMemFrameAllocator::LockFrame(mfxMemId mid, mfxFrameData* ptr) {
             ptr->U16 = ptr->Y16 + 1;
             ptr->V16 = ptr->Y16 + 3;
             //4 words per macropixel -> 2 words per pixel -> 4 bytes per pixel
-            ptr->PitchHigh = (mfxU16)((4 * MSDK_ALIGN32(fs->info.Width)) / (1 << 16));
-            ptr->PitchLow  = (mfxU16)((4 * MSDK_ALIGN32(fs->info.Width)) % (1 << 16));
+            ptr->PitchHigh = (mfxU16)((4 * MSDK_ALIGN32(info.Width)) / (1 << 16));
+            ptr->PitchLow  = (mfxU16)((4 * MSDK_ALIGN32(info.Width)) % (1 << 16));
             break;
         case MFX_FOURCC_Y410:
             ptr->U = ptr->V = ptr->A = ptr->Y;
-            ptr->PitchHigh           = (mfxU16)((4 * MSDK_ALIGN32(fs->info.Width)) / (1 << 16));
-            ptr->PitchLow            = (mfxU16)((4 * MSDK_ALIGN32(fs->info.Width)) % (1 << 16));
+            ptr->PitchHigh           = (mfxU16)((4 * MSDK_ALIGN32(info.Width)) / (1 << 16));
+            ptr->PitchLow            = (mfxU16)((4 * MSDK_ALIGN32(info.Width)) % (1 << 16));
             break;
 
         default:
@@ -221,19 +237,55 @@ mfxStatus SysMemFrameAllocator::LockFrame(mfxMemId mid, mfxFrameData* ptr) {
     return MFX_ERR_NONE;
 }
 
-mfxStatus SysMemFrameAllocator::UnlockFrame(mfxMemId mid, mfxFrameData* ptr) {
+mfxStatus SysMemFrameAllocator::LockFrame(mfxMemId mid, mfxFrameData* ptr) {
     if (!m_pBufferAllocator)
         return MFX_ERR_NOT_INITIALIZED;
 
+    if (!ptr)
+        return MFX_ERR_NULL_PTR;
+
     // If allocator uses pointers instead of mids, no further action is required
     if (!mid && ptr->Y)
         return MFX_ERR_NONE;
 
-    mfxStatus sts = m_pBufferAllocator->Unlock(m_pBufferAllocator->pthis, mid);
+    if (m_bUseSlab) {
+        // mid points to the frame header in the slab, planes follow it
+        sFrame* fs = (sFrame*)mid;
+        if (!fs || ID_FRAME != fs->id)
+            return MFX_ERR_INVALID_HANDLE;
+
+        return SetFramePointers(fs->info, (mfxU8*)fs + SLAB_HEADER_SIZE, ptr);
+    }
+
+    sFrame* fs    = 0;
+    mfxStatus sts = m_pBufferAllocator->Lock(m_pBufferAllocator->pthis, mid, (mfxU8**)&fs);
 
     if (MFX_ERR_NONE != sts)
         return sts;
 
+    if (ID_FRAME != fs->id) {
+        m_pBufferAllocator->Unlock(m_pBufferAllocator->pthis, mid);
+        return MFX_ERR_INVALID_HANDLE;
+    }
+
+    return SetFramePointers(fs->info, (mfxU8*)fs + MSDK_ALIGN32(sizeof(sFrame)), ptr);
+}
+
+mfxStatus SysMemFrameAllocator::UnlockFrame(mfxMemId mid, mfxFrameData* ptr) {
+    if (!m_pBufferAllocator)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    // If allocator uses pointers instead of mids, no further action is required
+    if (!mid && ptr->Y)
+        return MFX_ERR_NONE;
+
+    if (!m_bUseSlab) {
+        mfxStatus sts = m_pBufferAllocator->Unlock(m_pBufferAllocator->pthis, mid);
+
+        if (MFX_ERR_NONE != sts)
+            return sts;
+    }
+
     if (NULL != ptr) {
         ptr->Pitch = 0;
         ptr->Y     = 0;
@@ -260,15 +312,129 @@ mfxStatus SysMemFrameAllocator::CheckRequestType(mfxFrameAllocRequest* request)
         return MFX_ERR_UNSUPPORTED;
 }
 
-mfxMemId* SysMemFrameAllocator::GetMidHolder(mfxMemId mid) {
+mfxMemId* SysMemFrameAllocator::GetMidHolder(mfxMemId mid, mfxMemId** ppMids) {
     for (auto resp : m_vResp) {
         mfxMemId* it = std::find(resp->mids, resp->mids + resp->NumFrameActual, mid);
-        if (it != resp->mids + resp->NumFrameActual)
+        if (it != resp->mids + resp->NumFrameActual) {
+            if (ppMids)
+                *ppMids = resp->mids;
             return it;
+        }
     }
     return nullptr;
 }
 
+mfxStatus SysMemFrameAllocator::AllocSlab(size_t size, mfxMemId* mids, mfxU8** ptr) {
+    void* slab      = NULL;
+    bool bHugePages = false;
+
+#if defined(_WIN32) || defined(_WIN64)
+    DWORD node       = m_nNumaNode >= 0 ? (DWORD)m_nNumaNode : NUMA_NO_PREFERRED_NODE;
+    SIZE_T largePage = m_bUseHugePages ? GetLargePageMinimum() : 0;
+    if (largePage) {
+        // large pages require "Lock pages in memory" privilege
+        size_t largeSize = AlignSize(size, largePage);
+        slab             = VirtualAllocExNuma(GetCurrentProcess(),
+                                  NULL,
+                                  largeSize,
+                                  MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                                  PAGE_READWRITE,
+                                  node);
+        if (slab) {
+            size       = largeSize;
+            bHugePages = true;
+        }
+    }
+    if (!slab) {
+        slab = VirtualAllocExNuma(GetCurrentProcess(),
+                                  NULL,
+                                  size,
+                                  MEM_RESERVE | MEM_COMMIT,
+                                  PAGE_READWRITE,
+                                  node);
+        if (!slab)
+            return MFX_ERR_MEMORY_ALLOC;
+    }
+#else
+    #if defined(MAP_HUGETLB)
+    if (m_bUseHugePages) {
+        // huge pages reserved in the system are used first, 1 GB pages only for big slabs
+        const size_t pageSizes[] = { (size_t)1 << 30, (size_t)1 << 21 };
+        const int pageShifts[]   = { 30, 21 };
+        for (size_t i = 0; i < sizeof(pageSizes) / sizeof(pageSizes[0]) && !slab; i++) {
+            if (size < pageSizes[i] / 2)
+                continue;
+
+            size_t hugeSize = AlignSize(size, pageSizes[i]);
+            void* p         = mmap(NULL,
+                           hugeSize,
+                           PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                               (pageShifts[i] << MAP_HUGE_SHIFT),
+                           -1,
+                           0);
+            if (MAP_FAILED != p) {
+                slab       = p;
+                size       = hugeSize;
+                bHugePages = true;
+            }
+        }
+    }
+    #endif
+    if (!slab) {
+        void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == p)
+            return MFX_ERR_MEMORY_ALLOC;
+        slab = p;
+
+    #if defined(MADV_HUGEPAGE)
+        // transparent huge pages are the fallback
+        if (m_bUseHugePages)
+            bHugePages = 0 == madvise(slab, size, MADV_HUGEPAGE);
+    #endif
+    }
+
+    #if defined(SYS_mbind)
+    if (m_nNumaNode >= 0) {
+        // pages are not touched yet, so they will be allocated on the node
+        const size_t bits = 8 * sizeof(unsigned long);
+        std::vector<unsigned long> nodeMask(m_nNumaNode / bits + 1, 0);
+        nodeMask[m_nNumaNode / bits] |= 1UL << (m_nNumaNode % bits);
+
+        if (syscall(SYS_mbind,
+                    slab,
+                    size,
+                    MPOL_BIND_MODE,
+                    nodeMask.data(),
+                    nodeMask.size() * bits + 1,
+                    0)) {
+            msdk_printf(MSDK_STRING("WARNING: failed to bind surfaces to NUMA node %d\n"),
+                        m_nNumaNode);
+        }
+    }
+    #endif
+#endif
+
+    if (m_bUseHugePages && !bHugePages && !m_bHugePagesFailed) {
+        msdk_printf(MSDK_STRING("WARNING: huge pages are not available, regular pages are used\n"));
+        m_bHugePagesFailed = true;
+    }
+
+    sSlab desc = { mids, (mfxU8*)slab, size };
+    m_vSlabs.push_back(desc);
+
+    *ptr = (mfxU8*)slab;
+    return MFX_ERR_NONE;
+}
+
+void SysMemFrameAllocator::FreeSlab(const sSlab& slab) {
+#if defined(_WIN32) || defined(_WIN64)
+    VirtualFree(slab.ptr, 0, MEM_RELEASE);
+#else
+    munmap(slab.ptr, slab.size);
+#endif
+}
+
 static mfxU32 GetSurfaceSize(mfxU32 FourCC, mfxU32 Width2, mfxU32 Height2) {
     mfxU32 nbytes = 0;
 
@@ -356,10 +522,28 @@ mfxStatus SysMemFrameAllocator::ReallocImpl(mfxMemId mid,
         return MFX_ERR_UNSUPPORTED;
 
     // pointer to the record in m_mids structure
-    mfxMemId* pmid = GetMidHolder(mid);
+    mfxMemId* mids = NULL;
+    mfxMemId* pmid = GetMidHolder(mid, &mids);
     if (!pmid)
         return MFX_ERR_MEMORY_ALLOC;
 
+    if (m_bUseSlab) {
+        // old frame stays in its slab until the response is released
+        mfxU8* slab   = NULL;
+        mfxStatus sts = AllocSlab(AlignSize(SLAB_HEADER_SIZE + nbytes, SLAB_FRAME_ALIGNMENT),
+                                  mids,
+                                  &slab);
+        if (MFX_ERR_NONE != sts)
+            return sts;
+
+        sFrame* fs = (sFrame*)slab;
+        fs->id     = ID_FRAME;
+        fs->info   = *info;
+
+        *pmid = *midOut = fs;
+        return MFX_ERR_NONE;
+    }
+
     mfxStatus sts = m_pBufferAllocator->Free(m_pBufferAllocator->pthis, *pmid);
     if (MFX_ERR_NONE != sts)
         return sts;
@@ -399,6 +583,30 @@ mfxStatus SysMemFrameAllocator::AllocImpl(mfxFrameAllocRequest* request,
 
     std::unique_ptr<mfxMemId[]> mids(new mfxMemId[request->NumFrameSuggested]);
 
+    if (m_bUseSlab) {
+        // all frames of the request are placed one by one into one slab
+        size_t frameSize = AlignSize(SLAB_HEADER_SIZE + nbytes, SLAB_FRAME_ALIGNMENT);
+        mfxU8* slab      = NULL;
+
+        mfxStatus sts = AllocSlab(frameSize * request->NumFrameSuggested, mids.get(), &slab);
+        if (MFX_ERR_NONE != sts)
+            return MFX_ERR_MEMORY_ALLOC;
+
+        for (numAllocated = 0; numAllocated < request->NumFrameSuggested; numAllocated++) {
+            sFrame* fs = (sFrame*)(slab + frameSize * numAllocated);
+            fs->id     = ID_FRAME;
+            fs->info   = request->Info;
+
+            mids[numAllocated] = fs;
+        }
+
+        response->NumFrameActual = (mfxU16)numAllocated;
+        response->mids           = mids.release();
+
+        m_vResp.push_back(response);
+        return MFX_ERR_NONE;
+    }
+
     // allocate frames
     for (numAllocated = 0; numAllocated < request->NumFrameSuggested; numAllocated++) {
         mfxStatus sts = m_pBufferAllocator->Alloc(m_pBufferAllocator->pthis,
@@ -444,7 +652,18 @@ mfxStatus SysMemFrameAllocator::ReleaseResponse(mfxFrameAllocResponse* response)
 
     mfxStatus sts = MFX_ERR_NONE;
 
-    if (response->mids) {
+    if (m_bUseSlab) {
+        for (auto it = m_vSlabs.begin(); it != m_vSlabs.end();) {
+            if (it->mids == response->mids) {
+                FreeSlab(*it);
+                it = m_vSlabs.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+    else if (response->mids) {
         for (mfxU32 i = 0; i < response->NumFrameActual; i++) {
             if (response->mids[i]) {
                 sts = m_pBufferAllocator->Free(m_pBufferAllocator->pthis, response->mids[i]);
@@ -377,7 +377,13 @@ void VPLImplementationLoader::SetMinVersion(mfxVersion const& version) {
     m_MinVersion = version;
 }
 
+std::recursive_mutex& VPLImplementationLoader::GetMutex() {
+    return m_mutex;
+}
+
 mfxStatus MainVideoSession::CreateSession(VPLImplementationLoader* Loader) {
+    std::lock_guard<std::recursive_mutex> lock(Loader->GetMutex());
+
     mfxStatus sts      = MFXCreateSession(Loader->GetLoader(), Loader->GetImplIndex(), &m_session);
     mfxVersion version = Loader->GetVersion();
     msdk_printf(MSDK_STRING("Loaded Library Version: %d.%d \n"), version.Major, version.Minor);
@@ -111,6 +111,8 @@ struct sInputParams {
 
     msdk_char strSrcFile[MSDK_MAX_FILENAME_LEN];
     msdk_char strDstFile[MSDK_MAX_FILENAME_LEN];
+    bool bShmInput; // strSrcFile is a shared memory ring of encoded frames
+    bool bShmOutput; // strDstFile is a shared memory ring of decoded frames
 
     bool bDisableFilmGrain;
 };
@@ -208,7 +210,7 @@ protected: // functions
     virtual mfxStatus ReallocCurrentSurface(const mfxFrameInfo& info);
 
 protected: // variables
-    CSmplYUVWriter m_FileWriter;
+    std::unique_ptr<CSmplYUVWriter> m_FileWriter;
     std::unique_ptr<CSmplBitstreamReader> m_FileReader;
     mfxBitstreamWrapper m_mfxBS; // contains encoded data
     mfxU64 totalBytesProcessed;
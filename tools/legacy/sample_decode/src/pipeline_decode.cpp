@@ -18,6 +18,7 @@
 #include <ctime>
 #include <thread>
 #include "pipeline_decode.h"
+#include "shm_transport.h"
 #include "sysmem_allocator.h"
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -47,7 +48,7 @@
 #endif
 
 CDecodingPipeline::CDecodingPipeline()
-        : m_FileWriter(),
+        : m_FileWriter(new CSmplYUVWriter()),
           m_FileReader(),
           m_mfxBS(8 * 1024 * 1024),
           totalBytesProcessed(0),
@@ -171,6 +172,10 @@ mfxStatus CDecodingPipeline::Init(sInputParams* pParams) {
         }
     }
 
+    // frames arrive one per slot, so latency modes above work with it too
+    if (pParams->bShmInput)
+        m_FileReader.reset(new CShmBitstreamReader());
+
     if (pParams->fourcc)
         m_fourcc = pParams->fourcc;
 
@@ -395,8 +400,10 @@ mfxStatus CDecodingPipeline::Init(sInputParams* pParams) {
 
     if (m_eWorkMode == MODE_FILE_DUMP) {
         // prepare YUV file writer
-        sts = m_FileWriter.Init(pParams->strDstFile, pParams->numViews);
-        MSDK_CHECK_STATUS(sts, "m_FileWriter.Init failed");
+        if (pParams->bShmOutput)
+            m_FileWriter.reset(new CShmYUVWriter());
+        sts = m_FileWriter->Init(pParams->strDstFile, pParams->numViews);
+        MSDK_CHECK_STATUS(sts, "m_FileWriter->Init failed");
     }
     else if ((m_eWorkMode != MODE_PERFORMANCE) && (m_eWorkMode != MODE_RENDERING)) {
         msdk_printf(MSDK_STRING("error: unsupported work mode\n"));
@@ -492,7 +499,7 @@ void CDecodingPipeline::Close() {
     DeallocateExtMVCBuffers();
 
     m_mfxSession.Close();
-    m_FileWriter.Close();
+    m_FileWriter->Close();
     if (m_FileReader.get())
         m_FileReader->Close();
 
@@ -1288,7 +1295,7 @@ void CDecodingPipeline::DeleteAllocator() {
 }
 
 void CDecodingPipeline::SetMultiView() {
-    m_FileWriter.SetMultiView();
+    m_FileWriter->SetMultiView();
     m_bIsMVC = true;
 }
 
@@ -1395,7 +1402,7 @@ mfxStatus CDecodingPipeline::DeliverOutput(mfxFrameSurface1* frame) {
     }
 
     if (m_bResetFileWriter) {
-        sts = m_FileWriter.Reset();
+        sts = m_FileWriter->Reset();
         MSDK_CHECK_STATUS(sts, "");
         m_bResetFileWriter = false;
     }
@@ -1406,8 +1413,8 @@ mfxStatus CDecodingPipeline::DeliverOutput(mfxFrameSurface1* frame) {
                                             frame->Data.MemId,
                                             &(frame->Data));
             if (MFX_ERR_NONE == res) {
-                res = m_bOutI420 ? m_FileWriter.WriteNextFrameI420(frame)
-                                 : m_FileWriter.WriteNextFrame(frame);
+                res = m_bOutI420 ? m_FileWriter->WriteNextFrameI420(frame)
+                                 : m_FileWriter->WriteNextFrame(frame);
                 sts = m_pGeneralAllocator->Unlock(m_pGeneralAllocator->pthis,
                                                   frame->Data.MemId,
                                                   &(frame->Data));
@@ -1425,8 +1432,8 @@ mfxStatus CDecodingPipeline::DeliverOutput(mfxFrameSurface1* frame) {
         }
     }
     else {
-        res = m_bOutI420 ? m_FileWriter.WriteNextFrameI420(frame)
-                         : m_FileWriter.WriteNextFrame(frame);
+        res = m_bOutI420 ? m_FileWriter->WriteNextFrameI420(frame)
+                         : m_FileWriter->WriteNextFrame(frame);
     }
 
     m_fpsLimiter.Work();
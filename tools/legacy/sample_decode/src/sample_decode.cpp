@@ -76,6 +76,10 @@ void PrintHelp(msdk_char* strAppName, const msdk_char* strErrorMessage) {
 #endif
     msdk_printf(MSDK_STRING(
         "   [-disable_film_grain] - disable film grain application(valid only for av1)\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-i::shm name]        - reads encoded frames from shared memory ring created by another sample (e.g. sample_encode -o::shm)\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-o::shm name]        - writes decoded frames to shared memory ring instead of the output file\n"));
     msdk_printf(MSDK_STRING("\n"));
     msdk_printf(MSDK_STRING("JPEG Chroma Type:\n"));
     msdk_printf(MSDK_STRING("   [-jpeg_rgb] - RGB Chroma Type\n"));
@@ -639,6 +643,23 @@ mfxStatus ParseInputString(msdk_char* strInput[], mfxU8 nArgNum, sInputParams* p
         else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-disable_film_grain"))) {
             pParams->bDisableFilmGrain = true;
         }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-i::shm"))) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], MSDK_STRING("Not enough parameters for -i::shm key"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            msdk_opt_read(strInput[++i], pParams->strSrcFile);
+            pParams->bShmInput = true;
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-o::shm"))) {
+            if (i + 1 >= nArgNum) {
+                PrintHelp(strInput[0], MSDK_STRING("Not enough parameters for -o::shm key"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            msdk_opt_read(strInput[++i], pParams->strDstFile);
+            pParams->mode       = MODE_FILE_DUMP;
+            pParams->bShmOutput = true;
+        }
         else // 1-character options
         {
             switch (strInput[i][1]) {
@@ -687,6 +708,11 @@ mfxStatus ParseInputString(msdk_char* strInput[], mfxU8 nArgNum, sInputParams* p
         return MFX_ERR_UNSUPPORTED;
     }
 
+    if (pParams->bShmOutput && pParams->outI420) {
+        PrintHelp(strInput[0], MSDK_STRING("-o::shm doesn't support I420 output"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
     if (MFX_CODEC_MPEG2 != pParams->videoType && MFX_CODEC_AVC != pParams->videoType &&
         MFX_CODEC_HEVC != pParams->videoType && MFX_CODEC_VC1 != pParams->videoType &&
         MFX_CODEC_JPEG != pParams->videoType && MFX_CODEC_VP8 != pParams->videoType &&
@@ -36,6 +36,7 @@
     #include "v4l2_util.h"
 #endif
 
+#include "brc_frame_analyzer.h"
 #include "brc_routines.h"
 
 #if defined(_WIN64) || defined(_WIN32)
@@ -151,6 +152,7 @@ struct sInputParams {
     mfxU16 nGPB;
     mfxU16 nTransformSkip;
     ExtBRCType nExtBRC;
+    mfxU16 nExtBRCLookAhead; // frames analyzed ahead of the encoder for -extbrc:on, 0 - off
     mfxU16 nAdaptiveMaxFrameSize;
 
     mfxU16 WeightedPred;
@@ -166,6 +168,16 @@ struct sInputParams {
 
     mfxU32 nTimeout;
     mfxU16 nPerfOpt; // size of pre-load buffer which used for loop encode
+    bool bPreload; // keep raw input in memory and replay it from there
+    mfxU32 nPreloadFrames; // frames kept in memory, 0 - whole file
+    mfxU32 nPreloadLoops; // passes over preloaded frames, 0 - infinite
+    bool bPreloadTimeStamps; // rewrite time stamps of replayed frames
+    mfxU32 nPrefetchFrames; // input frames read ahead per file on background threads
+    bool bZeroCopyInput; // encode directly from the mapped input, no copy into surfaces
+    bool bShmInput; // input file name is a shared memory ring of raw frames
+    bool bShmOutput; // output file name is a shared memory ring of encoded frames
+    BitstreamSinkType OutSinkType; // how encoded data is written to the output file
+    mfxU32 nOutSinkBufferSize; // sink buffer size in bytes, 0 - default
     mfxU16 nMaxFPS; // limits overall fps
 
     mfxU32 nSyncOpTimeout; // SyncOperation timeout in msec
@@ -263,7 +275,11 @@ struct sTask {
     sTask();
     mfxStatus WriteBitstream(bool isCompleteFrame = true);
     mfxStatus Reset();
-    mfxStatus Init(mfxU32 nBufferSize, mfxU32 nCodecID, void* pWriter = NULL, bool bHWLib = false);
+    mfxStatus Init(mfxU32 nBufferSize,
+                   mfxU32 nCodecID,
+                   void* pWriter           = NULL,
+                   bool bHWLib             = false,
+                   CBitstreamArena* pArena = NULL);
     mfxStatus Close();
 };
 
@@ -301,6 +317,8 @@ protected:
     sTask* m_pTasks;
     mfxU32 m_nPoolSize;
     mfxU32 m_nTaskBufferStart;
+    // output buffers of all tasks
+    CBitstreamArena m_BitstreamArena;
 
     bool m_bGpuHangRecovery;
 
@@ -345,7 +363,9 @@ public:
 protected:
     std::pair<CSmplBitstreamWriter*, CSmplBitstreamWriter*> m_FileWriters;
     std::pair<CIVFFrameWriter*, CIVFFrameWriter*> m_IVFFileWriters;
-    CSmplYUVReader m_FileReader;
+    CPreloadedYUVReader m_FileReader;
+    std::unique_ptr<CExternalFrameSource> m_pExternalSource; // frames imported without a copy
+    std::unique_ptr<CBRCFrameAnalyzer> m_pBRCAnalyzer; // lookahead for sample ExtBRC
     CEncTaskPool m_TaskPool;
     QPFile::Reader m_QPFileReader;
 
@@ -355,6 +375,8 @@ protected:
     MFXVideoVPP* m_pmfxVPP;
 
     bool m_bNoOutFile;
+    BitstreamSinkType m_OutSinkType;
+    mfxU32 m_nOutSinkBufferSize;
 
     MfxVideoParamsWrapper m_mfxEncParams;
     MfxVideoParamsWrapper m_mfxVppParams;
@@ -443,6 +465,7 @@ protected:
 
     virtual mfxStatus AllocFrames();
     virtual void DeleteFrames();
+    virtual void ReleaseUnlockedFrames();
 
     virtual mfxU32 GetSufficientBufferSize();
     virtual mfxStatus AllocateSufficientBuffer(mfxBitstreamWrapper& bs);
@@ -7,6 +7,11 @@
 #ifndef __PIPELINE_REGION_ENCODE_H__
 #define __PIPELINE_REGION_ENCODE_H__
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "pipeline_encode.h"
 
 #ifndef MFX_VERSION
@@ -21,7 +26,6 @@ public:
 
     MainVideoSession Session;
     MFXVideoENCODE* pEncoder;
-    CEncTaskPool TaskPool;
 };
 
 class CResourcesPool {
@@ -40,17 +44,14 @@ public:
         return m_size;
     }
 
+    mfxU32 GetSyncOpTimeout() const {
+        return m_nSyncOpTimeout;
+    }
+
     mfxStatus Init(int size, VPLImplementationLoader* Loader, mfxU32 nSyncOpTimeout);
-    mfxStatus InitTaskPools(CSmplBitstreamWriter* pWriter,
-                            mfxU32 nPoolSize,
-                            mfxU32 nBufferSize,
-                            mfxU32 CodecId,
-                            void* pOtherWriter = NULL,
-                            bool bUseHWLib     = false);
     mfxStatus CreateEncoders();
     mfxStatus CreatePlugins(mfxPluginUID pluginGUID, mfxChar* pluginPath);
 
-    mfxStatus GetFreeTask(int resourceNum, sTask** ppTask);
     void CloseAndDeleteEverything();
 
 protected:
@@ -68,7 +69,10 @@ private:
     }
 };
 
-/* This class implements a pipeline with 2 mfx components: vpp (video preprocessing) and encode */
+/* This class implements a pipeline with 2 mfx components: vpp (video preprocessing) and encode.
+   Every region is encoded by its own session on a separate worker thread. Main thread loads frames
+   and publishes them into a ring of frame slots, workers put encoded regions into the slot of
+   their output frame and the stitcher thread writes complete frames in region order. */
 class CRegionEncodingPipeline : public CEncodingPipeline {
 public:
     CRegionEncodingPipeline();
@@ -85,9 +89,65 @@ public:
     }
 
 protected:
-    mfxI64 m_timeAll;
+    // frame which is loaded, encoded by region workers or being written
+    struct RegionFrameSlot {
+        RegionFrameSlot()
+                : pSurface(NULL),
+                  bInsertIDR(false),
+                  bResetWriters(false),
+                  pRegions(),
+                  nReady(0),
+                  nEncodeTime(0) {}
+
+        mfxFrameSurface1* pSurface; // input, set before the frame is published
+        bool bInsertIDR;
+        bool bResetWriters;
+        std::unique_ptr<sTask[]> pRegions; // output of every region
+        std::atomic<mfxU32> nReady; // number of regions with output
+        std::atomic<mfxI64> nEncodeTime; // ticks of the slowest region to encode the frame
+    };
+
+    // one frame is loaded while the next one is encoded and the previous one is written
+    static const mfxU32 REGION_FRAMES_IN_FLIGHT = 3;
+
+    mfxI64 m_timeAll; // sum of per frame encode times, written by the stitcher
     CResourcesPool m_resources;
 
+    std::unique_ptr<RegionFrameSlot[]> m_pSlots;
+    // regions which haven't synced the frame of the surface yet, surface is shared by
+    // all region sessions, so its Data.Locked can't tell when it is free
+    std::unique_ptr<std::atomic<mfxU32>[]> m_pSurfInUse;
+    std::atomic<mfxU32> m_nFramesPublished;
+    std::atomic<mfxU32> m_nFramesWritten;
+    std::atomic<bool> m_bInputDone;
+    std::atomic<bool> m_bAbort;
+    std::atomic<int> m_nActiveWorkers;
+    mfxStatus m_threadSts; // first error of the worker threads
+    std::mutex m_waitMutex;
+    std::condition_variable m_waitCond;
+
+    mfxStatus InitRegionSlots(mfxU32 nBufferSize, mfxU32 CodecId, bool bUseHWLib);
+    mfxU16 GetFreeRegionSurface();
+
+    void RegionWorkerRoutine(int regId);
+    void StitcherRoutine();
+    mfxStatus EncodeRegionFrames(int regId);
+    mfxStatus EncodeRegionFrame(int regId, sTask& task, mfxFrameSurface1* pSurf);
+    mfxStatus StitchRegionFrames();
+
+    void Abort(mfxStatus sts);
+    // wakes up waiters, called after every change they wait for: a frame is published,
+    // submitted, synced or written, a worker exits or the pipeline is aborted
+    void Notify();
+    // blocks until pred is true or pipeline is aborted
+    template <typename Pred>
+    void WaitFor(Pred pred) {
+        std::unique_lock<std::mutex> lock(m_waitMutex);
+        m_waitCond.wait(lock, [&]() {
+            return m_bAbort || pred();
+        });
+    }
+
     virtual mfxStatus InitMfxEncParams(sInputParams* pParams);
 
     virtual mfxStatus CreateAllocator();
@@ -24,6 +24,7 @@
 #endif
 
 #include "sample_utils.h"
+#include "shm_transport.h"
 
 #if defined(ENABLE_V4L2_SUPPORT)
     #include <pthread.h>
@@ -77,7 +78,8 @@ CEncTaskPool::CEncTaskPool()
         : firstOut_total(0),
           firstOut_start(0),
           lastOut_total(0),
-          lastOut_start(0) {
+          lastOut_start(0),
+          m_BitstreamArena() {
     m_pTasks           = NULL;
     m_pmfxSession      = NULL;
     m_nTaskBufferStart = 0;
@@ -120,19 +122,23 @@ mfxStatus CEncTaskPool::Init(MFXVideoSession* pmfxSession,
     m_pTasks = new sTask[m_nPoolSize];
     MSDK_CHECK_POINTER(m_pTasks, MFX_ERR_MEMORY_ALLOC);
 
-    mfxStatus sts = MFX_ERR_NONE;
+    // one slot per task, slots are given back when a task needs bigger buffer
+    mfxStatus sts = m_BitstreamArena.Init(m_nPoolSize, nBufferSize);
+    MSDK_CHECK_STATUS(sts, "m_BitstreamArena.Init failed");
+
+    CBitstreamArena* pArena = &m_BitstreamArena;
 
     if (pOtherWriter) // 2 bitstreams on output
     {
         for (mfxU32 i = 0; i < m_nPoolSize; i += 2) {
-            sts = m_pTasks[i + 0].Init(nBufferSize, nCodecID, pWriter, bUseHWLib);
-            sts = m_pTasks[i + 1].Init(nBufferSize, nCodecID, pOtherWriter, bUseHWLib);
+            sts = m_pTasks[i + 0].Init(nBufferSize, nCodecID, pWriter, bUseHWLib, pArena);
+            sts = m_pTasks[i + 1].Init(nBufferSize, nCodecID, pOtherWriter, bUseHWLib, pArena);
             MSDK_CHECK_STATUS(sts, "m_pTasks[i+1].Init failed");
         }
     }
     else {
         for (mfxU32 i = 0; i < m_nPoolSize; i++) {
-            sts = m_pTasks[i].Init(nBufferSize, nCodecID, pWriter, bUseHWLib);
+            sts = m_pTasks[i].Init(nBufferSize, nCodecID, pWriter, bUseHWLib, pArena);
             MSDK_CHECK_STATUS(sts, "m_pTasks[i].Init failed");
         }
     }
@@ -276,6 +282,8 @@ void CEncTaskPool::Close() {
     }
 
     MSDK_SAFE_DELETE_ARRAY(m_pTasks);
+    // tasks are deleted, so nobody refers to the arena
+    m_BitstreamArena.Close();
 
     m_pmfxSession      = NULL;
     m_nTaskBufferStart = 0;
@@ -293,7 +301,11 @@ void CEncTaskPool::ClearTasks() {
     m_nTaskBufferStart = 0;
 }
 
-mfxStatus sTask::Init(mfxU32 nBufferSize, mfxU32 nCodecID, void* pwriter, bool bHWLib) {
+mfxStatus sTask::Init(mfxU32 nBufferSize,
+                      mfxU32 nCodecID,
+                      void* pwriter,
+                      bool bHWLib,
+                      CBitstreamArena* pArena) {
     Close();
 
     pWriter       = pwriter;
@@ -301,6 +313,7 @@ mfxStatus sTask::Init(mfxU32 nBufferSize, mfxU32 nCodecID, void* pwriter, bool b
     bUseHWLib     = bHWLib;
     mfxStatus sts = Reset();
     MSDK_CHECK_STATUS(sts, "Reset failed");
+    mfxBS.SetArena(pArena);
     mfxBS.Extend(nBufferSize);
 
     return sts;
@@ -653,8 +666,23 @@ mfxStatus CEncodingPipeline::InitMfxEncParams(sInputParams* pInParams) {
     // This is for explicit extbrc only. In case of implicit (built-into-library) version - we don't need this extended buffer
     if (pInParams->nExtBRC == EXTBRC_ON &&
         (pInParams->CodecId == MFX_CODEC_HEVC || pInParams->CodecId == MFX_CODEC_AVC)) {
+        if (pInParams->nExtBRCLookAhead) {
+            // analyzer takes frames the encoder gets, so they must come from the reader as is
+            if (m_pmfxVPP || (MVC_ENABLED & m_MVCflags) || m_bExternalAlloc ||
+                !CBRCFrameAnalyzer::IsSupported(m_mfxEncParams.mfx.FrameInfo.FourCC)) {
+                msdk_printf(MSDK_STRING(
+                    "ERROR: ExtBRC lookahead doesn't support VPP, MVC, video memory and this color format\n"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+
+            m_pBRCAnalyzer.reset(new CBRCFrameAnalyzer);
+            mfxStatus sts =
+                m_pBRCAnalyzer->Init(m_mfxEncParams.mfx.FrameInfo, pInParams->nExtBRCLookAhead);
+            MSDK_CHECK_STATUS(sts, "m_pBRCAnalyzer->Init failed");
+        }
+
         auto extBRC = m_mfxEncParams.AddExtBuffer<mfxExtBRC>();
-        HEVCExtBRC::Create(*extBRC);
+        HEVCExtBRC::Create(*extBRC, m_pBRCAnalyzer.get());
     }
 
     // set up mfxCodingOption3
@@ -981,9 +1009,15 @@ mfxStatus CEncodingPipeline::AllocFrames() {
             MFX_MEMTYPE_FROM_VPPOUT; // surfaces are shared between vpp output and encode input
     }
 
-    // alloc frames for encoder
-    sts = m_pMFXAllocator->Alloc(m_pMFXAllocator->pthis, &EncRequest, &m_EncResponse);
-    MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Alloc failed");
+    // alloc frames for encoder, imported frames need surface structures only
+    if (m_pExternalSource) {
+        m_EncResponse                = {};
+        m_EncResponse.NumFrameActual = nEncSurfNum;
+    }
+    else {
+        sts = m_pMFXAllocator->Alloc(m_pMFXAllocator->pthis, &EncRequest, &m_EncResponse);
+        MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Alloc failed");
+    }
 
     // alloc frames for vpp if vpp is enabled
     if (m_pmfxVPP) {
@@ -1013,6 +1047,9 @@ mfxStatus CEncodingPipeline::AllocFrames() {
         if (m_bExternalAlloc) {
             m_pEncSurfaces[i].Data.MemId = m_EncResponse.mids[i];
         }
+        else if (m_pExternalSource) {
+            // planes are pointed at imported frames by LoadNextFrame
+        }
         else {
             // get YUV pointers
             sts = m_pMFXAllocator->Lock(m_pMFXAllocator->pthis,
@@ -1183,14 +1220,32 @@ mfxStatus CEncodingPipeline::CreateAllocator() {
     return MFX_ERR_NONE;
 }
 
+void CEncodingPipeline::ReleaseUnlockedFrames() {
+    if (!m_pExternalSource || !m_pEncSurfaces)
+        return;
+
+    // encoder doesn't reference these surfaces anymore, return their frames to the owner
+    for (int i = 0; i < m_EncResponse.NumFrameActual; i++) {
+        if (0 == m_pEncSurfaces[i].Data.Locked)
+            m_pExternalSource->ReleaseFrame(&m_pEncSurfaces[i]);
+    }
+}
+
 void CEncodingPipeline::DeleteFrames() {
+    // return imported frames to their owner
+    if (m_pExternalSource && m_pEncSurfaces) {
+        for (int i = 0; i < m_EncResponse.NumFrameActual; i++)
+            m_pExternalSource->ReleaseFrame(&m_pEncSurfaces[i]);
+    }
+
     // delete surfaces array
     MSDK_SAFE_DELETE_ARRAY(m_pEncSurfaces);
     MSDK_SAFE_DELETE_ARRAY(m_pVppSurfaces);
 
     // delete frames
     if (m_pMFXAllocator) {
-        m_pMFXAllocator->Free(m_pMFXAllocator->pthis, &m_EncResponse);
+        if (m_EncResponse.mids)
+            m_pMFXAllocator->Free(m_pMFXAllocator->pthis, &m_EncResponse);
         m_pMFXAllocator->Free(m_pMFXAllocator->pthis, &m_VppResponse);
     }
 }
@@ -1223,6 +1278,8 @@ CEncodingPipeline::CEncodingPipeline()
           m_pmfxENC(NULL),
           m_pmfxVPP(NULL),
           m_bNoOutFile(false),
+          m_OutSinkType(SINK_STDIO),
+          m_nOutSinkBufferSize(0),
           m_mfxEncParams(),
           m_mfxVppParams(),
           m_MVCflags(MVC_DISABLED),
@@ -1279,6 +1336,7 @@ mfxStatus CEncodingPipeline::InitIVFFileWriter(CIVFFrameWriter** ppWriter,
     MSDK_SAFE_DELETE(*ppWriter);
     *ppWriter = new CIVFFrameWriter;
     MSDK_CHECK_POINTER(*ppWriter, MFX_ERR_MEMORY_ALLOC);
+    (*ppWriter)->SetSinkParams(m_OutSinkType, m_nOutSinkBufferSize);
     mfxStatus sts = MFX_ERR_NONE;
 
     if (no_outfile) {
@@ -1301,6 +1359,7 @@ mfxStatus CEncodingPipeline::InitFileWriter(CSmplBitstreamWriter** ppWriter,
     MSDK_SAFE_DELETE(*ppWriter);
     *ppWriter = new CSmplBitstreamWriter;
     MSDK_CHECK_POINTER(*ppWriter, MFX_ERR_MEMORY_ALLOC);
+    (*ppWriter)->SetSinkParams(m_OutSinkType, m_nOutSinkBufferSize);
     mfxStatus sts = (*ppWriter)->Init(filename);
     MSDK_CHECK_STATUS(sts, " failed");
 
@@ -1315,6 +1374,7 @@ mfxStatus CEncodingPipeline::InitFileWriter(CSmplBitstreamWriter** ppWriter,
     MSDK_SAFE_DELETE(*ppWriter);
     *ppWriter = new CSmplBitstreamWriter;
     MSDK_CHECK_POINTER(*ppWriter, MFX_ERR_MEMORY_ALLOC);
+    (*ppWriter)->SetSinkParams(m_OutSinkType, m_nOutSinkBufferSize);
 
     mfxStatus sts = MFX_ERR_NONE;
 
@@ -1336,6 +1396,9 @@ mfxStatus CEncodingPipeline::InitFileWriters(sInputParams* pParams) {
 
     mfxStatus sts = MFX_ERR_NONE;
 
+    m_OutSinkType        = pParams->OutSinkType;
+    m_nOutSinkBufferSize = pParams->nOutSinkBufferSize;
+
     // no output mode
     if (!pParams->dstFileBuff.size()) {
         // do nothing but preventing from assertion by 0 vector size in following process
@@ -1366,6 +1429,7 @@ mfxStatus CEncodingPipeline::InitFileWriters(sInputParams* pParams) {
 
         // init first duplicate writer
         MSDK_CHECK_POINTER(first.get(), MFX_ERR_MEMORY_ALLOC);
+        first->SetSinkParams(m_OutSinkType, m_nOutSinkBufferSize);
         sts = first->Init(pParams->dstFileBuff[0]);
         MSDK_CHECK_STATUS(sts, "first->Init failed");
         sts = first->InitDuplicate(pParams->dstFileBuff[2]);
@@ -1374,6 +1438,7 @@ mfxStatus CEncodingPipeline::InitFileWriters(sInputParams* pParams) {
         // init second duplicate writer
         std::unique_ptr<CSmplBitstreamDuplicateWriter> second(new CSmplBitstreamDuplicateWriter);
         MSDK_CHECK_POINTER(second.get(), MFX_ERR_MEMORY_ALLOC);
+        second->SetSinkParams(m_OutSinkType, m_nOutSinkBufferSize);
         sts = second->Init(pParams->dstFileBuff[1]);
         MSDK_CHECK_STATUS(sts, "second->Init failed");
         sts = second->JoinDuplicate(first.get());
@@ -1384,7 +1449,13 @@ mfxStatus CEncodingPipeline::InitFileWriters(sInputParams* pParams) {
     }
     // not ViewOutput mode
     else {
-        if (pParams->CodecId == MFX_CODEC_AV1 && pParams->bUseHWLib == false) {
+        if (pParams->bShmOutput && !m_bNoOutFile) {
+            MSDK_SAFE_DELETE(m_FileWriters.first);
+            CShmBitstreamWriter* pWriter = new CShmBitstreamWriter;
+            m_FileWriters.first          = pWriter;
+            sts                          = pWriter->Init(pParams->dstFileBuff[0]);
+        }
+        else if (pParams->CodecId == MFX_CODEC_AV1 && pParams->bUseHWLib == false) {
             mfxU32 fr_nom, fr_denom;
             ConvertFrameRate(pParams->dFrameRate, &fr_nom, &fr_denom);
             sts = InitIVFFileWriter(&m_IVFFileWriters.first,
@@ -1561,8 +1632,31 @@ mfxStatus CEncodingPipeline::Init(sInputParams* pParams) {
     }
 
     // Preparing readers and writers
-    if (!isV4L2InputEnabled) {
+    if (pParams->bZeroCopyInput) {
+        // surfaces point at the input data directly, so it must be in the encoder format
+        if (m_pmfxVPP || readerShift || pParams->FileInputFourCC != pParams->EncodeFourCC) {
+            msdk_printf(MSDK_STRING(
+                "ERROR: zero-copy input requires input in the encoder color format and size, without VPP\n"));
+            return MFX_ERR_UNSUPPORTED;
+        }
+
+        if (pParams->bShmInput) {
+            CShmFrameSource* pSource = new CShmFrameSource();
+            m_pExternalSource.reset(pSource);
+            sts = pSource->Init(pParams->InputFiles.front());
+            MSDK_CHECK_STATUS(sts, "CShmFrameSource::Init failed");
+        }
+        // mapped input is opened below, once the encoder surface size is known
+    }
+    else if (!isV4L2InputEnabled) {
         // prepare input file reader
+        if (pParams->bPreload)
+            m_FileReader.SetPreloadParams(pParams->nPreloadFrames,
+                                          pParams->nPreloadLoops,
+                                          pParams->bPreloadTimeStamps);
+        if (pParams->nPrefetchFrames)
+            m_FileReader.SetPrefetchParams(pParams->nPrefetchFrames);
+
         sts = m_FileReader.Init(pParams->InputFiles, pParams->FileInputFourCC, readerShift);
         MSDK_CHECK_STATUS(sts, "m_FileReader.Init failed");
     }
@@ -1584,6 +1678,14 @@ mfxStatus CEncodingPipeline::Init(sInputParams* pParams) {
     sts = InitMfxEncParams(pParams);
     MSDK_CHECK_STATUS(sts, "InitMfxEncParams failed");
 
+    if (pParams->bZeroCopyInput && !pParams->bShmInput) {
+        // mapping depends on the aligned surface size, input frames are its crop area
+        CMappedYUVFrameSource* pSource = new CMappedYUVFrameSource();
+        m_pExternalSource.reset(pSource);
+        sts = pSource->Init(pParams->InputFiles.front(), m_mfxEncParams.mfx.FrameInfo);
+        MSDK_CHECK_STATUS(sts, "CMappedYUVFrameSource::Init failed");
+    }
+
     sts = InitMfxVppParams(pParams);
     MSDK_CHECK_STATUS(sts, "InitMfxVppParams failed");
 
@@ -1748,6 +1850,8 @@ void CEncodingPipeline::Close() {
     auto extBRC = m_mfxEncParams.GetExtBuffer<mfxExtBRC>();
     if (extBRC)
         HEVCExtBRC::Destroy(*extBRC);
+    // after the encoder, it may still wait for lookahead
+    m_pBRCAnalyzer.reset();
 
     DeallocateExtMVCBuffers();
     FreeVppFilters();
@@ -1758,6 +1862,7 @@ void CEncodingPipeline::Close() {
     m_mfxSession.Close();
 
     m_FileReader.Close();
+    m_pExternalSource.reset();
     FreeFileWriters();
 
     if (m_round_in) {
@@ -2060,6 +2165,9 @@ mfxStatus CEncodingPipeline::Run() {
         sts = GetFreeTask(&pCurrentTask);
         MSDK_BREAK_ON_ERROR(sts);
 
+        // synchronized tasks may have unlocked surfaces holding imported frames
+        ReleaseUnlockedFrames();
+
         // find free surface for encoder input
         if (m_nPerfOpt && !m_pmfxVPP) {
             nEncSurfIdx %= m_nPerfOpt;
@@ -2107,6 +2215,11 @@ mfxStatus CEncodingPipeline::Run() {
 
                 MSDK_BREAK_ON_ERROR(sts);
 
+                if (m_pBRCAnalyzer) {
+                    sts = m_pBRCAnalyzer->Submit(pSurf);
+                    MSDK_BREAK_ON_ERROR(sts);
+                }
+
                 if (m_bQPFileMode) {
                     LoadNextControl(pCtrl, nEncSurfIdx);
                 }
@@ -2385,6 +2498,17 @@ mfxStatus CEncodingPipeline::LoadNextFrame(mfxFrameSurface1* pSurf) {
             m_bInsertIDR = m_bCutOutput;
         }
     }
+    else if (m_pExternalSource) {
+        sts = m_pExternalSource->ImportFrame(pSurf);
+
+        if ((MFX_ERR_MORE_DATA == sts) && !m_bTimeOutExceed) {
+            m_pExternalSource->Reset();
+            m_bFileWriterReset = m_bCutOutput;
+            // forcedly insert idr frame to make output file readable
+            m_bInsertIDR = m_bCutOutput;
+            return sts;
+        }
+    }
     else {
         // read frame from file
         if (m_bExternalAlloc) {
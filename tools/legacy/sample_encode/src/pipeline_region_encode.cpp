@@ -27,23 +27,6 @@
     #error MFX_VERSION not defined
 #endif
 
-mfxStatus CResourcesPool::GetFreeTask(int resourceNum, sTask** ppTask) {
-    // get a pointer to a free task (bit stream and sync point for encoder)
-    mfxStatus sts = m_resources[resourceNum].TaskPool.GetFreeTask(ppTask);
-    if (MFX_ERR_NOT_FOUND == sts) {
-        // We should syncrhonize every first task in all task pools to write regions (slices) into destination in correct order
-        for (int i = 0; i < m_size; i++) {
-            sts = m_resources[i].TaskPool.SynchronizeFirstTask(m_nSyncOpTimeout);
-            MSDK_CHECK_STATUS(sts, "m_resources[i].TaskPool.SynchronizeFirstTask failed");
-        }
-
-        // try again
-        sts = m_resources[resourceNum].TaskPool.GetFreeTask(ppTask);
-    }
-
-    return sts;
-}
-
 mfxStatus CResourcesPool::Init(int sz, VPLImplementationLoader* Loader, mfxU32 nSyncOpTimeout) {
     MSDK_CHECK_NOT_EQUAL(m_resources, NULL, MFX_ERR_INVALID_HANDLE);
     m_size           = sz;
@@ -57,26 +40,6 @@ mfxStatus CResourcesPool::Init(int sz, VPLImplementationLoader* Loader, mfxU32 n
     return MFX_ERR_NONE;
 }
 
-mfxStatus CResourcesPool::InitTaskPools(CSmplBitstreamWriter* pWriter,
-                                        mfxU32 nPoolSize,
-                                        mfxU32 nBufferSize,
-                                        mfxU32 CodecId,
-                                        void* pOtherWriter,
-                                        bool bUseHWLib) {
-    for (int i = 0; i < m_size; i++) {
-        mfxStatus sts = m_resources[i].TaskPool.Init(&m_resources[i].Session,
-                                                     pWriter,
-                                                     nPoolSize,
-                                                     nBufferSize,
-                                                     CodecId,
-                                                     pOtherWriter,
-                                                     bUseHWLib);
-
-        MSDK_CHECK_STATUS(sts, "m_resources[i].TaskPool.Init failed");
-    }
-    return MFX_ERR_NONE;
-}
-
 mfxStatus CResourcesPool::CreateEncoders() {
     for (int i = 0; i < m_size; i++) {
         MFXVideoENCODE* pEnc = new MFXVideoENCODE(m_resources[i].Session);
@@ -88,7 +51,6 @@ mfxStatus CResourcesPool::CreateEncoders() {
 
 void CResourcesPool::CloseAndDeleteEverything() {
     for (int i = 0; i < m_size; i++) {
-        m_resources[i].TaskPool.Close();
         MSDK_SAFE_DELETE(m_resources[i].pEncoder);
         m_resources[i].Session.Close();
     }
@@ -252,9 +214,20 @@ mfxStatus CRegionEncodingPipeline::CreateAllocator() {
     return MFX_ERR_NONE;
 }
 
-CRegionEncodingPipeline::CRegionEncodingPipeline() : CEncodingPipeline() {
-    m_timeAll = 0;
-}
+CRegionEncodingPipeline::CRegionEncodingPipeline()
+        : CEncodingPipeline(),
+          m_timeAll(0),
+          m_resources(),
+          m_pSlots(),
+          m_pSurfInUse(),
+          m_nFramesPublished(0),
+          m_nFramesWritten(0),
+          m_bInputDone(false),
+          m_bAbort(false),
+          m_nActiveWorkers(0),
+          m_threadSts(MFX_ERR_NONE),
+          m_waitMutex(),
+          m_waitCond() {}
 
 CRegionEncodingPipeline::~CRegionEncodingPipeline() {
     Close();
@@ -297,13 +270,16 @@ mfxStatus CRegionEncodingPipeline::Init(sInputParams* pParams) {
         sts = m_pLoader->EnumImplementations();
         MSDK_CHECK_STATUS(sts, "m_mfxSession.EnumImplementations failed");
 
-        sts = m_resources.Init(pParams->nNumSlice, m_pLoader.get(), pParams->nSyncOpTimeout);
+        sts = m_resources.Init(pParams->nNumSlice,
+                               m_pLoader.get(),
+                               pParams->nSyncOpTimeout ? pParams->nSyncOpTimeout
+                                                       : MSDK_WAIT_INTERVAL);
         MSDK_CHECK_STATUS(sts, "m_resources.Init failed");
     }
 
     mfxVersion version;
-    sts = m_mfxSession.QueryVersion(&version);
-    MSDK_CHECK_STATUS(sts, "m_mfxSession.QueryVersion failed");
+    sts = m_resources[0].Session.QueryVersion(&version);
+    MSDK_CHECK_STATUS(sts, "m_resources[0].Session.QueryVersion failed");
 
     if ((pParams->MVC_flags & MVC_ENABLED) != 0 && !CheckVersion(&version, MSDK_FEATURE_MVC)) {
         msdk_printf(MSDK_STRING("error: MVC is not supported in the %d.%d API version\n"),
@@ -375,12 +351,15 @@ void CRegionEncodingPipeline::Close() {
                     m_timeAll ? frameNum * ((double)time_get_frequency()) / m_timeAll : 0);
     }
 
+    // encoders are closed first, after abort they may still reference surfaces and bitstreams
+    m_resources.CloseAndDeleteEverything();
+    m_pSlots.reset();
+    m_pSurfInUse.reset();
+
     DeallocateExtMVCBuffers();
 
     DeleteFrames();
 
-    m_resources.CloseAndDeleteEverything();
-
     m_FileReader.Close();
     FreeFileWriters();
 
@@ -404,10 +383,6 @@ mfxStatus CRegionEncodingPipeline::ResetMFXComponents(sInputParams* pParams) {
     // free allocated frames
     DeleteFrames();
 
-    for (int i = 0; i < m_resources.GetSize(); i++) {
-        m_resources[i].TaskPool.Close();
-    }
-
     sts = AllocFrames();
     MSDK_CHECK_STATUS(sts, "AllocFrames failed");
 
@@ -426,16 +401,13 @@ mfxStatus CRegionEncodingPipeline::ResetMFXComponents(sInputParams* pParams) {
         MSDK_CHECK_STATUS(sts, "m_resources[regId].pEncoder->Init failed");
     }
 
+    // every region holds its part of the frame only
     mfxU32 nEncodedDataBufferSize =
-        m_mfxEncParams.mfx.FrameInfo.Width * m_mfxEncParams.mfx.FrameInfo.Height * 4;
+        m_mfxEncParams.mfx.FrameInfo.Width * m_mfxEncParams.mfx.FrameInfo.Height * 4 /
+        m_resources.GetSize();
 
-    sts = m_resources.InitTaskPools(m_FileWriters.first,
-                                    m_mfxEncParams.AsyncDepth,
-                                    nEncodedDataBufferSize,
-                                    pParams->CodecId,
-                                    m_FileWriters.second,
-                                    pParams->bUseHWLib);
-    MSDK_CHECK_STATUS(sts, "m_resources.InitTaskPools failed");
+    sts = InitRegionSlots(nEncodedDataBufferSize, pParams->CodecId, pParams->bUseHWLib);
+    MSDK_CHECK_STATUS(sts, "InitRegionSlots failed");
 
     sts = FillBuffers();
     MSDK_CHECK_STATUS(sts, "FillBuffers failed");
@@ -443,36 +415,265 @@ mfxStatus CRegionEncodingPipeline::ResetMFXComponents(sInputParams* pParams) {
     return MFX_ERR_NONE;
 }
 
-mfxStatus CRegionEncodingPipeline::Run() {
-    mfxI64 timeCurStart = 0;
-    mfxI64 timeCurEnd   = 0;
-    mfxI64 timeCurMax;
-    mfxI64 nFrames = 0;
+mfxStatus CRegionEncodingPipeline::InitRegionSlots(mfxU32 nBufferSize,
+                                                   mfxU32 CodecId,
+                                                   bool bUseHWLib) {
+    mfxStatus sts = MFX_ERR_NONE;
 
+    m_pSlots.reset(new RegionFrameSlot[REGION_FRAMES_IN_FLIGHT]);
+    for (mfxU32 i = 0; i < REGION_FRAMES_IN_FLIGHT; i++) {
+        m_pSlots[i].pRegions.reset(new sTask[m_resources.GetSize()]);
+        for (int regId = 0; regId < m_resources.GetSize(); regId++) {
+            sts = m_pSlots[i].pRegions[regId].Init(nBufferSize,
+                                                   CodecId,
+                                                   m_FileWriters.first,
+                                                   bUseHWLib);
+            MSDK_CHECK_STATUS(sts, "m_pSlots[i].pRegions[regId].Init failed");
+        }
+    }
+
+    m_pSurfInUse.reset(new std::atomic<mfxU32>[m_EncResponse.NumFrameActual]);
+    for (mfxU16 i = 0; i < m_EncResponse.NumFrameActual; i++) {
+        m_pSurfInUse[i] = 0;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxU16 CRegionEncodingPipeline::GetFreeRegionSurface() {
+    for (mfxU16 i = 0; i < m_EncResponse.NumFrameActual; i++) {
+        if (0 == m_pSurfInUse[i])
+            return i;
+    }
+    return MSDK_INVALID_SURF_IDX;
+}
+
+void CRegionEncodingPipeline::Abort(mfxStatus sts) {
+    {
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+        if (MFX_ERR_NONE == m_threadSts)
+            m_threadSts = sts;
+        m_bAbort = true;
+    }
+    m_waitCond.notify_all();
+}
+
+void CRegionEncodingPipeline::Notify() {
+    // take the lock so a waiter can't miss the change between its check and wait
+    { std::lock_guard<std::mutex> lock(m_waitMutex); }
+    m_waitCond.notify_all();
+}
+
+mfxStatus CRegionEncodingPipeline::EncodeRegionFrame(int regId,
+                                                     sTask& task,
+                                                     mfxFrameSurface1* pSurf) {
     mfxStatus sts = MFX_ERR_NONE;
 
-    mfxFrameSurface1* pSurf = NULL; // dispatching pointer
+    for (;;) {
+        sts = m_resources[regId].pEncoder->EncodeFrameAsync(&task.encCtrl,
+                                                            pSurf,
+                                                            &task.mfxBS,
+                                                            &task.EncSyncP);
+
+        if (MFX_ERR_NONE < sts && !task.EncSyncP) // repeat the call if warning and no output
+        {
+            if (MFX_WRN_DEVICE_BUSY == sts)
+                MSDK_SLEEP(1); // wait if device is busy
+        }
+        else if (MFX_ERR_NONE < sts && task.EncSyncP) {
+            sts = MFX_ERR_NONE; // ignore warnings if output is available
+            break;
+        }
+        else if (MFX_ERR_NOT_ENOUGH_BUFFER == sts) {
+            // size is not queried from the encoder, it's called from other threads
+            task.mfxBS.Extend(task.mfxBS.MaxLength * 2);
+        }
+        else {
+            MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_BITSTREAM);
+            break;
+        }
+    }
+
+    return sts;
+}
+
+mfxStatus CRegionEncodingPipeline::EncodeRegionFrames(int regId) {
+    mfxStatus sts  = MFX_ERR_NONE;
+    mfxU32 nInput  = 0; // frames submitted to this region's encoder
+    mfxU32 nOutput = 0; // frames encoded by this region's encoder
+
+    for (;;) {
+        // frame barrier: wait for the next frame loaded by the main thread
+        WaitFor([&]() {
+            return m_nFramesPublished > nInput || m_bInputDone;
+        });
+        if (m_bAbort)
+            return MFX_ERR_ABORTED;
+
+        // input slot is valid until all regions write its output, output slot is
+        // the same unless the encoder buffers frames
+        RegionFrameSlot* pInSlot = (m_nFramesPublished > nInput)
+                                       ? &m_pSlots[nInput % REGION_FRAMES_IN_FLIGHT]
+                                       : NULL; // no more input, drain the encoder
+        RegionFrameSlot& outSlot = m_pSlots[nOutput % REGION_FRAMES_IN_FLIGHT];
+        sTask& task              = outSlot.pRegions[regId];
+
+        mfxFrameSurface1* pSurf = pInSlot ? pInSlot->pSurface : NULL;
+        InsertIDR(task.encCtrl, pInSlot ? pInSlot->bInsertIDR : false);
+
+        mfxI64 timeStart = time_get_tick();
+        sts              = EncodeRegionFrame(regId, task, pSurf);
+
+        if (pInSlot) {
+            nInput++;
+            Notify();
+        }
+
+        if (MFX_ERR_MORE_DATA == sts) {
+            // MFX_ERR_MORE_DATA without input indicates that there are no more buffered frames
+            if (!pInSlot)
+                return MFX_ERR_NONE;
+            continue;
+        }
+        MSDK_CHECK_STATUS(sts, "m_resources[regId].pEncoder->EncodeFrameAsync failed");
+
+        sts = m_resources[regId].Session.SyncOperation(task.EncSyncP,
+                                                       m_resources.GetSyncOpTimeout());
+        // region isn't ready on timeout, MFX_WRN_IN_EXECUTION has to be reported
+        MSDK_CHECK_NOERROR_STATUS_NO_RET(sts, "SyncOperation fail or timeout");
+        if (MFX_WRN_IN_EXECUTION == sts)
+            return MFX_ERR_ABORTED;
+        MSDK_CHECK_STATUS(sts, "m_resources[regId].Session.SyncOperation failed");
+
+        // frame encode time is the time of its slowest region
+        mfxI64 timeEncode = time_get_tick() - timeStart;
+        mfxI64 timeMax    = outSlot.nEncodeTime;
+        while (timeMax < timeEncode &&
+               !outSlot.nEncodeTime.compare_exchange_weak(timeMax, timeEncode)) {
+            // timeMax is reloaded by the failed exchange
+        }
+
+        // frames are encoded in order (GopRefDist is 1), so this output is the frame of the
+        // slot's input surface and the region doesn't use the surface anymore
+        if (!m_nPerfOpt)
+            m_pSurfInUse[outSlot.pSurface - m_pEncSurfaces]--;
+
+        nOutput++;
+        outSlot.nReady++;
+        Notify();
+    }
+}
+
+mfxStatus CRegionEncodingPipeline::StitchRegionFrames() {
+    mfxStatus sts   = MFX_ERR_NONE;
+    mfxU32 nRegions = (mfxU32)m_resources.GetSize();
+
+    for (mfxU32 nFrame = 0;; nFrame++) {
+        RegionFrameSlot& slot = m_pSlots[nFrame % REGION_FRAMES_IN_FLIGHT];
+
+        WaitFor([&]() {
+            return slot.nReady == nRegions || 0 == m_nActiveWorkers;
+        });
+        if (m_bAbort)
+            return MFX_ERR_ABORTED;
+        // all workers have finished, regions are ready before the worker exits
+        if (slot.nReady != nRegions)
+            return MFX_ERR_NONE;
+
+        if (slot.bResetWriters) {
+            if (m_FileWriters.first) {
+                sts = m_FileWriters.first->Reset();
+                MSDK_CHECK_STATUS(sts, "m_FileWriters.first->Reset failed");
+            }
+            if (m_FileWriters.second) {
+                sts = m_FileWriters.second->Reset();
+                MSDK_CHECK_STATUS(sts, "m_FileWriters.second->Reset failed");
+            }
+        }
 
-    sTask* pCurrentTask = NULL; // a pointer to the current task
-    mfxU16 nEncSurfIdx  = 0; // index of free surface for encoder input (vpp output)
+        // regions (slices) are written into destination in order
+        for (mfxU32 regId = 0; regId < nRegions; regId++) {
+            sts = slot.pRegions[regId].WriteBitstream();
+            MSDK_CHECK_STATUS(sts, "slot.pRegions[regId].WriteBitstream failed");
+
+            sts = slot.pRegions[regId].Reset();
+            MSDK_CHECK_STATUS(sts, "slot.pRegions[regId].Reset failed");
+        }
+
+        m_timeAll += slot.nEncodeTime;
+        slot.nEncodeTime = 0;
+        slot.nReady      = 0;
+        m_nFramesWritten = nFrame + 1;
+        Notify();
+    }
+}
+
+void CRegionEncodingPipeline::RegionWorkerRoutine(int regId) {
+    mfxStatus sts = EncodeRegionFrames(regId);
+    if (sts < MFX_ERR_NONE && !m_bAbort)
+        Abort(sts);
+
+    m_nActiveWorkers--;
+    Notify();
+}
+
+void CRegionEncodingPipeline::StitcherRoutine() {
+    mfxStatus sts = StitchRegionFrames();
+    if (sts < MFX_ERR_NONE && !m_bAbort)
+        Abort(sts);
+}
+
+mfxStatus CRegionEncodingPipeline::Run() {
+    mfxStatus sts = MFX_ERR_NONE;
+
+    mfxFrameSurface1* pSurf = NULL; // dispatching pointer
+    mfxU16 nEncSurfIdx      = 0; // index of free surface for encoder input
 
     // Since in sample we support just 2 views
     // we will change this value between 0 and 1 in case of MVC
     mfxU16 currViewNum = 0;
 
-    sts = MFX_ERR_NONE;
+    MSDK_CHECK_POINTER(m_pSlots, MFX_ERR_NOT_INITIALIZED);
+
+    m_nFramesPublished = 0;
+    m_nFramesWritten   = 0;
+    m_bInputDone       = false;
+    m_bAbort           = false;
+    m_nActiveWorkers   = m_resources.GetSize();
+    m_threadSts        = MFX_ERR_NONE;
+
     m_statOverall.StartTimeMeasurement();
 
-    // main loop, preprocessing and encoding
-    while (MFX_ERR_NONE <= sts || MFX_ERR_MORE_DATA == sts) {
+    std::vector<std::thread> workers;
+    for (int regId = 0; regId < m_resources.GetSize(); regId++) {
+        workers.emplace_back(&CRegionEncodingPipeline::RegionWorkerRoutine, this, regId);
+    }
+    std::thread stitcher(&CRegionEncodingPipeline::StitcherRoutine, this);
+
+    // main loop, loading of frames for region workers
+    for (mfxU32 nFrame = 0; !m_bAbort;) {
+        RegionFrameSlot& slot = m_pSlots[nFrame % REGION_FRAMES_IN_FLIGHT];
+
+        // slot is reused when its previous frame is written
+        WaitFor([&]() {
+            return m_nFramesWritten + REGION_FRAMES_IN_FLIGHT > nFrame;
+        });
+        if (m_bAbort)
+            break;
+
         // find free surface for encoder input
         if (m_nPerfOpt) {
-            nEncSurfIdx %= m_nPerfOpt;
+            // surfaces are preloaded and only read by encoders
+            nEncSurfIdx = nFrame % m_nPerfOpt;
         }
         else {
-            nEncSurfIdx = GetFreeSurface(m_pEncSurfaces, m_EncResponse.NumFrameActual);
+            WaitFor([&]() {
+                nEncSurfIdx = GetFreeRegionSurface();
+                return MSDK_INVALID_SURF_IDX != nEncSurfIdx;
+            });
+            if (m_bAbort)
+                break;
         }
-        MSDK_CHECK_ERROR(nEncSurfIdx, MSDK_INVALID_SURF_IDX, MFX_ERR_MEMORY_ALLOC);
 
         // point pSurf to encoder surface
         pSurf                      = &m_pEncSurfaces[nEncSurfIdx];
@@ -488,143 +689,37 @@ mfxStatus CRegionEncodingPipeline::Run() {
             currViewNum ^= 1; // Flip between 0 and 1 for ViewId
         MSDK_BREAK_ON_ERROR(sts);
 
-        m_statFile.StopTimeMeasurement();
+        slot.pSurface      = pSurf;
+        slot.bInsertIDR    = m_bInsertIDR;
+        slot.bResetWriters = m_bFileWriterReset;
+        m_bInsertIDR       = false;
+        m_bFileWriterReset = false;
 
-        timeCurMax = 0;
-        if (m_bFileWriterReset) {
-            if (m_FileWriters.first) {
-                sts = m_FileWriters.first->Reset();
-                MSDK_CHECK_STATUS(sts, "m_FileWriters.first->Reset failed");
-            }
-            if (m_FileWriters.second) {
-                sts = m_FileWriters.second->Reset();
-                MSDK_CHECK_STATUS(sts, "m_FileWriters.second->Reset failed");
-            }
-            m_bFileWriterReset = false;
-        }
-        for (int regId = 0; regId < m_resources.GetSize(); regId++) {
-            // get a pointer to a free task (bit stream and sync point for encoder)
-            sts = m_resources.GetFreeTask(regId, &pCurrentTask);
-            MSDK_CHECK_STATUS(sts, "m_resources.GetFreeTask failed");
-
-            for (;;) {
-                timeCurStart = time_get_tick();
-                // at this point surface for encoder contains a frame from a file
-
-                InsertIDR(pCurrentTask->encCtrl, m_bInsertIDR);
-                m_bInsertIDR = false;
-
-                sts = m_resources[regId].pEncoder->EncodeFrameAsync(&pCurrentTask->encCtrl,
-                                                                    &m_pEncSurfaces[nEncSurfIdx],
-                                                                    &pCurrentTask->mfxBS,
-                                                                    &pCurrentTask->EncSyncP);
-
-                if ((sts != MFX_ERR_NOT_ENOUGH_BUFFER) && m_nPerfOpt) {
-                    nEncSurfIdx++;
-                }
-
-                if (MFX_ERR_NONE < sts &&
-                    !pCurrentTask->EncSyncP) // repeat the call if warning and no output
-                {
-                    if (MFX_WRN_DEVICE_BUSY == sts)
-                        MSDK_SLEEP(1); // wait if device is busy
-                }
-                else if (MFX_ERR_NONE < sts && pCurrentTask->EncSyncP) {
-                    sts = MFX_ERR_NONE; // ignore warnings if output is available
-                    break;
-                }
-                else if (MFX_ERR_NOT_ENOUGH_BUFFER == sts) {
-                    sts = AllocateSufficientBuffer(pCurrentTask->mfxBS);
-                    MSDK_CHECK_STATUS(sts, "AllocateSufficientBuffer failed");
-                    continue;
-                }
-                else {
-                    // get next surface and new task for 2nd bitstream in ViewOutput mode
-                    MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_BITSTREAM);
-                    break;
-                }
-            }
+        if (!m_nPerfOpt)
+            m_pSurfInUse[nEncSurfIdx] = (mfxU32)m_resources.GetSize();
 
-            timeCurEnd = time_get_tick();
-            if (timeCurMax < (timeCurEnd - timeCurStart))
-                timeCurMax = timeCurEnd - timeCurStart;
-        }
-        if (timeCurMax) {
-            nFrames++;
-            m_timeAll += timeCurMax;
-        }
+        m_nFramesPublished = ++nFrame;
+        Notify();
     }
 
-    // means that the input file has ended, need to go to buffering loops
-    MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
-    // exit in case of other errors
-    MSDK_CHECK_STATUS(sts, "Unexpected error!!");
+    // workers drain encoders and finish
+    m_bInputDone = true;
+    if (sts < MFX_ERR_NONE && MFX_ERR_MORE_DATA != sts)
+        Abort(sts);
+    else
+        Notify();
 
-    // loop to get buffered frames from encoder
-    while (MFX_ERR_NONE <= sts) {
-        timeCurMax = 0;
-        for (int regId = 0; regId < m_resources.GetSize(); regId++) {
-            // get a free task (bit stream and sync point for encoder)
-            sts = m_resources.GetFreeTask(regId, &pCurrentTask);
-            MSDK_CHECK_STATUS(sts, "m_resources.GetFreeTask failed");
-
-            for (;;) {
-                timeCurStart = time_get_tick();
-
-                InsertIDR(pCurrentTask->encCtrl, m_bInsertIDR);
-                m_bInsertIDR = false;
-
-                sts = m_resources[regId].pEncoder->EncodeFrameAsync(&pCurrentTask->encCtrl,
-                                                                    NULL,
-                                                                    &pCurrentTask->mfxBS,
-                                                                    &pCurrentTask->EncSyncP);
-
-                if (MFX_ERR_NONE < sts &&
-                    !pCurrentTask->EncSyncP) // repeat the call if warning and no output
-                {
-                    if (MFX_WRN_DEVICE_BUSY == sts)
-                        MSDK_SLEEP(1); // wait if device is busy
-                }
-                else if (MFX_ERR_NONE < sts && pCurrentTask->EncSyncP) {
-                    sts = MFX_ERR_NONE; // ignore warnings if output is available
-                    break;
-                }
-                else if (MFX_ERR_NOT_ENOUGH_BUFFER == sts) {
-                    sts = AllocateSufficientBuffer(pCurrentTask->mfxBS);
-                    MSDK_CHECK_STATUS(sts, "AllocateSufficientBuffer failed");
-                    continue;
-                }
-                else {
-                    // get new task for 2nd bitstream in ViewOutput mode
-                    MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_BITSTREAM);
-                    break;
-                }
-            }
-
-            // MFX_ERR_MORE_DATA is the correct status to exit buffering loop with
-            // indicates that there are no more buffered frames
-            if (sts == MFX_ERR_MORE_DATA)
-                continue;
-            // exit in case of other errors
-            MSDK_CHECK_STATUS(sts, "m_resources[regId].pEncoder->EncodeFrameAsync failed");
-
-            timeCurEnd = time_get_tick();
-            if (timeCurMax < (timeCurEnd - timeCurStart))
-                timeCurMax = timeCurEnd - timeCurStart;
-        }
-        if (timeCurMax) {
-            nFrames++;
-            m_timeAll += timeCurMax;
-        }
+    for (auto& worker : workers) {
+        worker.join();
     }
+    stitcher.join();
 
+    // means that the input file has ended
     MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
-
-    // MFX_ERR_NOT_FOUND is the correct status to exit the loop with
-    // EncodeFrameAsync and SyncOperation don't return this status
-    MSDK_IGNORE_MFX_STS(sts, MFX_ERR_NOT_FOUND);
-    // report any errors that occurred in asynchronous part
+    // exit in case of other errors
     MSDK_CHECK_STATUS(sts, "Unexpected error!!");
+    // report any errors that occurred on region threads
+    MSDK_CHECK_STATUS(m_threadSts, "Region encoding failed");
 
     m_statOverall.StopTimeMeasurement();
     return sts;
@@ -260,6 +260,22 @@ void PrintHelp(msdk_char* strAppName, const msdk_char* strErrorMessage, ...) {
         MSDK_STRING("   [-syncop_timeout]        - SyncOperation timeout in milliseconds\n"));
     msdk_printf(MSDK_STRING(
         "   [-perf_opt n]            - sets number of prefetched frames. In performance mode app preallocates buffer and loads first n frames\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-preload n m]           - keeps first n input frames in memory (0 - whole file) and encodes them m times (0 - infinite)\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-preload_ts]            - rewrites time stamps of preloaded frames so they keep growing across loops\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-prefetch n]            - reads n frames ahead of the encoder per input file on background threads\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-zero_copy]             - maps input file (or shared memory object) and encodes from it without copying, system memory only\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-i::shm name]           - reads raw frames from shared memory ring created by another sample (e.g. sample_decode -o::shm), implies -zero_copy\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-o::shm name]           - writes encoded frames to shared memory ring instead of the output file\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-out_sink stdio|async|direct [KB]] - output written per frame (default), batched on background thread or batched with O_DIRECT, KB - batch buffer size\n"));
+    msdk_printf(MSDK_STRING(
+        "                              output name tcp://host:port or udp://host:port sends the stream to a socket\n"));
     msdk_printf(MSDK_STRING("   [-fps]                   - limits overall fps of pipeline\n"));
     msdk_printf(MSDK_STRING(
         "   [-uncut]                 - do not cut output file in looped mode (in case of -timeout option)\n"));
@@ -279,6 +295,10 @@ void PrintHelp(msdk_char* strAppName, const msdk_char* strErrorMessage, ...) {
 #endif
     msdk_printf(
         MSDK_STRING("   [-extbrc:<on,off,implicit>] - External BRC for AVC and HEVC encoders\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-extbrc_la n]           - complexity of n frames ahead is analyzed for -extbrc:on, system memory input from file only.\n"));
+    msdk_printf(MSDK_STRING(
+        "                              BRC sees only frames already loaded, use -async to load more\n"));
     msdk_printf(MSDK_STRING("   [-encTools]     - enables enctools for AVC encoder\n"));
     msdk_printf(MSDK_STRING(
         "   [-et:adaptiveI:<on,off>] - flag for configuring “Frame type calculation” feature.\n"));
@@ -1122,6 +1142,32 @@ mfxStatus ParseInputString(msdk_char* strInput[], mfxU8 nArgNum, sInputParams* p
                 return MFX_ERR_UNSUPPORTED;
             }
         }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-preload"))) {
+            VAL_CHECK(i + 2 >= nArgNum, i, strInput[i]);
+
+            pParams->bPreload = true;
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nPreloadFrames)) {
+                PrintHelp(strInput[0], MSDK_STRING("preload frames number is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nPreloadLoops)) {
+                PrintHelp(strInput[0], MSDK_STRING("preload loops number is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-preload_ts"))) {
+            pParams->bPreloadTimeStamps = true;
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-zero_copy"))) {
+            pParams->bZeroCopyInput = true;
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-prefetch"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nPrefetchFrames)) {
+                PrintHelp(strInput[0], MSDK_STRING("prefetch frames number is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
         else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-WeightedPred:default"))) {
             pParams->WeightedPred = MFX_WEIGHTED_PRED_DEFAULT;
         }
@@ -1208,6 +1254,13 @@ mfxStatus ParseInputString(msdk_char* strInput[], mfxU8 nArgNum, sInputParams* p
         else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-extbrc:implicit"))) {
             pParams->nExtBRC = EXTBRC_IMPLICIT;
         }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-extbrc_la"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nExtBRCLookAhead)) {
+                PrintHelp(strInput[0], MSDK_STRING("ExtBRC lookahead depth is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
         else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-ExtBrcAdaptiveLTR:on"))) {
             pParams->ExtBrcAdaptiveLTR = MFX_CODINGOPTION_ON;
         }
@@ -1337,6 +1390,39 @@ mfxStatus ParseInputString(msdk_char* strInput[], mfxU8 nArgNum, sInputParams* p
             VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
             pParams->dstFileBuff.push_back(strInput[++i]);
         }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-i::shm"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            pParams->InputFiles.push_back(strInput[++i]);
+            pParams->bShmInput      = true;
+            pParams->bZeroCopyInput = true;
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-out_sink"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            i++;
+            if (0 == msdk_strcmp(strInput[i], MSDK_STRING("stdio")))
+                pParams->OutSinkType = SINK_STDIO;
+            else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("async")))
+                pParams->OutSinkType = SINK_ASYNC;
+            else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("direct")))
+                pParams->OutSinkType = SINK_DIRECT;
+            else {
+                PrintHelp(strInput[0], MSDK_STRING("Unknown -out_sink type"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (i + 1 < nArgNum && isdigit(*strInput[1 + i])) {
+                mfxU32 nBufferSizeKB = 0;
+                if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], nBufferSizeKB)) {
+                    PrintHelp(strInput[0], MSDK_STRING("-out_sink buffer size is invalid"));
+                    return MFX_ERR_UNSUPPORTED;
+                }
+                pParams->nOutSinkBufferSize = nBufferSizeKB * 1024;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-o::shm"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+            pParams->dstFileBuff.push_back(strInput[++i]);
+            pParams->bShmOutput = true;
+        }
         else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-p"))) {
             VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
             pParams->pluginParams = ParsePluginGuid(strInput[++i]);
@@ -1483,6 +1569,45 @@ mfxStatus ParseInputString(msdk_char* strInput[], mfxU8 nArgNum, sInputParams* p
         return MFX_ERR_UNSUPPORTED;
     }
 
+    if (pParams->bPreload && (pParams->nPerfOpt || pParams->QPFileMode)) {
+        PrintHelp(strInput[0], MSDK_STRING("-preload can't be combined with -perf_opt or -qpfile"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    // qpfile mode seeks the input for every frame, read ahead data would be dropped each time
+    if (pParams->nPrefetchFrames && pParams->QPFileMode) {
+        PrintHelp(strInput[0], MSDK_STRING("-prefetch can't be combined with -qpfile"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    if (pParams->bZeroCopyInput &&
+        (pParams->memType != SYSTEM_MEMORY || pParams->InputFiles.size() != 1 ||
+         pParams->nPerfOpt || pParams->QPFileMode || pParams->bPreload ||
+         pParams->nPrefetchFrames)) {
+        PrintHelp(
+            strInput[0],
+            MSDK_STRING(
+                "-zero_copy and -i::shm need system memory and a single input, they can't be combined with -perf_opt, -qpfile, -preload or -prefetch"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    // analyzer reads surfaces the file reader has just filled, in display order
+    if (pParams->nExtBRCLookAhead &&
+        (pParams->nExtBRC != EXTBRC_ON || pParams->memType != SYSTEM_MEMORY ||
+         pParams->nPerfOpt || pParams->QPFileMode || pParams->bZeroCopyInput)) {
+        PrintHelp(
+            strInput[0],
+            MSDK_STRING(
+                "-extbrc_la needs -extbrc:on and system memory, it can't be combined with -perf_opt, -qpfile or -zero_copy"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    if (pParams->bShmOutput &&
+        (pParams->dstFileBuff.size() != 1 || (MVC_VIEWOUTPUT & pParams->MVC_flags))) {
+        PrintHelp(strInput[0], MSDK_STRING("-o::shm supports a single output stream only"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
     if (MFX_CODEC_MPEG2 != pParams->CodecId && MFX_CODEC_AVC != pParams->CodecId &&
         MFX_CODEC_JPEG != pParams->CodecId && MFX_CODEC_HEVC != pParams->CodecId &&
         MFX_CODEC_VP9 != pParams->CodecId && MFX_CODEC_AV1 != pParams->CodecId) {
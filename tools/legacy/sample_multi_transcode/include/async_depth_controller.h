@@ -0,0 +1,80 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __ASYNC_DEPTH_CONTROLLER_H__
+#define __ASYNC_DEPTH_CONTROLLER_H__
+
+#include <vector>
+
+#include "sample_defs.h"
+#include "vm/time_defs.h"
+
+namespace TranscodingSample {
+
+// Chooses number of frames in flight between min and max depth at run time. Components are
+// initialized for max depth, the pipeline just syncs frames earlier when depth is lower.
+// Every window of frames throughput and submit-to-sync latency are measured. Depth goes one
+// step down while throughput holds the target and goes back up when it drops below it.
+// Without target fps the target is the throughput measured recently at higher depths, they
+// are measured again from time to time as the best depth changes with content.
+class CAsyncDepthController {
+public:
+    CAsyncDepthController();
+
+    // targetFps - 0 if there is no target
+    void Init(mfxU16 minDepth, mfxU16 maxDepth, mfxF64 targetFps);
+    bool IsEnabled() const {
+        return m_nMinDepth < m_nMaxDepth;
+    }
+    mfxU16 GetDepth() const {
+        return m_nDepth;
+    }
+
+    // called when frame is synced, latency is from its submission
+    void OnSync(msdk_tick latency, size_t nInFlight);
+
+    mfxU16 GetMinDepth() const {
+        return m_nMinDepth;
+    }
+    mfxU16 GetMaxDepth() const {
+        return m_nMaxDepth;
+    }
+    // whole run averages, latency in ms
+    mfxF64 GetAvgDepth() const;
+    mfxF64 GetAvgInFlight() const;
+    mfxF64 GetAvgLatency() const;
+
+protected:
+    void UpdateDepth(mfxF64 fps);
+
+    mfxU16 m_nMinDepth;
+    mfxU16 m_nMaxDepth;
+    mfxU16 m_nDepth;
+    mfxF64 m_targetFps;
+    mfxU32 m_nWindow; // frames
+
+    // current window
+    msdk_tick m_windowStart;
+    mfxU32 m_nWindowFrames;
+    mfxU32 m_nSettle; // frames skipped before the window starts, after depth change
+
+    std::vector<mfxF64> m_fps; // last throughput at every depth
+    std::vector<mfxU32> m_age; // windows since it was measured
+    mfxU32 m_nHold; // windows to wait before the next step down
+    mfxU32 m_nBackoff; // hold after a failed step down, doubles each time
+    bool m_bProbing; // depth was lowered in the last window
+    bool m_bRefreshing; // depth was raised in the last window to measure it again
+
+    // totals
+    mfxU64 m_nFrames;
+    mfxU64 m_nDepthSum;
+    mfxU64 m_nInFlightSum;
+    mfxF64 m_latencySum;
+};
+
+} // namespace TranscodingSample
+
+#endif //__ASYNC_DEPTH_CONTROLLER_H__
@@ -0,0 +1,78 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __LIVE_DEADLINE_H__
+#define __LIVE_DEADLINE_H__
+
+#include "sample_defs.h"
+#include "vm/time_defs.h"
+
+namespace TranscodingSample {
+
+// Live mode of transcoding: decoded frames are paced to their presentation time, as if they
+// came from a live source, and every frame has to be output within max latency from it.
+// Presentation time comes from surface time stamps, or from frame rate when there are none.
+// Frames which can't be encoded in time anymore are dropped, and when they keep coming late
+// decoder is asked to skip non-reference frames.
+class CLiveDeadline {
+public:
+    CLiveDeadline();
+
+    // maxLatency - ms from presentation time to the moment the frame is output, 0 - off
+    void Init(mfxF64 frameRate, mfxU32 maxLatency);
+    bool IsEnabled() const {
+        return m_maxLatency > 0;
+    }
+    // input starts from the beginning, time stamps start again
+    void Restart();
+
+    // Waits for presentation time of the decoded frame, returns true if the frame
+    // can't meet its deadline and shouldn't be processed further.
+    bool OnFrame(const mfxFrameSurface1& surface);
+    // called when frame is synced, latency is from its submission to encoder
+    void OnOutput(msdk_tick latency);
+
+    // decoder skip level which keeps up with the input, 0 - no skipping
+    mfxU32 GetSkipLevel() const {
+        return m_nSkipLevel;
+    }
+
+    mfxU64 GetNumFrames() const {
+        return m_nFrames;
+    }
+    mfxU64 GetNumDropped() const {
+        return m_nDropped;
+    }
+    mfxU32 GetMaxSkipLevel() const {
+        return m_nMaxSkipLevel;
+    }
+
+protected:
+    mfxF64 GetPresentationTime(const mfxFrameSurface1& surface);
+    void UpdateSkipLevel(bool bLate, mfxF64 slack);
+
+    mfxF64 m_frameDuration; // s
+    mfxF64 m_maxLatency; // s
+
+    bool m_bStarted;
+    msdk_tick m_startTick; // presentation time 0
+    mfxU64 m_firstTimeStamp; // time stamp which time stamps are counted from
+    mfxF64 m_firstTime; // presentation time of the first time stamp
+    mfxF64 m_lastTime; // presentation time of the last frame
+    mfxF64 m_encodeTime; // average submit-to-sync time, s
+
+    mfxU32 m_nSkipLevel;
+    mfxU32 m_nLateFrames; // late frames since the last skip level change
+    mfxU32 m_nEarlyFrames; // frames in a row with enough slack
+
+    mfxU64 m_nFrames;
+    mfxU64 m_nDropped;
+    mfxU32 m_nMaxSkipLevel;
+};
+
+} // namespace TranscodingSample
+
+#endif //__LIVE_DEADLINE_H__
@@ -9,6 +9,7 @@
 
 #include <stddef.h>
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <ctime>
@@ -26,8 +27,10 @@
 #include "sample_utils.h"
 #include "sysmem_allocator.h"
 
+#include "async_depth_controller.h"
 #include "brc_routines.h"
 #include "hw_device.h"
+#include "live_deadline.h"
 #include "mfxdeprecated.h"
 #include "mfxjpeg.h"
 #include "mfxmvc.h"
@@ -35,6 +38,7 @@
 #include "mfxvp8.h"
 #include "plugin_utils.h"
 #include "preset_manager.h"
+#include "roi_qp_map.h"
 #include "sample_defs.h"
 #include "vpl/mfxdispatcher.h"
 #include "vpl/mfxvideo++.h"
@@ -210,6 +214,9 @@ struct __sInputParams {
     mfxU16 ScalingMode;
 
     mfxU16 nAsyncDepth; // asyncronous queue
+    mfxU16 nAsyncDepthMin; // adaptive depth between this and nAsyncDepth, 0 - fixed depth
+    mfxF64 dAsyncTargetFps; // throughput adaptive depth must keep, 0 - -fps or the best one
+    mfxU32 nLiveLatency; // live mode max latency in ms, 0 - not a live mode
 
     PipelineMode eMode;
     PipelineMode eModeExt;
@@ -259,6 +266,15 @@ struct __sInputParams {
     sPluginParams encoderPluginParams;
 
     mfxU32 nTimeout; // how long transcoding works in seconds
+
+    bool bPreload; // keep input in memory and replay it from there
+    mfxU32 nPreloadFrames; // raw frames kept in memory, 0 - whole file
+    mfxU32 nPreloadLoops; // passes over preloaded input, 0 - infinite
+    bool bPreloadTimeStamps; // rewrite time stamps of replayed raw frames
+    bool bShmInput; // strSrcFile is a shared memory ring of encoded frames
+    bool bShmOutput; // strDstFile is a shared memory ring of encoded frames
+    BitstreamSinkType OutSinkType; // how encoded data is written to strDstFile
+    mfxU32 nOutSinkBufferSize; // sink buffer size in bytes, 0 - default
     mfxU32 nFPS; // limit transcoding to the number of frames per second
 
     mfxU32 statisticsWindowSize;
@@ -314,6 +330,10 @@ struct __sInputParams {
 
     mfxI32 monitorType;
     bool shouldUseGreedyFormula;
+    bool bParallelInit; // initialize independent sessions concurrently
+    bool bSysMemSlab; // system memory surfaces of one request are allocated in one slab
+    bool bSysMemHugePages;
+    mfxI32 nSysMemNumaNode; // -1 - no binding
     bool enableQSVFF;
     bool bSingleTexture;
 
@@ -486,6 +506,7 @@ public:
 
         mfxU32 PoolID =
             0; //surface pool for this target, it is output of decoder side VPP and input of encoder side VPP
+        bool SharedPool = false; //pool of previous cascade is reused, this target has no VPP
     };
 
     class PoolDescritpor {
@@ -493,17 +514,21 @@ public:
         mfxU32 ID            = 0; //ID of the current pool
         mfxU32 PrevID        = 0; //ID of the previous pool in cascade
         mfxU32 TargetID      = 0; //ID of the target channel
-        mfxU16 SurfaceWidth  = 0; //not aligned
+        mfxU16 SurfaceWidth  = 0; //not aligned, 0 - the same as decoder output
         mfxU16 SurfaceHeight = 0;
-        mfxU16 Size          = 20;
+        mfxU32 FourCC        = 0; //0 - the same as decoder output
+        mfxU16 RefCount      = 0; //number of components reading from the pool
+        mfxU16 Size          = 0; //number of allocated surfaces
 
-        mfxFrameAllocRequest AllocReq{};
+        mfxFrameAllocRequest AllocReq{}; //request of VPP writing to the pool
+        mfxFrameAllocRequest ConsumerReq{}; //combined request of components reading from it
         mfxFrameAllocResponse AllocResp{};
     };
 
     TargetDescriptor GetDesc(mfxU32 id);
     void PropagateCascadeParameters();
     void CreatePoolList();
+    mfxU32 FindCompatiblePool(const TargetDescriptor& desc, mfxU32 HeadID);
 
     bool ParFileImported       = false;
     bool CascadeScalerRequired = false;
@@ -544,6 +569,7 @@ struct ExtendedBS {
     mfxBitstreamWrapper Bitstream;
     mfxSyncPoint Syncp     = nullptr;
     PreEncAuxBuffer* pCtrl = nullptr;
+    msdk_tick SubmitTime   = 0;
 };
 
 class CIOStat : public CTimeStatistics {
@@ -635,33 +661,47 @@ protected:
 
 class ExtendedBSStore {
 public:
-    explicit ExtendedBSStore(mfxU32 size) {
-        m_pExtBS.resize(size);
+    explicit ExtendedBSStore(mfxU32 size) : m_arena(), m_pExtBS(size), m_free() {
+        m_free.reserve(size);
+        for (mfxU32 i = size; i > 0; i--) {
+            m_pExtBS[i - 1].Bitstream.SetArena(&m_arena);
+            m_free.push_back(&m_pExtBS[i - 1]);
+        }
     }
     virtual ~ExtendedBSStore() {
+        // bitstreams give their buffers back to the arena before it is destroyed
         m_pExtBS.clear();
     }
+    // bitstream buffers are taken from the arena, slot size is defined by the first request
+    mfxStatus InitArena(mfxU32 nSlotSize) {
+        if (m_arena.IsInitialized())
+            return MFX_ERR_NONE;
+        return m_arena.Init((mfxU32)m_pExtBS.size(), nSlotSize);
+    }
     ExtendedBS* GetNext() {
-        for (mfxU32 i = 0; i < m_pExtBS.size(); i++) {
-            if (m_pExtBS[i].IsFree) {
-                m_pExtBS[i].IsFree = false;
-                return &m_pExtBS[i];
-            }
-        }
-        return NULL;
+        if (m_free.empty())
+            return NULL;
+
+        ExtendedBS* pBS = m_free.back();
+        m_free.pop_back();
+        pBS->IsFree = false;
+        return pBS;
     }
     void Release(ExtendedBS* pBS) {
-        for (mfxU32 i = 0; i < m_pExtBS.size(); i++) {
-            if (&m_pExtBS[i] == pBS) {
-                m_pExtBS[i].IsFree = true;
-                return;
-            }
+        if (!pBS || m_pExtBS.empty() || pBS < &m_pExtBS.front() || pBS > &m_pExtBS.back())
+            return;
+
+        if (!pBS->IsFree) {
+            pBS->IsFree = true;
+            m_free.push_back(pBS);
         }
         return;
     }
     void ReleaseAll() {
-        for (mfxU32 i = 0; i < m_pExtBS.size(); i++) {
-            m_pExtBS[i].IsFree = true;
+        m_free.clear();
+        for (mfxU32 i = (mfxU32)m_pExtBS.size(); i > 0; i--) {
+            m_pExtBS[i - 1].IsFree = true;
+            m_free.push_back(&m_pExtBS[i - 1]);
         }
         return;
     }
@@ -674,7 +714,10 @@ public:
     }
 
 protected:
+    CBitstreamArena m_arena;
     std::vector<ExtendedBS> m_pExtBS;
+    // stack of free bitstreams, the last released one is reused first
+    std::vector<ExtendedBS*> m_free;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(ExtendedBSStore);
@@ -792,6 +835,10 @@ public:
         m_nID = id;
     }
     void StopSession();
+    // stops reading input, frames already decoded are encoded and output, 1 to 1 transcoding only
+    void DrainSession();
+    // new target bitrate, encoder is reset with it before the next frame, 1 to 1 transcoding only
+    void SetBitrate(mfxU32 kbps);
     mfxStatus CheckStopCondition();
     void SetSurfaceUtilizationSynchronizer(
         std::shared_ptr<SurfaceUtilizationSynchronizer>& surfaceUtilizationSynchronizer);
@@ -799,6 +846,13 @@ public:
     bool IsOverlayUsed();
     size_t GetRobustFlag();
 
+    const CAsyncDepthController& GetAsyncDepthController() const {
+        return m_AsyncDepthCtrl;
+    }
+    const CLiveDeadline& GetLiveDeadline() const {
+        return m_LiveDeadline;
+    }
+
     msdk_string GetSessionText() {
         msdk_stringstream ss;
         ss << m_pmfxSession->operator mfxSession();
@@ -835,6 +889,8 @@ protected:
     virtual mfxStatus Transcode();
     virtual mfxStatus DecodeOneFrame(ExtendedSurface* pExtSurface);
     virtual mfxStatus DecodeLastFrame(ExtendedSurface* pExtSurface);
+    // live mode: moves decoder skip mode to the level live deadline asks for
+    void UpdateDecoderSkipMode();
     virtual mfxStatus VPPOneFrame(ExtendedSurface* pSurfaceIn,
                                   ExtendedSurface* pExtSurface,
                                   mfxU32 ID = 0);
@@ -857,6 +913,7 @@ protected:
     // alloc frames for all component
     mfxStatus AllocFrames(mfxFrameAllocRequest* pRequest, bool isDecAlloc);
     mfxStatus AllocFramesForCS();
+    void AddPoolConsumer(CascadeScalerConfig::PoolDescritpor& PoolDesc, mfxFrameAllocRequest& Req);
     mfxStatus SetupSurfacePool(mfxU32 preallocateNum);
 
     // need for heterogeneous pipeline
@@ -889,6 +946,8 @@ protected:
 
     mfxStatus AllocateSufficientBuffer(mfxBitstreamWrapper* pBS);
     mfxStatus PutBS();
+    // flushes encoder and resets it with the bitrate set by SetBitrate()
+    mfxStatus ApplyNewBitrate();
 
     mfxStatus DumpSurface2File(mfxFrameSurface1* pSurface);
     mfxStatus Surface2BS(ExtendedSurface* pSurf, mfxBitstreamWrapper* pBS, mfxU32 fourCC);
@@ -952,6 +1011,7 @@ protected:
     mfxFrameAllocRequest m_VPPOutAllocReques;
 
     std::map<mfxU32, SurfPointersArray> m_CSSurfacePools;
+    std::map<mfxU32, ExtendedSurface> m_CSPoolSurfaces; // last output of every cascade pool
 
     mfxU16 m_EncSurfaceType; // actual type of encoder surface pool
     mfxU16 m_DecSurfaceType; // actual type of decoder surface pool
@@ -964,6 +1024,8 @@ protected:
     mfxInitParamlWrap m_initPar;
 
     volatile bool m_bForceStop;
+    std::atomic<bool> m_bDrainSession;
+    std::atomic<mfxU32> m_nNewBitrate; // Kbps, 0 - no change
 
     bool m_forceSyncAllSession;
     std::shared_ptr<SurfaceUtilizationSynchronizer> m_pSurfaceUtilizationSynchronizer;
@@ -999,7 +1061,11 @@ protected:
     mfxU32 m_tabDoUseAlg[ENH_FILTERS_COUNT];
 
     mfxU32 m_nID;
-    mfxU16 m_AsyncDepth;
+    mfxU16 m_AsyncDepth; // components and pools are initialized for it
+    CAsyncDepthController m_AsyncDepthCtrl; // frames actually kept in flight
+    CLiveDeadline m_LiveDeadline;
+    mfxU32 m_nDecSkipLevel; // MFX_SKIPMODE_MORE steps applied to decoder
+    bool m_bDecSkipSupported;
     mfxU32 m_nProcessedFramesNum;
 
     bool m_bIsJoinSession;
@@ -1062,6 +1128,14 @@ protected:
 
     std::map<void*, mfxExtMBQP> m_bufExtMBQP;
     std::map<void*, std::vector<mfxU8>> m_qpMapStorage;
+    // content of QP map buffers, they are rewritten only where the new map differs
+    struct QPMapState {
+        bool bValid;
+        mfxU16 PicStruct;
+        CROIQPMap::AreaState Area[2]; // frame or the first and the second half of the map
+    };
+    std::map<void*, QPMapState> m_qpMapState;
+    CROIQPMap m_ROIQPMap;
     std::map<void*, std::vector<mfxExtBuffer*>> m_extBuffPtrStorage;
     std::map<void*, mfxEncodeCtrl> encControlStorage;
 
@@ -1076,7 +1150,7 @@ protected:
 
     msdk_string m_strMfxParamsDumpFile;
 
-    void FillMBQPBuffer(mfxExtMBQP& qpMap, mfxU16 pictStruct);
+    void FillMBQPBuffer(mfxExtMBQP& qpMap, QPMapState& state, mfxU16 pictStruct);
 
 #ifdef ENABLE_MCTF
     sMctfRunTimeParams m_MctfRTParams;
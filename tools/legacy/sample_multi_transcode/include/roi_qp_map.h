@@ -0,0 +1,77 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __ROI_QP_MAP_H__
+#define __ROI_QP_MAP_H__
+
+#include <vector>
+
+#include "sample_defs.h"
+
+namespace TranscodingSample {
+
+// Regions of interest compiled to rectangles of QP map blocks. ROI list of every frame is
+// converted once at init, consecutive frames with the same regions share one region set.
+// Map buffers are reused for other frames, so the caller keeps AreaState per buffer and
+// Fill() rewrites only blocks of regions which differ from what the buffer already holds.
+class CROIQPMap {
+public:
+    // content of one map area (frame or field) of a map buffer
+    struct AreaState {
+        mfxU32 RegionSet;
+        mfxI32 BaseQP;
+    };
+    static const mfxU32 UNKNOWN_SET = 0xffffffff;
+    static AreaState UnknownArea() {
+        AreaState state = { UNKNOWN_SET, 0 };
+        return state;
+    }
+
+    CROIQPMap();
+
+    // width and height - map size in 16x16 blocks, bAlign32 - regions are aligned to 32x32
+    void Init(const std::vector<mfxExtEncoderROI>& roiData,
+              mfxU32 width,
+              mfxU32 height,
+              bool bAlign32);
+
+    // Fills progressive map with baseQP and regions of ROI entry nRoi, entries after
+    // the end of ROI data have no regions.
+    void FillFrame(mfxU32 nRoi, mfxI32 baseQP, mfxU8* pMap, AreaState& state) const;
+    // fills map area of one field, it has half of the map rows
+    void FillField(mfxU32 nRoi, mfxI32 baseQP, mfxU8* pMap, AreaState& state) const;
+
+protected:
+    struct Rect {
+        mfxU16 Left; // blocks
+        mfxU16 Top;
+        mfxU16 Right;
+        mfxU16 Bottom;
+        mfxI16 DeltaQP;
+    };
+    // regions in painting order, the first ROI of the entry is painted last and wins
+    struct RegionSet {
+        std::vector<Rect> Frame;
+        std::vector<Rect> Field;
+    };
+
+    void Fill(mfxU32 nSet,
+              bool bField,
+              mfxI32 baseQP,
+              mfxU32 height,
+              mfxU8* pMap,
+              AreaState& state) const;
+    void FillRect(const Rect& rect, mfxU8 qp, mfxU8* pMap) const;
+
+    mfxU32 m_nWidth;
+    mfxU32 m_nHeight;
+    std::vector<RegionSet> m_sets; // the first one has no regions
+    std::vector<mfxU32> m_setIdx; // region set of every ROI entry
+};
+
+} // namespace TranscodingSample
+
+#endif //__ROI_QP_MAP_H__
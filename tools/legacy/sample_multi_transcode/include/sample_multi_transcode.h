@@ -14,6 +14,7 @@
 
 #include "pipeline_transcode.h"
 #include "sample_utils.h"
+#include "session_control.h"
 #include "transcode_utils.h"
 #include "vpl_implementation_loader.h"
 
@@ -31,6 +32,8 @@
 
 #endif
 
+#include <functional>
+
 #ifndef MFX_VERSION
     #error MFX_VERSION not defined
 #endif
@@ -51,8 +54,20 @@ protected:
     virtual mfxStatus VerifyCrossSessionsOptions();
     virtual mfxStatus CreateSafetyBuffers();
     CascadeScalerConfig& CreateCascadeScalerConfig();
+    mfxStatus InitSession(mfxU32 idxSession,
+                          CTranscodingPipeline* pParentPipeline,
+                          SafetySurfaceBuffer* pBuffer,
+                          mfxHDL hdl,
+                          mfxVersion* pVer);
+    // calls func for every session: sessions of one group one by one in order of the par file,
+    // different groups concurrently
+    mfxStatus ForEachSessionGroup(const std::vector<mfxU32>& groups,
+                                  const std::function<mfxStatus(mfxU32)>& func);
     virtual void DoTranscoding();
     virtual void DoRobustTranscoding();
+    // executes commands of the control file, new sessions are initialized but not started
+    void ProcessControlCommands();
+    mfxStatus AddSession(const msdk_string& line);
 
     virtual void Close();
 
@@ -71,6 +86,8 @@ protected:
     std::vector<std::unique_ptr<FileBitstreamProcessor>> m_pExtBSProcArray;
     std::vector<std::shared_ptr<mfxAllocatorParams>> m_pAllocParams;
     std::vector<std::unique_ptr<CHWDevice>> m_hwdevs;
+    // device handle for each session
+    std::vector<mfxHDL> m_hdls;
     msdk_tick m_StartTime;
     // need to work with HW pipeline
     mfxHandleType m_eDevType;
@@ -82,6 +99,8 @@ protected:
     CascadeScalerConfig m_CSConfig;
     SMTTracer m_Tracer;
 
+    std::unique_ptr<CSessionControl> m_pControl;
+
 private:
     DISALLOW_COPY_AND_ASSIGN(Launcher);
 };
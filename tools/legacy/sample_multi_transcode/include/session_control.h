@@ -0,0 +1,62 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SESSION_CONTROL_H__
+#define __SESSION_CONTROL_H__
+
+#include <stdio.h>
+#include <vector>
+
+#include "sample_defs.h"
+
+namespace TranscodingSample {
+
+// Control channel of running application: a text file which is watched for appended lines,
+// one command per line. Commands written before the application starts are ignored, lines
+// are taken only when they are complete, so the writer may append them in parts.
+class CSessionControl {
+public:
+    enum CommandType {
+        CMD_ADD, // add <pipeline description>
+        CMD_STOP, // stop <session>
+        CMD_DRAIN, // drain <session>
+        CMD_BITRATE, // bitrate <session> <Kbps>
+        CMD_QUIT // quit
+    };
+    struct Command {
+        CommandType Type;
+        mfxU32 Session;
+        mfxU32 Bitrate; // Kbps
+        msdk_string Line; // pipeline description of the new session
+    };
+
+    CSessionControl();
+    ~CSessionControl();
+
+    mfxStatus Init(const msdk_char* fileName);
+    void Close();
+    bool IsOpen() const {
+        return m_pFile != NULL;
+    }
+
+    // commands of lines appended since the last call, invalid ones are reported and skipped
+    void ReadCommands(std::vector<Command>& commands);
+
+protected:
+    static bool ParseCommand(const msdk_string& line, Command& command);
+
+    FILE* m_pFile;
+    long m_offset; // the first byte not read yet
+    bool m_bSkipLine; // rest of too long line
+    std::vector<msdk_char> m_buf;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CSessionControl);
+};
+
+} // namespace TranscodingSample
+
+#endif //__SESSION_CONTROL_H__
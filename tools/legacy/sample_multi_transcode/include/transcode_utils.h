@@ -60,6 +60,14 @@ public:
     };
     void PrintParFileName();
     msdk_string GetLine(mfxU32 n);
+    const msdk_char* GetControlFileName() const {
+        return m_ctrlName;
+    }
+    // parses par file line of a session added at run time
+    mfxStatus ParseSessionLine(const msdk_string& line,
+                               TranscodingSample::sInputParams& InputParams);
+    // forgets the line of a session which wasn't added after all
+    void RemoveLastLine();
 
 protected:
     mfxStatus ParseParFile(FILE* file);
@@ -69,6 +77,9 @@ protected:
     static bool isspace(char a);
     static bool is_not_allowed_char(char a);
     bool ParseROIFile(msdk_char const* roi_file_name, std::vector<mfxExtEncoderROI>& m_ROIData);
+    static bool ParseROIBinary(const char* data,
+                               size_t size,
+                               std::vector<mfxExtEncoderROI>& m_ROIData);
 
     mfxStatus ParseParamsForOneSession(mfxU32 argc, msdk_char* argv[]);
     mfxStatus ParseOption__set(msdk_char* strCodecType, msdk_char* strPluginPath);
@@ -79,6 +90,7 @@ protected:
     std::map<mfxU32, sPluginParams> m_encoderPlugins;
     FILE* m_PerfFILE;
     msdk_char* m_parName;
+    msdk_char* m_ctrlName;
     mfxU32 statisticsWindowSize;
     FILE* statisticsLogFile;
     //store a name of a Logfile
@@ -87,6 +99,10 @@ protected:
     bool bRobustFlag;
     bool bSoftRobustFlag;
     bool shouldUseGreedyFormula;
+    bool bParallelInit;
+    bool bSysMemSlab;
+    bool bSysMemHugePages;
+    mfxI32 nSysMemNumaNode;
     std::vector<msdk_string> m_lines;
 
 private:
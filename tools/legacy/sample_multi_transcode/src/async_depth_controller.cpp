@@ -0,0 +1,160 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "async_depth_controller.h"
+
+#include <algorithm>
+
+namespace TranscodingSample {
+
+const mfxU32 ASYNC_MIN_WINDOW = 30;
+// throughput this much below the target still holds it
+const mfxF64 ASYNC_FPS_TOLERANCE = 0.03;
+// windows after which throughput measured at some depth is outdated
+const mfxU32 ASYNC_FPS_MAX_AGE = 20;
+const mfxU32 ASYNC_MAX_BACKOFF = 32;
+
+CAsyncDepthController::CAsyncDepthController()
+        : m_nMinDepth(0),
+          m_nMaxDepth(0),
+          m_nDepth(0),
+          m_targetFps(0),
+          m_nWindow(0),
+          m_windowStart(0),
+          m_nWindowFrames(0),
+          m_nSettle(0),
+          m_fps(),
+          m_age(),
+          m_nHold(0),
+          m_nBackoff(1),
+          m_bProbing(false),
+          m_bRefreshing(false),
+          m_nFrames(0),
+          m_nDepthSum(0),
+          m_nInFlightSum(0),
+          m_latencySum(0) {}
+
+void CAsyncDepthController::Init(mfxU16 minDepth, mfxU16 maxDepth, mfxF64 targetFps) {
+    m_nMaxDepth = std::max<mfxU16>(maxDepth, 1);
+    m_nMinDepth = std::min<mfxU16>(std::max<mfxU16>(minDepth, 1), m_nMaxDepth);
+    // start from the depth which gives the best throughput
+    m_nDepth    = m_nMaxDepth;
+    m_targetFps = targetFps;
+    m_nWindow   = std::max<mfxU32>(ASYNC_MIN_WINDOW, 4 * m_nMaxDepth);
+
+    m_windowStart   = 0;
+    m_nWindowFrames = 0;
+    m_nSettle       = m_nMaxDepth;
+    m_fps.assign(m_nMaxDepth + 1, 0);
+    m_age.assign(m_nMaxDepth + 1, ASYNC_FPS_MAX_AGE);
+    m_nHold       = 0;
+    m_nBackoff    = 1;
+    m_bProbing    = false;
+    m_bRefreshing = false;
+
+    m_nFrames      = 0;
+    m_nDepthSum    = 0;
+    m_nInFlightSum = 0;
+    m_latencySum   = 0;
+}
+
+void CAsyncDepthController::OnSync(msdk_tick latency, size_t nInFlight) {
+    const msdk_tick now = msdk_time_get_tick();
+
+    m_nFrames++;
+    m_nDepthSum += m_nDepth;
+    m_nInFlightSum += nInFlight;
+    m_latencySum += 1000.0 * latency / msdk_time_get_frequency();
+
+    if (!IsEnabled())
+        return;
+
+    // frames synced right after depth change don't show steady throughput
+    if (m_nSettle) {
+        m_nSettle--;
+        m_windowStart   = now;
+        m_nWindowFrames = 0;
+        return;
+    }
+
+    if (++m_nWindowFrames < m_nWindow)
+        return;
+
+    const mfxF64 time = MSDK_GET_TIME(now, m_windowStart, msdk_time_get_frequency());
+    const mfxU16 depth = m_nDepth;
+    if (time > 0)
+        UpdateDepth(m_nWindowFrames / time);
+
+    m_windowStart   = now;
+    m_nWindowFrames = 0;
+    if (depth != m_nDepth)
+        m_nSettle = m_nMaxDepth;
+}
+
+void CAsyncDepthController::UpdateDepth(mfxF64 fps) {
+    for (mfxU32& age : m_age)
+        age++;
+    m_fps[m_nDepth] = fps;
+    m_age[m_nDepth] = 0;
+
+    mfxF64 target = m_targetFps;
+    if (!target) {
+        // go up while it improves throughput, the next depth wasn't measured for long
+        if (m_nDepth < m_nMaxDepth && m_age[m_nDepth + 1] >= ASYNC_FPS_MAX_AGE &&
+            (!m_bRefreshing || fps > m_fps[m_nDepth - 1] * (1 + ASYNC_FPS_TOLERANCE))) {
+            m_nDepth++;
+            m_bRefreshing = true;
+            m_bProbing    = false;
+            return;
+        }
+        m_bRefreshing = false;
+
+        for (size_t depth = m_nDepth + 1; depth < m_fps.size(); depth++) {
+            if (m_age[depth] < ASYNC_FPS_MAX_AGE)
+                target = std::max(target, m_fps[depth]);
+        }
+    }
+
+    if (fps < target * (1 - ASYNC_FPS_TOLERANCE)) {
+        if (m_nDepth < m_nMaxDepth) {
+            // lower depth was just tried and failed, wait longer before the next try
+            if (m_bProbing)
+                m_nBackoff = std::min(2 * m_nBackoff, ASYNC_MAX_BACKOFF);
+            m_nHold = m_nBackoff;
+            m_nDepth++;
+        }
+        m_bProbing = false;
+        return;
+    }
+
+    if (m_bProbing)
+        m_nBackoff = 1;
+    m_bProbing = false;
+
+    if (m_nHold) {
+        m_nHold--;
+    }
+    else if (m_nDepth > m_nMinDepth) {
+        m_nDepth--;
+        m_bProbing = true;
+    }
+}
+
+mfxF64 CAsyncDepthController::GetAvgDepth() const {
+    return m_nFrames ? (mfxF64)m_nDepthSum / m_nFrames : m_nDepth;
+}
+
+mfxF64 CAsyncDepthController::GetAvgInFlight() const {
+    return m_nFrames ? (mfxF64)m_nInFlightSum / m_nFrames : 0;
+}
+
+mfxF64 CAsyncDepthController::GetAvgLatency() const {
+    return m_nFrames ? m_latencySum / m_nFrames : 0;
+}
+
+} // namespace TranscodingSample
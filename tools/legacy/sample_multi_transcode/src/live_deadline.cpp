@@ -0,0 +1,151 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "live_deadline.h"
+
+#include <algorithm>
+
+namespace TranscodingSample {
+
+const mfxF64 LIVE_TIMESTAMP_FREQ = 90000.0;
+// time stamp jump which is taken as a new start of time stamps, s
+const mfxF64 LIVE_MAX_TIMESTAMP_GAP = 1.0;
+// late frames after which decoder skips more
+const mfxU32 LIVE_LATE_FRAMES = 3;
+// frames in a row with half of max latency left after which decoder skips less
+const mfxU32 LIVE_EARLY_FRAMES = 60;
+// MFX_SKIPMODE_MORE steps, decoders don't skip more than that
+const mfxU32 LIVE_MAX_SKIP_LEVEL = 3;
+
+CLiveDeadline::CLiveDeadline()
+        : m_frameDuration(0),
+          m_maxLatency(0),
+          m_bStarted(false),
+          m_startTick(0),
+          m_firstTimeStamp(MFX_TIMESTAMP_UNKNOWN),
+          m_firstTime(0),
+          m_lastTime(0),
+          m_encodeTime(-1),
+          m_nSkipLevel(0),
+          m_nLateFrames(0),
+          m_nEarlyFrames(0),
+          m_nFrames(0),
+          m_nDropped(0),
+          m_nMaxSkipLevel(0) {}
+
+void CLiveDeadline::Init(mfxF64 frameRate, mfxU32 maxLatency) {
+    m_frameDuration = 1.0 / (frameRate > 0 ? frameRate : 30.0);
+    m_maxLatency    = maxLatency / 1000.0;
+    m_encodeTime    = -1;
+    m_nSkipLevel    = 0;
+    m_nLateFrames   = 0;
+    m_nEarlyFrames  = 0;
+    m_nFrames       = 0;
+    m_nDropped      = 0;
+    m_nMaxSkipLevel = 0;
+    Restart();
+}
+
+void CLiveDeadline::Restart() {
+    m_bStarted       = false;
+    m_startTick      = 0;
+    m_firstTimeStamp = MFX_TIMESTAMP_UNKNOWN;
+    m_firstTime      = 0;
+    m_lastTime       = 0;
+}
+
+mfxF64 CLiveDeadline::GetPresentationTime(const mfxFrameSurface1& surface) {
+    const mfxF64 expected = m_bStarted ? m_lastTime + m_frameDuration : 0;
+    const mfxU64 ts       = surface.Data.TimeStamp;
+    if ((mfxU64)MFX_TIMESTAMP_UNKNOWN == ts)
+        return expected;
+
+    if ((mfxU64)MFX_TIMESTAMP_UNKNOWN == m_firstTimeStamp || ts < m_firstTimeStamp) {
+        m_firstTimeStamp = ts;
+        m_firstTime      = expected;
+    }
+    const mfxF64 time = m_firstTime + (ts - m_firstTimeStamp) / LIVE_TIMESTAMP_FREQ;
+
+    // streams without time stamps have them all equal
+    if (m_bStarted && time <= m_lastTime)
+        return expected;
+    // discontinuity, time stamps are counted from this frame
+    if (time > expected + LIVE_MAX_TIMESTAMP_GAP) {
+        m_firstTimeStamp = ts;
+        m_firstTime      = expected;
+        return expected;
+    }
+    return time;
+}
+
+bool CLiveDeadline::OnFrame(const mfxFrameSurface1& surface) {
+    if (!IsEnabled())
+        return false;
+
+    m_nFrames++;
+    const mfxF64 time        = GetPresentationTime(surface);
+    const msdk_tick freq     = msdk_time_get_frequency();
+    const msdk_tick timeTick = (msdk_tick)(time * freq);
+
+    msdk_tick now = msdk_time_get_tick();
+    if (!m_bStarted) {
+        // the first frame is presented right when it is decoded
+        m_startTick = now - timeTick;
+        m_bStarted  = true;
+    }
+    m_lastTime = time;
+
+    // frames decoded ahead of time wait as they would for a live source
+    const msdk_tick presentTick = m_startTick + timeTick;
+    if (now < presentTick) {
+        MSDK_SLEEP((mfxU32)(1000 * (presentTick - now) / freq));
+        now = msdk_time_get_tick();
+    }
+
+    // time left after the frame is encoded
+    const mfxF64 slack = time + m_maxLatency - MSDK_GET_TIME(now, m_startTick, freq) -
+                         std::max(m_encodeTime, 0.0);
+    const bool bLate = slack < 0;
+
+    UpdateSkipLevel(bLate, slack);
+    if (bLate)
+        m_nDropped++;
+    return bLate;
+}
+
+void CLiveDeadline::OnOutput(msdk_tick latency) {
+    if (!IsEnabled())
+        return;
+
+    const mfxF64 time = (mfxF64)latency / msdk_time_get_frequency();
+    m_encodeTime      = m_encodeTime < 0 ? time : 0.9 * m_encodeTime + 0.1 * time;
+}
+
+void CLiveDeadline::UpdateSkipLevel(bool bLate, mfxF64 slack) {
+    if (bLate) {
+        m_nEarlyFrames = 0;
+        if (++m_nLateFrames >= LIVE_LATE_FRAMES && m_nSkipLevel < LIVE_MAX_SKIP_LEVEL) {
+            m_nSkipLevel++;
+            m_nMaxSkipLevel = std::max(m_nMaxSkipLevel, m_nSkipLevel);
+            m_nLateFrames   = 0;
+        }
+        return;
+    }
+
+    if (slack < m_maxLatency / 2) {
+        m_nEarlyFrames = 0;
+        return;
+    }
+    if (++m_nEarlyFrames >= LIVE_EARLY_FRAMES && m_nSkipLevel) {
+        m_nSkipLevel--;
+        m_nEarlyFrames = 0;
+        m_nLateFrames  = 0;
+    }
+}
+
+} // namespace TranscodingSample
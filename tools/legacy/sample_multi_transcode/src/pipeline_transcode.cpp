@@ -100,6 +100,8 @@ sInputParams::sInputParams()
     dGfxIdx     = -1;
     adapterNum  = -1;
 
+    nSysMemNumaNode = -1;
+
     MaxFrameNumber   = MFX_INFINITE;
     pVppCompDstRects = NULL;
     m_hwdev          = NULL;
@@ -141,12 +143,15 @@ CTranscodingPipeline::CTranscodingPipeline()
           m_DecOutAllocReques({ 0 }),
           m_VPPOutAllocReques({ 0 }),
           m_CSSurfacePools(),
+          m_CSPoolSurfaces(),
           m_EncSurfaceType(0),
           m_DecSurfaceType(0),
           m_pPreEncAuxPool(),
           m_BSPool(),
           m_initPar(),
           m_bForceStop(false),
+          m_bDrainSession(false),
+          m_nNewBitrate(0),
           m_forceSyncAllSession(false),
           m_pSurfaceUtilizationSynchronizer(),
           m_decoderPluginParams(),
@@ -170,6 +175,10 @@ CTranscodingPipeline::CTranscodingPipeline()
           m_tabDoUseAlg{ 0 },
           m_nID(0),
           m_AsyncDepth(0),
+          m_AsyncDepthCtrl(),
+          m_LiveDeadline(),
+          m_nDecSkipLevel(0),
+          m_bDecSkipSupported(true),
           m_nProcessedFramesNum(0),
           m_bIsJoinSession(false),
           m_bAllocHint(),
@@ -208,6 +217,8 @@ CTranscodingPipeline::CTranscodingPipeline()
           m_bUseQPMap(0),
           m_bufExtMBQP(),
           m_qpMapStorage(),
+          m_qpMapState(),
+          m_ROIQPMap(),
           m_extBuffPtrStorage(),
           encControlStorage(),
           m_QPmapWidth(0),
@@ -615,6 +626,22 @@ mfxStatus CTranscodingPipeline::DecodeOneFrame(ExtendedSurface* pExtSurface) {
     return sts;
 
 } // mfxStatus CTranscodingPipeline::DecodeOneFrame(ExtendedSurface *pExtSurface)
+void CTranscodingPipeline::UpdateDecoderSkipMode() {
+    while (m_bDecSkipSupported && m_nDecSkipLevel != m_LiveDeadline.GetSkipLevel()) {
+        const bool bMore = m_nDecSkipLevel < m_LiveDeadline.GetSkipLevel();
+        mfxStatus sts    = m_pmfxDEC->SetSkipMode(bMore ? MFX_SKIPMODE_MORE : MFX_SKIPMODE_LESS);
+        if (MFX_ERR_NONE != sts) {
+            // frames are still dropped after decoding
+            m_bDecSkipSupported = false;
+            break;
+        }
+        if (bMore)
+            m_nDecSkipLevel++;
+        else
+            m_nDecSkipLevel--;
+    }
+}
+
 mfxStatus CTranscodingPipeline::DecodeLastFrame(ExtendedSurface* pExtSurface) {
     MFX_ITT_TASK("DecodeLastFrame");
     mfxFrameSurface1* pmfxSurface = NULL;
@@ -938,6 +965,19 @@ void CTranscodingPipeline::StopSession() {
     msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
 }
 
+void CTranscodingPipeline::DrainSession() {
+    m_bDrainSession = true;
+
+    msdk_stringstream ss;
+    ss << MSDK_STRING("session [") << GetSessionText() << MSDK_STRING("] is draining")
+       << std::endl;
+    msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
+}
+
+void CTranscodingPipeline::SetBitrate(mfxU32 kbps) {
+    m_nNewBitrate = kbps;
+}
+
 mfxStatus CTranscodingPipeline::CheckStopCondition() {
     std::unique_lock<std::mutex> lock(m_mStopSession);
     if (m_bForceStop) {
@@ -1088,9 +1128,14 @@ mfxStatus CTranscodingPipeline::Decode() {
                 }
                 else {
                     if (m_ScalerConfig.CascadeScalerRequired) {
-                        ExtendedSurface InSurface = DecExtSurface;
+                        ExtendedSurface InSurface       = DecExtSurface;
+                        m_CSPoolSurfaces[DecoderPoolID] = DecExtSurface;
                         for (auto desc : m_ScalerConfig.Targets) {
-                            if (desc.CascadeScaler) {
+                            if (desc.CascadeScaler && desc.SharedPool) {
+                                //no VPP, the frame is already in the shared pool
+                                VppExtSurface = InSurface = m_CSPoolSurfaces[desc.PoolID];
+                            }
+                            else if (desc.CascadeScaler) {
                                 sts = VPPOneFrame(&InSurface, &VppExtSurface, desc.TargetID);
                                 if (sts == MFX_ERR_NONE) {
                                     IncreaseReference(*VppExtSurface.pSurface);
@@ -1106,6 +1151,7 @@ mfxStatus CTranscodingPipeline::Decode() {
                                 else {
                                     return MFX_ERR_UNKNOWN;
                                 }
+                                m_CSPoolSurfaces[desc.PoolID] = VppExtSurface;
                             }
                             else {
                                 VppExtSurface = InSurface;
@@ -1201,7 +1247,7 @@ mfxStatus CTranscodingPipeline::Decode() {
             //unlock out surfaces
             for (auto& s : OutSurfaces) {
                 auto desc = m_ScalerConfig.GetDesc(s.TargetID);
-                if (desc.CascadeScaler) {
+                if (desc.CascadeScaler && !desc.SharedPool) {
                     DecreaseReference(*s.pSurface);
                 }
             }
@@ -1450,6 +1496,7 @@ mfxStatus CTranscodingPipeline::Encode() {
         if (!pBS)
             return MFX_ERR_NOT_FOUND;
 
+        pBS->SubmitTime = msdk_time_get_tick();
         m_BSPool.push_back(pBS);
 
         mfxU32 NumFramesForReset =
@@ -1571,9 +1618,12 @@ mfxStatus CTranscodingPipeline::Encode() {
         }
 
         if ((m_nVPPCompEnable != VppCompOnly) || (m_nVPPCompEnable == VppCompOnlyEncode)) {
-            if (m_BSPool.size() == m_AsyncDepth) {
-                sts = PutBS();
-                MSDK_CHECK_STATUS(sts, "PutBS failed");
+            if (m_BSPool.size() >= m_AsyncDepthCtrl.GetDepth()) {
+                // more than one frame is synced after depth is lowered
+                while (m_BSPool.size() >= m_AsyncDepthCtrl.GetDepth()) {
+                    sts = PutBS();
+                    MSDK_CHECK_STATUS(sts, "PutBS failed");
+                }
             }
             else {
                 continue;
@@ -1632,55 +1682,31 @@ mfxStatus CTranscodingPipeline::Encode() {
 
 } // mfxStatus CTranscodingPipeline::Encode()
 
-void CTranscodingPipeline::FillMBQPBuffer(mfxExtMBQP& qpMap, mfxU16 pictStruct) {
+void CTranscodingPipeline::FillMBQPBuffer(mfxExtMBQP& qpMap,
+                                          QPMapState& state,
+                                          mfxU16 pictStruct) {
     // External MBQP case
     if (m_bExtMBQP) {
-        // Use simplistic approach to fill in QP buffer
-        for (size_t i = 0; i < qpMap.NumQPAlloc; i++) {
-            qpMap.QP[i] = i % 52;
+        // Use simplistic approach to fill in QP buffer, the same for every frame
+        if (!state.bValid) {
+            for (size_t i = 0; i < qpMap.NumQPAlloc; i++) {
+                qpMap.QP[i] = i % 52;
+            }
+            state.bValid = true;
         }
         return;
     }
 
-    // External MBQP with ROI case
-    if (pictStruct == MFX_PICSTRUCT_PROGRESSIVE) {
-        mfxI8 fQP = (m_nSubmittedFramesNum % m_GOPSize) ? (mfxI8)m_QPforP : (mfxI8)m_QPforI;
-        std::memset(qpMap.QP, fQP, qpMap.NumQPAlloc);
-
-        //        printf("QP expectation: %d, map PTR %lld\n",fQP,(long long int)qpMap.QP);
-
-        if (m_ROIData.size() > m_nSubmittedFramesNum) {
-            mfxExtEncoderROI& roi = m_ROIData[m_nSubmittedFramesNum];
-            for (mfxI32 i = roi.NumROI - 1; i >= 0; i--) {
-                mfxU32 l = (roi.ROI[i].Left) >> 4, t = (roi.ROI[i].Top) >> 4,
-                       r = (roi.ROI[i].Right + 15) >> 4, b = (roi.ROI[i].Bottom + 15) >> 4;
-
-                //Additional 32x32 block alignment for HEVC VDEnc, using caps could be better
-                if (m_mfxEncParams.mfx.CodecId == MFX_CODEC_HEVC &&
-                    m_mfxEncParams.mfx.LowPower == MFX_CODINGOPTION_ON) {
-                    l = ((roi.ROI[i].Left) >> 5) << 1;
-                    t = ((roi.ROI[i].Top) >> 5) << 1;
-                    r = ((roi.ROI[i].Right + 31) >> 5) << 1;
-                    b = ((roi.ROI[i].Bottom + 31) >> 5) << 1;
-                }
-
-                if (l > m_QPmapWidth)
-                    l = m_QPmapWidth;
-                if (r > m_QPmapWidth)
-                    r = m_QPmapWidth;
-                if (t > m_QPmapHeight)
-                    t = m_QPmapHeight;
-                if (b > m_QPmapHeight)
-                    b = m_QPmapHeight;
-
-                mfxI8 qp_value = (mfxI8)std::min(std::max(fQP + (mfxI8)roi.ROI[i].DeltaQP, 0), 51);
-
-                for (mfxU32 k = t; k < b; k++)
-                    std::memset(qpMap.QP + k * m_QPmapWidth + l, qp_value, r - l);
-            }
-        }
+    // map layout depends on picture structure
+    if (!state.bValid || state.PicStruct != pictStruct) {
+        state.bValid    = true;
+        state.PicStruct = pictStruct;
+        state.Area[0]   = CROIQPMap::UnknownArea();
+        state.Area[1]   = CROIQPMap::UnknownArea();
     }
-    else if (pictStruct == MFX_PICSTRUCT_FIELD_TFF || pictStruct == MFX_PICSTRUCT_FIELD_BFF) {
+
+    // External MBQP with ROI case
+    if (pictStruct == MFX_PICSTRUCT_FIELD_TFF || pictStruct == MFX_PICSTRUCT_FIELD_BFF) {
         mfxU32 fQP[2]  = { (m_nSubmittedFramesNum % m_GOPSize) ? m_QPforP : m_QPforI,
                           (m_GOPSize > 1) ? m_QPforP : m_QPforI };
         mfxU32 fIdx[2] = { 2 * m_nSubmittedFramesNum, 2 * m_nSubmittedFramesNum + 1 };
@@ -1689,33 +1715,18 @@ void CTranscodingPipeline::FillMBQPBuffer(mfxExtMBQP& qpMap, mfxU16 pictStruct)
         fOff[(pictStruct == MFX_PICSTRUCT_FIELD_BFF) ? 0 : 1] = qpMap.NumQPAlloc / 2;
 
         for (int fld = 0; fld <= 1; fld++) {
-            std::memset(qpMap.QP + fOff[fld], fQP[fld], qpMap.NumQPAlloc / 2);
-            if (m_ROIData.size() > fIdx[fld]) {
-                mfxExtEncoderROI& roi = m_ROIData[fIdx[fld]];
-                for (mfxI32 i = roi.NumROI - 1; i >= 0; i--) {
-                    mfxU32 l = (roi.ROI[i].Left) >> 4, t = (roi.ROI[i].Top) >> 5,
-                           r = (roi.ROI[i].Right + 15) >> 4, b = (roi.ROI[i].Bottom + 31) >> 5;
-                    mfxI8 qp_delta = (mfxI8)roi.ROI[i].DeltaQP;
-                    mfxU8 roi_qp   = (mfxU8)std::min(std::max(mfxI8(fQP[fld]) + qp_delta, 0), 51);
-
-                    if (l > m_QPmapWidth)
-                        l = m_QPmapWidth;
-                    if (r > m_QPmapWidth)
-                        r = m_QPmapWidth;
-                    if (t > m_QPmapHeight / 2)
-                        t = m_QPmapHeight / 2;
-                    if (b > m_QPmapHeight / 2)
-                        b = m_QPmapHeight / 2;
-
-                    for (mfxU32 k = t; k < b; k++)
-                        std::memset(qpMap.QP + fOff[fld] + k * m_QPmapWidth + l, roi_qp, r - l);
-                }
-            }
+            m_ROIQPMap.FillField(fIdx[fld],
+                                 (mfxI32)fQP[fld],
+                                 qpMap.QP + fOff[fld],
+                                 state.Area[fOff[fld] ? 1 : 0]);
         }
     }
     else {
-        mfxI8 fQP = (m_nSubmittedFramesNum % m_GOPSize) ? (mfxI8)m_QPforP : (mfxI8)m_QPforI;
-        std::memset(qpMap.QP, fQP, qpMap.NumQPAlloc);
+        mfxU32 fQP = (m_nSubmittedFramesNum % m_GOPSize) ? m_QPforP : m_QPforI;
+        // regions are applied to progressive frames only
+        mfxU32 nRoi = (pictStruct == MFX_PICSTRUCT_PROGRESSIVE) ? m_nSubmittedFramesNum
+                                                                 : (mfxU32)m_ROIData.size();
+        m_ROIQPMap.FillFrame(nRoi, (mfxI32)fQP, qpMap.QP, state.Area[0]);
     }
 }
 
@@ -1741,6 +1752,7 @@ void CTranscodingPipeline::SetEncCtrlRT(ExtendedSurface& extSurface, bool bInser
             m_bufExtMBQP[keyId].NumQPAlloc      = m_QPmapWidth * m_QPmapHeight;
             m_bufExtMBQP[keyId].QP =
                 m_QPmapWidth && m_QPmapHeight ? &(m_qpMapStorage[keyId][0]) : NULL;
+            m_qpMapState[keyId] = QPMapState();
         }
 
         // Initialize *pCtrl optionally copying content of the pExtSurface.pAuxCtrl.encCtrl
@@ -1751,29 +1763,31 @@ void CTranscodingPipeline::SetEncCtrlRT(ExtendedSurface& extSurface, bool bInser
             ctrl = *extSurface.pEncCtrl;
         }
 
-        // Copy all extended buffer pointers from pExtSurface.pAuxCtrl.encCtrl
-        m_extBuffPtrStorage[keyId].clear();
+        // Copy all extended buffer pointers from pExtSurface.pAuxCtrl.encCtrl,
+        // storage keeps its capacity between frames
+        std::vector<mfxExtBuffer*>& extBuffPtrs = m_extBuffPtrStorage[keyId];
+        extBuffPtrs.clear();
         if (extSurface.pAuxCtrl) {
             for (unsigned int i = 0; i < ctrl.NumExtParam; i++) {
-                m_extBuffPtrStorage[keyId].push_back(extSurface.pAuxCtrl->encCtrl.ExtParam[i]);
+                extBuffPtrs.push_back(extSurface.pAuxCtrl->encCtrl.ExtParam[i]);
             }
         }
 
         // Attach additional buffer with either MBQP or ROI information
         if (m_bUseQPMap) {
-            FillMBQPBuffer(m_bufExtMBQP[keyId], extSurface.pSurface->Info.PicStruct);
-            m_extBuffPtrStorage[keyId].push_back((mfxExtBuffer*)&m_bufExtMBQP[keyId]);
+            mfxExtMBQP& extMBQP = m_bufExtMBQP[keyId];
+            FillMBQPBuffer(extMBQP, m_qpMapState[keyId], extSurface.pSurface->Info.PicStruct);
+            extBuffPtrs.push_back((mfxExtBuffer*)&extMBQP);
         }
         else {
             if (m_ROIData.size() > m_nSubmittedFramesNum)
-                m_extBuffPtrStorage[keyId].push_back(
-                    (mfxExtBuffer*)&m_ROIData[m_nSubmittedFramesNum]);
+                extBuffPtrs.push_back((mfxExtBuffer*)&m_ROIData[m_nSubmittedFramesNum]);
         }
 
         // Replace the buffers pointer to pre-allocated storage
-        ctrl.NumExtParam = (mfxU16)m_extBuffPtrStorage[keyId].size();
+        ctrl.NumExtParam = (mfxU16)extBuffPtrs.size();
         if (ctrl.NumExtParam) {
-            ctrl.ExtParam = &(m_extBuffPtrStorage[keyId][0]);
+            ctrl.ExtParam = extBuffPtrs.data();
         }
 
         extSurface.pEncCtrl = &ctrl;
@@ -1811,7 +1825,7 @@ mfxStatus CTranscodingPipeline::Transcode() {
 
         if (time(0) - start >= m_nTimeout)
             bLastCycle = true;
-        if (m_MaxFramesForTranscode == m_nProcessedFramesNum) {
+        if (m_MaxFramesForTranscode == m_nProcessedFramesNum || m_bDrainSession) {
             DecExtSurface.pSurface = NULL; // to get buffered VPP or ENC frames
             bNeedDecodedFrames     = false; // no more decoded frames needed
         }
@@ -1827,6 +1841,7 @@ mfxStatus CTranscodingPipeline::Transcode() {
 
                         m_pBSProcessor->ResetInput();
                         m_pBSProcessor->ResetOutput();
+                        m_LiveDeadline.Restart();
                         bNeedDecodedFrames = true;
 
                         bEndOfFile = false;
@@ -1848,6 +1863,24 @@ mfxStatus CTranscodingPipeline::Transcode() {
                 sts                    = MFX_ERR_NONE;
             }
             MSDK_CHECK_STATUS(sts, "Decode<One|Last>Frame failed");
+
+            // live mode: frame which can't meet its deadline goes no further than decoder
+            if (m_LiveDeadline.IsEnabled() && DecExtSurface.pSurface && !m_bIsFieldWeaving &&
+                !m_bIsFieldSplitting) {
+                const bool bDrop = m_LiveDeadline.OnFrame(*DecExtSurface.pSurface);
+                if (m_pmfxDEC.get())
+                    UpdateDecoderSkipMode();
+                if (bDrop) {
+                    if (m_MemoryModel != GENERAL_ALLOC) {
+                        mfxStatus sts_release =
+                            DecExtSurface.pSurface->FrameInterface->Release(DecExtSurface.pSurface);
+                        MSDK_CHECK_STATUS(sts_release, "FrameInterface->Release failed");
+                    }
+                    DecExtSurface.pSurface = NULL;
+                    m_nProcessedFramesNum++;
+                    continue;
+                }
+            }
         }
         if (m_bIsFieldWeaving && DecExtSurface.pSurface != NULL) {
             m_mfxDecParams.mfx.FrameInfo.PicStruct = DecExtSurface.pSurface->Info.PicStruct;
@@ -1934,11 +1967,17 @@ mfxStatus CTranscodingPipeline::Transcode() {
 
         MSDK_CHECK_STATUS(sts, "Unexpected error!!");
 
+        if (m_nNewBitrate && VppExtSurface.pSurface) {
+            sts = ApplyNewBitrate();
+            MSDK_CHECK_STATUS(sts, "ApplyNewBitrate failed");
+        }
+
         // encode frame
         pBS = m_pBSStore->GetNext();
         if (!pBS)
             return MFX_ERR_NOT_FOUND;
 
+        pBS->SubmitTime = msdk_time_get_tick();
         m_BSPool.push_back(pBS);
 
         // Set Encoding control if it is required.
@@ -2000,7 +2039,8 @@ mfxStatus CTranscodingPipeline::Transcode() {
 
         m_BSPool.back()->Syncp = VppExtSurface.Syncp;
 
-        if (m_BSPool.size() == m_AsyncDepth) {
+        // more than one frame is synced after depth is lowered
+        while (m_BSPool.size() >= m_AsyncDepthCtrl.GetDepth()) {
             sts = PutBS();
             MSDK_CHECK_STATUS(sts, "PutBS failed");
         }
@@ -2051,6 +2091,8 @@ mfxStatus CTranscodingPipeline::PutBS() {
         }
     }
 
+    m_AsyncDepthCtrl.OnSync(msdk_time_get_tick() - pBitstreamEx->SubmitTime, m_BSPool.size());
+    m_LiveDeadline.OnOutput(msdk_time_get_tick() - pBitstreamEx->SubmitTime);
     m_nOutputFramesNum++;
 
     //--- Time measurements
@@ -2074,6 +2116,83 @@ mfxStatus CTranscodingPipeline::PutBS() {
     return sts;
 } //mfxStatus CTranscodingPipeline::PutBS()
 
+mfxStatus CTranscodingPipeline::ApplyNewBitrate() {
+    const mfxU32 kbps = m_nNewBitrate.exchange(0);
+    mfxInfoMFX& mfx   = m_mfxEncParams.mfx;
+
+    msdk_stringstream ss;
+    ss << MSDK_STRING("session [") << GetSessionText() << MSDK_STRING("] ");
+    if (!m_pmfxENC.get() || MFX_RATECONTROL_CQP == mfx.RateControlMethod ||
+        MFX_RATECONTROL_ICQ == mfx.RateControlMethod ||
+        MFX_RATECONTROL_LA_ICQ == mfx.RateControlMethod) {
+        ss << MSDK_STRING("has no bitrate to change") << std::endl;
+        msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
+        return MFX_ERR_NONE;
+    }
+
+    // frames buffered in encoder are output before Reset
+    mfxStatus sts                = MFX_ERR_NONE;
+    ExtendedSurface flushSurface = {};
+    for (;;) {
+        ExtendedBS* pBS = m_pBSStore->GetNext();
+        if (!pBS)
+            return MFX_ERR_NOT_FOUND;
+
+        pBS->SubmitTime = msdk_time_get_tick();
+        m_BSPool.push_back(pBS);
+
+        sts = EncodeOneFrame(&flushSurface, &pBS->Bitstream);
+        if (MFX_ERR_MORE_DATA == sts) {
+            m_BSPool.pop_back();
+            m_pBSStore->Release(pBS);
+            break;
+        }
+        MSDK_CHECK_STATUS(sts, "EncodeOneFrame failed");
+
+        pBS->Syncp = flushSurface.Syncp;
+        while (m_BSPool.size() >= m_AsyncDepthCtrl.GetDepth()) {
+            sts = PutBS();
+            MSDK_CHECK_STATUS(sts, "PutBS failed");
+        }
+    }
+    while (m_BSPool.size()) {
+        sts = PutBS();
+        MSDK_CHECK_STATUS(sts, "PutBS failed");
+    }
+
+    const mfxU16 oldTargetKbps = mfx.TargetKbps;
+    const mfxU16 oldMaxKbps    = mfx.MaxKbps;
+    const mfxU32 multiplier    = std::max<mfxU16>(mfx.BRCParamMultiplier, 1);
+
+    mfx.TargetKbps = (mfxU16)std::min<mfxU32>(kbps / multiplier, 0xffff);
+    // peak bitrate keeps its ratio to the target one
+    if (oldTargetKbps && oldMaxKbps) {
+        mfx.MaxKbps =
+            (mfxU16)std::min<mfxU32>((mfxU32)oldMaxKbps * mfx.TargetKbps / oldTargetKbps, 0xffff);
+    }
+
+    sts = m_pmfxENC->Reset(&m_mfxEncParams);
+    MSDK_IGNORE_MFX_STS(sts, MFX_WRN_INCOMPATIBLE_VIDEO_PARAM);
+    if (MFX_ERR_NONE != sts) {
+        ss << MSDK_STRING("failed to change bitrate to ") << kbps << MSDK_STRING(" Kbps, status ")
+           << StatusToString(sts) << std::endl;
+        msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
+
+        mfx.TargetKbps = oldTargetKbps;
+        mfx.MaxKbps    = oldMaxKbps;
+        sts            = m_pmfxENC->Reset(&m_mfxEncParams);
+        MSDK_IGNORE_MFX_STS(sts, MFX_WRN_INCOMPATIBLE_VIDEO_PARAM);
+        MSDK_CHECK_STATUS(sts, "m_pmfxENC->Reset failed");
+        return sts;
+    }
+
+    ss << MSDK_STRING("bitrate is changed to ") << mfx.TargetKbps * multiplier
+       << MSDK_STRING(" Kbps") << std::endl;
+    msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
+    return sts;
+
+} //mfxStatus CTranscodingPipeline::ApplyNewBitrate()
+
 mfxStatus CTranscodingPipeline::DumpSurface2File(mfxFrameSurface1* pSurf) {
     mfxStatus sts = MFX_ERR_NONE;
 
@@ -3123,38 +3242,6 @@ mfxStatus CTranscodingPipeline::AllocFrames(mfxFrameAllocRequest* pRequest, bool
 
 } // mfxStatus CTranscodingPipeline::AllocFrames(Component* pComp, mfxFrameAllocResponse* pMfxResponse, mfxVideoParam* pMfxVideoParam)
 
-mfxStatus CTranscodingPipeline::AllocFramesForCS() {
-    if (m_MemoryModel != GENERAL_ALLOC) {
-        return MFX_ERR_MEMORY_ALLOC;
-    }
-
-    for (auto& p : m_ScalerConfig.Pools) {
-        auto& PoolDesc = p.second;
-
-        if (PoolDesc.ID == DecoderPoolID) {
-            continue;
-        }
-
-        mfxStatus sts = MFX_ERR_NONE;
-        sts =
-            m_pMFXAllocator->Alloc(m_pMFXAllocator->pthis, &PoolDesc.AllocReq, &PoolDesc.AllocResp);
-        MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Alloc failed");
-
-        SurfPointersArray pool;
-        for (mfxU32 i = 0; i < PoolDesc.AllocResp.NumFrameActual; i++) {
-            mfxFrameSurface1* surface = new mfxFrameSurface1();
-            MSDK_CHECK_POINTER(surface, MFX_ERR_MEMORY_ALLOC);
-            surface->Info       = PoolDesc.AllocReq.Info;
-            surface->Data.MemId = PoolDesc.AllocResp.mids[i];
-            pool.push_back(surface);
-            m_EncSurfaceType = PoolDesc.AllocReq.Type;
-        }
-        m_CSSurfacePools[PoolDesc.ID] = pool;
-    }
-
-    return MFX_ERR_NONE;
-}
-
 //return true if correct
 static bool CheckAsyncDepth(mfxFrameAllocRequest& curReq, mfxU16 asyncDepth) {
     return (curReq.NumFrameSuggested >= asyncDepth);
@@ -3199,6 +3286,65 @@ static void SumAllocRequest(mfxFrameAllocRequest& curReq, mfxFrameAllocRequest&
     }
 }
 
+// Consumers of a pool read the same frames, unless greedy formula is requested the pool needs
+// as many surfaces as the most demanding of them rather than their sum.
+void CTranscodingPipeline::AddPoolConsumer(CascadeScalerConfig::PoolDescritpor& PoolDesc,
+                                           mfxFrameAllocRequest& Req) {
+    mfxU16 NumFrames = std::max(PoolDesc.ConsumerReq.NumFrameSuggested, Req.NumFrameSuggested);
+    SumAllocRequest(PoolDesc.ConsumerReq, Req);
+    if (!shouldUseGreedyFormula) {
+        PoolDesc.ConsumerReq.NumFrameSuggested = PoolDesc.ConsumerReq.NumFrameMin = NumFrames;
+    }
+    PoolDesc.RefCount++;
+}
+
+mfxStatus CTranscodingPipeline::AllocFramesForCS() {
+    if (m_MemoryModel != GENERAL_ALLOC) {
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+
+    for (auto& p : m_ScalerConfig.Pools) {
+        auto& PoolDesc = p.second;
+
+        if (PoolDesc.ID == DecoderPoolID) {
+            continue;
+        }
+
+        mfxStatus sts            = MFX_ERR_NONE;
+        mfxFrameAllocRequest Req = PoolDesc.AllocReq;
+        SumAllocRequest(Req, PoolDesc.ConsumerReq);
+
+        // Async depth is counted by both VPP and consumers as in CorrectAsyncDepth, and every
+        // consumer after the first one may run async depth frames behind the others.
+        if (!m_forceSyncAllSession && !shouldUseGreedyFormula) {
+            sts = CorrectAsyncDepth(Req, m_AsyncDepth);
+            MSDK_CHECK_STATUS(sts, "CorrectAsyncDepth failed");
+
+            if (PoolDesc.RefCount > 1) {
+                Req.NumFrameSuggested = Req.NumFrameMin =
+                    (mfxU16)(Req.NumFrameSuggested + (PoolDesc.RefCount - 1) * m_AsyncDepth);
+            }
+        }
+        PoolDesc.Size = Req.NumFrameSuggested;
+
+        sts = m_pMFXAllocator->Alloc(m_pMFXAllocator->pthis, &Req, &PoolDesc.AllocResp);
+        MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Alloc failed");
+
+        SurfPointersArray pool;
+        for (mfxU32 i = 0; i < PoolDesc.AllocResp.NumFrameActual; i++) {
+            mfxFrameSurface1* surface = new mfxFrameSurface1();
+            MSDK_CHECK_POINTER(surface, MFX_ERR_MEMORY_ALLOC);
+            surface->Info       = Req.Info;
+            surface->Data.MemId = PoolDesc.AllocResp.mids[i];
+            pool.push_back(surface);
+            m_EncSurfaceType = Req.Type;
+        }
+        m_CSSurfacePools[PoolDesc.ID] = pool;
+    }
+
+    return MFX_ERR_NONE;
+}
+
 mfxStatus CTranscodingPipeline::SetupSurfacePool(mfxU32 preallocateNum) {
     mfxStatus sts   = MFX_ERR_NONE;
     bool bAddFrames = true; // correct shared pool between session
@@ -3372,7 +3518,7 @@ mfxStatus CTranscodingPipeline::CalculateNumberOfReqFrames(mfxFrameAllocRequest&
                     SumAllocRequest(PoolDesc.AllocReq, VppRequest[1]);
                 }
                 else {
-                    SumAllocRequest(m_ScalerConfig.Pools[PoolDesc.PrevID].AllocReq, VppRequest[0]);
+                    AddPoolConsumer(m_ScalerConfig.Pools[PoolDesc.PrevID], VppRequest[0]);
                     SumAllocRequest(PoolDesc.AllocReq, VppRequest[1]);
                 }
             }
@@ -3435,14 +3581,10 @@ mfxStatus CTranscodingPipeline::CalculateNumberOfReqFrames(mfxFrameAllocRequest&
 
 void CTranscodingPipeline::CorrectNumberOfAllocatedFrames(mfxFrameAllocRequest* pNewReq,
                                                           mfxU32 ID) {
-    if (m_ScalerConfig.CascadeScalerRequired && TargetID == DecoderTargetID) {
-        const auto& desc = m_ScalerConfig.GetDesc(ID);
-        if (desc.PoolID == DecoderPoolID) {
-            SumAllocRequest(m_Request, *pNewReq);
-        }
-        else {
-            SumAllocRequest(m_ScalerConfig.Pools[desc.PoolID].AllocReq, *pNewReq);
-        }
+    const auto& desc = m_ScalerConfig.GetDesc(ID);
+    if (m_ScalerConfig.CascadeScalerRequired && TargetID == DecoderTargetID &&
+        desc.PoolID != DecoderPoolID) {
+        AddPoolConsumer(m_ScalerConfig.Pools[desc.PoolID], *pNewReq);
     }
     else {
         if (shouldUseGreedyFormula) {
@@ -3544,6 +3686,9 @@ mfxStatus CTranscodingPipeline::Init(sInputParams* pParams,
     m_nTimeout = pParams->nTimeout;
 
     m_AsyncDepth            = (0 == pParams->nAsyncDepth) ? 1 : pParams->nAsyncDepth;
+    m_AsyncDepthCtrl.Init(pParams->nAsyncDepthMin ? pParams->nAsyncDepthMin : m_AsyncDepth,
+                          m_AsyncDepth,
+                          pParams->dAsyncTargetFps ? pParams->dAsyncTargetFps : pParams->nFPS);
     m_FrameNumberPreference = pParams->FrameNumberPreference;
     m_numEncoders           = 0;
     m_bUseOverlay           = pParams->DecodeId == MFX_CODEC_RGB4 ? true : false;
@@ -3752,6 +3897,15 @@ mfxStatus CTranscodingPipeline::Init(sInputParams* pParams,
         else
             MSDK_CHECK_STATUS(sts, "DecodePreInit failed");
 
+        if (pParams->nLiveLatency) {
+            const mfxFrameInfo& info = m_mfxDecParams.mfx.FrameInfo;
+            m_LiveDeadline.Init(info.FrameRateExtD ? (mfxF64)info.FrameRateExtN / info.FrameRateExtD
+                                                   : 0,
+                                pParams->nLiveLatency);
+            m_nDecSkipLevel     = 0;
+            m_bDecSkipSupported = true;
+        }
+
         if (TargetID == DecoderTargetID && !CSConfig.Targets.empty()) {
             CSConfig.Targets[0].SrcWidth  = m_mfxDecParams.mfx.FrameInfo.CropW;
             CSConfig.Targets[0].SrcHeight = m_mfxDecParams.mfx.FrameInfo.CropH;
@@ -3887,6 +4041,13 @@ mfxStatus CTranscodingPipeline::Init(sInputParams* pParams,
                 m_QPforI    = enc_par.mfx.QPI;
                 m_QPforP    = enc_par.mfx.QPP;
                 m_bUseQPMap = true;
+
+                //Additional 32x32 block alignment for HEVC VDEnc, using caps could be better
+                m_ROIQPMap.Init(m_ROIData,
+                                m_QPmapWidth,
+                                m_QPmapHeight,
+                                m_mfxEncParams.mfx.CodecId == MFX_CODEC_HEVC &&
+                                    m_mfxEncParams.mfx.LowPower == MFX_CODINGOPTION_ON);
             }
         }
     }
@@ -4375,6 +4536,11 @@ mfxStatus CTranscodingPipeline::AllocateSufficientBuffer(mfxBitstreamWrapper* pB
             par.mfx.BRCParamMultiplier == 0 ? 1 : par.mfx.BRCParamMultiplier;
         new_size = par.mfx.BufferSizeInKB * tempBRCParamMultiplier * 1000u;
     }
+
+    if (m_pBSStore) {
+        sts = m_pBSStore->InitArena(new_size);
+        MSDK_CHECK_STATUS(sts, "m_pBSStore->InitArena failed");
+    }
     pBS->Extend(new_size);
 
     return MFX_ERR_NONE;
@@ -0,0 +1,119 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "roi_qp_map.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace TranscodingSample {
+
+static bool operator==(const CROIQPMap::AreaState& left, const CROIQPMap::AreaState& right) {
+    return left.RegionSet == right.RegionSet && left.BaseQP == right.BaseQP;
+}
+
+CROIQPMap::CROIQPMap() : m_nWidth(0), m_nHeight(0), m_sets(1), m_setIdx() {}
+
+void CROIQPMap::Init(const std::vector<mfxExtEncoderROI>& roiData,
+                     mfxU32 width,
+                     mfxU32 height,
+                     bool bAlign32) {
+    m_nWidth  = width;
+    m_nHeight = height;
+    m_sets.assign(1, RegionSet());
+    m_setIdx.resize(roiData.size());
+
+    for (size_t n = 0; n < roiData.size(); n++) {
+        const mfxExtEncoderROI& roi = roiData[n];
+        RegionSet set;
+
+        for (mfxI32 i = roi.NumROI - 1; i >= 0; i--) {
+            const mfxU32 left = roi.ROI[i].Left, top = roi.ROI[i].Top;
+            const mfxU32 right = roi.ROI[i].Right, bottom = roi.ROI[i].Bottom;
+
+            Rect rect = {};
+            if (bAlign32) {
+                rect.Left   = (mfxU16)std::min((left >> 5) << 1, width);
+                rect.Top    = (mfxU16)std::min((top >> 5) << 1, height);
+                rect.Right  = (mfxU16)std::min(((right + 31) >> 5) << 1, width);
+                rect.Bottom = (mfxU16)std::min(((bottom + 31) >> 5) << 1, height);
+            }
+            else {
+                rect.Left   = (mfxU16)std::min(left >> 4, width);
+                rect.Top    = (mfxU16)std::min(top >> 4, height);
+                rect.Right  = (mfxU16)std::min((right + 15) >> 4, width);
+                rect.Bottom = (mfxU16)std::min((bottom + 15) >> 4, height);
+            }
+            rect.DeltaQP = roi.ROI[i].DeltaQP;
+            if (rect.Left < rect.Right && rect.Top < rect.Bottom)
+                set.Frame.push_back(rect);
+
+            // field rows are 32 frame rows, no 32x32 alignment
+            rect.Left   = (mfxU16)std::min(left >> 4, width);
+            rect.Top    = (mfxU16)std::min(top >> 5, height / 2);
+            rect.Right  = (mfxU16)std::min((right + 15) >> 4, width);
+            rect.Bottom = (mfxU16)std::min((bottom + 31) >> 5, height / 2);
+            if (rect.Left < rect.Right && rect.Top < rect.Bottom)
+                set.Field.push_back(rect);
+        }
+
+        const RegionSet& last = m_sets.back();
+        auto equal            = [](const Rect& a, const Rect& b) {
+            return a.Left == b.Left && a.Top == b.Top && a.Right == b.Right &&
+                   a.Bottom == b.Bottom && a.DeltaQP == b.DeltaQP;
+        };
+        if (set.Frame.size() != last.Frame.size() || set.Field.size() != last.Field.size() ||
+            !std::equal(set.Frame.begin(), set.Frame.end(), last.Frame.begin(), equal) ||
+            !std::equal(set.Field.begin(), set.Field.end(), last.Field.begin(), equal)) {
+            m_sets.push_back(set);
+        }
+        m_setIdx[n] = (mfxU32)m_sets.size() - 1;
+    }
+}
+
+void CROIQPMap::FillFrame(mfxU32 nRoi, mfxI32 baseQP, mfxU8* pMap, AreaState& state) const {
+    Fill(nRoi < m_setIdx.size() ? m_setIdx[nRoi] : 0, false, baseQP, m_nHeight, pMap, state);
+}
+
+void CROIQPMap::FillField(mfxU32 nRoi, mfxI32 baseQP, mfxU8* pMap, AreaState& state) const {
+    Fill(nRoi < m_setIdx.size() ? m_setIdx[nRoi] : 0, true, baseQP, m_nHeight / 2, pMap, state);
+}
+
+void CROIQPMap::Fill(mfxU32 nSet,
+                     bool bField,
+                     mfxI32 baseQP,
+                     mfxU32 height,
+                     mfxU8* pMap,
+                     AreaState& state) const {
+    const AreaState newState = { nSet, baseQP };
+    if (state == newState)
+        return; // buffer already holds this map
+
+    const std::vector<Rect>& rects = bField ? m_sets[nSet].Field : m_sets[nSet].Frame;
+    if (state.RegionSet == UNKNOWN_SET || state.BaseQP != baseQP) {
+        std::memset(pMap, baseQP, m_nWidth * height);
+    }
+    else {
+        // only regions of the previous map differ from the base QP
+        const RegionSet& prev = m_sets[state.RegionSet];
+        for (const Rect& rect : bField ? prev.Field : prev.Frame)
+            FillRect(rect, (mfxU8)baseQP, pMap);
+    }
+
+    for (const Rect& rect : rects)
+        FillRect(rect, (mfxU8)std::min(std::max(baseQP + rect.DeltaQP, 0), 51), pMap);
+
+    state = newState;
+}
+
+void CROIQPMap::FillRect(const Rect& rect, mfxU8 qp, mfxU8* pMap) const {
+    for (mfxU32 y = rect.Top; y < rect.Bottom; y++)
+        std::memset(pMap + y * m_nWidth + rect.Left, qp, rect.Right - rect.Left);
+}
+
+} // namespace TranscodingSample
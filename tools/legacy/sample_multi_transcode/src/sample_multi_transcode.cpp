@@ -10,6 +10,7 @@
 #endif
 
 #include "sample_multi_transcode.h"
+#include "shm_transport.h"
 
 #if defined(LIBVA_WAYLAND_SUPPORT)
     #include "class_wayland.h"
@@ -21,6 +22,8 @@
 
 #include <future>
 #include <iomanip>
+#include <map>
+#include <numeric>
 
 using namespace std;
 using namespace TranscodingSample;
@@ -34,13 +37,15 @@ Launcher::Launcher()
           m_pExtBSProcArray(),
           m_pAllocParams(),
           m_hwdevs(),
+          m_hdls(),
           m_StartTime(0),
           m_eDevType(static_cast<mfxHandleType>(0)),
           m_accelerationMode(MFX_ACCEL_MODE_NA),
           m_pLoader(),
           m_VppDstRects(),
           m_CSConfig(),
-          m_Tracer() {} // Launcher::Launcher()
+          m_Tracer(),
+          m_pControl() {} // Launcher::Launcher()
 
 Launcher::~Launcher() {
     Close();
@@ -58,15 +63,9 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
     SafetySurfaceBuffer* pBuffer = NULL;
     mfxU32 BufCounter            = 0;
     mfxHDL hdl                   = NULL;
-    std::vector<mfxHDL> hdls;
     sInputParams InputParams;
     bool bNeedToCreateDevice = true;
 
-    //parent transcode pipeline
-    CTranscodingPipeline* pParentPipeline = NULL;
-    // source transcode pipeline use instead parent in heterogeneous pipeline
-    CTranscodingPipeline* pSinkPipeline = NULL;
-
     // parse input par file
     sts = m_parser.ParseCmdLine(argc, argv);
     MSDK_CHECK_PARSE_RESULT(sts, MFX_ERR_NONE, sts);
@@ -75,6 +74,12 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
         return sts;
     }
 
+    if (m_parser.GetControlFileName()) {
+        m_pControl.reset(new CSessionControl);
+        sts = m_pControl->Init(m_parser.GetControlFileName());
+        MSDK_CHECK_STATUS(sts, "m_pControl->Init failed");
+    }
+
     // get parameters for each session from parser
     mfxU32 id = DecoderTargetID;
     while (m_parser.GetNextSessionParams(InputParams)) {
@@ -141,12 +146,12 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 
                 m_pAllocParams.push_back(pAllocParam);
                 m_hwdevs.push_back(std::move(hwdev));
-                hdls.push_back(hdl);
+                m_hdls.push_back(hdl);
             }
             else {
-                if (!m_pAllocParams.empty() && !hdls.empty()) {
+                if (!m_pAllocParams.empty() && !m_hdls.empty()) {
                     m_pAllocParams.push_back(m_pAllocParams.back());
-                    hdls.push_back(hdls.back());
+                    m_hdls.push_back(m_hdls.back());
                 }
                 else {
                     msdk_printf(MSDK_STRING("error: failed to initialize alloc parameters\n"));
@@ -183,12 +188,12 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 
                 m_pAllocParams.push_back(pAllocParam);
                 m_hwdevs.push_back(std::move(hwdev));
-                hdls.push_back(hdl);
+                m_hdls.push_back(hdl);
             }
             else {
-                if (!m_pAllocParams.empty() && !hdls.empty()) {
+                if (!m_pAllocParams.empty() && !m_hdls.empty()) {
                     m_pAllocParams.push_back(m_pAllocParams.back());
-                    hdls.push_back(hdls.back());
+                    m_hdls.push_back(m_hdls.back());
                 }
                 else {
                     msdk_printf(MSDK_STRING("error: failed to initialize alloc parameters\n"));
@@ -279,12 +284,12 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 
                 m_pAllocParams.push_back(std::shared_ptr<mfxAllocatorParams>(pAllocParam));
                 m_hwdevs.push_back(std::move(hwdev));
-                hdls.push_back(hdl);
+                m_hdls.push_back(hdl);
             }
             else {
-                if (!m_pAllocParams.empty() && !hdls.empty()) {
+                if (!m_pAllocParams.empty() && !m_hdls.empty()) {
                     m_pAllocParams.push_back(m_pAllocParams.back());
-                    hdls.push_back(hdls.back());
+                    m_hdls.push_back(m_hdls.back());
                 }
                 else {
                     msdk_printf(MSDK_STRING("error: failed to initialize alloc parameters\n"));
@@ -295,12 +300,17 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 #endif
     }
     if (m_pAllocParams.empty()) {
-        m_pAllocParams.push_back(std::shared_ptr<mfxAllocatorParams>(new SysMemAllocatorParams));
-        hdls.push_back(NULL);
+        SysMemAllocatorParams* pSysMemParams = new SysMemAllocatorParams;
+        pSysMemParams->bUseSlab              = m_InputParamsArray[0].bSysMemSlab;
+        pSysMemParams->bUseHugePages         = m_InputParamsArray[0].bSysMemHugePages;
+        pSysMemParams->nNumaNode             = m_InputParamsArray[0].nSysMemNumaNode;
+
+        m_pAllocParams.push_back(std::shared_ptr<mfxAllocatorParams>(pSysMemParams));
+        m_hdls.push_back(NULL);
 
         for (i = 1; i < m_InputParamsArray.size(); i++) {
             m_pAllocParams.push_back(m_pAllocParams.back());
-            hdls.push_back(NULL);
+            m_hdls.push_back(NULL);
         }
     }
 
@@ -326,72 +336,23 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
     }
 
     // create sessions, allocators
-    for (i = 0; i < m_InputParamsArray.size(); i++) {
-        msdk_printf(MSDK_STRING("Session %d:\n"), (int)i);
-        std::unique_ptr<GeneralAllocator> pAllocator(new GeneralAllocator);
-        sts = pAllocator->Init(m_pAllocParams[i].get());
-        MSDK_CHECK_STATUS(sts, "pAllocator->Init failed");
-
-        m_pAllocArray.push_back(std::move(pAllocator));
+    // pipelines are created in advance, so links between sessions are known before their Init
+    const mfxU32 NO_SESSION = 0xFFFFFFFF;
+    std::vector<mfxU32> parents(m_InputParamsArray.size(), NO_SESSION);
+    std::vector<SafetySurfaceBuffer*> buffers(m_InputParamsArray.size(), NULL);
+    mfxU32 idxSink   = NO_SESSION;
+    mfxU32 idxJoined = NO_SESSION;
 
-        std::unique_ptr<ThreadTranscodeContext> pThreadPipeline(new ThreadTranscodeContext);
+    for (i = 0; i < m_InputParamsArray.size(); i++) {
+        m_pAllocArray.push_back(std::unique_ptr<GeneralAllocator>(new GeneralAllocator));
         // extend BS processing init
         m_pExtBSProcArray.push_back(
             std::unique_ptr<FileBitstreamProcessor>(new FileBitstreamProcessor));
 
+        std::unique_ptr<ThreadTranscodeContext> pThreadPipeline(new ThreadTranscodeContext);
         pThreadPipeline->pPipeline.reset(CreatePipeline());
-
-        pThreadPipeline->pPipeline->SetAdapterType(m_pLoader->GetAdapterType());
-        pThreadPipeline->pPipeline->SetPrefferdGfx(m_InputParamsArray[i].dGfxIdx);
-        pThreadPipeline->pPipeline->SetAdapterNum(m_pLoader->GetDeviceIDAndAdapter().second);
-
         pThreadPipeline->pBSProcessor = m_pExtBSProcArray.back().get();
-
-        std::unique_ptr<CSmplBitstreamReader> reader;
-        std::unique_ptr<CSmplYUVReader> yuvreader;
-        if (m_InputParamsArray[i].DecodeId == MFX_CODEC_VP9 ||
-            m_InputParamsArray[i].DecodeId == MFX_CODEC_VP8 ||
-            m_InputParamsArray[i].DecodeId == MFX_CODEC_AV1) {
-            reader.reset(new CIVFFrameReader());
-        }
-        else if (m_InputParamsArray[i].DecodeId == MFX_CODEC_RGB4 ||
-                 m_InputParamsArray[i].DecodeId == MFX_CODEC_I420 ||
-                 m_InputParamsArray[i].DecodeId == MFX_CODEC_NV12) {
-            // YUV reader for RGB4 overlay and raw input
-            yuvreader.reset(new CSmplYUVReader());
-        }
-        else {
-            reader.reset(new CSmplBitstreamReader());
-        }
-
-        if (reader.get()) {
-            sts = reader->Init(m_InputParamsArray[i].strSrcFile);
-            if (sts == MFX_ERR_UNSUPPORTED && m_InputParamsArray[i].DecodeId == MFX_CODEC_AV1) {
-                reader.reset(new CSmplBitstreamReader());
-                msdk_printf(MSDK_STRING("WARNING: Stream is not IVF, default reader\n"));
-            }
-            MSDK_CHECK_STATUS(sts, "reader->Init failed");
-            sts = m_pExtBSProcArray.back()->SetReader(reader);
-            MSDK_CHECK_STATUS(sts, "m_pExtBSProcArray.back()->SetReader failed");
-        }
-        else if (yuvreader.get()) {
-            std::list<msdk_string> input;
-            input.push_back(m_InputParamsArray[i].strSrcFile);
-            sts = yuvreader->Init(input, m_InputParamsArray[i].DecodeId);
-            MSDK_CHECK_STATUS(sts, "m_YUVReader->Init failed");
-            sts = m_pExtBSProcArray.back()->SetReader(yuvreader);
-            MSDK_CHECK_STATUS(sts, "m_pExtBSProcArray.back()->SetReader failed");
-        }
-
-        if (msdk_strncmp(MSDK_STRING("null"),
-                         m_InputParamsArray[i].strDstFile,
-                         msdk_strlen(MSDK_STRING("null")))) {
-            std::unique_ptr<CSmplBitstreamWriter> writer(new CSmplBitstreamWriter());
-            sts = writer->Init(m_InputParamsArray[i].strDstFile);
-
-            sts = m_pExtBSProcArray.back()->SetWriter(writer);
-            MSDK_CHECK_STATUS(sts, "m_pExtBSProcArray.back()->SetWriter failed");
-        }
+        m_pThreadContextArray.push_back(std::move(pThreadPipeline));
 
         if (Sink == m_InputParamsArray[i].eMode) {
             /* N_to_1 mode */
@@ -406,7 +367,7 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
             {
                 pBuffer = m_pBufferArray[m_pBufferArray.size() - 1].get();
             }
-            pSinkPipeline = pThreadPipeline->pPipeline.get();
+            idxSink = i;
         }
         else if (Source == m_InputParamsArray[i].eMode) {
             /* N_to_1 mode */
@@ -423,6 +384,7 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
         else {
             pBuffer = NULL;
         }
+        buffers[i] = pBuffer;
 
         /**/
         /* Vector stored linearly in the memory !*/
@@ -430,52 +392,77 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 
         // if session has VPP plus ENCODE only (-i::source option)
         // use decode source session as input
-        sts = MFX_ERR_MORE_DATA;
+        parents[i] = Source == m_InputParamsArray[i].eMode ? idxSink : idxJoined;
 
-        auto pipeline = Source == m_InputParamsArray[i].eMode ? pSinkPipeline : pParentPipeline;
-        sts           = CheckAndFixAdapterDependency(i, pipeline);
-        MSDK_CHECK_STATUS(sts, "CheckAndFixAdapterDependency failed");
-        // force implementation type based on iGfx/dGfx parameters
-        if (sts == MFX_WRN_VIDEO_PARAM_CHANGED &&
-            m_InputParamsArray[i].libType != MFX_IMPL_SOFTWARE) {
-            if (m_InputParamsArray[i].dGfxIdx >= 0)
-                m_pLoader->SetDiscreteAdapterIndex(m_InputParamsArray[i].dGfxIdx);
-            else
-                m_pLoader->SetAdapterType(m_InputParamsArray[i].adapterType);
+        if (NO_SESSION == idxJoined && m_InputParamsArray[i].bIsJoin)
+            idxJoined = i;
+    }
 
-            if (m_InputParamsArray[i].adapterNum >= 0)
-                m_pLoader->SetAdapterNum(m_InputParamsArray[i].adapterNum);
+    // Session depends on its parent session, sessions linked by safety buffers depend on each
+    // other. Dependent sessions are put into one group and initialized in order of the par file,
+    // independent groups are initialized concurrently.
+    std::vector<mfxU32> groups(m_InputParamsArray.size());
+    std::iota(groups.begin(), groups.end(), 0);
 
-            sts = m_pLoader->ConfigureAndEnumImplementations(m_InputParamsArray[i].libType,
-                                                             m_accelerationMode);
-            MSDK_CHECK_STATUS(sts, "ConfigureAndEnumImplementations failed");
+    auto findGroup = [&groups](mfxU32 idx) {
+        while (groups[idx] != idx)
+            idx = groups[idx];
+        return idx;
+    };
+    auto mergeGroups = [&groups, &findGroup](mfxU32 idx1, mfxU32 idx2) {
+        mfxU32 group1                    = findGroup(idx1);
+        mfxU32 group2                    = findGroup(idx2);
+        groups[std::max(group1, group2)] = std::min(group1, group2);
+    };
+
+    // cascade scaler config is shared by all sessions and updated by decoder's Init
+    bool bParallelInit =
+        m_InputParamsArray[0].bParallelInit && !CreateCascadeScalerConfig().CascadeScalerRequired;
+
+    mfxU32 idxBuffered = NO_SESSION;
+    for (i = 0; i < m_InputParamsArray.size(); i++) {
+        if (!bParallelInit) {
+            mergeGroups(0, i);
+            continue;
         }
-        sts = pThreadPipeline->pPipeline->Init(&m_InputParamsArray[i],
-                                               m_pAllocArray[i].get(),
-                                               hdls[i],
-                                               pipeline,
-                                               pBuffer,
-                                               m_pExtBSProcArray.back().get(),
-                                               m_pLoader.get(),
-                                               CreateCascadeScalerConfig());
 
-        MSDK_CHECK_STATUS(sts, "pThreadPipeline->pPipeline->Init failed");
+        if (NO_SESSION != parents[i])
+            mergeGroups(parents[i], i);
 
-        if (!pParentPipeline && m_InputParamsArray[i].bIsJoin)
-            pParentPipeline = pThreadPipeline->pPipeline.get();
+        if (buffers[i]) {
+            if (NO_SESSION == idxBuffered)
+                idxBuffered = i;
+            mergeGroups(idxBuffered, i);
+        }
+    }
+    for (i = 0; i < m_InputParamsArray.size(); i++)
+        groups[i] = findGroup(i);
 
-        // set the session's start status (like it is waiting)
-        pThreadPipeline->startStatus = MFX_WRN_DEVICE_BUSY;
-        // set other session's parameters
-        pThreadPipeline->implType = m_InputParamsArray[i].libType;
-        m_pThreadContextArray.push_back(std::move(pThreadPipeline));
+    std::vector<mfxVersion> versions(m_InputParamsArray.size(), mfxVersion{ { 0, 0 } });
+    std::vector<mfxF64> initTimes(m_InputParamsArray.size(), 0);
+    std::vector<mfxF64> completeInitTimes(m_InputParamsArray.size(), 0);
 
-        mfxVersion ver = { { 0, 0 } };
-        sts            = m_pThreadContextArray[i]->pPipeline->QueryMFXVersion(&ver);
-        MSDK_CHECK_STATUS(sts, "m_pThreadContextArray[i]->pPipeline->QueryMFXVersion failed");
+    CTimer totalTimer;
+    totalTimer.Start();
 
-        PrintInfo(i, &m_InputParamsArray[i], &ver);
-    }
+    sts = ForEachSessionGroup(groups, [&](mfxU32 idx) {
+        CTimer timer;
+        timer.Start();
+
+        CTranscodingPipeline* pParentPipeline = NULL;
+        if (NO_SESSION != parents[idx])
+            pParentPipeline = m_pThreadContextArray[parents[idx]]->pPipeline.get();
+
+        mfxStatus sts =
+            InitSession(idx, pParentPipeline, buffers[idx], m_hdls[idx], &versions[idx]);
+
+        initTimes[idx] = timer.GetTime();
+        return sts;
+    });
+    MSDK_CHECK_STATUS(sts, "InitSession failed");
+
+    for (i = 0; i < m_InputParamsArray.size(); i++)
+        PrintInfo(i, &m_InputParamsArray[i], &versions[i]);
 
     if (m_InputParamsArray[0].forceSyncAllSession == MFX_CODINGOPTION_ON) {
         auto maxNumFrameForAllocIter = std::max_element(
@@ -494,24 +481,211 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
         }
     }
 
-    for (i = 0; i < m_InputParamsArray.size(); i++) {
-        sts = m_pThreadContextArray[i]->pPipeline->CompleteInit();
-        MSDK_CHECK_STATUS(sts, "m_pThreadContextArray[i]->pPipeline->CompleteInit failed");
+    // CompleteInit of child session updates parent's number of frames, so the same groups are used
+    sts = ForEachSessionGroup(groups, [&](mfxU32 idx) {
+        CTimer timer;
+        timer.Start();
+
+        mfxStatus sts = m_pThreadContextArray[idx]->pPipeline->CompleteInit();
+        MSDK_CHECK_STATUS(sts, "m_pThreadContextArray[idx]->pPipeline->CompleteInit failed");
+
+        m_pThreadContextArray[idx]->pPipeline->SetPipelineID(idx);
 
+        completeInitTimes[idx] = timer.GetTime();
+        return sts;
+    });
+    MSDK_CHECK_STATUS(sts, "CompleteInit failed");
+
+    for (i = 0; i < m_InputParamsArray.size(); i++) {
         if (m_pThreadContextArray[i]->pPipeline->GetJoiningFlag())
             msdk_printf(MSDK_STRING("Session %d was joined with other sessions\n"), (int)i);
         else
             msdk_printf(MSDK_STRING("Session %d was NOT joined with other sessions\n"), (int)i);
-
-        m_pThreadContextArray[i]->pPipeline->SetPipelineID(i);
     }
 
     msdk_printf(MSDK_STRING("\n"));
 
+    for (i = 0; i < m_InputParamsArray.size(); i++) {
+        msdk_printf(
+            MSDK_STRING("Session %d init time: %.2f ms (Init %.2f ms, CompleteInit %.2f ms)\n"),
+            (int)i,
+            (initTimes[i] + completeInitTimes[i]) * 1000,
+            initTimes[i] * 1000,
+            completeInitTimes[i] * 1000);
+    }
+    msdk_printf(MSDK_STRING("Sessions were initialized in %.2f ms (%s)\n\n"),
+                totalTimer.GetTime() * 1000,
+                bParallelInit ? MSDK_STRING("parallel") : MSDK_STRING("serial"));
+
     return sts;
 
 } // mfxStatus Launcher::Init()
 
+mfxStatus Launcher::InitSession(mfxU32 idxSession,
+                                CTranscodingPipeline* pParentPipeline,
+                                SafetySurfaceBuffer* pBuffer,
+                                mfxHDL hdl,
+                                mfxVersion* pVer) {
+    mfxStatus sts                        = MFX_ERR_NONE;
+    sInputParams& params                 = m_InputParamsArray[idxSession];
+    ThreadTranscodeContext* pContext     = m_pThreadContextArray[idxSession].get();
+    FileBitstreamProcessor* pBSProcessor = m_pExtBSProcArray[idxSession].get();
+
+    msdk_printf(MSDK_STRING("Session %d:\n"), (int)idxSession);
+    sts = m_pAllocArray[idxSession]->Init(m_pAllocParams[idxSession].get());
+    MSDK_CHECK_STATUS(sts, "pAllocator->Init failed");
+
+    std::unique_ptr<CSmplBitstreamReader> reader;
+    std::unique_ptr<CSmplYUVReader> yuvreader;
+    if (params.bShmInput) {
+        // frames come one per slot, container parsing isn't needed
+        reader.reset(new CShmBitstreamReader());
+    }
+    else if (params.DecodeId == MFX_CODEC_VP9 || params.DecodeId == MFX_CODEC_VP8 ||
+             params.DecodeId == MFX_CODEC_AV1) {
+        reader.reset(new CIVFFrameReader());
+    }
+    else if (params.DecodeId == MFX_CODEC_RGB4 || params.DecodeId == MFX_CODEC_I420 ||
+             params.DecodeId == MFX_CODEC_NV12) {
+        // YUV reader for RGB4 overlay and raw input
+        if (params.bPreload) {
+            CPreloadedYUVReader* preloadedReader = new CPreloadedYUVReader();
+            preloadedReader->SetPreloadParams(params.nPreloadFrames,
+                                              params.nPreloadLoops,
+                                              params.bPreloadTimeStamps);
+            yuvreader.reset(preloadedReader);
+        }
+        else {
+            yuvreader.reset(new CSmplYUVReader());
+        }
+    }
+    else if (params.bPreload) {
+        CPreloadedBitstreamReader* preloadedReader = new CPreloadedBitstreamReader();
+        preloadedReader->SetLoops(params.nPreloadLoops);
+        reader.reset(preloadedReader);
+    }
+    else {
+        reader.reset(new CSmplBitstreamReader());
+    }
+
+    if (reader.get()) {
+        sts = reader->Init(params.strSrcFile);
+        if (sts == MFX_ERR_UNSUPPORTED && params.DecodeId == MFX_CODEC_AV1) {
+            reader.reset(new CSmplBitstreamReader());
+            msdk_printf(MSDK_STRING("WARNING: Stream is not IVF, default reader\n"));
+        }
+        MSDK_CHECK_STATUS(sts, "reader->Init failed");
+        sts = pBSProcessor->SetReader(reader);
+        MSDK_CHECK_STATUS(sts, "pBSProcessor->SetReader failed");
+    }
+    else if (yuvreader.get()) {
+        std::list<msdk_string> input;
+        input.push_back(params.strSrcFile);
+        sts = yuvreader->Init(input, params.DecodeId);
+        MSDK_CHECK_STATUS(sts, "m_YUVReader->Init failed");
+        sts = pBSProcessor->SetReader(yuvreader);
+        MSDK_CHECK_STATUS(sts, "pBSProcessor->SetReader failed");
+    }
+
+    if (msdk_strncmp(MSDK_STRING("null"), params.strDstFile, msdk_strlen(MSDK_STRING("null")))) {
+        std::unique_ptr<CSmplBitstreamWriter> writer;
+        if (params.bShmOutput)
+            writer.reset(new CShmBitstreamWriter());
+        else
+            writer.reset(new CSmplBitstreamWriter());
+        writer->SetSinkParams(params.OutSinkType, params.nOutSinkBufferSize);
+        sts = writer->Init(params.strDstFile);
+        MSDK_CHECK_STATUS(sts, "writer->Init failed");
+
+        sts = pBSProcessor->SetWriter(writer);
+        MSDK_CHECK_STATUS(sts, "pBSProcessor->SetWriter failed");
+    }
+
+    {
+        // Loader is shared by sessions initialized concurrently. Its configuration is used by
+        // CreateSession inside of pipeline Init, so the lock is held until Init is done.
+        // CompleteInit with the heavy part of initialization still runs concurrently.
+        std::lock_guard<std::recursive_mutex> lock(m_pLoader->GetMutex());
+
+        pContext->pPipeline->SetAdapterType(m_pLoader->GetAdapterType());
+        pContext->pPipeline->SetPrefferdGfx(params.dGfxIdx);
+        pContext->pPipeline->SetAdapterNum(m_pLoader->GetDeviceIDAndAdapter().second);
+
+        sts = CheckAndFixAdapterDependency(idxSession, pParentPipeline);
+        MSDK_CHECK_STATUS(sts, "CheckAndFixAdapterDependency failed");
+        // force implementation type based on iGfx/dGfx parameters
+        if (sts == MFX_WRN_VIDEO_PARAM_CHANGED && params.libType != MFX_IMPL_SOFTWARE) {
+            if (params.dGfxIdx >= 0)
+                m_pLoader->SetDiscreteAdapterIndex(params.dGfxIdx);
+            else
+                m_pLoader->SetAdapterType(params.adapterType);
+
+            if (params.adapterNum >= 0)
+                m_pLoader->SetAdapterNum(params.adapterNum);
+
+            sts = m_pLoader->ConfigureAndEnumImplementations(params.libType, m_accelerationMode);
+            MSDK_CHECK_STATUS(sts, "ConfigureAndEnumImplementations failed");
+        }
+
+        sts = pContext->pPipeline->Init(&params,
+                                        m_pAllocArray[idxSession].get(),
+                                        hdl,
+                                        pParentPipeline,
+                                        pBuffer,
+                                        pBSProcessor,
+                                        m_pLoader.get(),
+                                        CreateCascadeScalerConfig());
+        MSDK_CHECK_STATUS(sts, "pThreadPipeline->pPipeline->Init failed");
+    }
+
+    // set the session's start status (like it is waiting)
+    pContext->startStatus = MFX_WRN_DEVICE_BUSY;
+    // set other session's parameters
+    pContext->implType = params.libType;
+
+    sts = pContext->pPipeline->QueryMFXVersion(pVer);
+    MSDK_CHECK_STATUS(sts, "pContext->pPipeline->QueryMFXVersion failed");
+
+    return sts;
+
+} // mfxStatus Launcher::InitSession()
+
+mfxStatus Launcher::ForEachSessionGroup(const std::vector<mfxU32>& groups,
+                                        const std::function<mfxStatus(mfxU32)>& func) {
+    std::map<mfxU32, std::vector<mfxU32>> sessionsByGroup;
+    for (mfxU32 i = 0; i < groups.size(); i++)
+        sessionsByGroup[groups[i]].push_back(i);
+
+    std::vector<mfxStatus> statuses(groups.size(), MFX_ERR_NONE);
+    auto runGroup = [&func, &statuses](const std::vector<mfxU32>* sessions) {
+        for (mfxU32 idx : *sessions) {
+            statuses[idx] = func(idx);
+            if (statuses[idx] < MFX_ERR_NONE)
+                break;
+        }
+    };
+
+    if (sessionsByGroup.size() == 1) {
+        runGroup(&sessionsByGroup.begin()->second);
+    }
+    else {
+        std::vector<std::future<void>> handles;
+        for (const auto& group : sessionsByGroup)
+            handles.push_back(std::async(std::launch::async, runGroup, &group.second));
+
+        for (auto& handle : handles)
+            handle.wait();
+    }
+
+    for (mfxStatus sts : statuses) {
+        if (sts < MFX_ERR_NONE)
+            return sts;
+    }
+
+    return statuses.empty() ? MFX_ERR_NONE : statuses.back();
+
+} // mfxStatus Launcher::ForEachSessionGroup()
+
 void Launcher::Run() {
     msdk_printf(MSDK_STRING("Transcoding started\n"));
 
@@ -545,10 +719,18 @@ void Launcher::DoTranscoding() {
         MSDK_CHECK_POINTER_NO_RET(context->pPipeline);
         isOverlayUsed = isOverlayUsed || context->pPipeline->IsOverlayUsed();
     }
+    size_t nStarted = m_pThreadContextArray.size();
 
     // Transcoding threads waiting cycle
+    // with control file it goes on without sessions until 'quit' command
     bool aliveNonOverlaySessions = true;
-    while (aliveNonOverlaySessions) {
+    while (aliveNonOverlaySessions || (m_pControl && m_pControl->IsOpen())) {
+        if (m_pControl && m_pControl->IsOpen()) {
+            ProcessControlCommands();
+            for (; nStarted < m_pThreadContextArray.size(); nStarted++)
+                RunTranscodeRoutine(m_pThreadContextArray[nStarted].get());
+        }
+
         aliveNonOverlaySessions = false;
 
         for (size_t i = 0; i < m_pThreadContextArray.size(); ++i) {
@@ -570,17 +752,22 @@ void Launcher::DoTranscoding() {
                     // But do not stop in robust mode when gpu hang's happened
                     if (m_pThreadContextArray[i]->transcodingSts != MFX_ERR_GPU_HANG ||
                         !m_pThreadContextArray[i]->pPipeline->GetRobustFlag()) {
+                        // sessions controlled by control file are independent
                         msdk_stringstream ss;
                         ss << MSDK_STRING("\n\n session ") << i << MSDK_STRING(" [")
                            << m_pThreadContextArray[i]->pPipeline->GetSessionText()
                            << MSDK_STRING("] failed with status ")
                            << StatusToString(m_pThreadContextArray[i]->transcodingSts)
-                           << MSDK_STRING(" shutting down the application...") << std::endl
+                           << (m_pControl ? MSDK_STRING("")
+                                          : MSDK_STRING(" shutting down the application..."))
+                           << std::endl
                            << std::endl;
                         msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
 
-                        for (const auto& context : m_pThreadContextArray) {
-                            context->pPipeline->StopSession();
+                        if (!m_pControl) {
+                            for (const auto& context : m_pThreadContextArray) {
+                                context->pPipeline->StopSession();
+                            }
                         }
                     }
                 }
@@ -600,6 +787,12 @@ void Launcher::DoTranscoding() {
             }
         }
 
+        if (!aliveNonOverlaySessions && m_pControl && m_pControl->IsOpen()) {
+            // nothing to wait for until new sessions come
+            MSDK_SLEEP(66);
+            continue;
+        }
+
         // Stop overlay sessions
         // Note: Overlay sessions never stop themselves so they should be forcibly stopped
         // after stopping of all non-overlay sessions
@@ -622,6 +815,99 @@ void Launcher::DoTranscoding() {
     }
 }
 
+void Launcher::ProcessControlCommands() {
+    std::vector<CSessionControl::Command> commands;
+    m_pControl->ReadCommands(commands);
+
+    for (const CSessionControl::Command& command : commands) {
+        if (CSessionControl::CMD_QUIT == command.Type) {
+            msdk_printf(MSDK_STRING("Control: quit, waiting for sessions to finish\n"));
+            m_pControl->Close();
+            break;
+        }
+        if (CSessionControl::CMD_ADD == command.Type) {
+            if (MFX_ERR_NONE != AddSession(command.Line))
+                msdk_printf(MSDK_STRING("Control: session is not added\n"));
+            continue;
+        }
+
+        const mfxU32 idx = command.Session;
+        if (idx >= m_pThreadContextArray.size() || !m_pThreadContextArray[idx]->handle.valid()) {
+            msdk_printf(MSDK_STRING("Control: session %d is not running\n"), (int)idx);
+            continue;
+        }
+        CTranscodingPipeline* pPipeline = m_pThreadContextArray[idx]->pPipeline.get();
+        if (CSessionControl::CMD_STOP == command.Type) {
+            pPipeline->StopSession();
+        }
+        else if (Native != m_InputParamsArray[idx].eMode) {
+            msdk_printf(MSDK_STRING("Control: session %d is not 1 to 1 transcoding\n"), (int)idx);
+        }
+        else if (CSessionControl::CMD_DRAIN == command.Type) {
+            pPipeline->DrainSession();
+        }
+        else if (CSessionControl::CMD_BITRATE == command.Type) {
+            pPipeline->SetBitrate(command.Bitrate);
+        }
+    }
+} // void Launcher::ProcessControlCommands()
+
+mfxStatus Launcher::AddSession(const msdk_string& line) {
+    sInputParams params;
+    mfxStatus sts = m_parser.ParseSessionLine(line, params);
+    MSDK_CHECK_STATUS(sts, "m_parser.ParseSessionLine failed");
+
+    // the session uses device, allocator parameters and loader of session 0
+    const sInputParams& first = m_InputParamsArray[0];
+    const bool bSoftware      = MFX_IMPL_SOFTWARE == MFX_IMPL_BASETYPE(params.libType);
+    if (Native != params.eMode || params.bIsJoin || params.bRobustFlag ||
+        MFX_CODEC_RGB4 == params.DecodeId ||
+        bSoftware != (MFX_IMPL_SOFTWARE == MFX_IMPL_BASETYPE(first.libType)) ||
+        params.nMemoryModel != first.nMemoryModel) {
+        PrintError(MSDK_STRING(
+            "only not joined, not robust 1 to 1 session with library type and memory model of session 0 can be added"));
+        m_parser.RemoveLastLine();
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    const mfxU32 idx = (mfxU32)m_InputParamsArray.size();
+    params.TargetID  = DecoderTargetID + idx;
+    m_InputParamsArray.push_back(params);
+    m_pAllocParams.push_back(m_pAllocParams[0]);
+    m_hdls.push_back(m_hdls[0]);
+    m_pAllocArray.push_back(std::unique_ptr<GeneralAllocator>(new GeneralAllocator));
+    m_pExtBSProcArray.push_back(
+        std::unique_ptr<FileBitstreamProcessor>(new FileBitstreamProcessor));
+
+    std::unique_ptr<ThreadTranscodeContext> pThreadPipeline(new ThreadTranscodeContext);
+    pThreadPipeline->pPipeline.reset(CreatePipeline());
+    pThreadPipeline->pBSProcessor = m_pExtBSProcArray.back().get();
+    m_pThreadContextArray.push_back(std::move(pThreadPipeline));
+
+    mfxVersion version = { { 0, 0 } };
+    sts                = InitSession(idx, NULL, NULL, m_hdls[idx], &version);
+    if (sts >= MFX_ERR_NONE) {
+        sts = m_pThreadContextArray[idx]->pPipeline->CompleteInit();
+        MSDK_CHECK_STATUS_NO_RET(sts, "CompleteInit failed");
+    }
+    if (sts < MFX_ERR_NONE) {
+        m_pThreadContextArray.pop_back();
+        m_pExtBSProcArray.pop_back();
+        m_pAllocArray.pop_back();
+        m_hdls.pop_back();
+        m_pAllocParams.pop_back();
+        m_InputParamsArray.pop_back();
+        m_parser.RemoveLastLine();
+        return sts;
+    }
+
+    m_pThreadContextArray[idx]->pPipeline->SetPipelineID(idx);
+    PrintInfo(idx, &m_InputParamsArray[idx], &version);
+    msdk_printf(MSDK_STRING("Control: session %d is added\n"), (int)idx);
+    return MFX_ERR_NONE;
+
+} // mfxStatus Launcher::AddSession()
+
 void Launcher::DoRobustTranscoding() {
     mfxStatus sts = MFX_ERR_NONE;
 
@@ -691,9 +977,25 @@ mfxStatus Launcher::ProcessResult() {
            << SessionStsStr << MSDK_STRING(" (") << StatusToString(transcodingSts)
            << MSDK_STRING(") ") << workTime << MSDK_STRING(" sec, ") << framesNum
            << MSDK_STRING(" frames, ") << std::fixed << std::setprecision(3) << framesNum / workTime
-           << MSDK_STRING(" fps") << std::endl
-           << m_parser.GetLine(i) << std::endl
-           << std::endl;
+           << MSDK_STRING(" fps") << std::endl;
+
+        const CAsyncDepthController& asyncDepth =
+            m_pThreadContextArray[i]->pPipeline->GetAsyncDepthController();
+        if (asyncDepth.IsEnabled()) {
+            ss << MSDK_STRING("async depth ") << asyncDepth.GetMinDepth() << MSDK_STRING("..")
+               << asyncDepth.GetMaxDepth() << MSDK_STRING(": last ") << asyncDepth.GetDepth()
+               << MSDK_STRING(", average ") << asyncDepth.GetAvgDepth()
+               << MSDK_STRING(", in flight ") << asyncDepth.GetAvgInFlight()
+               << MSDK_STRING(", latency ") << asyncDepth.GetAvgLatency() << MSDK_STRING(" ms")
+               << std::endl;
+        }
+        const CLiveDeadline& live = m_pThreadContextArray[i]->pPipeline->GetLiveDeadline();
+        if (live.IsEnabled()) {
+            ss << MSDK_STRING("live: ") << live.GetNumDropped() << MSDK_STRING(" of ")
+               << live.GetNumFrames() << MSDK_STRING(" decoded frames dropped")
+               << MSDK_STRING(", max decoder skip level ") << live.GetMaxSkipLevel() << std::endl;
+        }
+        ss << m_parser.GetLine(i) << std::endl << std::endl;
 
         msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
         if (pPerfFile) {
@@ -1010,6 +1312,12 @@ mfxStatus Launcher::VerifyCrossSessionsOptions() {
         return MFX_ERR_UNSUPPORTED;
     }
 
+    // robust transcoding loop doesn't poll the control file
+    if (m_pControl && !m_InputParamsArray.empty() && m_InputParamsArray[0].bRobustFlag) {
+        PrintError(MSDK_STRING("Error: -ctrl can't be used with -robust"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
     if (bSingleTexture) {
         bool showWarning = false;
         for (mfxU32 j = 0; j < m_InputParamsArray.size(); j++) {
@@ -1187,17 +1495,66 @@ void TranscodingSample::CascadeScalerConfig::CreatePoolList() {
 
     for (TargetDescriptor& desc : Targets) {
         if (desc.CascadeScaler) {
-            pool.PrevID        = pool.ID;
-            pool.ID            = DecoderPoolID + (desc.TargetID - DecoderTargetID);
-            pool.TargetID      = desc.TargetID;
-            pool.SurfaceWidth  = desc.DstWidth;
-            pool.SurfaceHeight = desc.DstHeight;
-            Pools[pool.ID]     = pool;
+            mfxU32 SharedID = FindCompatiblePool(desc, pool.ID);
+            if (SharedID) {
+                //cascade continues from the shared pool
+                pool            = Pools[SharedID];
+                desc.SharedPool = true;
+            }
+            else {
+                const sInputParams& par = InParams[desc.TargetID];
+
+                pool.PrevID        = pool.ID;
+                pool.ID            = DecoderPoolID + (desc.TargetID - DecoderTargetID);
+                pool.TargetID      = desc.TargetID;
+                pool.SurfaceWidth  = desc.DstWidth ? desc.DstWidth : pool.SurfaceWidth;
+                pool.SurfaceHeight = desc.DstHeight ? desc.DstHeight : pool.SurfaceHeight;
+                pool.FourCC        = par.EncoderFourCC ? par.EncoderFourCC : pool.FourCC;
+                Pools[pool.ID]     = pool;
+            }
         }
         desc.PoolID = pool.ID;
     }
 }
 
+//VPP of the target changes frame rate or picture structure, frames before it can't be shared
+static bool ChangesFrameSequence(const sInputParams& par) {
+    return par.FRCAlgorithm || par.dVPPOutFramerate || par.bEnableDeinterlacing ||
+           par.fieldProcessingMode;
+}
+
+//Cascade VPP of the target only copies frames if it keeps their size and format and has no
+//filters or other per-target VPP parameters, then the target can read an existing pool. Pools
+//are searched back along the cascade up to the first stage which changes frame rate or picture
+//structure. Returns 0 if none fits.
+mfxU32 TranscodingSample::CascadeScalerConfig::FindCompatiblePool(const TargetDescriptor& desc,
+                                                                  mfxU32 HeadID) {
+    const sInputParams& par = InParams[desc.TargetID];
+    if (ChangesFrameSequence(par) || par.DenoiseLevel != -1 || par.DetailLevel != -1 ||
+        VPP_FILTER_DISABLED != par.mctfParam.mode || par.ScalingMode || par.numSurf4Comp) {
+        return 0;
+    }
+
+    const PoolDescritpor& head = Pools[HeadID];
+    mfxU16 Width               = desc.DstWidth ? desc.DstWidth : head.SurfaceWidth;
+    mfxU16 Height              = desc.DstHeight ? desc.DstHeight : head.SurfaceHeight;
+    mfxU32 FourCC              = par.EncoderFourCC ? par.EncoderFourCC : head.FourCC;
+
+    for (mfxU32 ID = HeadID; ID != 0; ID = Pools[ID].PrevID) {
+        const PoolDescritpor& pool = Pools[ID];
+        if (pool.SurfaceWidth == Width && pool.SurfaceHeight == Height && pool.FourCC == FourCC) {
+            return ID;
+        }
+
+        auto owner = InParams.find(pool.TargetID);
+        if (owner != InParams.end() && ChangesFrameSequence(owner->second)) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
 SMTTracer::SMTTracer() : Log(), AddonLog(), TracerFileMutex(), TraceFile() {
     TimeBase = std::chrono::steady_clock::now();
 }
@@ -1571,6 +1928,8 @@ void Launcher::Close() {
     m_pExtBSProcArray.clear();
     m_pAllocParams.clear();
     m_hwdevs.clear();
+    m_hdls.clear();
+    m_pControl.reset();
 
 } // void Launcher::Close()
 
@@ -0,0 +1,132 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "session_control.h"
+
+#include "sample_utils.h"
+
+namespace TranscodingSample {
+
+const size_t CTRL_MAX_LINE = 16 * 1024;
+
+CSessionControl::CSessionControl() : m_pFile(NULL), m_offset(0), m_bSkipLine(false), m_buf() {}
+
+CSessionControl::~CSessionControl() {
+    Close();
+}
+
+mfxStatus CSessionControl::Init(const msdk_char* fileName) {
+    MSDK_CHECK_POINTER(fileName, MFX_ERR_NULL_PTR);
+    Close();
+
+    // file is created if it doesn't exist yet, the application only reads it
+    MSDK_FOPEN(m_pFile, fileName, MSDK_STRING("a+"));
+    if (!m_pFile) {
+        msdk_printf(MSDK_STRING("error: control file \"%s\" can't be opened\n"), fileName);
+        return MFX_ERR_NOT_FOUND;
+    }
+
+    fseek(m_pFile, 0, SEEK_END);
+    m_offset    = ftell(m_pFile);
+    m_bSkipLine = false;
+    m_buf.resize(CTRL_MAX_LINE);
+
+    msdk_printf(MSDK_STRING("Control file is: %s\n\n"), fileName);
+    return MFX_ERR_NONE;
+}
+
+void CSessionControl::Close() {
+    if (m_pFile) {
+        fclose(m_pFile);
+        m_pFile = NULL;
+    }
+}
+
+void CSessionControl::ReadCommands(std::vector<Command>& commands) {
+    commands.clear();
+    if (!m_pFile)
+        return;
+
+    fseek(m_pFile, 0, SEEK_END);
+    const long size = ftell(m_pFile);
+    if (size < m_offset) {
+        // file was truncated, new commands are written from its beginning
+        m_offset    = 0;
+        m_bSkipLine = false;
+    }
+    if (size == m_offset)
+        return;
+    fseek(m_pFile, m_offset, SEEK_SET);
+
+    while (msdk_fgets(m_buf.data(), (int)m_buf.size(), m_pFile)) {
+        msdk_string line(m_buf.data());
+        const bool bComplete = !line.empty() && line.back() == '\n';
+        if (!bComplete && line.size() + 1 < m_buf.size())
+            break; // the rest of the line isn't written yet
+
+        m_offset = ftell(m_pFile);
+        if (m_bSkipLine) {
+            m_bSkipLine = !bComplete;
+            continue;
+        }
+        if (!bComplete) {
+            msdk_printf(MSDK_STRING("Control: line is too long, skipped\n"));
+            m_bSkipLine = true;
+            continue;
+        }
+
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+            line.pop_back();
+        const size_t start = line.find_first_not_of(MSDK_STRING(" \t"));
+        if (start == msdk_string::npos || line[start] == '#')
+            continue;
+
+        Command command = {};
+        if (ParseCommand(line.substr(start), command))
+            commands.push_back(command);
+        else
+            msdk_printf(MSDK_STRING("Control: invalid command \"%s\"\n"), line.c_str());
+    }
+    clearerr(m_pFile);
+}
+
+bool CSessionControl::ParseCommand(const msdk_string& line, Command& command) {
+    msdk_stringstream ss(line);
+    msdk_string name, session, value, rest;
+    ss >> name;
+
+    if (name == MSDK_STRING("add")) {
+        command.Type = CMD_ADD;
+        command.Line = line.substr(name.size());
+        return command.Line.find_first_not_of(MSDK_STRING(" \t")) != msdk_string::npos;
+    }
+    if (name == MSDK_STRING("quit")) {
+        command.Type = CMD_QUIT;
+        return !(ss >> rest);
+    }
+
+    if (name == MSDK_STRING("stop"))
+        command.Type = CMD_STOP;
+    else if (name == MSDK_STRING("drain"))
+        command.Type = CMD_DRAIN;
+    else if (name == MSDK_STRING("bitrate"))
+        command.Type = CMD_BITRATE;
+    else
+        return false;
+
+    if (!(ss >> session) || MFX_ERR_NONE != msdk_opt_read(session, command.Session))
+        return false;
+    if (CMD_BITRATE == command.Type) {
+        if (!(ss >> value) || MFX_ERR_NONE != msdk_opt_read(value, command.Bitrate) ||
+            !command.Bitrate)
+            return false;
+    }
+    return !(ss >> rest);
+}
+
+} // namespace TranscodingSample
@@ -116,6 +116,35 @@ void TranscodingSample::PrintHelp() {
     msdk_printf(MSDK_STRING("  -greedy \n"));
     msdk_printf(
         MSDK_STRING("                Use greedy formula to calculate number of surfaces\n"));
+    msdk_printf(MSDK_STRING("  -parallel_init\n"));
+    msdk_printf(MSDK_STRING(
+        "                Initialize independent sessions concurrently. Joined sessions and sessions\n"));
+    msdk_printf(MSDK_STRING(
+        "                linked by -o::sink/-i::source are still initialized one by one\n"));
+    msdk_printf(MSDK_STRING("  -sysmem_slab\n"));
+    msdk_printf(MSDK_STRING(
+        "                Allocate system memory surfaces of one request in one page aligned slab\n"));
+    msdk_printf(MSDK_STRING("  -sysmem_huge_pages\n"));
+    msdk_printf(MSDK_STRING(
+        "                Back system memory slabs with huge pages (implies -sysmem_slab)\n"));
+    msdk_printf(MSDK_STRING("  -sysmem_numa <node>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Bind system memory slabs to NUMA node (implies -sysmem_slab)\n"));
+    msdk_printf(MSDK_STRING("  -ctrl <file-name>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Read control commands from lines appended to the file while transcoding,\n"));
+    msdk_printf(MSDK_STRING(
+        "                the application runs until 'quit' command. <N> is a session number:\n"));
+    msdk_printf(MSDK_STRING(
+        "                  add <pipeline-description>  start 1 to 1 session on the device of session 0\n"));
+    msdk_printf(MSDK_STRING("                  stop <N>        stop session right away\n"));
+    msdk_printf(MSDK_STRING(
+        "                  drain <N>       stop reading input, output frames in flight (1 to 1 only)\n"));
+    msdk_printf(MSDK_STRING(
+        "                  bitrate <N> <Kbps>  reset encoder with new target bitrate (1 to 1 only)\n"));
+    msdk_printf(MSDK_STRING(
+        "                  quit            stop reading commands, exit when sessions finish\n"));
+    msdk_printf(MSDK_STRING("                Can't be combined with -robust\n"));
     msdk_printf(MSDK_STRING("\n"));
     msdk_printf(MSDK_STRING("Pipeline description (general options):\n"));
     msdk_printf(MSDK_STRING("  -i::h265|h264|mpeg2|vc1|mvc|jpeg|vp9|av1 <file-name>\n"));
@@ -128,6 +157,17 @@ void TranscodingSample::PrintHelp() {
     msdk_printf(MSDK_STRING("                Set output file and encoder type\n"));
     msdk_printf(MSDK_STRING(
         "                \'null\' keyword as file-name disables output file writing \n"));
+    msdk_printf(MSDK_STRING("  -out_sink stdio|async|direct [KB]\n"));
+    msdk_printf(MSDK_STRING(
+        "                Write output per frame (default), batched on background thread or batched\n"));
+    msdk_printf(MSDK_STRING(
+        "                with O_DIRECT, KB - batch buffer size. Output file-name tcp://host:port or\n"));
+    msdk_printf(MSDK_STRING("                udp://host:port sends the stream to a socket\n"));
+    msdk_printf(MSDK_STRING("  -i::shm|-o::shm\n"));
+    msdk_printf(MSDK_STRING(
+        "                Treat input/output file-name as shared memory ring shared with another\n"));
+    msdk_printf(MSDK_STRING(
+        "                process (e.g. sample_encode -o::shm, sample_decode -i::shm), frame per slot\n"));
     msdk_printf(MSDK_STRING("  -sw|-hw|-hw_d3d11|-hw_d3d9\n"));
     msdk_printf(MSDK_STRING("                SDK implementation to use: \n"));
     msdk_printf(MSDK_STRING(
@@ -207,6 +247,17 @@ void TranscodingSample::PrintHelp() {
     msdk_printf(MSDK_STRING("  -robust:soft  Recover from gpu hang errors by inserting an IDR\n"));
 
     msdk_printf(MSDK_STRING("  -async        Depth of asynchronous pipeline. default value 1\n"));
+    msdk_printf(MSDK_STRING("  -async_min <depth>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Adaptive depth between <depth> and -async value: the lowest one holding the target throughput.\n"));
+    msdk_printf(MSDK_STRING("                Not supported in decoding sessions (-o::sink)\n"));
+    msdk_printf(MSDK_STRING("  -async_target_fps <fps>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Target throughput of adaptive depth. By default it is -fps value or throughput at higher depths\n"));
+    msdk_printf(MSDK_STRING(
+        "  -live <ms>    Live mode: decoded frames are paced by their time stamps or frame rate,\n"));
+    msdk_printf(MSDK_STRING(
+        "                frames which can't be encoded within <ms> from it are dropped. Only for 1 to 1 transcoding\n"));
     msdk_printf(MSDK_STRING(
         "  -join         Join session with other session(s), by default sessions are not joined\n"));
     msdk_printf(MSDK_STRING(
@@ -221,6 +272,14 @@ void TranscodingSample::PrintHelp() {
                     "                In encoding sessions (-o::source) and transcoding sessions \n")
                     MSDK_STRING(
                         "                  this parameter limits number of frames sent to encoder.\n"));
+    msdk_printf(MSDK_STRING(
+        "  -preload n m  Keep input in memory and replay it m times (0 - infinite).\n"));
+    msdk_printf(MSDK_STRING(
+        "                For raw input only first n frames are kept (0 - whole file).\n"));
+    msdk_printf(MSDK_STRING(
+        "                Elementary streams are always kept whole, n is ignored for them\n"));
+    msdk_printf(MSDK_STRING(
+        "  -preload_ts   Rewrite time stamps of preloaded raw frames so they keep growing across loops\n"));
 
     msdk_printf(
         MSDK_STRING("  -MemType::video    Force usage of external video allocator (default)\n"));
@@ -381,6 +440,10 @@ void TranscodingSample::PrintHelp() {
     msdk_printf(MSDK_STRING("  -roi_file <roi-file-name>\n"));
     msdk_printf(MSDK_STRING(
         "                Set Regions of Interest for each frame from <roi-file-name>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Binary file starts with \"ROIB\", then per frame: 16-bit number of regions\n"));
+    msdk_printf(MSDK_STRING(
+        "                and 32-bit left, top, right, bottom, 16-bit delta QP of every region\n"));
     msdk_printf(MSDK_STRING("  -roi_qpmap    Use QP map to emulate ROI for CQP mode\n"));
     msdk_printf(MSDK_STRING("  -extmbqp      Use external MBQP map\n"));
     msdk_printf(MSDK_STRING(
@@ -613,11 +676,16 @@ CmdProcessor::CmdProcessor() {
     m_encoderPlugins.clear();
     m_PerfFILE           = NULL;
     m_parName            = NULL;
+    m_ctrlName           = NULL;
     m_nTimeout           = 0;
     statisticsWindowSize = 0;
     statisticsLogFile    = NULL;
     DumpLogFileName.clear();
     shouldUseGreedyFormula = false;
+    bParallelInit          = false;
+    bSysMemSlab            = false;
+    bSysMemHugePages       = false;
+    nSysMemNumaNode        = -1;
     bRobustFlag            = false;
     bSoftRobustFlag        = false;
 
@@ -646,6 +714,35 @@ msdk_string CmdProcessor::GetLine(mfxU32 n) {
     return msdk_string();
 }
 
+mfxStatus CmdProcessor::ParseSessionLine(const msdk_string& line,
+                                         TranscodingSample::sInputParams& InputParams) {
+    const size_t nLines    = m_lines.size();
+    const size_t nSessions = m_SessionArray.size();
+
+    std::vector<msdk_char> buf(line.begin(), line.end());
+    buf.push_back(0);
+    mfxStatus sts = TokenizeLine(buf.data(), (mfxU32)line.size());
+    if (MFX_ERR_NONE == sts && m_SessionArray.size() != nSessions + 1) {
+        PrintError(MSDK_STRING("line doesn't describe a session"));
+        sts = MFX_ERR_UNSUPPORTED;
+    }
+    if (MFX_ERR_NONE != sts) {
+        m_lines.resize(std::min(m_lines.size(), nLines));
+        m_SessionArray.resize(nSessions);
+        return sts;
+    }
+
+    // it isn't returned by GetNextSessionParams
+    InputParams = m_SessionArray.back();
+    m_SessionArray.pop_back();
+    return MFX_ERR_NONE;
+}
+
+void CmdProcessor::RemoveLastLine() {
+    if (!m_lines.empty())
+        m_lines.pop_back();
+}
+
 mfxStatus CmdProcessor::ParseCmdLine(int argc, msdk_char* argv[]) {
     FILE* parFile = NULL;
     mfxStatus sts = MFX_ERR_UNSUPPORTED;
@@ -667,6 +764,15 @@ mfxStatus CmdProcessor::ParseCmdLine(int argc, msdk_char* argv[]) {
             }
             m_parName = argv[0];
         }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-ctrl"))) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                msdk_printf(MSDK_STRING("error: no argument given for '-ctrl' option\n"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            m_ctrlName = argv[0];
+        }
         else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-timeout"))) {
             --argc;
             ++argv;
@@ -691,6 +797,27 @@ mfxStatus CmdProcessor::ParseCmdLine(int argc, msdk_char* argv[]) {
         else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-greedy"))) {
             shouldUseGreedyFormula = true;
         }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-parallel_init"))) {
+            bParallelInit = true;
+        }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-sysmem_slab"))) {
+            bSysMemSlab = true;
+        }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-sysmem_huge_pages"))) {
+            bSysMemHugePages = true;
+        }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-sysmem_numa"))) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                msdk_printf(MSDK_STRING("error: no argument given for '-sysmem_numa' option\n"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(argv[0], nSysMemNumaNode) || nSysMemNumaNode < 0) {
+                msdk_printf(MSDK_STRING("error: -sysmem_numa \"%s\" is invalid"), argv[0]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
         else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-p"))) {
             if (m_PerfFILE) {
                 msdk_printf(MSDK_STRING("error: only one performance file is supported"));
@@ -924,6 +1051,51 @@ bool CmdProcessor::is_not_allowed_char(char a) {
     return (std::isdigit(a) == 0) && (std::isspace(a) == 0) && (a != ';') && (a != '-');
 }
 
+// Binary ROI file starts with "ROIB", then for every frame:
+// mfxU16 NumROI and NumROI records of mfxI32 Left, Top, Right, Bottom and mfxI16 DeltaQP,
+// little endian without padding.
+const char ROI_BINARY_MAGIC[4]       = { 'R', 'O', 'I', 'B' };
+const size_t ROI_BINARY_RECORD_SIZE = 4 * sizeof(mfxI32) + sizeof(mfxI16);
+
+bool CmdProcessor::ParseROIBinary(const char* data,
+                                  size_t size,
+                                  std::vector<mfxExtEncoderROI>& m_ROIData) {
+    const char* pos = data + sizeof(ROI_BINARY_MAGIC);
+    const char* end = data + size;
+
+    while (pos < end) {
+        mfxU16 roi_num = 0;
+        if (end - pos < (ptrdiff_t)sizeof(roi_num))
+            return false;
+        std::memcpy(&roi_num, pos, sizeof(roi_num));
+        pos += sizeof(roi_num);
+
+        m_ROIData.emplace_back();
+        mfxExtEncoderROI& frame_roi = m_ROIData.back();
+        std::memset(&frame_roi, 0, sizeof(frame_roi));
+        frame_roi.Header.BufferId = MFX_EXTBUFF_ENCODER_ROI;
+        frame_roi.ROIMode         = MFX_ROI_MODE_QP_DELTA;
+
+        if (roi_num > sizeof(frame_roi.ROI) / sizeof(frame_roi.ROI[0]) ||
+            (size_t)(end - pos) < roi_num * ROI_BINARY_RECORD_SIZE)
+            return false;
+
+        for (mfxU16 i = 0; i < roi_num; i++) {
+            mfxI32 rect[4] = {};
+            std::memcpy(rect, pos, sizeof(rect));
+            std::memcpy(&frame_roi.ROI[i].DeltaQP, pos + sizeof(rect), sizeof(mfxI16));
+            pos += ROI_BINARY_RECORD_SIZE;
+
+            frame_roi.ROI[i].Left   = rect[0];
+            frame_roi.ROI[i].Top    = rect[1];
+            frame_roi.ROI[i].Right  = rect[2];
+            frame_roi.ROI[i].Bottom = rect[3];
+        }
+        frame_roi.NumROI = roi_num;
+    }
+    return true;
+}
+
 bool CmdProcessor::ParseROIFile(const msdk_char* roi_file_name,
                                 std::vector<mfxExtEncoderROI>& m_ROIData) {
     FILE* roi_file = NULL;
@@ -944,6 +1116,16 @@ bool CmdProcessor::ParseROIFile(const msdk_char* roi_file_name,
         }
         fclose(roi_file);
 
+        // binary file is loaded as is, no text parsing
+        if ((size_t)file_size >= sizeof(ROI_BINARY_MAGIC) &&
+            !std::memcmp(roi_data, ROI_BINARY_MAGIC, sizeof(ROI_BINARY_MAGIC))) {
+            if (!ParseROIBinary(roi_data, file_size, m_ROIData)) {
+                m_ROIData.clear();
+                return false;
+            }
+            return true;
+        }
+
         // search for not allowed characters
         char* not_allowed_char = std::find_if(roi_data, roi_data + file_size, is_not_allowed_char);
         if (not_allowed_char != (roi_data + file_size)) {
@@ -1752,6 +1934,10 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char* argv[])
         InputParams.bSoftRobustFlag = true;
 
     InputParams.shouldUseGreedyFormula = shouldUseGreedyFormula;
+    InputParams.bParallelInit          = bParallelInit;
+    InputParams.bSysMemSlab            = bSysMemSlab;
+    InputParams.bSysMemHugePages       = bSysMemHugePages;
+    InputParams.nSysMemNumaNode        = nSysMemNumaNode;
 
     InputParams.statisticsWindowSize = statisticsWindowSize;
     InputParams.statisticsLogFile    = statisticsLogFile;
@@ -1779,7 +1965,8 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char* argv[])
         if ((0 == msdk_strncmp(MSDK_STRING("-i::"), argv[i], msdk_strlen(MSDK_STRING("-i::")))) &&
             (0 != msdk_strncmp(argv[i] + 4,
                                MSDK_STRING("source"),
-                               msdk_strlen(MSDK_STRING("source"))))) {
+                               msdk_strlen(MSDK_STRING("source")))) &&
+            (0 != msdk_strcmp(argv[i] + 4, MSDK_STRING("shm")))) {
             sts = StrFormatToCodecFormatFourCC(argv[i] + 4, InputParams.DecodeId);
             if (sts != MFX_ERR_NONE) {
                 return MFX_ERR_UNSUPPORTED;
@@ -1810,7 +1997,8 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char* argv[])
                   msdk_strncmp(MSDK_STRING("-o::"), argv[i], msdk_strlen(MSDK_STRING("-o::")))) &&
                  (0 != msdk_strncmp(argv[i] + 4,
                                     MSDK_STRING("sink"),
-                                    msdk_strlen(MSDK_STRING("sink"))))) {
+                                    msdk_strlen(MSDK_STRING("sink")))) &&
+                 (0 != msdk_strcmp(argv[i] + 4, MSDK_STRING("shm")))) {
             sts = StrFormatToCodecFormatFourCC(argv[i] + 4, InputParams.EncodeId);
 
             if (sts != MFX_ERR_NONE) {
@@ -2148,6 +2336,31 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char* argv[])
                 return MFX_ERR_UNSUPPORTED;
             }
         }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-async_min"))) {
+            VAL_CHECK(i + 1 == argc, i, argv[i]);
+            i++;
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nAsyncDepthMin)) {
+                PrintError(MSDK_STRING("async_min \"%s\" is invalid"), argv[i]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-async_target_fps"))) {
+            VAL_CHECK(i + 1 == argc, i, argv[i]);
+            i++;
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.dAsyncTargetFps)) {
+                PrintError(MSDK_STRING("async_target_fps \"%s\" is invalid"), argv[i]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-live"))) {
+            VAL_CHECK(i + 1 == argc, i, argv[i]);
+            i++;
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nLiveLatency) ||
+                !InputParams.nLiveLatency) {
+                PrintError(MSDK_STRING("live \"%s\" is invalid"), argv[i]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
         else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-join"))) {
             InputParams.bIsJoin = true;
         }
@@ -2346,6 +2559,52 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char* argv[])
                 return MFX_ERR_UNSUPPORTED;
             }
         }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-preload"))) {
+            VAL_CHECK(i + 2 >= argc, i, argv[i]);
+            InputParams.bPreload = true;
+            i++;
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nPreloadFrames)) {
+                PrintError(MSDK_STRING("-preload %s frames number is invalid"), argv[i]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+            i++;
+            if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nPreloadLoops)) {
+                PrintError(MSDK_STRING("-preload %s loops number is invalid"), argv[i]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-preload_ts"))) {
+            InputParams.bPreloadTimeStamps = true;
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-out_sink"))) {
+            VAL_CHECK(i + 1 == argc, i, argv[i]);
+            i++;
+            if (0 == msdk_strcmp(argv[i], MSDK_STRING("stdio")))
+                InputParams.OutSinkType = SINK_STDIO;
+            else if (0 == msdk_strcmp(argv[i], MSDK_STRING("async")))
+                InputParams.OutSinkType = SINK_ASYNC;
+            else if (0 == msdk_strcmp(argv[i], MSDK_STRING("direct")))
+                InputParams.OutSinkType = SINK_DIRECT;
+            else {
+                PrintError(MSDK_STRING("-out_sink %s is unknown"), argv[i]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (i + 1 < argc && isdigit(*argv[i + 1])) {
+                i++;
+                mfxU32 nBufferSizeKB = 0;
+                if (MFX_ERR_NONE != msdk_opt_read(argv[i], nBufferSizeKB)) {
+                    PrintError(MSDK_STRING("-out_sink buffer size %s is invalid"), argv[i]);
+                    return MFX_ERR_UNSUPPORTED;
+                }
+                InputParams.nOutSinkBufferSize = nBufferSizeKB * 1024;
+            }
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-i::shm"))) {
+            InputParams.bShmInput = true;
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-o::shm"))) {
+            InputParams.bShmOutput = true;
+        }
         else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-angle"))) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
@@ -2725,6 +2984,12 @@ mfxStatus CmdProcessor::VerifyAndCorrectInputParams(TranscodingSample::sInputPar
         InputParams.rawInput = false;
     }
 
+    if (InputParams.bShmInput && (InputParams.rawInput || InputParams.bPreload ||
+                                  MFX_CODEC_RGB4 == InputParams.DecodeId)) {
+        PrintError(MSDK_STRING("-i::shm supports encoded input without -preload only\n"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
     if (MFX_CODEC_RGB4 == InputParams.DecodeId &&
         (!InputParams.nVppCompSrcH || !InputParams.nVppCompSrcW)) {
         PrintError(MSDK_STRING(
@@ -2766,7 +3031,8 @@ mfxStatus CmdProcessor::VerifyAndCorrectInputParams(TranscodingSample::sInputPar
 
     // Ignoring user-defined Async Depth for LA
     if (InputParams.nMaxSliceSize) {
-        InputParams.nAsyncDepth = 1;
+        InputParams.nAsyncDepth    = 1;
+        InputParams.nAsyncDepthMin = 0;
     }
 
     // For decoder session of inter-session case, let's set AsyncDepth to 4 by default
@@ -2774,6 +3040,25 @@ mfxStatus CmdProcessor::VerifyAndCorrectInputParams(TranscodingSample::sInputPar
         InputParams.nAsyncDepth = 4;
     }
 
+    if (InputParams.nAsyncDepthMin && InputParams.nAsyncDepthMin >= InputParams.nAsyncDepth) {
+        PrintError(MSDK_STRING("-async_min must be less than -async"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+    // decoded frames of the sink are synced when the buffer to the next session is full,
+    // adaptive depth doesn't control it
+    if (InputParams.nAsyncDepthMin && InputParams.eMode == Sink) {
+        PrintError(MSDK_STRING("-async_min is not supported in decoding sessions (-o::sink)"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+    if (InputParams.dAsyncTargetFps < 0) {
+        PrintError(MSDK_STRING("-async_target_fps must not be negative"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+    if (InputParams.nLiveLatency && InputParams.eMode != Native) {
+        PrintError(MSDK_STRING("-live is supported only for 1 to 1 transcoding"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
     if (InputParams.bLABRC && !(InputParams.libType & MFX_IMPL_HARDWARE_ANY)) {
         PrintError(MSDK_STRING("Look ahead BRC is supported only with -hw option!"));
         return MFX_ERR_UNSUPPORTED;
@@ -0,0 +1,77 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SAMPLE_VPP_SURFACE_POOL_H
+#define __SAMPLE_VPP_SURFACE_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "sample_defs.h"
+#include "sample_utils.h"
+
+#ifndef MFX_VERSION
+    #error MFX_VERSION not defined
+#endif
+
+/* ************************************************************************* */
+// Pool of VPP surfaces with FIFO of free surfaces.
+// Surfaces come back to the free queue when the application drops the last reference
+// (ReleaseReference) and waiters are woken immediately. The library drops its references
+// when a task completes, so the application calls Reclaim after synchronization to return
+// those surfaces and wake waiters.
+class CVPPSurfacePool {
+public:
+    CVPPSurfacePool();
+    ~CVPPSurfacePool();
+
+    mfxStatus Init(mfxFrameSurfaceWrap* pSurfaces, mfxU16 nPoolSize, bool bCollectStatistics);
+    void Close();
+
+    // waits up to nTimeout msec for a free surface
+    mfxStatus GetFreeSurface(mfxFrameSurfaceWrap** ppSurface,
+                             mfxU32 nTimeout = MSDK_SURFACE_WAIT_INTERVAL);
+
+    // checks if a surface can be taken without waiting
+    bool HasFreeSurface();
+
+    void AddReference(mfxFrameSurfaceWrap* pSurface);
+    void ReleaseReference(mfxFrameSurfaceWrap* pSurface);
+
+    // picks up surfaces released by the library, called once tasks are synchronized
+    void Reclaim();
+
+    void PrintStatistics(const msdk_char* strName);
+
+protected:
+    mfxU16 GetIndex(mfxFrameSurfaceWrap* pSurface) const;
+    mfxFrameSurfaceWrap* PopFreeSurfaceUnsafe();
+    void ReclaimUnsafe();
+
+    mfxFrameSurfaceWrap* m_pSurfaces;
+    mfxU16 m_nPoolSize;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<mfxU16> m_freeQueue;
+    std::vector<bool> m_isQueued;
+
+    // wait statistics
+    bool m_bCollectStatistics;
+    mfxU64 m_nRequests;
+    mfxU64 m_nWaits;
+    mfxU64 m_nTimeouts;
+    mfxF64 m_totalWaitTime;
+    mfxF64 m_maxWaitTime;
+
+private:
+    CVPPSurfacePool(const CVPPSurfacePool&);
+    void operator=(const CVPPSurfacePool&);
+};
+
+#endif /* __SAMPLE_VPP_SURFACE_POOL_H */
@@ -49,6 +49,7 @@
     #include "base_allocator.h"
     #include "sample_vpp_config.h"
     #include "sample_vpp_roi.h"
+    #include "sample_vpp_surface_pool.h"
 
     // we introduce new macros without error message (returned status only)
     // it allows to remove final error message due to EOF
@@ -188,6 +189,7 @@ struct sInputParams {
     bool bPartialAccel;
 
     bool bPerf;
+    bool bSurfacePoolStat;
     mfxU32 numFrames;
     mfxU16 numRepeat;
     bool isOutput;
@@ -260,7 +262,8 @@ struct sInputParams {
         MSDK_ZERO_MEMORY(compositionParam);
         MSDK_ZERO_MEMORY(roiCheckParam);
 
-        bPerf = false;
+        bPerf            = false;
+        bSurfacePoolStat = false;
         MSDK_ZERO_MEMORY(strSrcFile);
         MSDK_ZERO_MEMORY(strPerfFile);
         strDstFiles.clear();
@@ -302,6 +305,9 @@ struct sMemoryAllocator {
     mfxFrameAllocResponse responseIn[MAX_INPUT_STREAMS]; // SINGLE_IN/OUT/MULTIPLE_INs
     mfxFrameAllocResponse responseOut;
 
+    CVPPSurfacePool surfacePoolIn[MAX_INPUT_STREAMS]; // free surfaces tracking for pSurfacesIn
+    CVPPSurfacePool surfacePoolOut; // free surfaces tracking for pSurfacesOut
+
     mfxFrameSurfaceWrap* pSvcSurfaces[8]; //output surfaces per layer
     mfxFrameAllocResponse svcResponse[8]; //per layer
 
@@ -347,10 +353,9 @@ private:
     mfxStatus GetPreAllocFrame(mfxFrameSurfaceWrap** pSurface);
 
     FILE* m_fSrc;
-    std::list<mfxFrameSurfaceWrap>::iterator m_it;
-    std::list<mfxFrameSurfaceWrap> m_SurfacesList;
+    std::vector<mfxFrameSurfaceWrap> m_SurfacesList;
+    CPreloadedLoop m_PreloadLoop;
     bool m_isPerfMode;
-    mfxU16 m_Repeat;
 
     PTSMaker* m_pPTSMaker;
     mfxU32 m_initFcc;
@@ -461,9 +466,6 @@ void WipeParams(sInputParams* pParams);
 mfxStatus UpdateSurfacePool(mfxFrameInfo SurfacesInfo,
                             mfxU16 nPoolSize,
                             mfxFrameSurfaceWrap* pSurface);
-mfxStatus GetFreeSurface(mfxFrameSurfaceWrap* pSurfacesPool,
-                         mfxU16 nPoolSize,
-                         mfxFrameSurfaceWrap** ppSurface);
 
 const msdk_char* IOpattern2Str(mfxU32 IOpattern);
 
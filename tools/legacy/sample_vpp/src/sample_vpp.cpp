@@ -24,14 +24,6 @@
 
 using namespace std;
 
-void IncreaseReference(mfxFrameData* ptr) {
-    msdk_atomic_inc16((volatile mfxU16*)&ptr->Locked);
-}
-
-void DecreaseReference(mfxFrameData* ptr) {
-    msdk_atomic_dec16((volatile mfxU16*)&ptr->Locked);
-}
-
 void PutPerformanceToFile(sInputParams& Params, mfxF64 FPS) {
     FILE* fPRF = NULL;
     MSDK_FOPEN(fPRF, Params.strPerfFile, MSDK_STRING("ab"));
@@ -195,7 +187,7 @@ mfxStatus OutputProcessFrame(sAppResources Resources,
                                         : &Resources.pDstFileWriters[paramID];
             sts = writer->PutNextFrame(Resources.pAllocator, pOutFrameInfo, pProcessedSurface);
         }
-        DecreaseReference(&pProcessedSurface->Data);
+        Resources.pAllocator->surfacePoolOut.ReleaseReference(pProcessedSurface);
 
         if (sts)
             msdk_printf(MSDK_STRING("Failed to write frame to disk\n"));
@@ -212,6 +204,11 @@ mfxStatus OutputProcessFrame(sAppResources Resources,
                 msdk_printf(MSDK_STRING("."));
         }
     }
+
+    // input surfaces of the synchronized tasks are released by the library now
+    for (int i = 0; i < Resources.numSrcFiles; i++) {
+        Resources.pAllocator->surfacePoolIn[i].Reclaim();
+    }
     return MFX_ERR_NONE;
 
 } // mfxStatus OutputProcessFrame(
@@ -658,6 +655,14 @@ int main(int argc, msdk_char* argv[])
                 }
             }
 
+            // surfaces held by the library are released only when their tasks are synchronized
+            if (!surfStore.m_SyncPoints.empty() &&
+                (!allocator.surfacePoolOut.HasFreeSurface() ||
+                 (!bDoNotUpdateIn && !allocator.surfacePoolIn[nInStreamInd].HasFreeSurface()))) {
+                sts = OutputProcessFrame(Resources, &realFrameInfoOut, nFrames, paramID);
+                MSDK_BREAK_ON_ERROR(sts);
+            }
+
             if (!bDoNotUpdateIn) {
                 if (nextResetFrmNum == numGetFrames) {
                     bNeedReset = true;
@@ -691,9 +696,7 @@ int main(int argc, msdk_char* argv[])
             // VPP processing
             bDoNotUpdateIn = false;
 
-            sts = GetFreeSurface(allocator.pSurfacesOut,
-                                 allocator.responseOut.NumFrameActual,
-                                 &pOutSurf);
+            sts = allocator.surfacePoolOut.GetFreeSurface(&pOutSurf);
             MSDK_BREAK_ON_ERROR(sts);
 
             if (bROITest[VPP_IN]) {
@@ -761,11 +764,12 @@ int main(int argc, msdk_char* argv[])
 
                 if (bMultiView) {
                     if (viewSurfaceStore[viewIndx]) {
-                        DecreaseReference(&(viewSurfaceStore[viewIndx]->Data));
+                        allocator.surfacePoolIn[nInStreamInd].ReleaseReference(
+                            viewSurfaceStore[viewIndx]);
                     }
 
                     viewSurfaceStore[viewIndx] = pInSurf[nInStreamInd];
-                    IncreaseReference(&(viewSurfaceStore[viewIndx]->Data));
+                    allocator.surfacePoolIn[nInStreamInd].AddReference(viewSurfaceStore[viewIndx]);
 
                     bMultipleOutStore[viewIndx] = true;
                 }
@@ -780,7 +784,8 @@ int main(int argc, msdk_char* argv[])
             }
             else if (MFX_ERR_NONE == sts && bMultiView) {
                 if (viewSurfaceStore[viewIndx]) {
-                    DecreaseReference(&(viewSurfaceStore[viewIndx]->Data));
+                    allocator.surfacePoolIn[nInStreamInd].ReleaseReference(
+                        viewSurfaceStore[viewIndx]);
                     viewSurfaceStore[viewIndx] = NULL;
                 }
             }
@@ -788,7 +793,7 @@ int main(int argc, msdk_char* argv[])
             MSDK_CHECK_STATUS_NO_RET(sts, "RunFrameVPPAsync(Ex) failed")
             MSDK_BREAK_ON_ERROR(sts);
             surfStore.m_SyncPoints.push_back(SurfaceVPPStore::SyncPair(syncPoint, pOutSurf));
-            IncreaseReference(&pOutSurf->Data);
+            allocator.surfacePoolOut.AddReference(pOutSurf);
             if (surfStore.m_SyncPoints.size() !=
                 (size_t)((size_t)Params.asyncNum *
                          (size_t)Params.multiViewParam[paramID].viewCount)) {
@@ -819,9 +824,7 @@ int main(int argc, msdk_char* argv[])
 
         // loop to get buffered frames from VPP
         while (MFX_ERR_NONE <= sts) {
-            sts = GetFreeSurface(allocator.pSurfacesOut,
-                                 allocator.responseOut.NumFrameActual,
-                                 &pOutSurf);
+            sts = allocator.surfacePoolOut.GetFreeSurface(&pOutSurf);
             MSDK_BREAK_ON_ERROR(sts);
 
             bDoNotUpdateIn = false;
@@ -872,6 +875,7 @@ int main(int argc, msdk_char* argv[])
             if (sts)
                 msdk_printf(MSDK_STRING("SyncOperation wait interval exceeded\n"));
             MSDK_BREAK_ON_ERROR(sts);
+            allocator.surfacePoolOut.Reclaim();
             if (!Resources.pParams->strDstFiles.empty()) {
                 GeneralWriter* writer = (1 == Resources.dstFileWritersN)
                                             ? &Resources.pDstFileWriters[0]
@@ -910,6 +914,13 @@ int main(int argc, msdk_char* argv[])
     msdk_printf(MSDK_STRING("Total time %.2f sec \n"), statTimer.GetTotalTime());
     msdk_printf(MSDK_STRING("Frames per second %.3f fps \n"), nFrames / statTimer.GetTotalTime());
 
+    if (Params.bSurfacePoolStat) {
+        for (int i = 0; i < Resources.numSrcFiles; i++) {
+            allocator.surfacePoolIn[i].PrintStatistics(MSDK_STRING("Input"));
+        }
+        allocator.surfacePoolOut.PrintStatistics(MSDK_STRING("Output"));
+    }
+
     PutPerformanceToFile(Params, nFrames / statTimer.GetTotalTime());
 
     WipeResources(&Resources);
@@ -366,7 +366,9 @@ void vppPrintHelp(const msdk_char* strAppName, const msdk_char* strErrorMessage)
     msdk_printf(
         MSDK_STRING("   [-async n] - maximum number of asynchronious tasks. def: -async 1 \n"));
     msdk_printf(MSDK_STRING(
-        "   [-perf_opt n m] - n: number of prefetech frames. m : number of passes. In performance mode app preallocates bufer and load first n frames,  def: no performace 1 \n"));
+        "   [-perf_opt n m] - n: number of prefetech frames. m : number of passes (0 - infinite). In performance mode app preallocates bufer and load first n frames,  def: no performace 1 \n"));
+    msdk_printf(MSDK_STRING(
+        "   [-surf_stat] - report how often and how long VPP waits for free surfaces. Default is OFF \n"));
     msdk_printf(MSDK_STRING("   [-pts_check] - checking of time stampls. Default is OFF \n"));
     msdk_printf(MSDK_STRING(
         "   [-pts_jump ] - checking of time stamps jumps. Jump for random value since 13-th frame. Also, you can change input frame rate (via pts). Default frame_rate = sf \n"));
@@ -1888,6 +1890,9 @@ mfxStatus vppParseInputString(msdk_char* strInput[],
                 i++;
                 msdk_sscanf(strInput[i], MSDK_STRING("%hu"), &pParams->numRepeat);
             }
+            else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-surf_stat"))) {
+                pParams->bSurfacePoolStat = true;
+            }
             else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-pts_check"))) {
                 pParams->ptsCheck = true;
             }
@@ -0,0 +1,204 @@
+/*############################################################################
+  # Copyright (C) 2005 Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "sample_vpp_surface_pool.h"
+#include <chrono>
+#include "vm/atomic_defs.h"
+
+#ifndef MFX_VERSION
+    #error MFX_VERSION not defined
+#endif
+
+CVPPSurfacePool::CVPPSurfacePool()
+        : m_pSurfaces(nullptr),
+          m_nPoolSize(0),
+          m_mutex(),
+          m_cv(),
+          m_freeQueue(),
+          m_isQueued(),
+          m_bCollectStatistics(false),
+          m_nRequests(0),
+          m_nWaits(0),
+          m_nTimeouts(0),
+          m_totalWaitTime(0),
+          m_maxWaitTime(0) {}
+
+CVPPSurfacePool::~CVPPSurfacePool() {
+    Close();
+}
+
+mfxStatus CVPPSurfacePool::Init(mfxFrameSurfaceWrap* pSurfaces,
+                                mfxU16 nPoolSize,
+                                bool bCollectStatistics) {
+    MSDK_CHECK_POINTER(pSurfaces, MFX_ERR_NULL_PTR);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_pSurfaces          = pSurfaces;
+    m_nPoolSize          = nPoolSize;
+    m_bCollectStatistics = bCollectStatistics;
+
+    m_freeQueue.clear();
+    m_isQueued.assign(nPoolSize, false);
+    ReclaimUnsafe();
+
+    m_nRequests     = 0;
+    m_nWaits        = 0;
+    m_nTimeouts     = 0;
+    m_totalWaitTime = 0;
+    m_maxWaitTime   = 0;
+
+    return MFX_ERR_NONE;
+}
+
+void CVPPSurfacePool::Close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_pSurfaces = nullptr;
+    m_nPoolSize = 0;
+    m_freeQueue.clear();
+    m_isQueued.clear();
+}
+
+mfxU16 CVPPSurfacePool::GetIndex(mfxFrameSurfaceWrap* pSurface) const {
+    if (!m_pSurfaces || pSurface < m_pSurfaces || pSurface >= m_pSurfaces + m_nPoolSize)
+        return MSDK_INVALID_SURF_IDX;
+
+    return (mfxU16)(pSurface - m_pSurfaces);
+}
+
+mfxFrameSurfaceWrap* CVPPSurfacePool::PopFreeSurfaceUnsafe() {
+    while (!m_freeQueue.empty()) {
+        mfxU16 index = m_freeQueue.front();
+        m_freeQueue.pop_front();
+        m_isQueued[index] = false;
+
+        // surface could be referenced again after it was queued, it will be reclaimed later
+        if (0 == m_pSurfaces[index].Data.Locked)
+            return &m_pSurfaces[index];
+    }
+
+    return nullptr;
+}
+
+void CVPPSurfacePool::ReclaimUnsafe() {
+    for (mfxU16 i = 0; i < m_nPoolSize; i++) {
+        if (!m_isQueued[i] && 0 == m_pSurfaces[i].Data.Locked) {
+            m_freeQueue.push_back(i);
+            m_isQueued[i] = true;
+        }
+    }
+}
+
+mfxStatus CVPPSurfacePool::GetFreeSurface(mfxFrameSurfaceWrap** ppSurface, mfxU32 nTimeout) {
+    MSDK_CHECK_POINTER(ppSurface, MFX_ERR_NULL_PTR);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    MSDK_CHECK_POINTER(m_pSurfaces, MFX_ERR_NOT_INITIALIZED);
+
+    m_nRequests++;
+
+    mfxFrameSurfaceWrap* pSurface = PopFreeSurfaceUnsafe();
+    if (!pSurface) {
+        ReclaimUnsafe();
+        pSurface = PopFreeSurfaceUnsafe();
+    }
+
+    if (!pSurface) {
+        CTimer timer;
+        timer.Start();
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(nTimeout);
+        while (!pSurface) {
+            // woken up by ReleaseReference or Reclaim
+            if (!m_cv.wait_until(lock, deadline, [this] {
+                    return !m_freeQueue.empty();
+                }))
+                break;
+
+            pSurface = PopFreeSurfaceUnsafe();
+        }
+
+        if (m_bCollectStatistics) {
+            mfxF64 waitTime = timer.GetTime();
+
+            m_nWaits++;
+            m_totalWaitTime += waitTime;
+            if (waitTime > m_maxWaitTime)
+                m_maxWaitTime = waitTime;
+            if (!pSurface)
+                m_nTimeouts++;
+        }
+    }
+
+    if (!pSurface)
+        return MFX_ERR_NOT_ENOUGH_BUFFER;
+
+    *ppSurface = pSurface;
+    return MFX_ERR_NONE;
+}
+
+bool CVPPSurfacePool::HasFreeSurface() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    ReclaimUnsafe();
+    for (mfxU16 index : m_freeQueue) {
+        if (0 == m_pSurfaces[index].Data.Locked)
+            return true;
+    }
+    return false;
+}
+
+void CVPPSurfacePool::AddReference(mfxFrameSurfaceWrap* pSurface) {
+    msdk_atomic_inc16((volatile mfxU16*)&pSurface->Data.Locked);
+}
+
+void CVPPSurfacePool::ReleaseReference(mfxFrameSurfaceWrap* pSurface) {
+    msdk_atomic_dec16((volatile mfxU16*)&pSurface->Data.Locked);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    mfxU16 index = GetIndex(pSurface);
+    if (MSDK_INVALID_SURF_IDX == index || m_isQueued[index] || pSurface->Data.Locked)
+        return;
+
+    m_freeQueue.push_back(index);
+    m_isQueued[index] = true;
+    m_cv.notify_one();
+}
+
+void CVPPSurfacePool::Reclaim() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_pSurfaces)
+        return;
+
+    ReclaimUnsafe();
+    if (!m_freeQueue.empty())
+        m_cv.notify_all();
+}
+
+void CVPPSurfacePool::PrintStatistics(const msdk_char* strName) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_bCollectStatistics)
+        return;
+
+    msdk_printf(MSDK_STRING("%s surface pool: %u surfaces, %llu requests, %llu waits (%.2f%%), "
+                            "%llu timeouts\n"),
+                strName,
+                (unsigned)m_nPoolSize,
+                (unsigned long long)m_nRequests,
+                (unsigned long long)m_nWaits,
+                m_nRequests ? 100.0 * m_nWaits / m_nRequests : 0.0,
+                (unsigned long long)m_nTimeouts);
+    msdk_printf(MSDK_STRING("%s surface pool: total wait %.3f ms, avg wait %.3f ms, "
+                            "max wait %.3f ms\n"),
+                strName,
+                m_totalWaitTime * 1000,
+                m_nWaits ? m_totalWaitTime * 1000 / m_nWaits : 0.0,
+                m_maxWaitTime * 1000);
+}
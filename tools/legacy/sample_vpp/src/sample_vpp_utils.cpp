@@ -472,7 +472,8 @@ mfxStatus InitFrameProcessor(sFrameProcessor* pProcessor, mfxVideoParam* pParams
 mfxStatus InitSurfaces(sMemoryAllocator* pAllocator,
                        mfxFrameAllocRequest* pRequest,
                        bool isInput,
-                       int streamIndex) {
+                       int streamIndex,
+                       bool bSurfacePoolStat) {
     mfxStatus sts = MFX_ERR_NONE;
     mfxU16 nFrames, i;
 
@@ -480,6 +481,8 @@ mfxStatus InitSurfaces(sMemoryAllocator* pAllocator,
         isInput ? pAllocator->responseIn[streamIndex] : pAllocator->responseOut;
     mfxFrameSurfaceWrap*& pSurfaces =
         isInput ? pAllocator->pSurfacesIn[streamIndex] : pAllocator->pSurfacesOut;
+    CVPPSurfacePool& surfacePool =
+        isInput ? pAllocator->surfacePoolIn[streamIndex] : pAllocator->surfacePoolOut;
 
     sts = pAllocator->pMfxAllocator->Alloc(pAllocator->pMfxAllocator->pthis, pRequest, &response);
     MSDK_CHECK_STATUS_SAFE(sts, "pAllocator->pMfxAllocator->Alloc failed", {
@@ -494,6 +497,9 @@ mfxStatus InitSurfaces(sMemoryAllocator* pAllocator,
         pSurfaces[i].Data.MemId = response.mids[i];
     }
 
+    sts = surfacePool.Init(pSurfaces, nFrames, bSurfacePoolStat);
+    MSDK_CHECK_STATUS(sts, "surfacePool.Init failed");
+
     return sts;
 }
 
@@ -662,7 +668,7 @@ mfxStatus InitMemoryAllocator(sFrameProcessor* pProcessor,
     // If we have only one input stream - allocate as many surfaces as were requested. Otherwise (in case of composition) - allocate 1 surface per input
     // Modify frame info as well
     if (pInParams->compositionParam.mode != VPP_FILTER_ENABLED_CONFIGURED) {
-        sts = InitSurfaces(pAllocator, &(request[VPP_IN]), true, 0);
+        sts = InitSurfaces(pAllocator, &(request[VPP_IN]), true, 0, pInParams->bSurfacePoolStat);
         MSDK_CHECK_STATUS_SAFE(sts, "InitSurfaces failed", WipeMemoryAllocator(pAllocator));
     }
     else {
@@ -670,13 +676,17 @@ mfxStatus InitMemoryAllocator(sFrameProcessor* pProcessor,
             ownToMfxFrameInfo(&pInParams->inFrameInfo[i], &request[VPP_IN].Info, true);
             request[VPP_IN].NumFrameSuggested = 1;
             request[VPP_IN].NumFrameMin       = request[VPP_IN].NumFrameSuggested;
-            sts = InitSurfaces(pAllocator, &(request[VPP_IN]), true, i);
+            sts = InitSurfaces(pAllocator,
+                               &(request[VPP_IN]),
+                               true,
+                               i,
+                               pInParams->bSurfacePoolStat);
             MSDK_CHECK_STATUS_SAFE(sts, "InitSurfaces failed", WipeMemoryAllocator(pAllocator));
         }
     }
 
     // [OUT]
-    sts = InitSurfaces(pAllocator, &(request[VPP_OUT]), false, 0);
+    sts = InitSurfaces(pAllocator, &(request[VPP_OUT]), false, 0, pInParams->bSurfacePoolStat);
     MSDK_CHECK_STATUS_SAFE(sts, "InitSurfaces failed", WipeMemoryAllocator(pAllocator));
 
     return MFX_ERR_NONE;
@@ -732,9 +742,11 @@ void WipeMemoryAllocator(sMemoryAllocator* pAllocator) {
     MSDK_CHECK_POINTER_NO_RET(pAllocator);
 
     for (int i = 0; i < MAX_INPUT_STREAMS; i++) {
+        pAllocator->surfacePoolIn[i].Close();
         MSDK_SAFE_DELETE_ARRAY(pAllocator->pSurfacesIn[i]);
     }
     //    MSDK_SAFE_DELETE_ARRAY(pAllocator->pSurfaces[VPP_IN_RGB]);
+    pAllocator->surfacePoolOut.Close();
     MSDK_SAFE_DELETE_ARRAY(pAllocator->pSurfacesOut);
 
     mfxU32 did;
@@ -818,10 +830,9 @@ void WipeParams(sInputParams* pParams) {
 
 CRawVideoReader::CRawVideoReader()
         : m_fSrc(NULL),
-          m_it(),
           m_SurfacesList(),
+          m_PreloadLoop(),
           m_isPerfMode(false),
-          m_Repeat(0),
           m_pPTSMaker(NULL),
           m_initFcc(0) {}
 
@@ -1275,9 +1286,7 @@ mfxStatus CRawVideoReader::GetNextInputFrame(sMemoryAllocator* pAllocator,
                                              mfxU16 streamIndex) {
     mfxStatus sts;
     if (!m_isPerfMode) {
-        sts = GetFreeSurface(pAllocator->pSurfacesIn[streamIndex],
-                             pAllocator->responseIn[streamIndex].NumFrameActual,
-                             pSurface);
+        sts = pAllocator->surfacePoolIn[streamIndex].GetFreeSurface(pSurface);
         MSDK_CHECK_STATUS(sts, "GetFreeSurface failed");
 
         mfxFrameSurfaceWrap* pCurSurf = *pSurface;
@@ -1313,18 +1322,17 @@ mfxStatus CRawVideoReader::GetNextInputFrame(sMemoryAllocator* pAllocator,
 }
 
 mfxStatus CRawVideoReader::GetPreAllocFrame(mfxFrameSurfaceWrap** pSurface) {
-    if (m_it == m_SurfacesList.end()) {
-        m_Repeat--;
-        m_it = m_SurfacesList.begin();
-    }
+    mfxU32 index  = 0;
+    mfxStatus sts = m_PreloadLoop.Peek(index);
+    if (MFX_ERR_NONE != sts)
+        return sts;
 
-    if (m_it->Data.Locked)
+    // the loop moves on only when the frame is handed out, so a retry gets the same frame
+    if (m_SurfacesList[index].Data.Locked)
         return MFX_ERR_ABORTED;
 
-    *pSurface = &(*m_it);
-    m_it++;
-    if (0 == m_Repeat)
-        return MFX_ERR_MORE_DATA;
+    m_PreloadLoop.Next(index);
+    *pSurface = &m_SurfacesList[index];
 
     return MFX_ERR_NONE;
 }
@@ -1337,7 +1345,6 @@ mfxStatus CRawVideoReader::PreAllocateFrameChunk(mfxVideoParam* pVideoParam,
     mfxFrameAllocResponse response;
     mfxFrameSurfaceWrap surface;
     m_isPerfMode = true;
-    m_Repeat     = pParams->numRepeat;
     request.Info = pVideoParam->vpp.In;
     request.Type =
         (pParams->IOPattern & MFX_IOPATTERN_IN_VIDEO_MEMORY)
@@ -1360,7 +1367,7 @@ mfxStatus CRawVideoReader::PreAllocateFrameChunk(mfxVideoParam* pVideoParam,
         MFX_CHECK_STS(sts);
         m_SurfacesList.push_back(surface);
     }
-    m_it = m_SurfacesList.begin();
+    m_PreloadLoop.Init((mfxU32)m_SurfacesList.size(), pParams->numRepeat);
     return MFX_ERR_NONE;
 }
 /* ******************************************************************* */
@@ -1994,34 +2001,6 @@ mfxStatus UpdateSurfacePool(mfxFrameInfo SurfacesInfo,
     return MFX_ERR_NONE;
 }
 
-mfxStatus GetFreeSurface(mfxFrameSurfaceWrap* pSurfacesPool,
-                         mfxU16 nPoolSize,
-                         mfxFrameSurfaceWrap** ppSurface) {
-    MSDK_CHECK_POINTER(pSurfacesPool, MFX_ERR_NULL_PTR);
-    MSDK_CHECK_POINTER(ppSurface, MFX_ERR_NULL_PTR);
-
-    mfxU32 timeToSleep = 10; // milliseconds
-    mfxU32 numSleeps   = MSDK_SURFACE_WAIT_INTERVAL / timeToSleep + 1; // at least 1
-
-    mfxU32 i = 0;
-
-    //wait if there's no free surface
-    while ((MSDK_INVALID_SURF_IDX == GetFreeSurfaceIndex(pSurfacesPool, nPoolSize)) &&
-           (i < numSleeps)) {
-        MSDK_SLEEP(timeToSleep);
-        i++;
-    }
-
-    mfxU16 index = GetFreeSurfaceIndex(pSurfacesPool, nPoolSize);
-
-    if (index < nPoolSize) {
-        *ppSurface = &(pSurfacesPool[index]);
-        return MFX_ERR_NONE;
-    }
-
-    return MFX_ERR_NOT_ENOUGH_BUFFER;
-}
-
 //---------------------------------------------------------
 
 void PrintDllInfo() {